@@ -31,6 +31,8 @@ static int			interopBufferInSize;
 static byte*		interopBufferOut;
 static int			interopBufferOutSize;
 
+static snapshotRing_t*	snapshotRing;
+
 
 static void CL_CallVote_f()
 {
@@ -104,36 +106,37 @@ static void CL_GetCurrentSnapshotNumber( int* snapshotNumber, int* serverTime )
 }
 
 
-static qbool CL_GetSnapshot( int snapshotNumber, snapshot_t* snapshot )
+static const clSnapshot_t* CL_FindSnapshot( int snapshotNumber )
 {
-	if ( clc.newDemoPlayer ) {
-		return CL_NDP_GetSnapshot( snapshotNumber, snapshot );
-	}
-
-	int i, count;
-
 	if ( snapshotNumber > cl.snap.messageNum ) {
 		Com_Error( ERR_DROP, "CL_GetSnapshot: snapshotNumber > cl.snapshot.messageNum" );
 	}
 
 	// if the frame has fallen out of the circular buffer, we can't return it
 	if ( cl.snap.messageNum - snapshotNumber >= PACKET_BACKUP ) {
-		return qfalse;
+		return NULL;
 	}
 
 	// if the frame is not valid, we can't return it
-	clSnapshot_t* clSnap = &cl.snapshots[snapshotNumber & PACKET_MASK];
+	const clSnapshot_t* clSnap = &cl.snapshots[snapshotNumber & PACKET_MASK];
 	if ( !clSnap->valid ) {
-		return qfalse;
+		return NULL;
 	}
 
 	// if the entities in the frame have fallen out of their
 	// circular buffer, we can't return it
 	if ( cl.parseEntitiesNum - clSnap->parseEntitiesNum >= MAX_PARSE_ENTITIES ) {
-		return qfalse;
+		return NULL;
 	}
 
-	// write the snapshot
+	return clSnap;
+}
+
+
+static void CL_WriteSnapshot( const clSnapshot_t* clSnap, snapshot_t* snapshot )
+{
+	int i, count;
+
 	snapshot->snapFlags = clSnap->snapFlags;
 	snapshot->serverCommandSequence = clSnap->serverCommandNum;
 	snapshot->ping = clSnap->ping;
@@ -151,11 +154,98 @@ static qbool CL_GetSnapshot( int snapshotNumber, snapshot_t* snapshot )
 	}
 
 	// FIXME: configstring changes and server commands!!!
+}
+
+
+static qbool CL_GetSnapshot( int snapshotNumber, snapshot_t* snapshot )
+{
+	if ( clc.newDemoPlayer ) {
+		return CL_NDP_GetSnapshot( snapshotNumber, snapshot, qtrue );
+	}
+
+	const clSnapshot_t* const clSnap = CL_FindSnapshot( snapshotNumber );
+	if ( !clSnap ) {
+		return qfalse;
+	}
+
+	CL_WriteSnapshot( clSnap, snapshot );
 
 	return qtrue;
 }
 
 
+static void CL_LocateSnapshotRing( void* ring, int ringSize )
+{
+	snapshotRing = NULL;
+	if ( ring == NULL ) {
+		return;
+	}
+
+	if ( ringSize != sizeof(snapshotRing_t) ) {
+		Com_Error( ERR_DROP, "trap_LocateSnapshotRing: snapshot ring size mismatch" );
+	}
+
+	// the whole ring must be inside the QVM's data segment
+	if ( !cgvm->entryPoint && (byte*)ring - cgvm->dataBase + ringSize > cgvm->dataMask + 1 ) {
+		Com_Error( ERR_DROP, "trap_LocateSnapshotRing: snapshot ring out of bounds" );
+	}
+
+	// older snapshots can't be requested, so slots are never needed again when reused
+	COMPILE_TIME_ASSERT( SNAPSHOT_RING_SIZE == PACKET_BACKUP );
+
+	snapshotRing = (snapshotRing_t*)ring;
+	CL_CG_InvalidateSnapshotRing();
+}
+
+
+void CL_CG_InvalidateSnapshotRing()
+{
+	if ( snapshotRing == NULL ) {
+		return;
+	}
+
+	for ( int i = 0; i < SNAPSHOT_RING_SIZE; ++i ) {
+		snapshotRing->snapshotNumbers[i] = -1;
+	}
+}
+
+
+// returns the ring slot holding the snapshot or -1 when it's not available
+// the data is only copied when it isn't in the ring already
+static int CL_GetSnapshotSlot( int snapshotNumber )
+{
+	if ( snapshotRing == NULL ) {
+		Com_Error( ERR_DROP, "trap_GetSnapshotSlot: no snapshot ring located" );
+	}
+
+	const int slot = snapshotNumber & SNAPSHOT_RING_MASK;
+	const qbool inRing = snapshotRing->snapshotNumbers[slot] == snapshotNumber;
+	snapshot_t* const snapshot = &snapshotRing->snapshots[slot];
+
+	if ( clc.newDemoPlayer ) {
+		snapshotRing->snapshotNumbers[slot] = -1;
+		if ( !CL_NDP_GetSnapshot( snapshotNumber, snapshot, !inRing ) ) {
+			return -1;
+		}
+		snapshotRing->snapshotNumbers[slot] = snapshotNumber;
+		return slot;
+	}
+
+	// a slot written earlier is only valid while the client still has the snapshot
+	const clSnapshot_t* const clSnap = CL_FindSnapshot( snapshotNumber );
+	if ( !clSnap ) {
+		return -1;
+	}
+
+	if ( !inRing ) {
+		CL_WriteSnapshot( clSnap, snapshot );
+		snapshotRing->snapshotNumbers[slot] = snapshotNumber;
+	}
+
+	return slot;
+}
+
+
 static void CL_SetUserCmdValue( int userCmdValue, float sensitivityScale )
 {
 	cl.cgameUserCmdValue = userCmdValue;
@@ -313,6 +403,7 @@ rescan:
 static void CL_CM_LoadMap( const char* mapname )
 {
 	unsigned checksum;
+	Hunk_ConsumerScope scope( HC_COLLISION );
 	CM_LoadMap( mapname, qtrue, &checksum );
 }
 
@@ -323,12 +414,13 @@ void CL_ShutdownCGame()
 	cls.keyCatchers &= ~KEYCATCH_CGAME;
 	cls.cgameStarted = qfalse;
 	cls.cgameForwardInput = 0;
+	snapshotRing = NULL;
 	CL_MapDownload_Cancel();
 	Cmd_UnregisterArray( cl_cmds );
 	if ( !cgvm ) {
 		return;
 	}
-	VM_Call( cgvm, CG_SHUTDOWN );
+	VM_Call0( cgvm, CG_SHUTDOWN );
 	VM_Free( cgvm );
 	cgvm = NULL;
 	Cmd_UnregisterModule( MODULE_CGAME );
@@ -356,6 +448,8 @@ static qbool CL_CG_GetValue( char* value, int valueSize, const char* key )
 		{ "trap_CNQ3_NDP_StartVideo", CG_EXT_NDP_STARTVIDEO },
 		{ "trap_CNQ3_NDP_StopVideo", CG_EXT_NDP_STOPVIDEO },
 		{ "trap_CNQ3_R_RenderScene", CG_EXT_R_RENDERSCENE },
+		{ "trap_LocateSnapshotRing", CG_EXT_LOCATESNAPSHOTRING },
+		{ "trap_GetSnapshotSlot", CG_EXT_GETSNAPSHOTSLOT },
 		// commands
 		{ "screenshotnc", 1 },
 		{ "screenshotncJPEG", 1 },
@@ -736,6 +830,13 @@ static intptr_t CL_CgameSystemCalls( intptr_t *args )
 		re.RenderScene( VMA(1), args[2] );
 		return 0;
 
+	case CG_EXT_LOCATESNAPSHOTRING:
+		CL_LocateSnapshotRing( VMA(1), args[2] );
+		return 0;
+
+	case CG_EXT_GETSNAPSHOTSLOT:
+		return CL_GetSnapshotSlot( args[1] );
+
 	default:
 		Com_Error( ERR_DROP, "Bad cgame system trap: %i", args[0] );
 	}
@@ -766,12 +867,28 @@ void CL_DisableFramerateLimiter()
 }
 
 
+static const vmPureTrap_t cl_cgamePureTraps[] = {
+	{ CG_MEMSET, VMPT_MEMSET },
+	{ CG_MEMCPY, VMPT_MEMCPY },
+	{ CG_STRNCPY, VMPT_STRNCPY },
+	{ CG_SIN, VMPT_SIN },
+	{ CG_COS, VMPT_COS },
+	{ CG_ATAN2, VMPT_ATAN2 },
+	{ CG_SQRT, VMPT_SQRT },
+	{ CG_FLOOR, VMPT_FLOOR },
+	{ CG_CEIL, VMPT_CEIL },
+	{ CG_ACOS, VMPT_ACOS }
+};
+
+
 void CL_InitCGame()
 {
+	Prof_Scope profScope( "CL_InitCGame" );
 	int t = Sys_Milliseconds();
 
 	cls.cgameForwardInput = 0;
 	cls.cgameNewDemoPlayer = qfalse;
+	snapshotRing = NULL;
 
 	// put away the console
 	Con_Close();
@@ -784,7 +901,7 @@ void CL_InitCGame()
 	// if sv_pure is set we only allow qvms to be loaded
 	const vmInterpret_t interpret = cl_connectedToPureServer ? VMI_COMPILED : (vmInterpret_t)Cvar_VariableIntegerValue( "vm_cgame" );
 
-	cgvm = VM_Create( VM_CGAME, CL_CgameSystemCalls, interpret );
+	cgvm = VM_Create( VM_CGAME, CL_CgameSystemCalls, cl_cgamePureTraps, ARRAY_LEN( cl_cgamePureTraps ), interpret );
 	if ( !cgvm ) {
 		Com_Error( ERR_DROP, "VM_Create on cgame failed" );
 	}
@@ -796,7 +913,7 @@ void CL_InitCGame()
 	// use the lastExecutedServerCommand instead of the serverCommandSequence
 	// otherwise server commands sent just before a gamestate are dropped
 	CL_SetMaxFPS( 20 );
-	VM_Call( cgvm, CG_INIT, clc.serverMessageSequence, clc.lastExecutedServerCommand, clc.clientNum );
+	VM_Call3( cgvm, CG_INIT, clc.serverMessageSequence, clc.lastExecutedServerCommand, clc.clientNum );
 	CL_SetMaxFPS( 0 );
 
 	// send a usercmd this frame, which will cause the server to send us the first snapshot
@@ -822,13 +939,13 @@ void CL_InitCGame()
 
 qbool CL_GameCommand()
 {
-	return (cgvm && VM_Call( cgvm, CG_CONSOLE_COMMAND ));
+	return (cgvm && VM_Call0( cgvm, CG_CONSOLE_COMMAND ));
 }
 
 
 void CL_CGameRendering( stereoFrame_t stereo )
 {
-	VM_Call( cgvm, CG_DRAW_ACTIVE_FRAME, cl.serverTime, stereo, clc.demoplaying );
+	VM_Call3( cgvm, CG_DRAW_ACTIVE_FRAME, cl.serverTime, stereo, clc.demoplaying );
 }
 
 
@@ -1036,7 +1153,7 @@ void CL_SetCGameTime()
 void CL_CGNDP_AnalyzeCommand( int serverTime )
 {
 	Q_assert(cls.cgameNewDemoPlayer);
-	VM_Call(cgvm, cls.cgvmCalls[CGVM_NDP_ANALYZE_COMMAND], serverTime);
+	VM_Call1(cgvm, cls.cgvmCalls[CGVM_NDP_ANALYZE_COMMAND], serverTime);
 }
 
 
@@ -1045,7 +1162,7 @@ void CL_CGNDP_GenerateCommands( const char** commands, int* numCommandBytes )
 	Q_assert(cls.cgameNewDemoPlayer);
 	Q_assert(commands);
 	Q_assert(numCommandBytes);
-	VM_Call(cgvm, cls.cgvmCalls[CGVM_NDP_GENERATE_COMMANDS]);
+	VM_Call0(cgvm, cls.cgvmCalls[CGVM_NDP_GENERATE_COMMANDS]);
 	*numCommandBytes = *(int*)interopBufferIn;
 	*commands = (const char*)interopBufferIn + 4;
 }
@@ -1055,7 +1172,7 @@ qbool CL_CGNDP_IsConfigStringNeeded( int csIndex )
 {
 	Q_assert(cls.cgameNewDemoPlayer);
 	Q_assert(csIndex >= 0 && csIndex < MAX_CONFIGSTRINGS);
-	return (qbool)VM_Call(cgvm, cls.cgvmCalls[CGVM_NDP_IS_CS_NEEDED], csIndex);
+	return (qbool)VM_Call1(cgvm, cls.cgvmCalls[CGVM_NDP_IS_CS_NEEDED], csIndex);
 }
 
 
@@ -1063,7 +1180,7 @@ void CL_CGNDP_AnalyzeSnapshot( int progress )
 {
 	Q_assert(cls.cgameNewDemoPlayer);
 	Q_assert(progress >= 0 && progress < 100);
-	VM_Call(cgvm, cls.cgvmCalls[CGVM_NDP_ANALYZE_SNAPSHOT], progress);
+	VM_Call1(cgvm, cls.cgvmCalls[CGVM_NDP_ANALYZE_SNAPSHOT], progress);
 }
 
 
@@ -1072,5 +1189,5 @@ void CL_CGNDP_EndAnalysis( const char* filePath, int firstServerTime, int lastSe
 	Q_assert(cls.cgameNewDemoPlayer);
 	Q_assert(lastServerTime > firstServerTime);
 	Q_strncpyz((char*)interopBufferOut, filePath, interopBufferOutSize);
-	VM_Call(cgvm, cls.cgvmCalls[CGVM_NDP_END_ANALYSIS], firstServerTime, lastServerTime, videoRestart);
+	VM_Call3(cgvm, cls.cgvmCalls[CGVM_NDP_END_ANALYSIS], firstServerTime, lastServerTime, videoRestart);
 }
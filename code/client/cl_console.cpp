@@ -239,7 +239,7 @@ void Con_ToggleMenu_f( void ) {
 	}
 	menu = atoi( Cmd_Argv(1) );
 	if ( menu >= 0 ) {
-		VM_Call( uivm, UI_SET_ACTIVE_MENU, menu );
+		VM_Call1( uivm, UI_SET_ACTIVE_MENU, menu );
 	}
 }
 #endif
@@ -277,7 +277,7 @@ Con_MessageMode3_f
 ================
 */
 void Con_MessageMode3_f (void) {
-	chat_playerNum = VM_Call( cgvm, CG_CROSSHAIR_PLAYER );
+	chat_playerNum = VM_Call0( cgvm, CG_CROSSHAIR_PLAYER );
 	if ( chat_playerNum < 0 || chat_playerNum >= MAX_CLIENTS ) {
 		chat_playerNum = -1;
 		return;
@@ -294,7 +294,7 @@ Con_MessageMode4_f
 ================
 */
 void Con_MessageMode4_f (void) {
-	chat_playerNum = VM_Call( cgvm, CG_LAST_ATTACKER );
+	chat_playerNum = VM_Call0( cgvm, CG_LAST_ATTACKER );
 	if ( chat_playerNum < 0 || chat_playerNum >= MAX_CLIENTS ) {
 		chat_playerNum = -1;
 		return;
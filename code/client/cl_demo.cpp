@@ -969,6 +969,7 @@ static void SeekToIndex( int seekIndex )
 	ReadNextSnapshot(); // 1st in next, ??? in current
 	ReadNextSnapshot(); // 2nd in next, 1st in current
 	demo.snapshotIndex = demoIndex->snapshotIndex;
+	CL_CG_InvalidateSnapshotRing(); // the snapshot numbers are about to be reused
 
 	ndpSnapshot_t* syncSnap = demo.currSnap;
 	if (!demo.currSnap->isFullSnap) {
@@ -1073,7 +1074,7 @@ void CL_NDP_GetCurrentSnapshotNumber( int* snapshotNumber, int* serverTime )
 }
 
 
-qbool CL_NDP_GetSnapshot( int snapshotNumber, snapshot_t* snapshot )
+qbool CL_NDP_GetSnapshot( int snapshotNumber, snapshot_t* snapshot, qbool copyData )
 {
 	// we don't give anything until CGame init is done
 	if (!cls.cgameStarted || cls.state != CA_ACTIVE) {
@@ -1094,19 +1095,22 @@ qbool CL_NDP_GetSnapshot( int snapshotNumber, snapshot_t* snapshot )
 
 	ndpSnapshot_t* const ndpSnap = snapshotNumber == playbackIndex ? demo.currSnap : demo.nextSnap;
 
-	Com_Memcpy(snapshot->areamask, ndpSnap->areaMask, sizeof(snapshot->areamask));
-	Com_Memcpy(&snapshot->ps, &ndpSnap->ps, sizeof(snapshot->ps));
-	snapshot->snapFlags = 0;
-	snapshot->ping = 0;
-	snapshot->numServerCommands = 0;
+	// the commands are queued on every request, but the snapshot ring can already hold the data
 	snapshot->serverCommandSequence = demo.numCommands;
-	snapshot->serverTime = ndpSnap->serverTime;
-	snapshot->numEntities = 0;
-
-	// copy over all valid entities
-	for (int i = 0; i < MAX_GENTITIES - 1 && snapshot->numEntities < MAX_ENTITIES_IN_SNAPSHOT; ++i) {
-		if (ndpSnap->entities[i].number == i) {
-			snapshot->entities[snapshot->numEntities++] = ndpSnap->entities[i];
+	if (copyData) {
+		Com_Memcpy(snapshot->areamask, ndpSnap->areaMask, sizeof(snapshot->areamask));
+		Com_Memcpy(&snapshot->ps, &ndpSnap->ps, sizeof(snapshot->ps));
+		snapshot->snapFlags = 0;
+		snapshot->ping = 0;
+		snapshot->numServerCommands = 0;
+		snapshot->serverTime = ndpSnap->serverTime;
+		snapshot->numEntities = 0;
+
+		// copy over all valid entities
+		for (int i = 0; i < MAX_GENTITIES - 1 && snapshot->numEntities < MAX_ENTITIES_IN_SNAPSHOT; ++i) {
+			if (ndpSnap->entities[i].number == i) {
+				snapshot->entities[snapshot->numEntities++] = ndpSnap->entities[i];
+			}
 		}
 	}
 
@@ -296,12 +296,12 @@ void CL_MouseEvent( int dx, int dy, int time )
 		return;
 
 	if ( cls.keyCatchers & KEYCATCH_UI ) {
-		VM_Call( uivm, UI_MOUSE_EVENT, dx, dy );
+		VM_Call2( uivm, UI_MOUSE_EVENT, dx, dy );
 	} else if (cls.keyCatchers & KEYCATCH_CGAME) {
-		VM_Call( cgvm, CG_MOUSE_EVENT, dx, dy );
+		VM_Call2( cgvm, CG_MOUSE_EVENT, dx, dy );
 	} else {
 		if ( cgvm && (cls.cgameForwardInput & 1) )
-			VM_Call( cgvm, CG_MOUSE_EVENT, dx, dy );
+			VM_Call2( cgvm, CG_MOUSE_EVENT, dx, dy );
 		cl.mouseDx[cl.mouseIndex] += dx;
 		cl.mouseDy[cl.mouseIndex] += dy;
 		cl.mouseTime = time;
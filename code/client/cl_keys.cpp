@@ -1105,22 +1105,22 @@ void CL_KeyEvent( int key, qbool down, unsigned time )
 		// escape always gets out of CGAME stuff
 		if (cls.keyCatchers & KEYCATCH_CGAME) {
 			cls.keyCatchers &= ~KEYCATCH_CGAME;
-			VM_Call( cgvm, CG_EVENT_HANDLING, CGAME_EVENT_NONE );
+			VM_Call1( cgvm, CG_EVENT_HANDLING, CGAME_EVENT_NONE );
 			return;
 		}
 
 		if (cls.keyCatchers & KEYCATCH_UI) {
-			VM_Call( uivm, UI_KEY_EVENT, key, down );
+			VM_Call2( uivm, UI_KEY_EVENT, key, down );
 			return;
 		}
 
 		if ( cls.state == CA_ACTIVE && !clc.demoplaying ) {
-			VM_Call( uivm, UI_SET_ACTIVE_MENU, UIMENU_INGAME );
+			VM_Call1( uivm, UI_SET_ACTIVE_MENU, UIMENU_INGAME );
 		}
 		else if ( !clc.demoplaying || cl_escapeAbortsDemo->integer ) {
 			CL_Disconnect_f();
 			S_StopAllSounds();
-			VM_Call( uivm, UI_SET_ACTIVE_MENU, UIMENU_MAIN );
+			VM_Call1( uivm, UI_SET_ACTIVE_MENU, UIMENU_MAIN );
 		}
 		return;
 	}
@@ -1138,11 +1138,11 @@ void CL_KeyEvent( int key, qbool down, unsigned time )
 		CL_AddKeyUpCommands( key, kb, time );
 
 		if ( (cls.keyCatchers & KEYCATCH_UI) && uivm ) {
-			VM_Call( uivm, UI_KEY_EVENT, key, down );
+			VM_Call2( uivm, UI_KEY_EVENT, key, down );
 		} else if ( (cls.keyCatchers & KEYCATCH_CGAME) && cgvm ) {
-			VM_Call( cgvm, CG_KEY_EVENT, key, down );
+			VM_Call2( cgvm, CG_KEY_EVENT, key, down );
 		} else if ( (cls.cgameForwardInput & 2) && cgvm ) {
-			VM_Call( cgvm, CG_KEY_EVENT, key, down );
+			VM_Call2( cgvm, CG_KEY_EVENT, key, down );
 		}
 
 		return;
@@ -1154,16 +1154,16 @@ void CL_KeyEvent( int key, qbool down, unsigned time )
 		Console_Key( key );
 	} else if ( cls.keyCatchers & KEYCATCH_UI ) {
 		if ( uivm ) {
-			VM_Call( uivm, UI_KEY_EVENT, key, down );
+			VM_Call2( uivm, UI_KEY_EVENT, key, down );
 		}
 	} else if ( cls.keyCatchers & KEYCATCH_CGAME ) {
 		if ( cgvm ) {
-			VM_Call( cgvm, CG_KEY_EVENT, key, down );
+			VM_Call2( cgvm, CG_KEY_EVENT, key, down );
 		}
 	} else if ( cls.keyCatchers & KEYCATCH_MESSAGE ) {
 		Message_Key( key );
 	} else if ( (cls.cgameForwardInput & 2) && cgvm ) {
-		VM_Call( cgvm, CG_KEY_EVENT, key, down );
+		VM_Call2( cgvm, CG_KEY_EVENT, key, down );
 	} else if ( cls.state == CA_DISCONNECTED ) {
 		Console_Key( key );
 	} else {
@@ -1236,7 +1236,7 @@ void CL_CharEvent( int key ) {
 	}
 	else if ( cls.keyCatchers & KEYCATCH_UI )
 	{
-		VM_Call( uivm, UI_KEY_EVENT, key | K_CHAR_FLAG, qtrue );
+		VM_Call2( uivm, UI_KEY_EVENT, key | K_CHAR_FLAG, qtrue );
 	}
 	else if ( cls.keyCatchers & KEYCATCH_MESSAGE )
 	{
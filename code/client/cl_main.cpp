@@ -748,7 +748,7 @@ void CL_Disconnect( qbool showMainMenu ) {
 	clc.demoplaying = qfalse;
 
 	if ( uivm && showMainMenu ) {
-		VM_Call( uivm, UI_SET_ACTIVE_MENU, UIMENU_NONE );
+		VM_Call1( uivm, UI_SET_ACTIVE_MENU, UIMENU_NONE );
 	}
 
 	SCR_StopCinematic ();
@@ -1584,6 +1584,8 @@ static void CL_CheckUserinfo()
 
 void CL_Frame( int msec )
 {
+	Prof_Scope profScope( "CL_Frame" );
+
 	if ( !com_cl_running->integer ) {
 		return;
 	}
@@ -1591,12 +1593,12 @@ void CL_Frame( int msec )
 	if ( cls.cddialog ) {
 		// bring up the cd error dialog if needed
 		cls.cddialog = qfalse;
-		VM_Call( uivm, UI_SET_ACTIVE_MENU, UIMENU_NEED_CD );
+		VM_Call1( uivm, UI_SET_ACTIVE_MENU, UIMENU_NEED_CD );
 	} else if ( cls.state == CA_DISCONNECTED && !( cls.keyCatchers & KEYCATCH_UI )
 		&& !com_sv_running->integer ) {
 		// if disconnected, bring up the menu
 		S_StopAllSounds();
-		VM_Call( uivm, UI_SET_ACTIVE_MENU, UIMENU_MAIN );
+		VM_Call1( uivm, UI_SET_ACTIVE_MENU, UIMENU_MAIN );
 	}
 
 	// if recording an avi, lock to a fixed fps
@@ -1761,6 +1763,21 @@ static void* CL_RefMalloc( int size )
 }
 
 
+#ifdef HUNK_DEBUG
+static void* CL_RefHunkAllocDebug( int size, ha_pref pref, char* label, char* file, int line )
+{
+	Hunk_ConsumerScope scope( HC_RENDERER );
+	return Hunk_AllocDebug( size, pref, label, file, line );
+}
+#else
+static void* CL_RefHunkAlloc( int size, ha_pref pref )
+{
+	Hunk_ConsumerScope scope( HC_RENDERER );
+	return Hunk_Alloc( size, pref );
+}
+#endif
+
+
 static void CL_ShutdownRef()
 {
 	if ( !re.Shutdown ) {
@@ -1805,15 +1822,18 @@ static void CL_InitRef()
 	ri.Malloc = CL_RefMalloc;
 	ri.Free = Z_Free;
 #ifdef HUNK_DEBUG
-	ri.Hunk_AllocDebug = Hunk_AllocDebug;
+	ri.Hunk_AllocDebug = CL_RefHunkAllocDebug;
 #else
-	ri.Hunk_Alloc = Hunk_Alloc;
+	ri.Hunk_Alloc = CL_RefHunkAlloc;
 #endif
 	ri.Hunk_AllocateTempMemory = Hunk_AllocateTempMemory;
 	ri.Hunk_FreeTempMemory = Hunk_FreeTempMemory;
 	ri.CM_DrawDebugSurface = CM_DrawDebugSurface;
 	ri.FS_ReadFile = FS_ReadFile;
 	ri.FS_ReadFilePak = FS_ReadFilePak;
+	ri.FS_ReadFileAsync = FS_ReadFileAsync;
+	ri.FS_FinishReadFile = FS_FinishReadFile;
+	ri.FS_CancelReadFile = FS_CancelReadFile;
 	ri.FS_FreeFile = FS_FreeFile;
 	ri.FS_WriteFile = FS_WriteFile;
 	ri.FS_FreeFileList = FS_FreeFileList;
@@ -320,7 +320,7 @@ static void SCR_DrawScreenField( stereoFrame_t stereoFrame )
 	}
 
 	// if the menu is going to cover the entire screen, we don't need to render anything under it
-	if ( !VM_Call( uivm, UI_IS_FULLSCREEN ) ) {
+	if ( !VM_Call0( uivm, UI_IS_FULLSCREEN ) ) {
 		switch ( cls.state ) {
 		default:
 			Com_Error( ERR_FATAL, "SCR_DrawScreenField: bad cls.state" );
@@ -331,15 +331,15 @@ static void SCR_DrawScreenField( stereoFrame_t stereoFrame )
 		case CA_DISCONNECTED:
 			// force menu up
 			S_StopAllSounds();
-			VM_Call( uivm, UI_SET_ACTIVE_MENU, UIMENU_MAIN );
+			VM_Call1( uivm, UI_SET_ACTIVE_MENU, UIMENU_MAIN );
 			break;
 		case CA_CONNECTING:
 		case CA_CHALLENGING:
 		case CA_CONNECTED:
 			// connecting clients will only show the connection dialog
 			// refresh to update the time
-			VM_Call( uivm, UI_REFRESH, cls.realtime );
-			VM_Call( uivm, UI_DRAW_CONNECT_SCREEN, qfalse );
+			VM_Call1( uivm, UI_REFRESH, cls.realtime );
+			VM_Call1( uivm, UI_DRAW_CONNECT_SCREEN, qfalse );
 			break;
 		case CA_LOADING:
 		case CA_PRIMED:
@@ -348,8 +348,8 @@ static void SCR_DrawScreenField( stereoFrame_t stereoFrame )
 			// also draw the connection information, so it doesn't
 			// flash away too briefly on local or lan games
 			// refresh to update the time
-			VM_Call( uivm, UI_REFRESH, cls.realtime );
-			VM_Call( uivm, UI_DRAW_CONNECT_SCREEN, qtrue );
+			VM_Call1( uivm, UI_REFRESH, cls.realtime );
+			VM_Call1( uivm, UI_DRAW_CONNECT_SCREEN, qtrue );
 			break;
 		case CA_ACTIVE:
 			CL_CGameRendering( stereoFrame );
@@ -360,7 +360,7 @@ static void SCR_DrawScreenField( stereoFrame_t stereoFrame )
 
 	// the menu draws next
 	if ( cls.keyCatchers & KEYCATCH_UI && uivm ) {
-		VM_Call( uivm, UI_REFRESH, cls.realtime );
+		VM_Call1( uivm, UI_REFRESH, cls.realtime );
 	}
 
 	SCR_DrawMouseInputLatencies();
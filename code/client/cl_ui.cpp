@@ -683,7 +683,7 @@ void Key_SetCatcher( int catcher ) {
 
 static qbool UI_usesUniqueCDKey()
 {
-	return (uivm && VM_Call( uivm, UI_HASUNIQUECDKEY ));
+	return (uivm && VM_Call0( uivm, UI_HASUNIQUECDKEY ));
 }
 
 
@@ -1175,12 +1175,25 @@ void CL_ShutdownUI()
 	if ( !uivm )
 		return;
 
-	VM_Call( uivm, UI_SHUTDOWN );
+	VM_Call0( uivm, UI_SHUTDOWN );
 	VM_Free( uivm );
 	uivm = NULL;
 }
 
 
+static const vmPureTrap_t cl_uiPureTraps[] = {
+	{ UI_MEMSET, VMPT_MEMSET },
+	{ UI_MEMCPY, VMPT_MEMCPY },
+	{ UI_STRNCPY, VMPT_STRNCPY },
+	{ UI_SIN, VMPT_SIN },
+	{ UI_COS, VMPT_COS },
+	{ UI_ATAN2, VMPT_ATAN2 },
+	{ UI_SQRT, VMPT_SQRT },
+	{ UI_FLOOR, VMPT_FLOOR },
+	{ UI_CEIL, VMPT_CEIL }
+};
+
+
 void CL_InitUI()
 {
 	// if sv_pure is set we only allow qvms to be loaded
@@ -1192,12 +1205,12 @@ void CL_InitUI()
 
 	//interpret = VMI_COMPILED;
 
-	uivm = VM_Create( VM_UI, CL_UISystemCalls, interpret );
+	uivm = VM_Create( VM_UI, CL_UISystemCalls, cl_uiPureTraps, ARRAY_LEN( cl_uiPureTraps ), interpret );
 	if ( !uivm )
 		Com_Error( ERR_FATAL, "VM_Create on UI failed" );
 
 	// currently-pointless sanity check caused by TA poison, sigh
-	int v = VM_Call( uivm, UI_GETAPIVERSION );
+	int v = VM_Call0( uivm, UI_GETAPIVERSION );
 	if (v != UI_API_VERSION) {
 		Com_Error( ERR_DROP, "User Interface is version %d, expected %d", v, UI_API_VERSION );
 		cls.uiStarted = qfalse;
@@ -1205,7 +1218,7 @@ void CL_InitUI()
 	}
 
 	// init for this gamestate
-	VM_Call( uivm, UI_INIT, (cls.state >= CA_AUTHORIZING && cls.state < CA_ACTIVE) );
+	VM_Call1( uivm, UI_INIT, (cls.state >= CA_AUTHORIZING && cls.state < CA_ACTIVE) );
 }
 
 
@@ -1215,7 +1228,7 @@ void CL_ForwardUIError( int level, int module, const char* error )
 		return;
 
 	Q_strncpyz( (char*)interopBufferOut, error, interopBufferOutSize );
-	VM_Call( uivm, cls.uivmCalls[UIVM_ERROR_CALLBACK], level, module );
+	VM_Call2( uivm, cls.uivmCalls[UIVM_ERROR_CALLBACK], level, module );
 }
 
 
@@ -1223,7 +1236,7 @@ void CL_ForwardUIError( int level, int module, const char* error )
 
 qbool UI_GameCommand()
 {
-	return (uivm && VM_Call( uivm, UI_CONSOLE_COMMAND, cls.realtime ));
+	return (uivm && VM_Call1( uivm, UI_CONSOLE_COMMAND, cls.realtime ));
 }
 
 
@@ -526,6 +526,7 @@ void CL_CGNDP_AnalyzeSnapshot( int progress );
 void CL_CGNDP_AnalyzeCommand( int serverTime );
 void CL_CGNDP_GenerateCommands( const char** commands, int* numCommandBytes );
 qbool CL_CGNDP_IsConfigStringNeeded( int csIndex );
+void CL_CG_InvalidateSnapshotRing();
 
 //
 // cl_ui.c
@@ -582,7 +583,7 @@ void CL_GL_Init();			// enables debug output if needed
 void CL_NDP_PlayDemo( qbool videoRestart );
 void CL_NDP_SetCGameTime();
 void CL_NDP_GetCurrentSnapshotNumber( int* snapshotNumber, int* serverTime );
-qbool CL_NDP_GetSnapshot( int snapshotNumber, snapshot_t* snapshot );
+qbool CL_NDP_GetSnapshot( int snapshotNumber, snapshot_t* snapshot, qbool copyData );
 qbool CL_NDP_GetServerCommand( int serverCommandNumber );
 int CL_NDP_Seek( int serverTime );
 void CL_NDP_ReadUntil( int serverTime );
@@ -106,7 +106,7 @@ void S_CodecRegister( snd_codec_t* codec )
 }
 
 
-byte* S_CodecLoad( const char* filename, snd_info_t* info )
+static const snd_codec_t* S_FindCodecAndFileName( const char* filename, char* fn )
 {
 	const snd_codec_t* codec = S_FindCodecForFile( filename );
 	if (!codec)
@@ -115,13 +115,84 @@ byte* S_CodecLoad( const char* filename, snd_info_t* info )
 		return NULL;
 	}
 
+	Com_Memset( fn, 0, MAX_QPATH );
+
+	strncpy(fn, filename, MAX_QPATH-1);
+	COM_DefaultExtension(fn, MAX_QPATH, codec->ext);
+
+	return codec;
+}
+
+
+static byte* S_CodecLoadFromBuffer( const snd_codec_t* codec, const char* fn, void* data, int length, snd_info_t* info )
+{
+	if (!data)
+	{
+		Com_Printf( S_COLOR_RED "ERROR: Could not open \"%s\"\n", fn );
+		return NULL;
+	}
+
+	byte* const samples = codec->load(fn, (const byte*)data, length, info);
+	FS_FreeFile( data );
+
+	return samples;
+}
+
+
+byte* S_CodecLoad( const char* filename, snd_info_t* info )
+{
 	char fn[MAX_QPATH];
-	Com_Memset( &fn, 0, sizeof(fn) );
-	
-	strncpy(fn, filename, sizeof(fn)-1);
-	COM_DefaultExtension(fn, sizeof(fn), codec->ext);
+	const snd_codec_t* codec = S_FindCodecAndFileName( filename, fn );
+	if (!codec)
+		return NULL;
+
+	void* data;
+	const int length = FS_ReadFile( fn, &data );
+
+	return S_CodecLoadFromBuffer( codec, fn, data, length, info );
+}
+
+
+int S_CodecStartLoad( const char* filename )
+{
+	char fn[MAX_QPATH];
+	const snd_codec_t* codec = S_FindCodecAndFileName( filename, fn );
+	if (!codec)
+		return 0;
+
+	const int request = FS_ReadFileAsync( fn, NULL );
+	if (!request)
+		Com_Printf( S_COLOR_RED "ERROR: Could not open \"%s\"\n", fn );
+
+	return request;
+}
+
+
+byte* S_CodecFinishLoad( const char* filename, int request, snd_info_t* info )
+{
+	if (!info)
+	{
+		FS_CancelReadFile( request );
+		return NULL;
+	}
+
+	char fn[MAX_QPATH];
+	const snd_codec_t* codec = S_FindCodecAndFileName( filename, fn );
+	if (!codec)
+	{
+		FS_CancelReadFile( request );
+		return NULL;
+	}
+
+	void* data;
+	int length = FS_FinishReadFile( request, &data );
+	if (!data)
+	{
+		// the file system was restarted since
+		length = FS_ReadFile( fn, &data );
+	}
 
-	return (byte*)codec->load(fn, info);
+	return S_CodecLoadFromBuffer( codec, fn, data, length, info );
 }
 
 
@@ -50,7 +50,7 @@ typedef struct
 } snd_stream_t;
 
 // Codec functions
-typedef byte* (*CODEC_LOAD)(const char *filename, snd_info_t *info);
+typedef byte* (*CODEC_LOAD)(const char *filename, const byte *data, int length, snd_info_t *info);
 typedef snd_stream_t* (*CODEC_OPEN)(const char *filename);
 typedef int (*CODEC_READ)(snd_stream_t *stream, int bytes, void *buffer);
 typedef void (*CODEC_CLOSE)(snd_stream_t *stream);
@@ -71,6 +71,8 @@ void S_CodecInit();
 void S_CodecShutdown();
 void S_CodecRegister( snd_codec_t* codec );
 byte* S_CodecLoad( const char* filename, snd_info_t* info );
+int S_CodecStartLoad( const char* filename ); // returns a file system request, 0 on failure
+byte* S_CodecFinishLoad( const char* filename, int request, snd_info_t* info ); // a null info discards the request
 snd_stream_t* S_CodecOpenStream( const char* filename );
 void S_CodecCloseStream(snd_stream_t *stream);
 int S_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer);
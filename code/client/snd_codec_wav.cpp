@@ -139,32 +139,137 @@ static qbool S_ReadRIFFHeader( fileHandle_t f, snd_info_t* info )
 }
 
 
-static byte* S_WAV_CodecLoad( const char* filename, snd_info_t* info )
+// the same parsing as above for a file that was read whole
+
+typedef struct {
+	const byte*	data;
+	int			length;
+	int			pos;
+} wavBuffer_t;
+
+
+static qbool MGetBytes( wavBuffer_t* b, void* out, int count )
 {
-	fileHandle_t f;
-	FS_FOpenFileRead( filename, &f, qtrue );
-	if (!f) {
-		Com_Printf( S_COLOR_RED "ERROR: Could not open \"%s\"\n", filename );
-		return NULL;
+	if ( count > b->length - b->pos ) {
+		b->pos = b->length;
+		return qfalse;
+	}
+
+	Com_Memcpy( out, b->data + b->pos, count );
+	b->pos += count;
+	return qtrue;
+}
+
+
+static int MGetLittleLong( wavBuffer_t* b )
+{
+	int v = 0;
+	MGetBytes( b, &v, sizeof(v) );
+	return LittleLong(v);
+}
+
+
+static short MGetLittleShort( wavBuffer_t* b )
+{
+	short v = 0;
+	MGetBytes( b, &v, sizeof(v) );
+	return LittleShort(v);
+}
+
+
+static void MSkip( wavBuffer_t* b, int count )
+{
+	b->pos = ( count > b->length - b->pos ) ? b->length : b->pos + count;
+}
+
+
+static int S_FindRIFFChunkInBuffer( wavBuffer_t* b, const char* chunkname )
+{
+	char name[4];
+
+	while ( MGetBytes( b, name, 4 ) )
+	{
+		const int len = MGetLittleLong( b );
+		if ( len < 0 ) {
+			Com_Printf( S_COLOR_YELLOW "WARNING: Negative chunk length\n" );
+			return -1;
+		}
+		if ( !memcmp( name, chunkname, 4 ) )
+			return len;
+		// not the right chunk - skip it
+		MSkip( b, PAD( len, 2 ) );
+	}
+
+	return -1;
+}
+
+
+static qbool S_ParseRIFFHeader( wavBuffer_t* b, snd_info_t* info )
+{
+	// skip the riff wav header
+	MSkip( b, 12 );
+
+	// scan for the format chunk
+	int fmtlen;
+	if ((fmtlen = S_FindRIFFChunkInBuffer(b, "fmt ")) < 0) {
+		Com_Printf( S_COLOR_RED "ERROR: Couldn't find \"fmt\" chunk\n" );
+		return qfalse;
 	}
 
-	if (!S_ReadRIFFHeader( f, info )) {
-		FS_FCloseFile( f );
+	// save the parts of the RIFF data we care about
+	MGetLittleShort(b); // format (1: PCM)
+	info->channels = MGetLittleShort(b);
+	info->rate = MGetLittleLong(b);
+	MGetLittleLong(b); // byte rate
+	MGetLittleShort(b); // block align
+	int bits = MGetLittleShort(b);
+
+	if ( bits < 8 ) {
+		Com_Printf( S_COLOR_RED "ERROR: Less than 8 bit sound is not supported\n");
+		return qfalse;
+	}
+
+	info->width = bits / 8;
+	info->dataofs = 0;
+
+	// skip the rest of the format chunk if we need to
+	if (fmtlen > 16)
+		MSkip( b, fmtlen - 16 );
+
+	// scan for the data chunk
+	if ((info->size = S_FindRIFFChunkInBuffer(b, "data")) < 0)
+	{
+		Com_Printf( S_COLOR_RED "ERROR: Couldn't find \"data\" chunk\n");
+		return qfalse;
+	}
+	info->samples = (info->size / info->width) / info->channels;
+
+	return qtrue;
+}
+
+
+static byte* S_WAV_CodecLoad( const char* filename, const byte* data, int length, snd_info_t* info )
+{
+	wavBuffer_t b;
+	b.data = data;
+	b.length = length;
+	b.pos = 0;
+
+	if (!S_ParseRIFFHeader( &b, info )) {
 		Com_Printf( S_COLOR_RED "ERROR: Incorrect/unsupported format in \"%s\"\n", filename );
 		return NULL;
 	}
 
 	byte* buffer = (byte*)Z_Malloc( info->size );
 	if (!buffer) {
-		FS_FCloseFile( f );
 		Com_Printf( S_COLOR_RED "ERROR: Out of memory reading \"%s\"\n", filename );
 		return NULL;
 	}
 
-	FS_Read( buffer, info->size, f );
+	// a truncated file leaves the rest of the buffer silent
+	Com_Memcpy( buffer, data + b.pos, min( info->size, b.length - b.pos ) );
 	S_ByteSwapRawSamples( info->samples, info->width, info->channels, buffer );
 
-	FS_FCloseFile( f );
 	return buffer;
 }
 
@@ -57,6 +57,7 @@ int s_paintedtime;
 #define MAX_SFX 4096
 static sfx_t s_knownSfx[MAX_SFX];
 static int s_numSfx;
+static int s_numLoadingSfx;	// registered sounds whose files are still being read
 
 #define SFX_HASH_SIZE 128
 static sfx_t* sfxHash[SFX_HASH_SIZE];
@@ -262,7 +263,7 @@ static sfxHandle_t S_Base_RegisterSound( const char* name )
 	}
 
 	sfx_t* sfx = S_FindName( name );
-	if ( sfx->soundData ) {
+	if ( sfx->soundData || sfx->loadRequest ) {
 		if ( sfx->defaultSound ) {
 			Com_Printf( S_COLOR_YELLOW "WARNING: could not find %s - using default\n", sfx->soundName );
 			return 0;
@@ -270,22 +271,60 @@ static sfxHandle_t S_Base_RegisterSound( const char* name )
 		return sfx - s_knownSfx;
 	}
 
+	// the samples are decoded when first needed or by the next update
 	sfx->inMemory = qfalse;
-	S_memoryLoad( sfx );
-
-	if ( sfx->defaultSound ) {
+	if ( !S_StartLoadingSound( sfx ) ) {
+		sfx->defaultSound = qtrue;
+		sfx->inMemory = qtrue;
 		Com_Printf( S_COLOR_YELLOW "WARNING: could not find %s - using default\n", sfx->soundName );
 		return 0;
 	}
+	s_numLoadingSfx++;
 
 	return sfx - s_knownSfx;
 }
 
 
+static void S_FinishLoadingSound( sfx_t* sfx )
+{
+	if ( !sfx->loadRequest )
+		return;
+
+	s_numLoadingSfx--;
+	S_memoryLoad( sfx );
+
+	if ( sfx->defaultSound ) {
+		Com_Printf( S_COLOR_YELLOW "WARNING: could not load %s - using default\n", sfx->soundName );
+	}
+}
+
+
+// the sounds still being read are finished by a later update or when first played
+static void S_FinishReadSounds()
+{
+	for ( int i = 1; i < s_numSfx && s_numLoadingSfx > 0; ++i ) {
+		sfx_t* const sfx = &s_knownSfx[i];
+		if ( sfx->loadRequest && FS_IsFileReadDone( sfx->loadRequest ) ) {
+			S_FinishLoadingSound( sfx );
+		}
+	}
+}
+
+
+static void S_CancelLoadingSounds()
+{
+	for ( int i = 1; i < s_numSfx; ++i ) {
+		S_CancelLoadingSound( &s_knownSfx[i] );
+	}
+	s_numLoadingSfx = 0;
+}
+
+
 static void S_Base_BeginRegistration()
 {
 	s_soundMuted = qfalse;		// we can play again
 
+	S_CancelLoadingSounds();
 	SND_setup();
 
 	Com_Memset( s_knownSfx, 0, sizeof( s_knownSfx ) );
@@ -418,7 +457,10 @@ static void S_Base_StartSound( const vec3_t origin, int entityNum, int entchanne
 	sfx_t* sfx = &s_knownSfx[ sfxHandle ];
 
 	if (sfx->inMemory == qfalse) {
-		S_memoryLoad(sfx);
+		if (sfx->loadRequest)
+			S_FinishLoadingSound(sfx);
+		else
+			S_memoryLoad(sfx);
 	}
 
 	if ( s_show->integer == 1 ) {
@@ -601,7 +643,15 @@ static void S_Base_AddLoopingSound( int entityNum, const vec3_t origin, sfxHandl
 	sfx_t* sfx = &s_knownSfx[ sfxHandle ];
 
 	if (sfx->inMemory == qfalse) {
-		S_memoryLoad( sfx );
+		if (sfx->loadRequest)
+			S_FinishLoadingSound( sfx );
+		else
+			S_memoryLoad( sfx );
+	}
+
+	// registered fine but the file turned out to be unusable
+	if ( sfx->defaultSound ) {
+		return;
 	}
 
 	if ( !sfx->soundLength ) {
@@ -897,6 +947,8 @@ static void S_Base_Update()
 		return;
 	}
 
+	S_FinishReadSounds();
+
 	if ( s_show->integer == 2 ) {
 		int total = 0;
 		const channel_t* ch = s_channels;
@@ -1187,6 +1239,7 @@ static void S_Base_Shutdown()
 		return;
 	}
 
+	S_CancelLoadingSounds();
 	Sys_S_Shutdown();
 
 	s_soundStarted = qfalse;
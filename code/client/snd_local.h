@@ -48,6 +48,7 @@ typedef struct sfx_s {
 	int				soundLength;
 	char			soundName[MAX_QPATH];
 	int				lastTimeUsed;
+	int				loadRequest;	// the file is being read, see S_StartLoadingSound
 	struct sfx_s	*next;
 } sfx_t;
 
@@ -162,6 +163,8 @@ extern cvar_t *s_musicVolume;
 extern cvar_t *s_testsound;
 extern cvar_t *s_khz;
 
+qbool S_StartLoadingSound( sfx_t* sfx );
+void S_CancelLoadingSound( sfx_t* sfx );
 qbool S_LoadSound( sfx_t* sfx );
 
 void		SND_free(sndBuffer *v);
@@ -139,6 +139,7 @@ void S_UpdateEntityPosition( int entityNum, const vec3_t origin )
 
 void S_Update()
 {
+	Prof_Scope profScope( "S_Update" );
 	if (si.Update)
 		si.Update();
 }
@@ -75,6 +75,7 @@ void SND_setup()
 				 "It allocates from " S_COLOR_CVAR "com_hunkMegs" S_COLOR_HELP "'s pool." );
 	const int scs = cv->integer * 1024;
 
+	Hunk_ConsumerScope scope( HC_SOUND );
 	sndbuffers = (sndBuffer*)Hunk_Alloc( scs * sizeof(sndBuffer), h_high );
 	sndmem_avail = scs * sizeof(sndBuffer);
 
@@ -143,6 +144,30 @@ static void ResampleSfx( sfx_t *sfx, int inrate, int inwidth, byte *data )
 }
 
 
+// has the file system read the file in the background until S_LoadSound needs it
+
+qbool S_StartLoadingSound( sfx_t* sfx )
+{
+	// player specific sounds are never directly loaded
+	if (sfx->soundName[0] == '*') {
+		return qfalse;
+	}
+
+	sfx->loadRequest = S_CodecStartLoad( sfx->soundName );
+
+	return sfx->loadRequest != 0;
+}
+
+
+void S_CancelLoadingSound( sfx_t* sfx )
+{
+	if (sfx->loadRequest) {
+		FS_CancelReadFile( sfx->loadRequest );
+		sfx->loadRequest = 0;
+	}
+}
+
+
 qbool S_LoadSound( sfx_t* sfx )
 {
 	// player specific sounds are never directly loaded
@@ -151,7 +176,13 @@ qbool S_LoadSound( sfx_t* sfx )
 	}
 
 	snd_info_t info;
-	byte* data = S_CodecLoad( sfx->soundName, &info );
+	byte* data;
+	if (sfx->loadRequest) {
+		data = S_CodecFinishLoad( sfx->soundName, sfx->loadRequest, &info );
+		sfx->loadRequest = 0;
+	} else {
+		data = S_CodecLoad( sfx->soundName, &info );
+	}
 	if (!data)
 		return qfalse;
 
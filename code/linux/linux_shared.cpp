@@ -26,6 +26,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <fcntl.h>
 #include <sys/time.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/types.h>
 #if defined(__linux__)
 #include <sys/sysinfo.h>
@@ -36,6 +37,8 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include <dirent.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <pthread.h>
+#include <semaphore.h>
 #ifdef DEDICATED
 #include <sys/wait.h>
 #endif
@@ -455,6 +458,267 @@ void Sys_Mkdir( const char* path )
 }
 
 
+void* Sys_MapFile( const char* path, size_t* size )
+{
+	const int fd = open( path, O_RDONLY );
+	if ( fd == -1 )
+		return NULL;
+
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || st.st_size <= 0 ) {
+		close( fd );
+		return NULL;
+	}
+
+	void* const data = mmap( NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	close( fd ); // the mapping keeps its own reference
+	if ( data == MAP_FAILED )
+		return NULL;
+
+	*size = (size_t)st.st_size;
+
+	return data;
+}
+
+
+void Sys_UnmapFile( void* data, size_t size )
+{
+	munmap( data, size );
+}
+
+
+#define HUGE_PAGE_SIZE	(2 << 20)
+
+#if !defined( MADV_POPULATE_WRITE )
+#define MADV_POPULATE_WRITE	23 // Linux 5.14, older kernels reject it
+#endif
+
+
+static qbool Sys_TransparentHugePagesEnabled()
+{
+	char mode[256];
+	const int fd = open( "/sys/kernel/mm/transparent_hugepage/enabled", O_RDONLY );
+	if ( fd == -1 )
+		return qfalse;
+
+	const ssize_t length = read( fd, mode, sizeof(mode) - 1 );
+	close( fd );
+	if ( length <= 0 )
+		return qfalse;
+	mode[length] = '\0';
+
+	// "always [madvise] never": the brackets mark the current mode
+	return strstr( mode, "[never]" ) == NULL;
+}
+
+
+static void Sys_Prefault( byte* data, size_t size )
+{
+	if ( madvise( data, size, MADV_POPULATE_WRITE ) == 0 )
+		return;
+
+	// one write per page, each huge page gets built on its first write
+	for ( size_t i = 0; i < size; i += 4096 ) {
+		data[i] = 0;
+	}
+}
+
+
+void* Sys_AllocHunk( size_t size, hugePages_t requested, hugePages_t* result )
+{
+	const size_t hugeSize = ( size + HUGE_PAGE_SIZE - 1 ) & ~(size_t)( HUGE_PAGE_SIZE - 1 );
+
+	if ( requested == HUGEPAGES_EXPLICIT ) {
+		// fails right away when the huge page pool is too small
+		void* const data = mmap( NULL, hugeSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0 );
+		if ( data != MAP_FAILED ) {
+			*result = HUGEPAGES_EXPLICIT;
+			return data;
+		}
+		requested = HUGEPAGES_TRANSPARENT;
+	}
+
+	if ( requested == HUGEPAGES_TRANSPARENT && Sys_TransparentHugePagesEnabled() ) {
+		// over-allocate to move the start to a huge page boundary,
+		// otherwise the first and last huge pages can't be used
+		byte* const base = (byte*)mmap( NULL, hugeSize + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0 );
+		if ( base != (byte*)MAP_FAILED ) {
+			byte* const data = (byte*)( ( (uintptr_t)base + HUGE_PAGE_SIZE - 1 ) & ~(uintptr_t)( HUGE_PAGE_SIZE - 1 ) );
+			if ( data > base ) {
+				munmap( base, data - base );
+			}
+			munmap( data + hugeSize, ( base + hugeSize + HUGE_PAGE_SIZE ) - ( data + hugeSize ) );
+			if ( madvise( data, hugeSize, MADV_HUGEPAGE ) == 0 ) {
+				Sys_Prefault( data, hugeSize );
+				*result = HUGEPAGES_TRANSPARENT;
+				return data;
+			}
+			munmap( data, hugeSize );
+		}
+	}
+
+	void* const data = mmap( NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0 );
+	if ( data == MAP_FAILED )
+		return NULL;
+
+	*result = HUGEPAGES_NONE;
+
+	return data;
+}
+
+
+int64_t Sys_GetModificationTime( const char* path )
+{
+	struct stat st;
+	if ( stat( path, &st ) != 0 )
+		return 0;
+
+	return (int64_t)st.st_mtim.tv_sec * 1000000000 + (int64_t)st.st_mtim.tv_nsec;
+}
+
+
+qbool Sys_GetFileStats( const char* path, int64_t* size, int64_t* modTime )
+{
+	struct stat st;
+	if ( stat( path, &st ) != 0 )
+		return qfalse;
+
+	*size = (int64_t)st.st_size;
+	*modTime = (int64_t)st.st_mtim.tv_sec * 1000000000 + (int64_t)st.st_mtim.tv_nsec;
+
+	return qtrue;
+}
+
+
+typedef struct {
+	pthread_t		handle;
+	threadFunc_t	function;
+	void*			userData;
+} sysThread_t;
+
+
+static void* Sys_ThreadMain( void* data )
+{
+	const sysThread_t* const thread = (const sysThread_t*)data;
+	thread->function( thread->userData );
+
+	return NULL;
+}
+
+
+void* Sys_CreateThread( threadFunc_t function, void* userData )
+{
+	sysThread_t* const thread = (sysThread_t*)malloc( sizeof( sysThread_t ) );
+	if ( !thread )
+		return NULL;
+
+	thread->function = function;
+	thread->userData = userData;
+	if ( pthread_create( &thread->handle, NULL, &Sys_ThreadMain, thread ) != 0 ) {
+		free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+
+void Sys_JoinThread( void* thread )
+{
+	pthread_join( ((sysThread_t*)thread)->handle, NULL );
+	free( thread );
+}
+
+
+void* Sys_CreateMutex()
+{
+	pthread_mutex_t* const mutex = (pthread_mutex_t*)malloc( sizeof( pthread_mutex_t ) );
+	if ( !mutex )
+		return NULL;
+
+	if ( pthread_mutex_init( mutex, NULL ) != 0 ) {
+		free( mutex );
+		return NULL;
+	}
+
+	return mutex;
+}
+
+
+void Sys_DestroyMutex( void* mutex )
+{
+	pthread_mutex_destroy( (pthread_mutex_t*)mutex );
+	free( mutex );
+}
+
+
+void Sys_LockMutex( void* mutex )
+{
+	pthread_mutex_lock( (pthread_mutex_t*)mutex );
+}
+
+
+void Sys_UnlockMutex( void* mutex )
+{
+	pthread_mutex_unlock( (pthread_mutex_t*)mutex );
+}
+
+
+void* Sys_CreateSemaphore()
+{
+	sem_t* const semaphore = (sem_t*)malloc( sizeof( sem_t ) );
+	if ( !semaphore )
+		return NULL;
+
+	if ( sem_init( semaphore, 0, 0 ) != 0 ) {
+		free( semaphore );
+		return NULL;
+	}
+
+	return semaphore;
+}
+
+
+void Sys_DestroySemaphore( void* semaphore )
+{
+	sem_destroy( (sem_t*)semaphore );
+	free( semaphore );
+}
+
+
+void Sys_PostSemaphore( void* semaphore )
+{
+	sem_post( (sem_t*)semaphore );
+}
+
+
+void Sys_WaitSemaphore( void* semaphore )
+{
+	while ( sem_wait( (sem_t*)semaphore ) != 0 && errno == EINTR ) {
+	}
+}
+
+
+qbool Sys_WaitSemaphoreTimeout( void* semaphore, int ms )
+{
+	struct timespec deadline;
+	clock_gettime( CLOCK_REALTIME, &deadline );
+	deadline.tv_sec += ms / 1000;
+	deadline.tv_nsec += ( ms % 1000 ) * 1000000;
+	if ( deadline.tv_nsec >= 1000000000 ) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+
+	for (;;) {
+		if ( sem_timedwait( (sem_t*)semaphore, &deadline ) == 0 )
+			return qtrue;
+		if ( errno != EINTR )
+			return qfalse;
+	}
+}
+
+
 #define	MAX_FOUND_FILES	0x1000
 
 // bk001129 - new in 1.26
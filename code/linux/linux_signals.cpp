@@ -331,6 +331,10 @@ static void Sig_HandleCrash(int sig)
 	Sig_WriteJSON(sig);
 	Sig_PrintDone();
 
+	Sig_PrintAttempt("flush the console log");
+	Com_FlushLogForCrash();
+	Sig_PrintDone();
+
 	if (fd != -1)
 	{
 		FILE* const file = fdopen(fd, "a");
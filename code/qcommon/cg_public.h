@@ -52,6 +52,22 @@ typedef struct {
 } snapshot_t;
 
 
+// engine extension: snapshots written by the engine into the cgame VM's memory
+// the ring is located once with trap_LocateSnapshotRing
+// trap_GetSnapshotSlot writes a snapshot into its slot the first time it's requested,
+// later requests for the same number only return the slot index
+// there is one slot per snapshot the client keeps (PACKET_BACKUP) and slots are only
+// written when requested, so a slot gets overwritten only when the mod asks for
+// snapshot number + SNAPSHOT_RING_SIZE
+#define SNAPSHOT_RING_SIZE	32
+#define SNAPSHOT_RING_MASK	(SNAPSHOT_RING_SIZE - 1)
+
+typedef struct {
+	int				snapshotNumbers[SNAPSHOT_RING_SIZE];	// -1 when the slot is invalid
+	snapshot_t		snapshots[SNAPSHOT_RING_SIZE];
+} snapshotRing_t;
+
+
 // allow a lot of command backups for very fast systems
 // multiple commands may be combined into a single packet, so this
 // needs to be larger than PACKET_BACKUP
@@ -208,7 +224,9 @@ typedef enum {
 	CG_EXT_NDP_READUNTIL,
 	CG_EXT_NDP_STARTVIDEO,
 	CG_EXT_NDP_STOPVIDEO,
-	CG_EXT_R_RENDERSCENE
+	CG_EXT_R_RENDERSCENE,
+	CG_EXT_LOCATESNAPSHOTRING,
+	CG_EXT_GETSNAPSHOTSLOT
 } cgameImport_t;
 
 
@@ -0,0 +1,522 @@
+/*
+===========================================================================
+Copyright (C) 2024 Gian 'myT' Schellenbaum
+
+This file is part of Challenge Quake 3 (CNQ3).
+
+Challenge Quake 3 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Challenge Quake 3 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Challenge Quake 3. If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+// on-disk cache of fully processed collision maps
+
+#include "cm_local.h"
+#include "cm_patch.h"
+#include <stddef.h> // offsetof macro
+
+
+/*
+A cache file holds the clip map as it is right after the lumps were loaded
+(the box hull and area flood are cheap and are redone on every load):
+
+cacheHeader_t
+blob: the clipMap_t followed by every array it references, pointers replaced by blob offsets
+int fixups[numFixups]: the blob offsets of all the pointers
+
+A hit is a single read of the blob into the hunk and adding its address to every pointer.
+The BSP's checksum and size make sure it's for the right file and
+the version and structure sizes make sure it's for the right code.
+*/
+
+
+#define CACHE_MAGIC		0x434D4331	// CMC1
+#define CACHE_VERSION	1			// bump when the generated data changes
+#define CACHE_ALIGN		16
+
+
+typedef struct {
+	int			magic;
+	int			version;
+	unsigned	checksum;		// of the BSP file
+	int			bspSize;
+	int			pointerSize;
+	int			structSizes[6];
+	int			blobSize;
+	int			numFixups;
+} cacheHeader_t;
+
+
+typedef struct {
+	byte*		blob;			// NULL when only measuring
+	int			blobSize;
+	int*		fixups;
+	int			numFixups;
+} cacheWriter_t;
+
+
+static void CM_Cache_GetStructSizes( int* sizes )
+{
+	sizes[0] = sizeof( clipMap_t );
+	sizes[1] = sizeof( cbrush_t );
+	sizes[2] = sizeof( cbrushSideGroup_t );
+	sizes[3] = sizeof( patchCollide_t );
+	sizes[4] = sizeof( facet_t );
+	sizes[5] = sizeof( facetNode_t );
+}
+
+
+static const char* CM_Cache_FileName( const char* mapName )
+{
+	char baseName[MAX_QPATH];
+	COM_StripExtension( COM_SkipPath( mapName ), baseName, sizeof( baseName ) );
+
+	return va( "cmcache/%s.cmc", baseName );
+}
+
+
+// returns the blob offset of the copy, data can be NULL to fill it in later
+static int CM_Cache_Write( cacheWriter_t* w, const void* data, int size )
+{
+	const int offset = PAD( w->blobSize, CACHE_ALIGN );
+	w->blobSize = offset + size;
+	if ( w->blob && data && size > 0 )
+		Com_Memcpy( w->blob + offset, data, size );
+
+	return offset;
+}
+
+
+// the pointer at blob offset 'at' points to blob offset 'target'
+static void CM_Cache_Fixup( cacheWriter_t* w, int at, int target )
+{
+	if ( w->blob ) {
+		*(intptr_t*)( w->blob + at ) = target;
+		w->fixups[w->numFixups] = at;
+	}
+	w->numFixups++;
+}
+
+
+#define FIXUP( w, base, type, index, field, target )	CM_Cache_Fixup( w, (base) + (index) * sizeof( type ) + offsetof( type, field ), target )
+
+
+static int CM_Cache_WritePatchCollide( cacheWriter_t* w, const patchCollide_t* pc )
+{
+	const int pcOfs = CM_Cache_Write( w, pc, sizeof( *pc ) );
+	const int planesOfs = CM_Cache_Write( w, pc->planes, pc->numPlanes * sizeof( *pc->planes ) );
+	const int facetsOfs = CM_Cache_Write( w, pc->facets, pc->numFacets * sizeof( *pc->facets ) );
+	const int nodesOfs = CM_Cache_Write( w, pc->nodes, pc->numNodes * sizeof( *pc->nodes ) );
+	FIXUP( w, pcOfs, patchCollide_t, 0, planes, planesOfs );
+	FIXUP( w, pcOfs, patchCollide_t, 0, facets, facetsOfs );
+	FIXUP( w, pcOfs, patchCollide_t, 0, nodes, nodesOfs );
+
+	return pcOfs;
+}
+
+
+static void CM_Cache_WriteMap( cacheWriter_t* w )
+{
+	int i;
+
+	// the models' brush and surface indices live in separate allocations
+	// that are addressed relative to the main arrays, so we append them to these instead
+	cmodel_t cmodels[MAX_SUBMODELS];
+	Com_Memcpy( cmodels, cm.cmodels, cm.numSubModels * sizeof( cmodel_t ) );
+	int numLeafBrushes = cm.numLeafBrushes + BOX_BRUSHES;
+	int numLeafSurfaces = cm.numLeafSurfaces;
+	for ( i = 1; i < cm.numSubModels; ++i ) {
+		numLeafBrushes += cmodels[i].leaf.numLeafBrushes;
+		numLeafSurfaces += cmodels[i].leaf.numLeafSurfaces;
+	}
+
+	// the box hull slots are still empty, so the only pointers to fix up are the ones to map data
+	const int cmOfs = CM_Cache_Write( w, &cm, sizeof( cm ) );
+
+	const int shadersOfs = CM_Cache_Write( w, cm.shaders, cm.numShaders * sizeof( *cm.shaders ) );
+	const int planesOfs = CM_Cache_Write( w, cm.planes, ( cm.numPlanes + BOX_PLANES ) * sizeof( *cm.planes ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, shaders, shadersOfs );
+	FIXUP( w, cmOfs, clipMap_t, 0, planes, planesOfs );
+
+	const int sidesOfs = CM_Cache_Write( w, cm.brushsides, ( cm.numBrushSides + BOX_SIDES ) * sizeof( *cm.brushsides ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, brushsides, sidesOfs );
+	for ( i = 0; i < cm.numBrushSides; ++i ) {
+		FIXUP( w, sidesOfs, cbrushside_t, i, plane, planesOfs + ( cm.brushsides[i].plane - cm.planes ) * sizeof( cplane_t ) );
+	}
+
+	const int nodesOfs = CM_Cache_Write( w, cm.nodes, cm.numNodes * sizeof( *cm.nodes ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, nodes, nodesOfs );
+	for ( i = 0; i < cm.numNodes; ++i ) {
+		FIXUP( w, nodesOfs, cNode_t, i, plane, planesOfs + ( cm.nodes[i].plane - cm.planes ) * sizeof( cplane_t ) );
+	}
+
+	const int leafsOfs = CM_Cache_Write( w, cm.leafs, ( cm.numLeafs + BOX_LEAFS ) * sizeof( *cm.leafs ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, leafs, leafsOfs );
+
+	const int leafBrushesOfs = CM_Cache_Write( w, NULL, numLeafBrushes * sizeof( int ) );
+	const int leafSurfacesOfs = CM_Cache_Write( w, NULL, numLeafSurfaces * sizeof( int ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, leafbrushes, leafBrushesOfs );
+	FIXUP( w, cmOfs, clipMap_t, 0, leafsurfaces, leafSurfacesOfs );
+	if ( w->blob ) {
+		int* const leafBrushes = (int*)( w->blob + leafBrushesOfs );
+		int* const leafSurfaces = (int*)( w->blob + leafSurfacesOfs );
+		Com_Memcpy( leafBrushes, cm.leafbrushes, ( cm.numLeafBrushes + BOX_BRUSHES ) * sizeof( int ) );
+		Com_Memcpy( leafSurfaces, cm.leafsurfaces, cm.numLeafSurfaces * sizeof( int ) );
+		int brushIndex = cm.numLeafBrushes + BOX_BRUSHES;
+		int surfaceIndex = cm.numLeafSurfaces;
+		for ( i = 1; i < cm.numSubModels; ++i ) {
+			cLeaf_t* const leaf = &cmodels[i].leaf;
+			Com_Memcpy( leafBrushes + brushIndex, cm.leafbrushes + leaf->firstLeafBrush, leaf->numLeafBrushes * sizeof( int ) );
+			Com_Memcpy( leafSurfaces + surfaceIndex, cm.leafsurfaces + leaf->firstLeafSurface, leaf->numLeafSurfaces * sizeof( int ) );
+			leaf->firstLeafBrush = brushIndex;
+			leaf->firstLeafSurface = surfaceIndex;
+			brushIndex += leaf->numLeafBrushes;
+			surfaceIndex += leaf->numLeafSurfaces;
+		}
+	}
+
+	const int cmodelsOfs = CM_Cache_Write( w, cmodels, cm.numSubModels * sizeof( cmodel_t ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, cmodels, cmodelsOfs );
+
+	int numSideGroups = 0;
+	for ( i = 0; i < cm.numBrushes; ++i ) {
+		numSideGroups += cm.brushes[i].numSideGroups;
+	}
+	const int brushesOfs = CM_Cache_Write( w, cm.brushes, ( cm.numBrushes + BOX_BRUSHES ) * sizeof( *cm.brushes ) );
+	const int sideGroupsOfs = CM_Cache_Write( w, cm.numBrushes > 0 ? cm.brushes[0].sideGroups : NULL, numSideGroups * sizeof( cbrushSideGroup_t ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, brushes, brushesOfs );
+	for ( i = 0; i < cm.numBrushes; ++i ) {
+		const cbrush_t* const b = &cm.brushes[i];
+		FIXUP( w, brushesOfs, cbrush_t, i, sides, sidesOfs + ( b->sides - cm.brushsides ) * sizeof( cbrushside_t ) );
+		FIXUP( w, brushesOfs, cbrush_t, i, sideGroups, sideGroupsOfs + ( b->sideGroups - cm.brushes[0].sideGroups ) * sizeof( cbrushSideGroup_t ) );
+	}
+
+	const int visSize = cm.vised ? cm.numClusters * cm.clusterBytes : cm.clusterBytes;
+	const int visOfs = CM_Cache_Write( w, cm.visibility, visSize );
+	FIXUP( w, cmOfs, clipMap_t, 0, visibility, visOfs );
+
+	const int entityOfs = CM_Cache_Write( w, cm.entityString, cm.numEntityChars );
+	FIXUP( w, cmOfs, clipMap_t, 0, entityString, entityOfs );
+
+	// nothing was flooded yet, so these are all zeroes
+	const int areasOfs = CM_Cache_Write( w, cm.areas, cm.numAreas * sizeof( *cm.areas ) );
+	const int portalsOfs = CM_Cache_Write( w, cm.areaPortals, cm.numAreas * cm.numAreas * sizeof( *cm.areaPortals ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, areas, areasOfs );
+	FIXUP( w, cmOfs, clipMap_t, 0, areaPortals, portalsOfs );
+
+	const int surfacesOfs = CM_Cache_Write( w, cm.surfaces, cm.numSurfaces * sizeof( *cm.surfaces ) );
+	FIXUP( w, cmOfs, clipMap_t, 0, surfaces, surfacesOfs );
+	for ( i = 0; i < cm.numSurfaces; ++i ) {
+		const cPatch_t* const patch = cm.surfaces[i];
+		if ( !patch )
+			continue;
+		const int patchOfs = CM_Cache_Write( w, patch, sizeof( *patch ) );
+		const int pcOfs = CM_Cache_WritePatchCollide( w, patch->pc );
+		FIXUP( w, patchOfs, cPatch_t, 0, pc, pcOfs );
+		CM_Cache_Fixup( w, surfacesOfs + i * sizeof( cPatch_t* ), patchOfs );
+	}
+}
+
+
+#undef FIXUP
+
+
+// the file's pointers were checked to land inside the blob, but not what they point to
+// nor the indices, so everything the collision code indexes with is range-checked here
+// like the lump loaders do
+
+typedef struct {
+	const byte*	blob;
+	int			blobSize;
+} cacheReader_t;
+
+
+static qbool CM_Cache_IsArray( const cacheReader_t* r, const void* array, int count, int size )
+{
+	if ( count < 0 )
+		return qfalse;
+	if ( count == 0 )
+		return qtrue;
+
+	const byte* const p = (const byte*)array;
+	if ( p < r->blob || p > r->blob + r->blobSize )
+		return qfalse;
+
+	return count <= ( r->blob + r->blobSize - p ) / size;
+}
+
+
+// the pointer must be to an element of the array, not just anywhere inside it
+template<typename T>
+static qbool CM_Cache_IsElement( const T* element, const T* array, int count )
+{
+	return element >= array && element < array + count &&
+		( (const byte*)element - (const byte*)array ) % sizeof( T ) == 0;
+}
+
+
+#define IS_ARRAY( r, array, count )	CM_Cache_IsArray( r, array, count, sizeof( *(array) ) )
+
+
+static qbool CM_Cache_IsValidPatchCollide( const cacheReader_t* r, const patchCollide_t* pc )
+{
+	if ( !IS_ARRAY( r, pc, 1 ) ||
+		!IS_ARRAY( r, pc->planes, pc->numPlanes ) ||
+		!IS_ARRAY( r, pc->facets, pc->numFacets ) ||
+		!IS_ARRAY( r, pc->nodes, pc->numNodes ) )
+		return qfalse;
+
+	for ( int i = 0; i < pc->numFacets; ++i ) {
+		const facet_t* const facet = &pc->facets[i];
+		if ( (unsigned)facet->surfacePlane >= (unsigned)pc->numPlanes ||
+			(unsigned)facet->numBorders > ARRAY_LEN( facet->borderPlanes ) )
+			return qfalse;
+		for ( int j = 0; j < facet->numBorders; ++j ) {
+			if ( (unsigned)facet->borderPlanes[j] >= (unsigned)pc->numPlanes )
+				return qfalse;
+		}
+	}
+
+	// the tree walk must always move forward and leafs must stay within the facets
+	for ( int i = 0; i < pc->numNodes; ++i ) {
+		const facetNode_t* const node = &pc->nodes[i];
+		if ( node->skipNode <= i || node->skipNode > pc->numNodes ||
+			node->firstFacet < 0 || node->numFacets < 0 ||
+			node->firstFacet > pc->numFacets - node->numFacets )
+			return qfalse;
+	}
+
+	return qtrue;
+}
+
+
+static qbool CM_Cache_IsValidMap( const cacheReader_t* r, const clipMap_t* c )
+{
+	int i;
+
+	// the box hull goes in the extra slots at the end of these
+	const int numPlanes = c->numPlanes + BOX_PLANES;
+	const int numSides = c->numBrushSides + BOX_SIDES;
+	const int numBrushes = c->numBrushes + BOX_BRUSHES;
+	const int numLeafs = c->numLeafs + BOX_LEAFS;
+
+	// the submodels' leaf brushes and surfaces were appended to the main arrays
+	if ( c->numSubModels < 1 || c->numSubModels > MAX_SUBMODELS || !IS_ARRAY( r, c->cmodels, c->numSubModels ) )
+		return qfalse;
+	int numLeafBrushes = c->numLeafBrushes + BOX_BRUSHES;
+	int numLeafSurfaces = c->numLeafSurfaces;
+	for ( i = 1; i < c->numSubModels; ++i ) {
+		if ( c->cmodels[i].leaf.numLeafBrushes < 0 || c->cmodels[i].leaf.numLeafSurfaces < 0 )
+			return qfalse;
+		numLeafBrushes += c->cmodels[i].leaf.numLeafBrushes;
+		numLeafSurfaces += c->cmodels[i].leaf.numLeafSurfaces;
+	}
+
+	if ( c->numShaders < 1 || !IS_ARRAY( r, c->shaders, c->numShaders ) ||
+		c->numPlanes < 1 || !IS_ARRAY( r, c->planes, numPlanes ) ||
+		c->numBrushSides < 0 || !IS_ARRAY( r, c->brushsides, numSides ) ||
+		c->numBrushes < 0 || !IS_ARRAY( r, c->brushes, numBrushes ) ||
+		c->numNodes < 1 || !IS_ARRAY( r, c->nodes, c->numNodes ) ||
+		c->numLeafs < 1 || !IS_ARRAY( r, c->leafs, numLeafs ) ||
+		c->numLeafBrushes < 0 || !IS_ARRAY( r, c->leafbrushes, numLeafBrushes ) ||
+		c->numLeafSurfaces < 0 || !IS_ARRAY( r, c->leafsurfaces, numLeafSurfaces ) ||
+		c->numAreas < 0 || !IS_ARRAY( r, c->areas, c->numAreas ) ||
+		!IS_ARRAY( r, c->areaPortals, c->numAreas * c->numAreas ) ||
+		c->numSurfaces < 0 || !IS_ARRAY( r, c->surfaces, c->numSurfaces ) ||
+		c->numPatches < 0 || c->numPatches > c->numSurfaces ||
+		c->numEntityChars < 0 || !IS_ARRAY( r, c->entityString, c->numEntityChars ) ||
+		c->numClusters < 0 || c->clusterBytes < 0 ||
+		!IS_ARRAY( r, c->visibility, c->vised ? c->numClusters * c->clusterBytes : c->clusterBytes ) )
+		return qfalse;
+
+	for ( i = 0; i < c->numBrushSides; ++i ) {
+		const cbrushside_t* const side = &c->brushsides[i];
+		if ( !CM_Cache_IsElement( side->plane, c->planes, c->numPlanes ) ||
+			(unsigned)side->shaderNum >= (unsigned)c->numShaders )
+			return qfalse;
+	}
+
+	for ( i = 0; i < c->numBrushes; ++i ) {
+		const cbrush_t* const brush = &c->brushes[i];
+		if ( (unsigned)brush->shaderNum >= (unsigned)c->numShaders ||
+			brush->numsides < 0 || brush->numsides > c->numBrushSides ||
+			brush->numSideGroups != ( brush->numsides + 3 ) / 4 ||
+			!IS_ARRAY( r, brush->sideGroups, brush->numSideGroups ) )
+			return qfalse;
+		if ( brush->numsides > 0 &&
+			( !CM_Cache_IsElement( brush->sides, c->brushsides, c->numBrushSides ) ||
+			brush->sides - c->brushsides > c->numBrushSides - brush->numsides ) )
+			return qfalse;
+	}
+
+	for ( i = 0; i < c->numNodes; ++i ) {
+		const cNode_t* const node = &c->nodes[i];
+		if ( !CM_Cache_IsElement( node->plane, c->planes, c->numPlanes ) )
+			return qfalse;
+		for ( int j = 0; j < 2; ++j ) {
+			const int child = node->children[j];
+			if ( child >= c->numNodes || ( child < 0 && -1 - child >= c->numLeafs ) )
+				return qfalse;
+		}
+	}
+
+	for ( i = 0; i < c->numLeafs + c->numSubModels; ++i ) {
+		const cLeaf_t* const leaf = i < c->numLeafs ? &c->leafs[i] : &c->cmodels[i - c->numLeafs].leaf;
+		if ( leaf->cluster >= c->numClusters || leaf->area >= c->numAreas ||
+			leaf->firstLeafBrush < 0 || leaf->numLeafBrushes < 0 ||
+			leaf->firstLeafBrush > numLeafBrushes - leaf->numLeafBrushes ||
+			leaf->firstLeafSurface < 0 || leaf->numLeafSurfaces < 0 ||
+			leaf->firstLeafSurface > numLeafSurfaces - leaf->numLeafSurfaces )
+			return qfalse;
+	}
+
+	for ( i = 0; i < numLeafBrushes; ++i ) {
+		if ( (unsigned)c->leafbrushes[i] >= (unsigned)numBrushes )
+			return qfalse;
+	}
+
+	for ( i = 0; i < numLeafSurfaces; ++i ) {
+		if ( (unsigned)c->leafsurfaces[i] >= (unsigned)c->numSurfaces )
+			return qfalse;
+	}
+
+	for ( i = 0; i < c->numSurfaces; ++i ) {
+		const cPatch_t* const patch = c->surfaces[i];
+		if ( !patch )
+			continue;
+		if ( !IS_ARRAY( r, patch, 1 ) ||
+			(unsigned)patch->patchNum >= (unsigned)c->numPatches ||
+			!CM_Cache_IsValidPatchCollide( r, patch->pc ) )
+			return qfalse;
+	}
+
+	return qtrue;
+}
+
+
+#undef IS_ARRAY
+
+
+void CM_SaveCachedMap( const char* mapName, unsigned checksum, int bspSize )
+{
+	cacheWriter_t w;
+	Com_Memset( &w, 0, sizeof( w ) );
+	CM_Cache_WriteMap( &w );
+
+	cacheHeader_t header;
+	Com_Memset( &header, 0, sizeof( header ) );
+	header.magic = CACHE_MAGIC;
+	header.version = CACHE_VERSION;
+	header.checksum = checksum;
+	header.bspSize = bspSize;
+	header.pointerSize = sizeof( void* );
+	CM_Cache_GetStructSizes( header.structSizes );
+	header.blobSize = w.blobSize;
+	header.numFixups = w.numFixups;
+
+	w.blob = (byte*)Hunk_AllocateTempMemory( header.blobSize );
+	w.fixups = (int*)Hunk_AllocateTempMemory( header.numFixups * sizeof( int ) );
+	Com_Memset( w.blob, 0, header.blobSize );
+	w.blobSize = 0;
+	w.numFixups = 0;
+	CM_Cache_WriteMap( &w );
+	assert( w.blobSize == header.blobSize && w.numFixups == header.numFixups );
+
+	const char* const fileName = CM_Cache_FileName( mapName );
+	const fileHandle_t f = FS_FOpenFileWrite( fileName );
+	if ( f ) {
+		FS_Write( &header, sizeof( header ), f );
+		FS_Write( w.blob, header.blobSize, f );
+		FS_Write( w.fixups, header.numFixups * sizeof( int ), f );
+		FS_FCloseFile( f );
+		Com_DPrintf( "CM_SaveCachedMap: wrote %s (%d KB)\n", fileName, ( header.blobSize + 1023 ) / 1024 );
+	} else {
+		Com_Printf( "^3WARNING: CM_SaveCachedMap: couldn't open %s for writing\n", fileName );
+	}
+
+	Hunk_FreeTempMemory( w.fixups );
+	Hunk_FreeTempMemory( w.blob );
+}
+
+
+qbool CM_LoadCachedMap( const char* mapName, unsigned checksum, int bspSize )
+{
+	const char* const fileName = CM_Cache_FileName( mapName );
+	fileHandle_t f;
+	const int fileSize = FS_FOpenFileRead( fileName, &f, qtrue, NULL );
+	if ( fileSize <= 0 )
+		return qfalse;
+
+	// only real files written by CM_SaveCachedMap, never anything from a pak
+	cacheHeader_t header;
+	int structSizes[ARRAY_LEN( header.structSizes )];
+	CM_Cache_GetStructSizes( structSizes );
+	if ( FS_IsZipFile( f ) ||
+		fileSize < sizeof( header ) ||
+		FS_Read( &header, sizeof( header ), f ) != sizeof( header ) ||
+		header.magic != CACHE_MAGIC ||
+		header.version != CACHE_VERSION ||
+		header.checksum != checksum ||
+		header.bspSize != bspSize ||
+		header.pointerSize != sizeof( void* ) ||
+		memcmp( header.structSizes, structSizes, sizeof( structSizes ) ) ||
+		header.blobSize < (int)sizeof( clipMap_t ) ||
+		header.numFixups < 0 ||
+		fileSize != sizeof( header ) + header.blobSize + header.numFixups * sizeof( int ) ) {
+		FS_FCloseFile( f );
+		Com_DPrintf( "CM_LoadCachedMap: %s is stale or invalid\n", fileName );
+		return qfalse;
+	}
+
+	int* const fixups = (int*)Hunk_AllocateTempMemory( max( header.numFixups, 1 ) * sizeof( int ) );
+	byte* const blob = (byte*)Hunk_Alloc( header.blobSize, h_high );
+	const qbool readOK =
+		FS_Read( blob, header.blobSize, f ) == header.blobSize &&
+		FS_Read( fixups, header.numFixups * sizeof( int ), f ) == header.numFixups * (int)sizeof( int );
+	FS_FCloseFile( f );
+
+	qbool valid = readOK;
+	for ( int i = 0; valid && i < header.numFixups; ++i ) {
+		const int at = fixups[i];
+		if ( at < 0 || at > header.blobSize - (int)sizeof( intptr_t ) || ( at % sizeof( intptr_t ) ) != 0 ) {
+			valid = qfalse;
+			break;
+		}
+		intptr_t* const pointer = (intptr_t*)( blob + at );
+		if ( *pointer < 0 || *pointer > header.blobSize ) {
+			valid = qfalse;
+			break;
+		}
+		*pointer += (intptr_t)blob;
+	}
+	Hunk_FreeTempMemory( fixups );
+
+	if ( valid ) {
+		cacheReader_t reader;
+		reader.blob = blob;
+		reader.blobSize = header.blobSize;
+		valid = CM_Cache_IsValidMap( &reader, (const clipMap_t*)blob );
+	}
+
+	if ( !valid ) {
+		// the hunk block is lost until the next map load, which is fine for a corrupt file
+		Com_Printf( "^3WARNING: CM_LoadCachedMap: %s is corrupt\n", fileName );
+		return qfalse;
+	}
+
+	Com_Memcpy( &cm, blob, sizeof( cm ) );
+	// built after the load, never cached
+	cm.areaBits = NULL;
+	Com_Memset( &cm.pointGrid, 0, sizeof( cm.pointGrid ) );
+
+	return qtrue;
+}
@@ -0,0 +1,492 @@
+/*
+===========================================================================
+Copyright (C) 2024 Gian 'myT' Schellenbaum
+
+This file is part of Challenge Quake 3 (CNQ3).
+
+Challenge Quake 3 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Challenge Quake 3 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Challenge Quake 3. If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+// collision model verification and benchmarking
+
+#include "cm_local.h"
+
+
+cmNodeOffsets_t cm_testNodeOffsets;
+qbool cm_scalarBrushTests;
+qbool cm_linearFacetTests;
+
+
+/*
+cm_tracetest builds a corpus of traces against the loaded map's world model and runs it
+through every mode of traceTestModes, comparing the results of each mode with the previous one:
+- the legacy tree traversal (a 2048 units box offset for every non-axial node)
+- the current one (the box's support distance along the plane's normal)
+- the patch facet trees instead of testing every facet of every patch
+- the SSE2 brush tests, which only match the scalar reference exactly without -ffast-math:
+  the compiler is free to reassociate the scalar code's arithmetic but not the intrinsics,
+  so that mode compares fractions with a tolerance
+Most traces start next to a brush and are short, since that's where the modes disagree if they do.
+
+cm_capture records the CM_BoxTrace and CM_TransformedBoxTrace queries of real server frames
+and cm_tracereplay runs them through the same modes, with a checksum of each mode's results
+so that a capture replayed by two builds proves whether they're equivalent.
+*/
+
+
+#define MAX_PRINTED_MISMATCHES	8
+
+
+// also the record format of the capture files
+typedef struct {
+	vec3_t	start;
+	vec3_t	end;
+	vec3_t	mins;
+	vec3_t	maxs;
+	vec3_t	origin;		// CM_TransformedBoxTrace only
+	vec3_t	angles;		// CM_TransformedBoxTrace only
+	vec3_t	boxMins;	// temp box model bounds
+	vec3_t	boxMaxs;
+	int		model;
+	int		contentMask;
+	int		capsule;
+	int		transformed;
+} traceTestInput_t;
+
+
+#define CAPTURE_MAGIC	0x31544D43	// "CMT1"
+#define CAPTURE_VERSION	1
+
+typedef struct {
+	int			magic;
+	int			version;
+	unsigned	checksum;	// of the BSP file
+	int			inputSize;
+} captureHeader_t;
+
+
+// only the thread that started the capture records its queries,
+// so the file and counters are never written concurrently
+static fileHandle_t	captureFile;
+static int			captureFrames;	// server frames left to record
+static int			captureCount;
+static THREAD_LOCAL qbool	captureThread;
+
+
+typedef struct {
+	int		leafs;
+	int		brushes;
+	int		patches;
+	int		facets;
+	int64_t	us;
+	unsigned	checksum;
+} traceTestStats_t;
+
+
+typedef struct {
+	const char*	name;
+	qbool		legacyNodeOffsets;
+	qbool		scalarBrushTests;
+	qbool		linearFacetTests;
+	float		fractionEpsilon;	// against the previous mode
+} traceTestMode_t;
+
+
+static const traceTestMode_t traceTestModes[] = {
+	{ "legacy", qtrue, qtrue, qtrue, 0.0f },
+	{ "tight", qfalse, qtrue, qtrue, 0.0f },
+	{ "facets", qfalse, qtrue, qfalse, 0.0f },
+#if idSSE2
+	{ "sse2", qfalse, qfalse, qfalse, 0.0001f }
+#endif
+};
+
+
+static void CM_TraceTest_Generate( traceTestInput_t* input, int index, int* seed )
+{
+	static const vec3_t playerMins = { -15, -15, -24 };
+	static const vec3_t playerMaxs = { 15, 15, 32 };
+	static const vec3_t crouchMaxs = { 15, 15, 16 };
+
+	Com_Memset( input, 0, sizeof( *input ) );
+	input->model = CM_InlineModel( 0 );
+	input->contentMask = CONTENTS_SOLID | CONTENTS_PLAYERCLIP | CONTENTS_BODY;
+
+	switch ( index % 4 ) {
+	case 0:
+		break;
+	case 1:
+		VectorCopy( playerMins, input->mins );
+		VectorCopy( playerMaxs, input->maxs );
+		break;
+	case 2:
+		VectorCopy( playerMins, input->mins );
+		VectorCopy( crouchMaxs, input->maxs );
+		break;
+	default:
+		for ( int i = 0; i < 3; ++i ) {
+			input->mins[i] = -1.0f - 31.0f * Q_random( seed );
+			input->maxs[i] = 1.0f + 31.0f * Q_random( seed );
+		}
+		break;
+	}
+	input->capsule = ( index % 8 ) == 5;
+
+	const cmodel_t* const world = &cm.cmodels[0];
+	if ( ( index % 16 ) == 15 || cm.numBrushes <= 0 ) {
+		// long traces across the world
+		for ( int i = 0; i < 3; ++i ) {
+			input->start[i] = world->mins[i] + ( world->maxs[i] - world->mins[i] ) * Q_random( seed );
+			input->end[i] = world->mins[i] + ( world->maxs[i] - world->mins[i] ) * Q_random( seed );
+		}
+		return;
+	}
+
+	// short traces starting around a brush
+	const cbrush_t* const brush = &cm.brushes[( Q_rand( seed ) & 0x7FFFFFFF ) % cm.numBrushes];
+	vec3_t dir;
+	for ( int i = 0; i < 3; ++i ) {
+		const float min = brush->bounds[0][i] - 96.0f;
+		const float max = brush->bounds[1][i] + 96.0f;
+		input->start[i] = min + ( max - min ) * Q_random( seed );
+		dir[i] = Q_crandom( seed );
+	}
+	VectorNormalize( dir );
+	VectorMA( input->start, 8.0f + 504.0f * Q_random( seed ), dir, input->end );
+}
+
+
+static void CM_TraceTest_Trace( trace_t* result, const traceTestInput_t* in )
+{
+	if ( in->model == BOX_MODEL_HANDLE || in->model == CAPSULE_MODEL_HANDLE )
+		CM_TempBoxModel( in->boxMins, in->boxMaxs, in->model == CAPSULE_MODEL_HANDLE );
+
+	if ( in->transformed )
+		CM_TransformedBoxTrace( result, in->start, in->end, in->mins, in->maxs, in->model, in->contentMask, in->origin, in->angles, in->capsule );
+	else
+		CM_BoxTrace( result, in->start, in->end, in->mins, in->maxs, in->model, in->contentMask, in->capsule );
+}
+
+
+// only hashes what CM_TraceTest_Equal compares exactly
+static unsigned CM_TraceTest_Checksum( const trace_t* results, int count )
+{
+	unsigned crc;
+	CRC32_Begin( &crc );
+	for ( int i = 0; i < count; ++i ) {
+		const trace_t* const tr = &results[i];
+		if ( tr->allsolid ) {
+			CRC32_ProcessBlock( &crc, &tr->allsolid, sizeof( tr->allsolid ) );
+			continue;
+		}
+		CRC32_ProcessBlock( &crc, &tr->fraction, sizeof( tr->fraction ) );
+		CRC32_ProcessBlock( &crc, tr->endpos, sizeof( tr->endpos ) );
+		CRC32_ProcessBlock( &crc, tr->plane.normal, sizeof( tr->plane.normal ) );
+		CRC32_ProcessBlock( &crc, &tr->plane.dist, sizeof( tr->plane.dist ) );
+		CRC32_ProcessBlock( &crc, &tr->startsolid, sizeof( tr->startsolid ) );
+		CRC32_ProcessBlock( &crc, &tr->surfaceFlags, sizeof( tr->surfaceFlags ) );
+		CRC32_ProcessBlock( &crc, &tr->contents, sizeof( tr->contents ) );
+	}
+	CRC32_End( &crc );
+
+	return crc;
+}
+
+
+static void CM_TraceTest_Run( const traceTestInput_t* inputs, trace_t* results, int count, const traceTestMode_t* mode, traceTestStats_t* stats )
+{
+	const cmStats_t before = *CM_Stats();
+
+	cm_testNodeOffsets = mode->legacyNodeOffsets ? CMNO_LEGACY : CMNO_TIGHT;
+	cm_scalarBrushTests = mode->scalarBrushTests;
+	cm_linearFacetTests = mode->linearFacetTests;
+	const int64_t start = Sys_Microseconds();
+	for ( int i = 0; i < count; ++i ) {
+		CM_TraceTest_Trace( &results[i], &inputs[i] );
+	}
+	stats->us = Sys_Microseconds() - start;
+	cm_testNodeOffsets = CMNO_CVAR;
+	cm_scalarBrushTests = qfalse;
+	cm_linearFacetTests = qfalse;
+
+	const cmStats_t* const after = CM_Stats();
+	stats->leafs = after->leafTraces - before.leafTraces;
+	stats->brushes = after->brushTraces - before.brushTraces;
+	stats->patches = after->patchTraces - before.patchTraces;
+	stats->facets = after->facetTraces - before.facetTraces;
+	stats->checksum = CM_TraceTest_Checksum( results, count );
+}
+
+
+static qbool CM_TraceTest_Equal( const trace_t* a, const trace_t* b, float fractionEpsilon )
+{
+	if ( a->allsolid && b->allsolid )
+		return qtrue; // the plane isn't valid
+
+	if ( fractionEpsilon > 0.0f ) {
+		// the end position follows the fraction
+		if ( fabsf( a->fraction - b->fraction ) > fractionEpsilon )
+			return qfalse;
+	} else if ( a->fraction != b->fraction || !VectorCompare( a->endpos, b->endpos ) ) {
+		return qfalse;
+	}
+
+	return
+		a->allsolid == b->allsolid &&
+		a->startsolid == b->startsolid &&
+		VectorCompare( a->plane.normal, b->plane.normal ) &&
+		a->plane.dist == b->plane.dist &&
+		a->surfaceFlags == b->surfaceFlags &&
+		a->contents == b->contents;
+}
+
+
+static int CM_TraceTest_Compare( const traceTestInput_t* inputs, const trace_t* results1, const trace_t* results2, int count,
+								 const traceTestMode_t* mode1, const traceTestMode_t* mode2 )
+{
+	int mismatches = 0;
+	for ( int i = 0; i < count; ++i ) {
+		const trace_t* const a = &results1[i];
+		const trace_t* const b = &results2[i];
+		if ( CM_TraceTest_Equal( a, b, mode2->fractionEpsilon ) )
+			continue;
+
+		if ( mismatches < MAX_PRINTED_MISMATCHES ) {
+			const traceTestInput_t* const in = &inputs[i];
+			Com_Printf( S_COLOR_RED "trace %d: model %d (%g %g %g) -> (%g %g %g) box (%g %g %g) (%g %g %g)%s%s\n", i, in->model,
+				in->start[0], in->start[1], in->start[2], in->end[0], in->end[1], in->end[2],
+				in->mins[0], in->mins[1], in->mins[2], in->maxs[0], in->maxs[1], in->maxs[2],
+				in->capsule ? " capsule" : "", in->transformed ? " transformed" : "" );
+			Com_Printf( "  %-8s fraction %g solid %d/%d normal (%g %g %g)\n", mode1->name,
+				a->fraction, a->startsolid, a->allsolid, a->plane.normal[0], a->plane.normal[1], a->plane.normal[2] );
+			Com_Printf( "  %-8s fraction %g solid %d/%d normal (%g %g %g)\n", mode2->name,
+				b->fraction, b->startsolid, b->allsolid, b->plane.normal[0], b->plane.normal[1], b->plane.normal[2] );
+		}
+		mismatches++;
+	}
+
+	return mismatches;
+}
+
+
+static void CM_TraceTest_PrintStats( const char* name, const traceTestStats_t* stats, int count, int mismatches )
+{
+	Com_Printf( "%-8s %10d %10d %10d %10d %10.2f %10.1f %10d   %08X\n", name, stats->leafs, stats->brushes, stats->patches, stats->facets,
+		(double)stats->leafs / (double)count, (double)stats->us * 1000.0 / (double)count, mismatches, stats->checksum );
+}
+
+
+static void CM_TraceTest_RunModes( const traceTestInput_t* inputs, int count )
+{
+	trace_t* results[2];
+	results[0] = (trace_t*)Hunk_AllocateTempMemory( count * sizeof( trace_t ) );
+	results[1] = (trace_t*)Hunk_AllocateTempMemory( count * sizeof( trace_t ) );
+
+	// the mismatches column is against the previous mode
+	Com_Printf( "%-8s %10s %10s %10s %10s %10s %10s %10s   %-8s\n", "mode", "leafs", "brushes", "patches", "facets", "leafs/tr", "ns/tr", "mismatches", "checksum" );
+	int totalMismatches = 0;
+	for ( int m = 0; m < ARRAY_LEN( traceTestModes ); ++m ) {
+		const traceTestMode_t* const mode = &traceTestModes[m];
+		traceTestStats_t stats;
+		CM_TraceTest_Run( inputs, results[m & 1], count, mode, &stats );
+
+		int mismatches = 0;
+		if ( m > 0 ) {
+			mismatches = CM_TraceTest_Compare( inputs, results[(m - 1) & 1], results[m & 1], count, &traceTestModes[m - 1], mode );
+			totalMismatches += mismatches;
+		}
+		CM_TraceTest_PrintStats( mode->name, &stats, count, mismatches );
+	}
+
+	if ( totalMismatches )
+		Com_Printf( S_COLOR_RED "%s: %d mismatches over %d traces\n", cm.name, totalMismatches, count );
+	else
+		Com_Printf( S_COLOR_GREEN "%s: all %d traces match in every mode\n", cm.name, count );
+
+	Hunk_FreeTempMemory( results[1] );
+	Hunk_FreeTempMemory( results[0] );
+}
+
+
+void CM_TraceTest_f()
+{
+	if ( !cm.numNodes ) {
+		Com_Printf( "ERROR: no map loaded\n" );
+		return;
+	}
+
+	const int count = Cmd_Argc() >= 2 ? max( atoi( Cmd_Argv(1) ), 1 ) : 100000;
+	int seed = Cmd_Argc() >= 3 ? atoi( Cmd_Argv(2) ) : 1337;
+
+	traceTestInput_t* const inputs = (traceTestInput_t*)Hunk_AllocateTempMemory( count * sizeof( traceTestInput_t ) );
+	for ( int i = 0; i < count; ++i ) {
+		CM_TraceTest_Generate( &inputs[i], i, &seed );
+	}
+
+	CM_TraceTest_RunModes( inputs, count );
+
+	Hunk_FreeTempMemory( inputs );
+}
+
+
+static const char* CM_Capture_FileName( const char* name )
+{
+	char baseName[MAX_QPATH];
+	COM_StripExtension( COM_SkipPath( name ), baseName, sizeof( baseName ) );
+
+	return va( "cmcapture/%s.cmt", baseName );
+}
+
+
+void CM_CaptureTrace( const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model,
+					  int brushmask, const vec3_t origin, const vec3_t angles, int capsule )
+{
+	if ( !captureThread || !captureFile )
+		return;
+
+	traceTestInput_t input;
+	Com_Memset( &input, 0, sizeof( input ) );
+	VectorCopy( start, input.start );
+	VectorCopy( end, input.end );
+	VectorCopy( mins ? mins : vec3_origin, input.mins );
+	VectorCopy( maxs ? maxs : vec3_origin, input.maxs );
+	if ( origin ) {
+		VectorCopy( origin, input.origin );
+		VectorCopy( angles, input.angles );
+		input.transformed = qtrue;
+	}
+	if ( model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE ) {
+		CM_ModelBounds( model, input.boxMins, input.boxMaxs );
+	}
+	input.model = model;
+	input.contentMask = brushmask;
+	input.capsule = capsule;
+
+	FS_Write( &input, sizeof( input ), captureFile );
+	captureCount++;
+}
+
+
+void CM_StopCapture()
+{
+	if ( !captureFile )
+		return;
+
+	FS_FCloseFile( captureFile );
+	captureFile = 0;
+	captureThread = qfalse;
+	Com_Printf( "cm_capture: recorded %d traces\n", captureCount );
+}
+
+
+void CM_EndCaptureFrame()
+{
+	if ( captureFile && --captureFrames <= 0 )
+		CM_StopCapture();
+}
+
+
+void CM_Capture_f()
+{
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: %s <frames> [name]\n", Cmd_Argv(0) );
+		return;
+	}
+
+	if ( !cm.numNodes ) {
+		Com_Printf( "ERROR: no map loaded\n" );
+		return;
+	}
+
+	if ( captureFile ) {
+		Com_Printf( "ERROR: already capturing\n" );
+		return;
+	}
+
+	const char* const fileName = CM_Capture_FileName( Cmd_Argc() >= 3 ? Cmd_Argv(2) : cm.name );
+	captureFile = FS_FOpenFileWrite( fileName );
+	if ( !captureFile ) {
+		Com_Printf( "ERROR: couldn't open %s for writing\n", fileName );
+		return;
+	}
+
+	captureHeader_t header;
+	header.magic = CAPTURE_MAGIC;
+	header.version = CAPTURE_VERSION;
+	header.checksum = cm.checksum;
+	header.inputSize = sizeof( traceTestInput_t );
+	FS_Write( &header, sizeof( header ), captureFile );
+
+	captureFrames = max( atoi( Cmd_Argv(1) ), 1 );
+	captureCount = 0;
+	captureThread = qtrue;
+	Com_Printf( "cm_capture: recording %d server frames to %s\n", captureFrames, fileName );
+}
+
+
+void CM_TraceReplay_f()
+{
+	if ( !cm.numNodes ) {
+		Com_Printf( "ERROR: no map loaded\n" );
+		return;
+	}
+
+	// the replay's own queries would be recorded too
+	if ( captureFile ) {
+		Com_Printf( "ERROR: can't replay while capturing\n" );
+		return;
+	}
+
+	const char* const fileName = CM_Capture_FileName( Cmd_Argc() >= 2 ? Cmd_Argv(1) : cm.name );
+	byte* buf;
+	const int fileSize = FS_ReadFile( fileName, (void**)&buf );
+	if ( !buf ) {
+		Com_Printf( "ERROR: couldn't read %s\n", fileName );
+		return;
+	}
+
+	const captureHeader_t* const header = (const captureHeader_t*)buf;
+	const int count = ( fileSize - (int)sizeof( captureHeader_t ) ) / (int)sizeof( traceTestInput_t );
+	if ( fileSize < (int)sizeof( captureHeader_t ) ||
+		header->magic != CAPTURE_MAGIC ||
+		header->version != CAPTURE_VERSION ||
+		header->inputSize != sizeof( traceTestInput_t ) ||
+		fileSize != sizeof( captureHeader_t ) + count * sizeof( traceTestInput_t ) ) {
+		Com_Printf( "ERROR: %s isn't a valid capture file\n", fileName );
+		FS_FreeFile( buf );
+		return;
+	}
+
+	if ( header->checksum != cm.checksum ) {
+		Com_Printf( "ERROR: %s wasn't captured on %s\n", fileName, cm.name );
+		FS_FreeFile( buf );
+		return;
+	}
+
+	const traceTestInput_t* const inputs = (const traceTestInput_t*)( buf + sizeof( captureHeader_t ) );
+	int invalid = 0;
+	for ( int i = 0; i < count; ++i ) {
+		const int model = inputs[i].model;
+		if ( ( model < 0 || model >= cm.numSubModels ) && model != BOX_MODEL_HANDLE && model != CAPSULE_MODEL_HANDLE )
+			invalid++;
+	}
+
+	if ( count <= 0 || invalid ) {
+		Com_Printf( "ERROR: %s has %d traces, %d with invalid models\n", fileName, count, invalid );
+	} else {
+		CM_TraceTest_RunModes( inputs, count );
+	}
+
+	FS_FreeFile( buf );
+}
@@ -24,16 +24,15 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "cm_local.h"
 
 
-// to allow boxes to be treated as brush models, we allocate
-// some extra indexes along with those needed by the map
-#define	BOX_BRUSHES		1
-#define	BOX_SIDES		6
-#define	BOX_LEAFS		2
-#define	BOX_PLANES		12
+clipMap_t cm;
 
+// a thread claims a slot on its first query and keeps it
+// the threads past the capacity share the last one, which can only lose counts
+#define CM_MAX_STATS_THREADS	16
 
-clipMap_t cm;
-int c_traces, c_brush_traces, c_patch_traces, c_pointcontents;
+static cmStats_t cm_stats[CM_MAX_STATS_THREADS];
+static int cm_numStats;
+THREAD_LOCAL cmStats_t* cm_threadStats;
 
 const byte* cmod_base;
 
@@ -42,6 +41,10 @@ const byte* cmod_base;
 cvar_t* cm_noAreas;
 cvar_t* cm_noCurves;
 cvar_t* cm_playerCurveClip;
+cvar_t* cm_debugSurfaceUpdate;
+cvar_t* cm_cache;
+cvar_t* cm_pointGrid;
+cvar_t* cm_tightNodeOffsets;
 #endif
 
 
@@ -207,6 +210,44 @@ static void CM_BoundBrush( cbrush_t* b )
 }
 
 
+static void CM_BuildBrushSideGroups()
+{
+	int numGroups = 0;
+	for (int i = 0; i < cm.numBrushes; ++i)
+		numGroups += (cm.brushes[i].numsides + 3) / 4;
+
+	cbrushSideGroup_t* groups = H_New<cbrushSideGroup_t>( numGroups, h_high );
+	for (int i = 0; i < cm.numBrushes; ++i)
+	{
+		cbrush_t* b = &cm.brushes[i];
+		b->numSideGroups = (b->numsides + 3) / 4;
+		b->sideGroups = groups;
+		groups += b->numSideGroups;
+
+		for (int s = 0; s < b->numSideGroups * 4; ++s)
+		{
+			cbrushSideGroup_t* g = &b->sideGroups[s / 4];
+			const int lane = s % 4;
+			if (s < b->numsides)
+			{
+				const cplane_t* plane = b->sides[s].plane;
+				g->normals[0][lane] = plane->normal[0];
+				g->normals[1][lane] = plane->normal[1];
+				g->normals[2][lane] = plane->normal[2];
+				g->dists[lane] = plane->dist;
+			}
+			else
+			{
+				g->normals[0][lane] = 0.0f;
+				g->normals[1][lane] = 0.0f;
+				g->normals[2][lane] = 0.0f;
+				g->dists[lane] = BRUSH_SIDE_PADDING_DIST;
+			}
+		}
+	}
+}
+
+
 static void CMod_LoadBrushes( const lump_t* l )
 {
 	const dbrush_t* in = (const dbrush_t*)(cmod_base + l->fileofs);
@@ -230,6 +271,8 @@ static void CMod_LoadBrushes( const lump_t* l )
 		out->contents = cm.shaders[out->shaderNum].contentFlags;
 		CM_BoundBrush( out );
 	}
+
+	CM_BuildBrushSideGroups();
 }
 
 
@@ -405,6 +448,7 @@ static void CMod_LoadPatches( const lump_t* surfs, const lump_t* verts )
 		// FIXME: check for non-colliding patches
 
 		cm.surfaces[i] = H_New<cPatch_t>( h_high );
+		cm.surfaces[i]->patchNum = cm.numPatches++;
 
 		// load the full drawverts onto the stack
 		int w = LittleLong( in->patchWidth );
@@ -430,17 +474,98 @@ static void CMod_LoadPatches( const lump_t* surfs, const lump_t* verts )
 }
 
 
+cmStats_t* CM_ClaimStats()
+{
+	for ( ;; ) {
+		const int count = Sys_AtomicLoad( &cm_numStats );
+		if ( count >= CM_MAX_STATS_THREADS ) {
+			cm_threadStats = &cm_stats[CM_MAX_STATS_THREADS - 1];
+			break;
+		}
+		if ( Sys_AtomicCompareExchange( &cm_numStats, count, count + 1 ) ) {
+			cm_threadStats = &cm_stats[count];
+			break;
+		}
+	}
+
+	return cm_threadStats;
+}
+
+
+// the other threads can be updating their counters, which is fine for statistics
+void CM_SumStats( cmStats_t* total )
+{
+	Com_Memset( total, 0, sizeof( *total ) );
+	for ( int i = 0; i < CM_MAX_STATS_THREADS; ++i ) {
+		const cmStats_t* const stats = &cm_stats[i];
+		total->traces += stats->traces;
+		total->leafTraces += stats->leafTraces;
+		total->brushTraces += stats->brushTraces;
+		total->patchTraces += stats->patchTraces;
+		total->facetTraces += stats->facetTraces;
+		total->pointContents += stats->pointContents;
+	}
+}
+
+
+// only reads the counters so that the threads owning them can't lose updates
+void CM_PrintTraceStats()
+{
+	static cmStats_t printed;
+	cmStats_t total;
+	CM_SumStats( &total );
+	Com_Printf( "%4i traces  (%il %ib %ip %if) %4i points\n",
+			total.traces - printed.traces, total.leafTraces - printed.leafTraces,
+			total.brushTraces - printed.brushTraces, total.patchTraces - printed.patchTraces,
+			total.facetTraces - printed.facetTraces, total.pointContents - printed.pointContents );
+	printed = total;
+}
+
+
 void CM_ClearMap()
 {
+#ifndef BSPC
+	CM_StopCapture();	// the queries only make sense against the map they were recorded on
+#endif
 	Com_Memset( &cm, 0, sizeof( cm ) );
 	CM_ClearLevelPatches();
 }
 
 
+#ifndef BSPC
+static const cvarTableItem_t cm_cvars[] =
+{
+	{ &cm_cache, "cm_cache", "0", CVAR_CHEAT, CVART_BOOL, NULL, NULL, "caches processed collision maps in cmcache/" },
+	{ &cm_pointGrid, "cm_pointGrid", "1", CVAR_ARCHIVE, CVART_BOOL, NULL, NULL, "speeds up point queries with a grid built at map load" },
+	{ &cm_tightNodeOffsets, "cm_tightNodeOffsets", "0", CVAR_CHEAT, CVART_BOOL, NULL, NULL, "tighter box offsets for non-axial BSP nodes\n"
+		"Faster, but can change startsolid/allsolid results. Check with cm_tracetest first." }
+};
+
+static const cmdTableItem_t cm_cmds[] =
+{
+	{ "cm_tracetest", CM_TraceTest_f, NULL, "compares the loaded map's traces against the legacy tree traversal" },
+	{ "cm_patchinfo", CM_PatchInfo_f, NULL, "prints the loaded map's largest patches and facet test counts" },
+	{ "cm_capture", CM_Capture_f, NULL, "records the collision queries of the next server frames to cmcapture/" },
+	{ "cm_tracereplay", CM_TraceReplay_f, NULL, "replays a cm_capture file in every cm_tracetest mode" }
+};
+#endif
+
+
+void CM_Init()
+{
+#ifndef BSPC
+	Cvar_RegisterArray( cm_cvars, MODULE_COMMON );
+	Cmd_RegisterArray( cm_cmds, MODULE_COMMON );
+#endif
+}
+
+
 // loads in the map and all submodels
 
 void CM_LoadMap( const char* name, qbool clientload, unsigned* checksum )
 {
+	Prof_Scope profScope( "CM_LoadMap" );
+
 	if ( !name || !name[0] )
 		Com_Error( ERR_DROP, "CM_LoadMap: NULL name" );
 
@@ -461,6 +586,7 @@ void CM_LoadMap( const char* name, qbool clientload, unsigned* checksum )
 	cm_noAreas = Cvar_Get("cm_noAreas", "0", CVAR_CHEAT);
 	cm_noCurves = Cvar_Get("cm_noCurves", "0", CVAR_CHEAT);
 	cm_playerCurveClip = Cvar_Get("cm_playerCurveClip", "1", CVAR_CHEAT);
+	cm_debugSurfaceUpdate = Cvar_Get("r_debugSurfaceUpdate", "1", 0);
 	length = FS_ReadFile( name, (void **)&buf );
 #else
 	length = LoadQuakeFile((quakefile_t *) name, (void **)&buf);
@@ -483,25 +609,47 @@ void CM_LoadMap( const char* name, qbool clientload, unsigned* checksum )
 
 	cmod_base = buf;
 
-	CMod_LoadShaders( &header.lumps[LUMP_SHADERS] );
-	CMod_LoadLeafs( &header.lumps[LUMP_LEAFS] );
-	CMod_LoadLeafBrushes( &header.lumps[LUMP_LEAFBRUSHES] );
-	CMod_LoadLeafSurfaces( &header.lumps[LUMP_LEAFSURFACES] );
-	CMod_LoadPlanes( &header.lumps[LUMP_PLANES] );
-	CMod_LoadBrushSides( &header.lumps[LUMP_BRUSHSIDES] );
-	CMod_LoadBrushes( &header.lumps[LUMP_BRUSHES] );
-	CMod_LoadSubmodels( &header.lumps[LUMP_MODELS] );
-	CMod_LoadNodes( &header.lumps[LUMP_NODES] );
-	CMod_LoadEntityString( &header.lumps[LUMP_ENTITIES] );
-	CMod_LoadVisibility( &header.lumps[LUMP_VISIBILITY] );
-	CMod_LoadPatches( &header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS] );
+#ifndef BSPC
+	const int startTime = Sys_Milliseconds();
+	if ( cm_cache->integer && CM_LoadCachedMap( name, last_checksum, length ) ) {
+		Com_DPrintf( "CM_LoadMap: loaded %s from the cache in %d ms\n", name, Sys_Milliseconds() - startTime );
+	} else
+#endif
+	{
+		CMod_LoadShaders( &header.lumps[LUMP_SHADERS] );
+		CMod_LoadLeafs( &header.lumps[LUMP_LEAFS] );
+		CMod_LoadLeafBrushes( &header.lumps[LUMP_LEAFBRUSHES] );
+		CMod_LoadLeafSurfaces( &header.lumps[LUMP_LEAFSURFACES] );
+		CMod_LoadPlanes( &header.lumps[LUMP_PLANES] );
+		CMod_LoadBrushSides( &header.lumps[LUMP_BRUSHSIDES] );
+		CMod_LoadBrushes( &header.lumps[LUMP_BRUSHES] );
+		CMod_LoadSubmodels( &header.lumps[LUMP_MODELS] );
+		CMod_LoadNodes( &header.lumps[LUMP_NODES] );
+		CMod_LoadEntityString( &header.lumps[LUMP_ENTITIES] );
+		CMod_LoadVisibility( &header.lumps[LUMP_VISIBILITY] );
+		CMod_LoadPatches( &header.lumps[LUMP_SURFACES], &header.lumps[LUMP_DRAWVERTS] );
+#ifndef BSPC
+		Com_DPrintf( "CM_LoadMap: processed %s in %d ms\n", name, Sys_Milliseconds() - startTime );
+		if ( cm_cache->integer ) {
+			CM_SaveCachedMap( name, last_checksum, length );
+		}
+#endif
+	}
 
 	// we are NOT freeing the file, because it is cached for the ref
 	FS_FreeFile(buf);
 
 	CM_InitBoxHull();
 
-	CM_FloodAreaConnections();
+	CM_InitAreaConnections();
+
+#ifndef BSPC
+	if ( cm_pointGrid->integer ) {
+		CM_InitPointGrid();
+	}
+#endif
+
+	cm.checksum = last_checksum;
 
 	// allow this to be cached if it is loaded by the server
 	if ( !clientload ) {
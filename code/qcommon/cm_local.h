@@ -56,18 +56,28 @@ typedef struct {
 	int			shaderNum;
 } cbrushside_t;
 
+// 4 brush sides in structure-of-arrays form for the SSE2 brush tests
+// the padding sides have a null normal and a huge distance so that they're never relevant
+#define BRUSH_SIDE_PADDING_DIST	1.0e30f
+
+typedef struct {
+	float		normals[3][4];
+	float		dists[4];
+} cbrushSideGroup_t;
+
 typedef struct {
 	int			shaderNum;		// the shader that determined the contents
 	int			contents;
 	vec3_t		bounds[2];
 	int			numsides;
 	cbrushside_t	*sides;
-	int			checkcount;		// to avoid repeated testings
+	int			numSideGroups;	// ( numsides + 3 ) / 4, 0 for the temp box brush
+	cbrushSideGroup_t	*sideGroups;	// copy of sides, the scalar code is the reference
 } cbrush_t;
 
 
 typedef struct {
-	int			checkcount;				// to avoid repeated testings
+	int			patchNum;				// index in the visited sets
 	int			surfaceFlags;
 	int			contents;
 	struct patchCollide_s	*pc;
@@ -79,6 +89,15 @@ typedef struct {
 	int			floodvalid;
 } cArea_t;
 
+// uniform grid over the world model for point queries
+// each cell has the deepest node whose subtree holds the whole cell
+typedef struct {
+	vec3_t		origin;			// mins of the first cell
+	float		invCellSize;
+	int			size[3];		// cell counts
+	int			*cells;			// [ size[0]*size[1]*size[2] ] node numbers, -1-leafnum for leafs
+} cPointGrid_t;
+
 typedef struct {
 	char		name[MAX_QPATH];
 
@@ -120,28 +139,65 @@ typedef struct {
 	int			numAreas;
 	cArea_t		*areas;
 	int			*areaPortals;	// [ numAreas*numAreas ] reference counts
+	int			areaBytes;		// size of one areaBits row
+	byte		*areaBits;		// [ (numAreas+2)*areaBytes ] row N: areas connected to area N
+								// the last 2 rows are for no area and for cm_noAreas
 
 	int			numSurfaces;
 	cPatch_t	**surfaces;			// non-patches will be NULL
+	int			numPatches;
+
+	cPointGrid_t	pointGrid;		// no cells when disabled
 
 	int			floodvalid;
-	int			checkcount;					// incremented on each trace
+	int			lastFloodnum;	// floodnums are never reused so that floods can be split in place
+
+	unsigned	checksum;		// of the BSP file
 } clipMap_t;
 
+// to allow boxes to be treated as brush models, we allocate
+// some extra indexes along with those needed by the map
+#define	BOX_BRUSHES		1
+#define	BOX_SIDES		6
+#define	BOX_LEAFS		2
+#define	BOX_PLANES		12
+
 
 // keep 1/8 unit away to keep the position valid before network snapping
 // and to avoid various numeric issues
 #define	SURFACE_CLIP_EPSILON	(0.125)
 
 extern	clipMap_t	cm;
-extern	int			c_pointcontents;
-extern	int			c_traces, c_brush_traces, c_patch_traces;
 extern	cvar_t		*cm_noAreas;
 extern	cvar_t		*cm_noCurves;
 extern	cvar_t		*cm_playerCurveClip;
+extern	cvar_t		*cm_debugSurfaceUpdate;
+extern	cvar_t		*cm_cache;
+extern	cvar_t		*cm_pointGrid;
+extern	cvar_t		*cm_tightNodeOffsets;
+
+// cm_cache.cpp
+void CM_SaveCachedMap( const char* mapName, unsigned checksum, int bspSize );
+qbool CM_LoadCachedMap( const char* mapName, unsigned checksum, int bspSize );	// fills cm on success
+
+// cm_debug.cpp
+typedef enum {
+	CMNO_CVAR,		// cm_tightNodeOffsets decides
+	CMNO_LEGACY,	// 2048 units box offset for non-axial nodes
+	CMNO_TIGHT		// the box's support distance along the node's normal
+} cmNodeOffsets_t;
+
+extern	cmNodeOffsets_t	cm_testNodeOffsets;	// for cm_tracetest
+extern	qbool		cm_scalarBrushTests;	// reference brush tests instead of the SSE2 ones, for cm_tracetest
+extern	qbool		cm_linearFacetTests;	// every patch facet instead of the facet tree's, for cm_tracetest
+void CM_TraceTest_f();
+void CM_StopCapture();
+void CM_Capture_f();
+void CM_TraceReplay_f();
 
 // cm_test.c
-extern void CM_FloodAreaConnections();
+extern void CM_InitAreaConnections();
+extern void CM_InitPointGrid();
 
 // Used for oriented capsule collision detection
 typedef struct
@@ -152,6 +208,58 @@ typedef struct
 	vec3_t		offset;
 } sphere_t;
 
+// statistics, per thread so that queries can run concurrently
+typedef struct {
+	int		traces;
+	int		leafTraces;
+	int		brushTraces;
+	int		patchTraces;
+	int		facetTraces;
+	int		pointContents;
+} cmStats_t;
+
+extern THREAD_LOCAL cmStats_t* cm_threadStats;
+
+cmStats_t* CM_ClaimStats();
+void CM_SumStats( cmStats_t* total );	// of all threads
+
+// the calling thread's counters
+static ID_INLINE cmStats_t* CM_Stats()
+{
+	return cm_threadStats ? cm_threadStats : CM_ClaimStats();
+}
+
+// brushes and patches can be in multiple leafs, so every query
+// keeps track of the ones it already tested
+// items past the capacity are never considered tested, which only costs redundant tests
+// every thread has a single set, which is fine since queries never start other queries
+#define MAX_VISITED_BRUSHES		MAX_MAP_BRUSHES
+#define MAX_VISITED_PATCHES		MAX_MAP_DRAW_SURFS
+
+typedef struct {
+	unsigned int	brushes[MAX_VISITED_BRUSHES / 32];
+	unsigned int	patches[MAX_VISITED_PATCHES / 32];
+} cmVisited_t;
+
+cmVisited_t* CM_ClearVisited();	// the calling thread's set
+
+static ID_INLINE qbool CM_FirstVisit( unsigned int* bits, int maxBits, int index )
+{
+	if ( (unsigned int)index >= (unsigned int)maxBits )
+		return qtrue;
+
+	unsigned int* const word = &bits[index >> 5];
+	const unsigned int mask = 1u << ( index & 31 );
+	if ( *word & mask )
+		return qfalse;
+
+	*word |= mask;
+	return qtrue;
+}
+
+#define CM_FirstBrushVisit( visited, brushNum )	CM_FirstVisit( (visited)->brushes, MAX_VISITED_BRUSHES, (brushNum) )
+#define CM_FirstPatchVisit( visited, patch )	CM_FirstVisit( (visited)->patches, MAX_VISITED_PATCHES, (patch)->patchNum )
+
 typedef struct {
 	vec3_t		start;
 	vec3_t		end;
@@ -163,8 +271,10 @@ typedef struct {
 	vec3_t		modelOrigin;// origin of the model tracing through
 	int			contents;	// ored contents of the model tracing through
 	qbool	isPoint;	// optimized case
+	qbool	tightNodeOffsets;	// see cm_tightNodeOffsets
 	trace_t		trace;		// returned from trace call
 	sphere_t	sphere;		// sphere for oriendted capsule collision
+	cmVisited_t	*visited;
 } traceWork_t;
 
 typedef struct leafList_s {
@@ -174,6 +284,8 @@ typedef struct leafList_s {
 	int		*list;
 	vec3_t	bounds[2];
 	int		lastLeaf;		// for overflows where each leaf can't be stored individually
+	float	*margin;		// if not NULL, the smallest CM_BoxPlaneMargin of the visited nodes
+	cmVisited_t	*visited;	// the brushes already stored by CM_StoreBrushes
 	void	(*storeLeafs)( struct leafList_s *ll, int nodenum );
 } leafList_t;
 
@@ -197,3 +309,4 @@ struct patchCollide_s* CM_GeneratePatchCollide( int width, int height, const vec
 void CM_TraceThroughPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 qbool CM_PositionTestInPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc );
 void CM_ClearLevelPatches( void );
+void CM_PatchInfo_f();
@@ -84,8 +84,9 @@ int	c_totalPatchBlocks;
 int	c_totalPatchSurfaces;
 int	c_totalPatchEdges;
 
-static const patchCollide_t	*debugPatchCollide;
-static const facet_t		*debugFacet;
+// traces record the facet they hit for the thread they run on,
+// so the debug surface is the last one hit on the thread drawing it
+static THREAD_LOCAL const facet_t	*debugFacet;
 static qbool		debugBlock;
 static vec3_t		debugBlockPoints[4];
 
@@ -95,7 +96,6 @@ CM_ClearLevelPatches
 =================
 */
 void CM_ClearLevelPatches( void ) {
-	debugPatchCollide = NULL;
 	debugFacet = NULL;
 }
 
@@ -420,6 +420,9 @@ static	patchPlane_t	planes[MAX_PATCH_PLANES];
 static	int				numFacets;
 static	facet_t			facets[MAX_PATCH_PLANES]; //maybe MAX_FACETS ??
 
+static	int				numFacetNodes;
+static	facetNode_t		facetNodes[2 * MAX_FACETS];
+
 #define	NORMAL_EPSILON	0.0001
 #define	DIST_EPSILON	0.02
 
@@ -812,11 +815,20 @@ static void CM_AddFacetBevels( facet_t *facet ) {
 		ChopWindingInPlace( &w, plane, plane[3], 0.1f );
 	}
 	if ( !w ) {
+		// no axial bevels, so the facet tree can't cull it
+		VectorSet( facet->bounds[0], -MAX_MAP_BOUNDS, -MAX_MAP_BOUNDS, -MAX_MAP_BOUNDS );
+		VectorSet( facet->bounds[1], MAX_MAP_BOUNDS, MAX_MAP_BOUNDS, MAX_MAP_BOUNDS );
 		return;
 	}
 
 	WindingBounds(w, mins, maxs);
 
+	// expand by one unit for epsilon purposes
+	for ( i = 0 ; i < 3 ; i++ ) {
+		facet->bounds[0][i] = mins[i] - 1;
+		facet->bounds[1][i] = maxs[i] + 1;
+	}
+
 	// add the axial planes
 	order = 0;
 	qbool flipped;
@@ -954,6 +966,37 @@ typedef enum {
 	EN_LEFT
 } edgeName_t;
 
+/*
+==================
+CM_BuildFacetTree_r
+
+Splits the facet range in half, which is good enough since consecutive
+facets come from the same grid column
+==================
+*/
+static void CM_BuildFacetTree_r( int firstFacet, int count ) {
+	if ( numFacetNodes == ARRAY_LEN( facetNodes ) ) {
+		Com_Error( ERR_DROP, "MAX_FACET_NODES" );
+	}
+
+	facetNode_t* const node = &facetNodes[numFacetNodes++];
+	node->firstFacet = firstFacet;
+	node->numFacets = count;
+	ClearBounds( node->bounds[0], node->bounds[1] );
+	for ( int i = firstFacet ; i < firstFacet + count ; i++ ) {
+		AddPointToBounds( facets[i].bounds[0], node->bounds[0], node->bounds[1] );
+		AddPointToBounds( facets[i].bounds[1], node->bounds[0], node->bounds[1] );
+	}
+
+	if ( count > MAX_FACET_NODE_LEAF_FACETS ) {
+		const int half = count / 2;
+		CM_BuildFacetTree_r( firstFacet, half );
+		CM_BuildFacetTree_r( firstFacet + half, count - half );
+	}
+
+	node->skipNode = numFacetNodes;
+}
+
 /*
 ==================
 CM_PatchCollideFromGrid
@@ -1114,6 +1157,15 @@ static void CM_PatchCollideFromGrid( cGrid_t *grid, patchCollide_t *pf ) {
 	Com_Memcpy( pf->facets, facets, numFacets * sizeof( *pf->facets ) );
 	pf->planes = (patchPlane_t*)Hunk_Alloc( numPlanes * sizeof( *pf->planes ), h_high );
 	Com_Memcpy( pf->planes, planes, numPlanes * sizeof( *pf->planes ) );
+
+	// build the facet tree for culling
+	numFacetNodes = 0;
+	if ( numFacets > 0 ) {
+		CM_BuildFacetTree_r( 0, numFacets );
+	}
+	pf->numNodes = numFacetNodes;
+	pf->nodes = (facetNode_t*)Hunk_Alloc( numFacetNodes * sizeof( *pf->nodes ), h_high );
+	Com_Memcpy( pf->nodes, facetNodes, numFacetNodes * sizeof( *pf->nodes ) );
 }
 
 
@@ -1203,6 +1255,76 @@ TRACE TESTING
 ================================================================================
 */
 
+/*
+====================
+CM_FirstFacet / CM_NextFacet
+
+Iterate over the facets whose bounds overlap the trace's bounds
+in increasing order, using the facet tree
+====================
+*/
+typedef struct {
+	const patchCollide_t	*pc;
+	const traceWork_t		*tw;
+	int						node;
+	int						facet;
+	int						endFacet;
+} facetCursor_t;
+
+static qbool CM_NextFacetLeaf( facetCursor_t *c ) {
+	const patchCollide_t* const pc = c->pc;
+
+	while ( c->node < pc->numNodes ) {
+		const facetNode_t* const node = &pc->nodes[c->node];
+		if ( !CM_BoundsIntersect( c->tw->bounds[0], c->tw->bounds[1], node->bounds[0], node->bounds[1] ) ) {
+			c->node = node->skipNode;
+			continue;
+		}
+		if ( node->numFacets > MAX_FACET_NODE_LEAF_FACETS ) {
+			c->node++;
+			continue;
+		}
+		c->facet = node->firstFacet;
+		c->endFacet = node->firstFacet + node->numFacets;
+		c->node = node->skipNode;
+		return qtrue;
+	}
+
+	return qfalse;
+}
+
+static const facet_t *CM_NextFacet( facetCursor_t *c ) {
+	for (;;) {
+		while ( c->facet < c->endFacet ) {
+			const facet_t* const facet = &c->pc->facets[c->facet++];
+			if ( cm_linearFacetTests || CM_BoundsIntersect( c->tw->bounds[0], c->tw->bounds[1], facet->bounds[0], facet->bounds[1] ) ) {
+				CM_Stats()->facetTraces++;
+				return facet;
+			}
+		}
+		if ( !CM_NextFacetLeaf( c ) ) {
+			return NULL;
+		}
+	}
+}
+
+static const facet_t *CM_FirstFacet( facetCursor_t *c, const traceWork_t *tw, const patchCollide_t *pc ) {
+	c->pc = pc;
+	c->tw = tw;
+	if ( cm_linearFacetTests ) {
+		// the reference: every facet in a single pass
+		c->node = pc->numNodes;
+		c->facet = 0;
+		c->endFacet = pc->numFacets;
+	} else {
+		c->node = 0;
+		c->facet = 0;
+		c->endFacet = 0;
+	}
+
+	return CM_NextFacet( c );
+}
+
 /*
 ====================
 CM_TracePointThroughPatchCollide
@@ -1219,9 +1341,6 @@ static void CM_TracePointThroughPatchCollide( traceWork_t *tw, const struct patc
 	int			i, j, k;
 	float		offset;
 	float		d1, d2;
-#ifndef BSPC
-	static cvar_t *cv;
-#endif //BSPC
 
 #ifndef BSPC
 	if ( !cm_playerCurveClip->integer || !tw->isPoint ) {
@@ -1252,8 +1371,8 @@ static void CM_TracePointThroughPatchCollide( traceWork_t *tw, const struct patc
 
 
 	// see if any of the surface planes are intersected
-	facet = pc->facets;
-	for ( i = 0 ; i < pc->numFacets ; i++, facet++ ) {
+	facetCursor_t cursor;
+	for ( facet = CM_FirstFacet( &cursor, tw, pc ) ; facet ; facet = CM_NextFacet( &cursor ) ) {
 		if ( !frontFacing[facet->surfacePlane] ) {
 			continue;
 		}
@@ -1279,11 +1398,7 @@ static void CM_TracePointThroughPatchCollide( traceWork_t *tw, const struct patc
 		if ( j == facet->numBorders ) {
 			// we hit this facet
 #ifndef BSPC
-			if (!cv) {
-				cv = Cvar_Get( "r_debugSurfaceUpdate", "1", 0 );
-			}
-			if (cv->integer) {
-				debugPatchCollide = pc;
+			if (cm_debugSurfaceUpdate->integer) {
 				debugFacet = facet;
 			}
 #endif //BSPC
@@ -1357,15 +1472,12 @@ CM_TraceThroughPatchCollide
 ====================
 */
 void CM_TraceThroughPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc ) {
-	int i, j, hit, hitnum;
+	int j, hit, hitnum;
 	float offset, enterFrac, leaveFrac, t;
 	patchPlane_t *lplanes;
-	facet_t	*facet;
+	const facet_t	*facet;
 	float plane[4] = {0, 0, 0, 0}, bestplane[4] = {0, 0, 0, 0};
 	vec3_t startp, endp;
-#ifndef BSPC
-	static cvar_t *cv;
-#endif //BSPC
 
 	if (!CM_BoundsIntersect( tw->bounds[0], tw->bounds[1], pc->bounds[0], pc->bounds[1] ))
 		return;
@@ -1375,8 +1487,8 @@ void CM_TraceThroughPatchCollide( traceWork_t *tw, const struct patchCollide_s *
 		return;
 	}
 
-	facet = pc->facets;
-	for ( i = 0 ; i < pc->numFacets ; i++, facet++ ) {
+	facetCursor_t cursor;
+	for ( facet = CM_FirstFacet( &cursor, tw, pc ) ; facet ; facet = CM_NextFacet( &cursor ) ) {
 		enterFrac = -1.0;
 		leaveFrac = 1.0;
 		hitnum = -1;
@@ -1464,11 +1576,7 @@ void CM_TraceThroughPatchCollide( traceWork_t *tw, const struct patchCollide_s *
 					enterFrac = 0;
 				}
 #ifndef BSPC
-				if (!cv) {
-					cv = Cvar_Get( "r_debugSurfaceUpdate", "1", 0 );
-				}
-				if (cv && cv->integer) {
-					debugPatchCollide = pc;
+				if (cm_debugSurfaceUpdate->integer) {
 					debugFacet = facet;
 				}
 #endif //BSPC
@@ -1496,10 +1604,10 @@ CM_PositionTestInPatchCollide
 ====================
 */
 qbool CM_PositionTestInPatchCollide( traceWork_t *tw, const struct patchCollide_s *pc ) {
-	int i, j;
+	int j;
 	float offset, t;
 	patchPlane_t *lplanes;
-	facet_t	*facet;
+	const facet_t	*facet;
 	float plane[4];
 	vec3_t startp;
 
@@ -1507,8 +1615,8 @@ qbool CM_PositionTestInPatchCollide( traceWork_t *tw, const struct patchCollide_
 		return qfalse;
 	}
 
-	facet = pc->facets;
-	for ( i = 0 ; i < pc->numFacets ; i++, facet++ ) {
+	facetCursor_t cursor;
+	for ( facet = CM_FirstFacet( &cursor, tw, pc ) ; facet ; facet = CM_NextFacet( &cursor ) ) {
 		lplanes = &pc->planes[ facet->surfacePlane ];
 		VectorCopy(lplanes->plane, plane);
 		plane[3] = lplanes->plane[3];
@@ -1598,6 +1706,17 @@ Called from the renderer
 void BotDrawDebugPolygons(void (*drawPoly)(int color, int numPoints, const float* points), int value);
 #endif
 
+static const patchCollide_t* CM_FacetPatchCollide( const facet_t* facet )
+{
+	for ( int i = 0; i < cm.numSurfaces; ++i ) {
+		const cPatch_t* const patch = cm.surfaces[i];
+		if ( patch && facet >= patch->pc->facets && facet < patch->pc->facets + patch->pc->numFacets )
+			return patch->pc;
+	}
+
+	return NULL;
+}
+
 void CM_DrawDebugSurface( void (*drawPoly)(int color, int numPoints, const float* points) )
 {
 	static cvar_t	*cv;
@@ -1627,7 +1746,7 @@ void CM_DrawDebugSurface( void (*drawPoly)(int color, int numPoints, const float
 	}
 #endif
 
-	if ( !debugPatchCollide ) {
+	if ( !debugFacet ) {
 		return;
 	}
 
@@ -1636,7 +1755,10 @@ void CM_DrawDebugSurface( void (*drawPoly)(int color, int numPoints, const float
 		cv = Cvar_Get( "cm_debugSize", "2", 0 );
 	}
 #endif
-	pc = debugPatchCollide;
+	pc = CM_FacetPatchCollide( debugFacet );
+	if ( !pc ) {
+		return;
+	}
 
 	for ( i = 0, facet = pc->facets ; i < pc->numFacets ; i++, facet++ ) {
 
@@ -1755,3 +1877,58 @@ void CM_DrawDebugSurface( void (*drawPoly)(int color, int numPoints, const float
 	drawPoly( 4, v[0] );
 #endif
 }
+
+
+#ifndef BSPC
+
+static int CM_ComparePatchFacets( const void* a, const void* b )
+{
+	const cPatch_t* const pa = *(const cPatch_t* const*)a;
+	const cPatch_t* const pb = *(const cPatch_t* const*)b;
+
+	return pb->pc->numFacets - pa->pc->numFacets;
+}
+
+void CM_PatchInfo_f()
+{
+	if ( !cm.numNodes ) {
+		Com_Printf( "ERROR: no map loaded\n" );
+		return;
+	}
+
+	const int maxPrinted = Cmd_Argc() >= 2 ? atoi( Cmd_Argv(1) ) : 10;
+
+	const cPatch_t** const patches = (const cPatch_t**)Hunk_AllocateTempMemory( max( cm.numPatches, 1 ) * sizeof( cPatch_t* ) );
+	int numPatches = 0;
+	int totalFacets = 0;
+	int totalPlanes = 0;
+	int totalNodes = 0;
+	for ( int i = 0; i < cm.numSurfaces; ++i ) {
+		const cPatch_t* const patch = cm.surfaces[i];
+		if ( !patch )
+			continue;
+		patches[numPatches++] = patch;
+		totalFacets += patch->pc->numFacets;
+		totalPlanes += patch->pc->numPlanes;
+		totalNodes += patch->pc->numNodes;
+	}
+	qsort( patches, numPatches, sizeof( patches[0] ), &CM_ComparePatchFacets );
+
+	Com_Printf( "%6s %6s %6s %6s %14s\n", "patch", "facets", "planes", "nodes", "size" );
+	for ( int i = 0; i < min( numPatches, maxPrinted ); ++i ) {
+		const patchCollide_t* const pc = patches[i]->pc;
+		Com_Printf( "%6d %6d %6d %6d %4d %4d %4d\n", patches[i]->patchNum, pc->numFacets, pc->numPlanes, pc->numNodes,
+			(int)( pc->bounds[1][0] - pc->bounds[0][0] ), (int)( pc->bounds[1][1] - pc->bounds[0][1] ), (int)( pc->bounds[1][2] - pc->bounds[0][2] ) );
+	}
+	Com_Printf( "%d patches: %d facets, %d planes, %d facet tree nodes\n", numPatches, totalFacets, totalPlanes, totalNodes );
+	cmStats_t stats;
+	CM_SumStats( &stats );
+	if ( stats.patchTraces > 0 ) {
+		Com_Printf( "%d facets tested in %d patch traces (%.2f per trace)\n",
+			stats.facetTraces, stats.patchTraces, (float)stats.facetTraces / (float)stats.patchTraces );
+	}
+
+	Hunk_FreeTempMemory( patches );
+}
+
+#endif
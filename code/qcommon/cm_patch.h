@@ -74,14 +74,29 @@ typedef struct {
 	int		borderPlanes[4+6+16];
 	qbool	borderInward[4+6+16];
 	qbool	borderNoAdjust[4+6+16];
+	vec3_t	bounds[2];		// the facet's winding expanded by one unit, nothing outside can collide
 } facet_t;
 
+// the facet tree never reorders facets: every node covers a contiguous range of them
+// and the nodes are stored depth-first, so visiting them in order yields the facets
+// in the same order as a linear scan and the results of ties don't change
+#define	MAX_FACET_NODE_LEAF_FACETS	4
+
+typedef struct {
+	vec3_t	bounds[2];
+	int		firstFacet;
+	int		numFacets;		// more than MAX_FACET_NODE_LEAF_FACETS for internal nodes
+	int		skipNode;		// the node following this one's sub-tree
+} facetNode_t;
+
 typedef struct patchCollide_s {
 	vec3_t	bounds[2];
 	int		numPlanes;			// surface planes plus edge planes
 	patchPlane_t	*planes;
 	int		numFacets;
 	facet_t	*facets;
+	int		numNodes;
+	facetNode_t	*nodes;
 } patchCollide_t;
 
 
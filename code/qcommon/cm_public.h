@@ -23,8 +23,15 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "qfiles.h"
 
 
+void CM_Init();
 void CM_LoadMap( const char* name, qbool clientload, unsigned* checksum );
 void CM_ClearMap();
+void CM_PrintTraceStats(); // of all threads since the last call, for com_showtrace
+void CM_EndCaptureFrame();	// counts down the server frames cm_capture records
+// the server reports its own queries so that a listen server's client and cgame traces aren't recorded
+// does nothing unless cm_capture was started on the calling thread
+void CM_CaptureTrace( const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs, clipHandle_t model,
+					  int brushmask, const vec3_t origin, const vec3_t angles, int capsule );	// NULL origin for CM_BoxTrace
 clipHandle_t CM_InlineModel( int index );		// 0 = world, 1 + are bmodels
 clipHandle_t CM_TempBoxModel( const vec3_t mins, const vec3_t maxs, int capsule );
 
@@ -33,6 +40,9 @@ void		CM_ModelBounds( clipHandle_t model, vec3_t mins, vec3_t maxs );
 int			CM_NumInlineModels( void );
 const char* CM_EntityString();
 
+// the point contents and trace queries keep all their state on the stack and can run concurrently
+// with each other, but not with CM_LoadMap or with CM_TempBoxModel while the temp model is in use
+
 // returns an ORed contents mask
 int			CM_PointContents( const vec3_t p, clipHandle_t model );
 int			CM_TransformedPointContents( const vec3_t p, clipHandle_t model, const vec3_t origin, const vec3_t angles );
@@ -53,12 +63,17 @@ int			CM_PointLeafnum( const vec3_t p );
 // overflow if return listsize and if *lastLeaf != list[listsize-1]
 int			CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *list,
 		 					int listsize, int *lastLeaf );
+// same leafs as CM_BoxLeafnums, plus how far the box's corners can move
+// before the returned leafs can change
+int			CM_BoxLeafnumsMargin( const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf, float *margin );
 
 int			CM_LeafCluster (int leafnum);
 int			CM_LeafArea (int leafnum);
 
 void		CM_AdjustAreaPortalState( int area1, int area2, qbool open );
 qbool	CM_AreasConnected( int area1, int area2 );
+// bit N is set when area N is connected to area, for a single bit probe per area
+const byte*	CM_ConnectedAreas( int area );
 
 int			CM_WriteAreaBits( byte *buffer, int area );
 
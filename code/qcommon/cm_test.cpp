@@ -48,16 +48,124 @@ int CM_PointLeafnum_r( const vec3_t p, int num ) {
 			num = node->children[0];
 	}
 
-	c_pointcontents++;		// optimize counter
+	CM_Stats()->pointContents++;		// optimize counter
 
 	return -1 - num;
 }
 
+/*
+==================
+CM_PointGridNode
+
+Returns the node to start descending from for the point
+==================
+*/
+static int CM_PointGridNode( const vec3_t p ) {
+	const cPointGrid_t* const grid = &cm.pointGrid;
+	if ( !grid->cells ) {
+		return 0;
+	}
+
+	int index = 0;
+	for ( int i = 2; i >= 0; --i ) {
+		const float c = ( p[i] - grid->origin[i] ) * grid->invCellSize;
+		if ( !( c >= 0.0f && c < (float)grid->size[i] ) ) {
+			return 0;
+		}
+		index = index * grid->size[i] + (int)c;
+	}
+
+	return grid->cells[index];
+}
+
 int CM_PointLeafnum( const vec3_t p ) {
 	if ( !cm.numNodes ) {	// map not loaded
 		return 0;
 	}
-	return CM_PointLeafnum_r (p, 0);
+	return CM_PointLeafnum_r (p, CM_PointGridNode (p));
+}
+
+
+/*
+======================================================================
+
+POINT GRID
+
+======================================================================
+*/
+
+#define POINT_GRID_MIN_CELL_SIZE	32
+#define POINT_GRID_MAX_CELLS		(1 << 18)
+#define POINT_GRID_EPSILON			1.0f	// keeps points on cell borders away from the planes
+
+
+// the deepest node whose subtree holds the whole box
+static int CM_BoxStartNode( const vec3_t mins, const vec3_t maxs ) {
+	int num = 0;
+	while ( num >= 0 ) {
+		const cNode_t* const node = cm.nodes + num;
+		const int s = BoxOnPlaneSide( mins, maxs, node->plane );
+		if ( s == 1 ) {
+			num = node->children[0];
+		} else if ( s == 2 ) {
+			num = node->children[1];
+		} else {
+			break;
+		}
+	}
+
+	return num;
+}
+
+
+void CM_InitPointGrid() {
+	if ( cm.numNodes <= 0 || cm.numSubModels <= 0 ) {
+		return;
+	}
+
+	cPointGrid_t* const grid = &cm.pointGrid;
+	const cmodel_t* const world = &cm.cmodels[0];
+	int cellSize = POINT_GRID_MIN_CELL_SIZE;
+	int64_t numCells;
+	for (;;) {
+		numCells = 1;
+		for ( int i = 0; i < 3; ++i ) {
+			grid->size[i] = max( (int)ceilf( ( world->maxs[i] - world->mins[i] ) / cellSize ), 1 );
+			numCells *= grid->size[i];
+		}
+		if ( numCells <= POINT_GRID_MAX_CELLS ) {
+			break;
+		}
+		cellSize *= 2;
+	}
+
+	VectorCopy( world->mins, grid->origin );
+	grid->invCellSize = 1.0f / cellSize;
+	grid->cells = H_New<int>( (int)numCells, h_high );
+
+	int* cell = grid->cells;
+	int leafCells = 0;
+	for ( int z = 0; z < grid->size[2]; ++z ) {
+		for ( int y = 0; y < grid->size[1]; ++y ) {
+			for ( int x = 0; x < grid->size[0]; ++x ) {
+				vec3_t mins, maxs;
+				mins[0] = grid->origin[0] + x * cellSize - POINT_GRID_EPSILON;
+				mins[1] = grid->origin[1] + y * cellSize - POINT_GRID_EPSILON;
+				mins[2] = grid->origin[2] + z * cellSize - POINT_GRID_EPSILON;
+				maxs[0] = mins[0] + cellSize + 2.0f * POINT_GRID_EPSILON;
+				maxs[1] = mins[1] + cellSize + 2.0f * POINT_GRID_EPSILON;
+				maxs[2] = mins[2] + cellSize + 2.0f * POINT_GRID_EPSILON;
+				*cell = CM_BoxStartNode( mins, maxs );
+				if ( *cell < 0 ) {
+					leafCells++;
+				}
+				cell++;
+			}
+		}
+	}
+
+	Com_DPrintf( "CM_InitPointGrid: %d cells of %d units, %d%% of them in a single leaf\n",
+				 (int)numCells, cellSize, (int)( ( 100 * (int64_t)leafCells ) / numCells ) );
 }
 
 
@@ -101,10 +209,20 @@ void CM_StoreBrushes( leafList_t *ll, int nodenum ) {
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
 		b = &cm.brushes[brushnum];
-		if ( b->checkcount == cm.checkcount ) {
-			continue;	// already checked this brush in another leaf
+		if ( brushnum < MAX_VISITED_BRUSHES ) {
+			if ( !CM_FirstBrushVisit( ll->visited, brushnum ) ) {
+				continue;	// already tested this brush from another leaf
+			}
+		} else {
+			for ( i = 0 ; i < ll->count ; i++ ) {
+				if ( ((cbrush_t **)ll->list)[i] == b ) {
+					break;	// already stored this brush from another leaf
+				}
+			}
+			if ( i != ll->count ) {
+				continue;
+			}
 		}
-		b->checkcount = cm.checkcount;
 		for ( i = 0 ; i < 3 ; i++ ) {
 			if ( b->bounds[0][i] >= ll->bounds[1][i] || b->bounds[1][i] <= ll->bounds[0][i] ) {
 				break;
@@ -137,6 +255,25 @@ CM_BoxLeafnums
 Fills in a list of all the leafs touched
 =============
 */
+// how far the box's corners can move before BoxOnPlaneSide's result changes
+static float CM_BoxPlaneMargin( const vec3_t mins, const vec3_t maxs, const cplane_t* plane )
+{
+	if ( plane->type < 3 ) {
+		return min( fabsf( mins[plane->type] - plane->dist ), fabsf( maxs[plane->type] - plane->dist ) );
+	}
+
+	float front = 0.0f;
+	float back = 0.0f;
+	for ( int i = 0; i < 3; ++i ) {
+		const float n = plane->normal[i];
+		front += n * ( n >= 0.0f ? maxs[i] : mins[i] );
+		back += n * ( n >= 0.0f ? mins[i] : maxs[i] );
+	}
+
+	return min( fabsf( front - plane->dist ), fabsf( back - plane->dist ) );
+}
+
+
 void CM_BoxLeafnums_r( leafList_t *ll, int nodenum ) {
 	cplane_t	*plane;
 	cNode_t		*node;
@@ -151,6 +288,9 @@ void CM_BoxLeafnums_r( leafList_t *ll, int nodenum ) {
 		node = &cm.nodes[nodenum];
 		plane = node->plane;
 		s = BoxOnPlaneSide( ll->bounds[0], ll->bounds[1], plane );
+		if ( ll->margin ) {
+			*ll->margin = min( *ll->margin, CM_BoxPlaneMargin( ll->bounds[0], ll->bounds[1], plane ) );
+		}
 		if (s == 1) {
 			nodenum = node->children[0];
 		} else if (s == 2) {
@@ -172,8 +312,27 @@ CM_BoxLeafnums
 int	CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf) {
 	leafList_t	ll;
 
-	cm.checkcount++;
+	VectorCopy( mins, ll.bounds[0] );
+	VectorCopy( maxs, ll.bounds[1] );
+	ll.count = 0;
+	ll.maxcount = listsize;
+	ll.list = list;
+	ll.storeLeafs = CM_StoreLeafs;
+	ll.lastLeaf = 0;
+	ll.overflowed = qfalse;
+	ll.margin = NULL;
+	ll.visited = NULL;
 
+	CM_BoxLeafnums_r( &ll, 0 );
+
+	*lastLeaf = ll.lastLeaf;
+	return ll.count;
+}
+
+
+int CM_BoxLeafnumsMargin( const vec3_t mins, const vec3_t maxs, int *list, int listsize, int *lastLeaf, float *margin )
+{
+	leafList_t ll;
 	VectorCopy( mins, ll.bounds[0] );
 	VectorCopy( maxs, ll.bounds[1] );
 	ll.count = 0;
@@ -182,6 +341,9 @@ int	CM_BoxLeafnums( const vec3_t mins, const vec3_t maxs, int *list, int listsiz
 	ll.storeLeafs = CM_StoreLeafs;
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
+	ll.margin = margin;
+	ll.visited = NULL;
+	*margin = MAX_MAP_BOUNDS;
 
 	CM_BoxLeafnums_r( &ll, 0 );
 
@@ -197,8 +359,6 @@ CM_BoxBrushes
 int CM_BoxBrushes( const vec3_t mins, const vec3_t maxs, cbrush_t **list, int listsize ) {
 	leafList_t	ll;
 
-	cm.checkcount++;
-
 	VectorCopy( mins, ll.bounds[0] );
 	VectorCopy( maxs, ll.bounds[1] );
 	ll.count = 0;
@@ -207,6 +367,8 @@ int CM_BoxBrushes( const vec3_t mins, const vec3_t maxs, cbrush_t **list, int li
 	ll.storeLeafs = CM_StoreBrushes;
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
+	ll.margin = NULL;
+	ll.visited = CM_ClearVisited();
 
 	CM_BoxLeafnums_r( &ll, 0 );
 
@@ -240,7 +402,7 @@ int CM_PointContents( const vec3_t p, clipHandle_t model ) {
 		const cmodel_t* clipm = CM_ClipHandleToModel( model );
 		leaf = &clipm->leaf;
 	} else {
-		leafnum = CM_PointLeafnum_r (p, 0);
+		leafnum = CM_PointLeafnum_r (p, CM_PointGridNode (p));
 		leaf = &cm.leafs[leafnum];
 	}
 
@@ -354,30 +516,122 @@ void CM_FloodArea_r( int areaNum, int floodnum) {
 	}
 }
 
+static byte* CM_AreaRow( int area )
+{
+	return cm.areaBits + area * cm.areaBytes;
+}
+
+
+// rewrites the connectivity rows of all the areas in the flood
+static void CM_WriteFloodRows( int floodnum )
+{
+	int		i;
+	byte	*row = NULL;
+
+	for (i = 0 ; i < cm.numAreas ; i++) {
+		if (cm.areas[i].floodnum != floodnum) {
+			continue;
+		}
+		if (!row) {
+			row = CM_AreaRow (i);
+			Com_Memset (row, 0, cm.areaBytes);
+		}
+		row[i>>3] |= 1<<(i&7);
+	}
+
+	for (i = 0 ; i < cm.numAreas ; i++) {
+		byte* const dest = CM_AreaRow (i);
+		if (cm.areas[i].floodnum == floodnum && dest != row) {
+			Com_Memcpy (dest, row, cm.areaBytes);
+		}
+	}
+}
+
 /*
 ====================
 CM_FloodAreaConnections
 
 ====================
 */
-void	CM_FloodAreaConnections() {
+static void CM_FloodAreaConnections() {
 	int		i;
 	cArea_t	*area;
 	int		floodnum;
 
 	// all current floods are now invalid
 	cm.floodvalid++;
-	floodnum = 0;
 
 	for (i = 0 ; i < cm.numAreas ; i++) {
 		area = &cm.areas[i];
 		if (area->floodvalid == cm.floodvalid) {
 			continue;		// already flooded into
 		}
-		floodnum++;
+		floodnum = ++cm.lastFloodnum;
 		CM_FloodArea_r (i, floodnum);
+		CM_WriteFloodRows (floodnum);
+	}
+
+}
+
+/*
+====================
+CM_SplitAreaFlood
+
+A portal inside the flood was closed.
+Only the flood's own areas can end up in new floods.
+====================
+*/
+static void CM_SplitAreaFlood( int floodnum ) {
+	int		i;
+	cArea_t	*area;
+	int		newFloodnum;
+
+	cm.floodvalid++;
+
+	for (i = 0 ; i < cm.numAreas ; i++) {
+		area = &cm.areas[i];
+		if (area->floodnum != floodnum) {
+			continue;		// other flood or already reflooded
+		}
+		newFloodnum = ++cm.lastFloodnum;
+		CM_FloodArea_r (i, newFloodnum);
+		CM_WriteFloodRows (newFloodnum);
+	}
+}
+
+/*
+====================
+CM_MergeAreaFloods
+
+A portal between the 2 floods was opened.
+====================
+*/
+static void CM_MergeAreaFloods( int floodnum, int otherFloodnum ) {
+	int		i;
+
+	for (i = 0 ; i < cm.numAreas ; i++) {
+		if (cm.areas[i].floodnum == otherFloodnum) {
+			cm.areas[i].floodnum = floodnum;
+		}
 	}
 
+	CM_WriteFloodRows (floodnum);
+}
+
+/*
+====================
+CM_InitAreaConnections
+
+====================
+*/
+void CM_InitAreaConnections() {
+	cm.areaBytes = (cm.numAreas+7)>>3;
+	cm.areaBits = H_New<byte>( (cm.numAreas + 2) * cm.areaBytes, h_high );
+
+	// the row for no area stays empty, the one for cm_noAreas is full
+	Com_Memset (CM_AreaRow (cm.numAreas + 1), 255, cm.areaBytes);
+
+	CM_FloodAreaConnections ();
 }
 
 /*
@@ -395,18 +649,25 @@ void	CM_AdjustAreaPortalState( int area1, int area2, qbool open ) {
 		Com_Error (ERR_DROP, "CM_ChangeAreaPortalState: bad area number");
 	}
 
+	const int floodnum1 = cm.areas[area1].floodnum;
+	const int floodnum2 = cm.areas[area2].floodnum;
+
 	if ( open ) {
 		cm.areaPortals[ area1 * cm.numAreas + area2 ]++;
 		cm.areaPortals[ area2 * cm.numAreas + area1 ]++;
+		if ( floodnum1 != floodnum2 ) {
+			CM_MergeAreaFloods( floodnum1, floodnum2 );
+		}
 	} else {
 		cm.areaPortals[ area1 * cm.numAreas + area2 ]--;
 		cm.areaPortals[ area2 * cm.numAreas + area1 ]--;
 		if ( cm.areaPortals[ area2 * cm.numAreas + area1 ] < 0 ) {
 			Com_Error (ERR_DROP, "CM_AdjustAreaPortalState: negative reference count");
 		}
+		if ( cm.areaPortals[ area2 * cm.numAreas + area1 ] == 0 ) {
+			CM_SplitAreaFlood( floodnum1 );
+		}
 	}
-
-	CM_FloodAreaConnections ();
 }
 
 /*
@@ -430,13 +691,43 @@ qbool	CM_AreasConnected( int area1, int area2 ) {
 		Com_Error (ERR_DROP, "area >= cm.numAreas");
 	}
 
-	if (cm.areas[area1].floodnum == cm.areas[area2].floodnum) {
+	if (CM_AreaRow(area1)[area2>>3] & (1<<(area2&7))) {
 		return qtrue;
 	}
 	return qfalse;
 }
 
 
+/*
+=================
+CM_ConnectedAreas
+
+Returns the bit vector of all the areas connected to the area parameter,
+which is empty for area -1 and full when cm_noAreas is set.
+It holds CM_WriteAreaBits' return value bytes and stays valid
+until the next portal state change.
+=================
+*/
+const byte* CM_ConnectedAreas( int area )
+{
+#ifndef BSPC
+	if ( cm_noAreas->integer ) {
+		return CM_AreaRow( cm.numAreas + 1 );
+	}
+#endif
+
+	if ( area < 0 ) {
+		return CM_AreaRow( cm.numAreas );
+	}
+
+	if ( area >= cm.numAreas ) {
+		Com_Error( ERR_DROP, "CM_ConnectedAreas: area >= cm.numAreas" );
+	}
+
+	return CM_AreaRow( area );
+}
+
+
 /*
 =================
 CM_WriteAreaBits
@@ -454,10 +745,9 @@ This is used to cull non-visible entities from snapshots
 int CM_WriteAreaBits (byte *buffer, int area)
 {
 	int		i;
-	int		floodnum;
 	int		bytes;
 
-	bytes = (cm.numAreas+7)>>3;
+	bytes = cm.areaBytes;
 
 #ifndef BSPC
 	if (cm_noAreas->integer || area == -1)
@@ -469,11 +759,10 @@ int CM_WriteAreaBits (byte *buffer, int area)
 	}
 	else
 	{
-		floodnum = cm.areas[area].floodnum;
-		for (i=0 ; i<cm.numAreas ; i++)
+		const byte* const row = CM_AreaRow (area);
+		for (i=0 ; i<bytes ; i++)
 		{
-			if (cm.areas[i].floodnum == floodnum || area == -1)
-				buffer[i>>3] |= 1<<(i&7);
+			buffer[i] |= row[i];
 		}
 	}
 
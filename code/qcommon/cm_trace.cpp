@@ -20,6 +20,9 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 ===========================================================================
 */
 #include "cm_local.h"
+#if idSSE2
+#include <emmintrin.h>
+#endif
 
 // always use bbox vs. bbox collision and never capsule vs. bbox or vice versa
 //#define ALWAYS_BBOX_VS_BBOX
@@ -156,6 +159,177 @@ POSITION TESTING
 ===============================================================================
 */
 
+#if idSSE2
+
+/*
+================
+SSE2 BRUSH TESTS
+
+These evaluate 4 brush sides at a time and follow the scalar code's order of operations,
+with ties going to the lowest side index. The results aren't bit-exact though: with -ffast-math,
+the compiler is free to reorder and contract the scalar math differently, so fractions can differ
+by a tiny amount and a trace that starts right on a plane can flip between in and out.
+/cm_tracetest accepts fraction differences of up to 0.0001 for this mode.
+Only boxes take this path, capsules always use the scalar code.
+================
+*/
+
+typedef struct {
+	__m128	start[3];
+	__m128	end[3];
+	__m128	size[2][3];
+} boxSideParams_t;
+
+
+static void CM_InitBoxSideParams( boxSideParams_t* p, const traceWork_t* tw )
+{
+	for ( int i = 0; i < 3; ++i ) {
+		p->start[i] = _mm_set1_ps( tw->start[i] );
+		p->end[i] = _mm_set1_ps( tw->end[i] );
+		p->size[0][i] = _mm_set1_ps( tw->size[0][i] );
+		p->size[1][i] = _mm_set1_ps( tw->size[1][i] );
+	}
+}
+
+
+// plane->dist - DotProduct( tw->offsets[ plane->signbits ], plane->normal ) for 4 sides
+static ID_INLINE __m128 CM_BoxSideDists( const boxSideParams_t* p, const __m128* n, __m128 dist )
+{
+	const __m128 zero = _mm_setzero_ps();
+	__m128 o[3];
+	for ( int i = 0; i < 3; ++i ) {
+		const __m128 negative = _mm_cmplt_ps( n[i], zero );
+		o[i] = _mm_or_ps( _mm_and_ps( negative, p->size[1][i] ), _mm_andnot_ps( negative, p->size[0][i] ) );
+	}
+	const __m128 dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( o[0], n[0] ), _mm_mul_ps( o[1], n[1] ) ), _mm_mul_ps( o[2], n[2] ) );
+
+	return _mm_sub_ps( dist, dot );
+}
+
+
+static ID_INLINE __m128 CM_PointSideDists( const __m128* point, const __m128* n, __m128 dist )
+{
+	const __m128 dot = _mm_add_ps( _mm_add_ps( _mm_mul_ps( point[0], n[0] ), _mm_mul_ps( point[1], n[1] ) ), _mm_mul_ps( point[2], n[2] ) );
+
+	return _mm_sub_ps( dot, dist );
+}
+
+
+// returns qtrue if the box is completely in front of one of the non-axial sides
+static qbool CM_BoxInFrontOfSideGroups( const traceWork_t* tw, const cbrush_t* brush )
+{
+	boxSideParams_t p;
+	CM_InitBoxSideParams( &p, tw );
+
+	// the first six planes are the axial planes, so we only
+	// need to test the remainder
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 firstGroupMask = _mm_castsi128_ps( _mm_setr_epi32( 0, 0, -1, -1 ) );
+	for ( int g = 1; g < brush->numSideGroups; ++g ) {
+		const cbrushSideGroup_t* const group = &brush->sideGroups[g];
+		__m128 n[3];
+		n[0] = _mm_loadu_ps( group->normals[0] );
+		n[1] = _mm_loadu_ps( group->normals[1] );
+		n[2] = _mm_loadu_ps( group->normals[2] );
+		const __m128 dist = CM_BoxSideDists( &p, n, _mm_loadu_ps( group->dists ) );
+		__m128 front = _mm_cmpgt_ps( CM_PointSideDists( p.start, n, dist ), zero );
+		if ( g == 1 )
+			front = _mm_and_ps( front, firstGroupMask );
+		if ( _mm_movemask_ps( front ) )
+			return qtrue;
+	}
+
+	return qfalse;
+}
+
+
+// returns qfalse if the trace is completely in front of one of the sides
+static qbool CM_ClipToSideGroups( const traceWork_t* tw, const cbrush_t* brush,
+									float* enterFracOut, float* leaveFracOut, int* leadSideOut, qbool* startOut, qbool* getOut )
+{
+	boxSideParams_t p;
+	CM_InitBoxSideParams( &p, tw );
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps( 1.0f );
+	const __m128 epsilon = _mm_set1_ps( SURFACE_CLIP_EPSILON );
+	const __m128i four = _mm_set1_epi32( 4 );
+	__m128i sideIndex = _mm_setr_epi32( 0, 1, 2, 3 );
+	__m128 enterFrac = _mm_set1_ps( -1.0f );
+	__m128i enterSide = _mm_set1_epi32( -1 );
+	__m128 leaveFrac = one;
+	__m128 startout = zero;
+	__m128 getout = zero;
+
+	for ( int g = 0; g < brush->numSideGroups; ++g ) {
+		const cbrushSideGroup_t* const group = &brush->sideGroups[g];
+		__m128 n[3];
+		n[0] = _mm_loadu_ps( group->normals[0] );
+		n[1] = _mm_loadu_ps( group->normals[1] );
+		n[2] = _mm_loadu_ps( group->normals[2] );
+		const __m128 dist = CM_BoxSideDists( &p, n, _mm_loadu_ps( group->dists ) );
+		const __m128 d1 = CM_PointSideDists( p.start, n, dist );
+		const __m128 d2 = CM_PointSideDists( p.end, n, dist );
+
+		const __m128 d1Out = _mm_cmpgt_ps( d1, zero );
+		const __m128 d2Out = _mm_cmpgt_ps( d2, zero );
+		getout = _mm_or_ps( getout, d2Out );	// endpoint is not in solid
+		startout = _mm_or_ps( startout, d1Out );
+
+		// if completely in front of face, no intersection with the entire brush
+		const __m128 front = _mm_and_ps( d1Out, _mm_or_ps( _mm_cmpge_ps( d2, epsilon ), _mm_cmpge_ps( d2, d1 ) ) );
+		if ( _mm_movemask_ps( front ) )
+			return qfalse;
+
+		// if it doesn't cross the plane, the plane isn't relevent
+		const __m128 crosses = _mm_or_ps( d1Out, d2Out );
+		const __m128 enters = _mm_and_ps( crosses, _mm_cmpgt_ps( d1, d2 ) );
+		const __m128 leaves = _mm_andnot_ps( enters, crosses );
+		const __m128 delta = _mm_sub_ps( d1, d2 );
+
+		const __m128 fEnter = _mm_max_ps( _mm_div_ps( _mm_sub_ps( d1, epsilon ), delta ), zero );
+		const __m128 betterEnter = _mm_and_ps( enters, _mm_cmpgt_ps( fEnter, enterFrac ) );
+		enterFrac = _mm_or_ps( _mm_and_ps( betterEnter, fEnter ), _mm_andnot_ps( betterEnter, enterFrac ) );
+		const __m128i betterEnterI = _mm_castps_si128( betterEnter );
+		enterSide = _mm_or_si128( _mm_and_si128( betterEnterI, sideIndex ), _mm_andnot_si128( betterEnterI, enterSide ) );
+
+		const __m128 fLeave = _mm_min_ps( _mm_div_ps( _mm_add_ps( d1, epsilon ), delta ), one );
+		const __m128 betterLeave = _mm_and_ps( leaves, _mm_cmplt_ps( fLeave, leaveFrac ) );
+		leaveFrac = _mm_or_ps( _mm_and_ps( betterLeave, fLeave ), _mm_andnot_ps( betterLeave, leaveFrac ) );
+
+		sideIndex = _mm_add_epi32( sideIndex, four );
+	}
+
+	float enterFracs[4], leaveFracs[4];
+	int enterSides[4];
+	_mm_storeu_ps( enterFracs, enterFrac );
+	_mm_storeu_ps( leaveFracs, leaveFrac );
+	_mm_storeu_si128( (__m128i*)enterSides, enterSide );
+
+	// the latest entry wins, the lowest side index breaks ties
+	*enterFracOut = -1.0f;
+	*leadSideOut = -1;
+	*leaveFracOut = 1.0f;
+	for ( int i = 0; i < 4; ++i ) {
+		if ( enterSides[i] >= 0 &&
+			( enterFracs[i] > *enterFracOut || ( enterFracs[i] == *enterFracOut && enterSides[i] < *leadSideOut ) ) ) {
+			*enterFracOut = enterFracs[i];
+			*leadSideOut = enterSides[i];
+		}
+		if ( leaveFracs[i] < *leaveFracOut ) {
+			*leaveFracOut = leaveFracs[i];
+		}
+	}
+
+	*startOut = _mm_movemask_ps( startout ) != 0;
+	*getOut = _mm_movemask_ps( getout ) != 0;
+
+	return qtrue;
+}
+
+#endif
+
+
 /*
 ================
 CM_TestBoxInBrush
@@ -210,7 +384,15 @@ void CM_TestBoxInBrush( traceWork_t *tw, cbrush_t *brush ) {
 				return;
 			}
 		}
-	} else {
+	}
+#if idSSE2
+	else if ( brush->sideGroups && !cm_scalarBrushTests ) {
+		if ( CM_BoxInFrontOfSideGroups( tw, brush ) ) {
+			return;
+		}
+	}
+#endif
+	else {
 		// the first six planes are the axial planes, so we only
 		// need to test the remainder
 		for ( i = 6 ; i < brush->numsides ; i++ ) {
@@ -246,11 +428,10 @@ static void CM_TestInLeaf( traceWork_t* tw, const cLeaf_t* leaf )
 	// test box position against all brushes in the leaf
 	for (k=0 ; k<leaf->numLeafBrushes ; k++) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
-		b = &cm.brushes[brushnum];
-		if (b->checkcount == cm.checkcount) {
+		if ( !CM_FirstBrushVisit( tw->visited, brushnum ) ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+		b = &cm.brushes[brushnum];
 
 		if ( !(b->contents & tw->contents)) {
 			continue;
@@ -273,10 +454,9 @@ static void CM_TestInLeaf( traceWork_t* tw, const cLeaf_t* leaf )
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == cm.checkcount ) {
-				continue;	// already checked this brush in another leaf
+			if ( !CM_FirstPatchVisit( tw->visited, patch ) ) {
+				continue;	// already checked this patch in another leaf
 			}
-			patch->checkcount = cm.checkcount;
 
 			if ( !(patch->contents & tw->contents)) {
 				continue;
@@ -424,14 +604,11 @@ void CM_PositionTest( traceWork_t *tw ) {
 	ll.storeLeafs = CM_StoreLeafs;
 	ll.lastLeaf = 0;
 	ll.overflowed = qfalse;
-
-	cm.checkcount++;
+	ll.margin = NULL;
+	ll.visited = NULL;
 
 	CM_BoxLeafnums_r( &ll, 0 );
 
-
-	cm.checkcount++;
-
 	// test the contents of the leafs
 	for (i=0 ; i < ll.count ; i++) {
 		CM_TestInLeaf( tw, &cm.leafs[leafs[i]] );
@@ -459,7 +636,7 @@ CM_TraceThroughPatch
 void CM_TraceThroughPatch( traceWork_t *tw, cPatch_t *patch ) {
 	float		oldFrac;
 
-	c_patch_traces++;
+	CM_Stats()->patchTraces++;
 
 	oldFrac = tw->trace.fraction;
 
@@ -497,7 +674,7 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 		return;
 	}
 
-	c_brush_traces++;
+	CM_Stats()->brushTraces++;
 
 	getout = qfalse;
 	startout = qfalse;
@@ -571,7 +748,20 @@ void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 				}
 			}
 		}
-	} else {
+	}
+#if idSSE2
+	else if ( brush->sideGroups && !cm_scalarBrushTests ) {
+		int leadSideIndex;
+		if ( !CM_ClipToSideGroups( tw, brush, &enterFrac, &leaveFrac, &leadSideIndex, &startout, &getout ) ) {
+			return;
+		}
+		if ( leadSideIndex >= 0 ) {
+			leadside = brush->sides + leadSideIndex;
+			clipplane = leadside->plane;
+		}
+	}
+#endif
+	else {
 		//
 		// compare the trace against all planes of the brush
 		// find the latest time the trace crosses a plane towards the interior
@@ -665,12 +855,10 @@ static void CM_TraceThroughLeaf( traceWork_t* tw, const cLeaf_t* leaf )
 	// trace line against all brushes in the leaf
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush+k];
-
-		b = &cm.brushes[brushnum];
-		if ( b->checkcount == cm.checkcount ) {
+		if ( !CM_FirstBrushVisit( tw->visited, brushnum ) ) {
 			continue;	// already checked this brush in another leaf
 		}
-		b->checkcount = cm.checkcount;
+		b = &cm.brushes[brushnum];
 
 		if ( !(b->contents & tw->contents) ) {
 			continue;
@@ -696,10 +884,9 @@ static void CM_TraceThroughLeaf( traceWork_t* tw, const cLeaf_t* leaf )
 			if ( !patch ) {
 				continue;
 			}
-			if ( patch->checkcount == cm.checkcount ) {
+			if ( !CM_FirstPatchVisit( tw->visited, patch ) ) {
 				continue;	// already checked this patch in another leaf
 			}
-			patch->checkcount = cm.checkcount;
 
 			if ( !(patch->contents & tw->contents) ) {
 				continue;
@@ -1033,6 +1220,7 @@ void CM_TraceThroughTree( traceWork_t *tw, int num, float p1f, float p2f, vec3_t
 
 	// if < 0, we are in a leaf node
 	if (num < 0) {
+		CM_Stats()->leafTraces++;
 		CM_TraceThroughLeaf( tw, &cm.leafs[-1-num] );
 		return;
 	}
@@ -1054,19 +1242,11 @@ void CM_TraceThroughTree( traceWork_t *tw, int num, float p1f, float p2f, vec3_t
 		t2 = DotProduct (plane->normal, p2) - plane->dist;
 		if ( tw->isPoint ) {
 			offset = 0;
+		} else if ( tw->tightNodeOffsets ) {
+			// the box's support distance along the normal, i.e. |extents . normal|
+			// offsets[signbits] is the corner furthest behind the plane
+			offset = -DotProduct( tw->offsets[plane->signbits], plane->normal );
 		} else {
-#if 0 // bk010201 - DEAD
-			// an axial brush right behind a slanted bsp plane
-			// will poke through when expanded, so adjust
-			// by sqrt(3)
-			offset = fabs(tw->extents[0]*plane->normal[0]) +
-				fabs(tw->extents[1]*plane->normal[1]) +
-				fabs(tw->extents[2]*plane->normal[2]);
-
-			offset *= 2;
-			offset = tw->maxOffset;
-#endif
-			// this is silly
 			offset = 2048;
 		}
 	}
@@ -1136,6 +1316,24 @@ void CM_TraceThroughTree( traceWork_t *tw, int num, float p1f, float p2f, vec3_t
 //======================================================================
 
 
+// too big for the stack of every query
+static THREAD_LOCAL cmVisited_t cm_threadVisited;
+
+
+cmVisited_t* CM_ClearVisited()
+{
+	cmVisited_t* const visited = &cm_threadVisited;
+
+	// the temp box brush comes right after the map's brushes
+	const int brushWords = min( ( cm.numBrushes + 1 + 31 ) / 32, (int)ARRAY_LEN( visited->brushes ) );
+	const int patchWords = min( ( cm.numPatches + 31 ) / 32, (int)ARRAY_LEN( visited->patches ) );
+	Com_Memset( visited->brushes, 0, brushWords * sizeof( visited->brushes[0] ) );
+	Com_Memset( visited->patches, 0, patchWords * sizeof( visited->patches[0] ) );
+
+	return visited;
+}
+
+
 /*
 ==================
 CM_Trace
@@ -1149,12 +1347,11 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, const vec
 
 	const cmodel_t* cmod = CM_ClipHandleToModel( model );
 
-	cm.checkcount++;		// for multi-check avoidance
-
-	c_traces++;				// for statistics, may be zeroed
+	CM_Stats()->traces++;	// for statistics
 
 	// fill in a default trace
 	Com_Memset( &tw, 0, sizeof(tw) );
+	tw.visited = CM_ClearVisited();
 	tw.trace.fraction = 1;	// assume it goes the entire distance until shown otherwise
 	VectorCopy(origin, tw.modelOrigin);
 
@@ -1292,6 +1489,11 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end, const vec
 		//
 		// check for point special case
 		//
+		if ( cm_testNodeOffsets == CMNO_CVAR )
+			tw.tightNodeOffsets = cm_tightNodeOffsets && cm_tightNodeOffsets->integer;
+		else
+			tw.tightNodeOffsets = cm_testNodeOffsets == CMNO_TIGHT;
+
 		if ( tw.size[0][0] == 0 && tw.size[0][1] == 0 && tw.size[0][2] == 0 ) {
 			tw.isPoint = qtrue;
 			VectorClear( tw.extents );
@@ -24,6 +24,7 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "q_shared.h"
 #include "qcommon.h"
 #include "common_help.h"
+#include "crash.h"
 #include <setjmp.h>
 
 #ifndef INT64_MIN
@@ -69,6 +70,8 @@ fileHandle_t		com_journalDataFile = 0;		// config files are written here
 
 cvar_t	*com_viewlog = 0;
 cvar_t	*com_speeds = 0;
+cvar_t	*com_profile = 0;
+cvar_t	*com_profileHitch = 0;
 cvar_t	*com_developer = 0;
 cvar_t	*com_dedicated = 0;
 cvar_t	*com_timescale = 0;
@@ -89,6 +92,7 @@ cvar_t	*sv_packetdelay = 0;
 cvar_t	*com_noErrorInterrupt;
 #endif
 
+static cvar_t	*com_logFlushInterval;
 static cvar_t	*con_completionStyle;	// 0 = legacy, 1 = ET-style
 static cvar_t	*con_history;
 
@@ -140,6 +144,275 @@ void Com_EndRedirect (void)
 }
 
 
+/*
+===================================================================
+
+CONSOLE LOG WRITER
+
+Com_Printf appends its messages to a ring buffer without locking and
+a thread writes them to qconsole.log in batches, so that slow disks
+don't stall the frame. The thread wakes up every com_logFlushInterval
+ms or when LOG_WAKE_SIZE bytes are pending, whichever comes first.
+
+A producer reserves its record by moving the head with a compare-and-swap,
+copies the text and then publishes the record by writing its header.
+The writer zeroes what it consumed before moving the tail, so a record
+that isn't published yet always has a 0 header and the order is kept.
+
+Com_Error writes everything out synchronously before unwinding.
+
+===================================================================
+*/
+
+#define LOG_RING_SIZE		(1 << 20)	// power of 2
+#define LOG_POSITION_MASK	0x7FFFFFFF	// the positions wrap at 2^31
+#define LOG_BATCH_SIZE		(64 << 10)
+#define LOG_WAKE_SIZE		(64 << 10)	// the writer is woken up early when this much is pending
+
+static struct {
+	int		ring[LOG_RING_SIZE / 4];	// records: text length + 1, then the text padded to 4 bytes
+	int		head;				// reserved up to here
+	int		tail;				// written up to here, only moved by the writer
+	int		writerSleeping;		// the producers can post the semaphore when it's set
+	int		quit;
+	int		flushInterval;		// ms, 0 flushes after every batch
+	int		lastFlushTime;
+	qbool	dirty;				// written but not flushed yet
+	FILE*	file;
+	void*	thread;
+	void*	semaphore;
+	void*	mutex;				// held while writing, by the thread or Com_FlushLog
+	char	batch[LOG_BATCH_SIZE];
+} com_log;
+
+
+static int Com_LogRecordSize( int length )
+{
+	return PAD( (int)sizeof(int) + length, (int)sizeof(int) );
+}
+
+
+static int Com_LogAdvance( int position, int bytes )
+{
+	return (int)( ( (unsigned int)position + (unsigned int)bytes ) & LOG_POSITION_MASK );
+}
+
+
+static void Com_LogWakeWriter()
+{
+	if ( Sys_AtomicLoad( &com_log.writerSleeping ) && Sys_AtomicCompareExchange( &com_log.writerSleeping, 1, 0 ) ) {
+		Sys_PostSemaphore( com_log.semaphore );
+	}
+}
+
+
+static void Com_LogAppend( const char* text, int length )
+{
+	length = min( length, LOG_BATCH_SIZE );
+	const int size = Com_LogRecordSize( length );
+
+	int head;
+	for (;;) {
+		head = Sys_AtomicLoad( &com_log.head );
+		const int tail = Sys_AtomicLoad( &com_log.tail );
+		if ( ( ( head - tail ) & LOG_POSITION_MASK ) + size > LOG_RING_SIZE ) {
+			// full, give the writer some time
+			Com_LogWakeWriter();
+			Sys_Sleep( 1 );
+			continue;
+		}
+		if ( Sys_AtomicCompareExchange( &com_log.head, head, Com_LogAdvance( head, size ) ) )
+			break;
+	}
+
+	char* const ring = (char*)com_log.ring;
+	const int index = head & ( LOG_RING_SIZE - 1 );
+	const int start = ( index + (int)sizeof(int) ) & ( LOG_RING_SIZE - 1 );
+	const int firstPart = min( length, LOG_RING_SIZE - start );
+	Com_Memcpy( ring + start, text, firstPart );
+	Com_Memcpy( ring, text + firstPart, length - firstPart );
+	Sys_AtomicStore( &com_log.ring[index / 4], length + 1 );
+
+	const int pending = ( Com_LogAdvance( head, size ) - Sys_AtomicLoad( &com_log.tail ) ) & LOG_POSITION_MASK;
+	if ( pending >= LOG_WAKE_SIZE || Sys_AtomicLoad( &com_log.flushInterval ) == 0 ) {
+		Com_LogWakeWriter();
+	}
+}
+
+
+static void Com_LogWriteBatch( int bytes )
+{
+	if ( bytes > 0 ) {
+		fwrite( com_log.batch, 1, bytes, com_log.file );
+		com_log.dirty = qtrue;
+	}
+}
+
+
+// writes all the published records, the caller owns the mutex
+
+static void Com_LogDrain()
+{
+	Prof_Scope profScope( "Com_LogDrain" );
+	char* const ring = (char*)com_log.ring;
+	int batchBytes = 0;
+
+	for (;;) {
+		const int tail = com_log.tail;
+		const int index = tail & ( LOG_RING_SIZE - 1 );
+		const int header = Sys_AtomicLoad( &com_log.ring[index / 4] );
+		if ( header == 0 )
+			break;
+
+		const int length = header - 1;
+		const int size = Com_LogRecordSize( length );
+		if ( batchBytes + length > LOG_BATCH_SIZE ) {
+			Com_LogWriteBatch( batchBytes );
+			batchBytes = 0;
+		}
+
+		const int start = ( index + (int)sizeof(int) ) & ( LOG_RING_SIZE - 1 );
+		const int firstPart = min( length, LOG_RING_SIZE - start );
+		Com_Memcpy( com_log.batch + batchBytes, ring + start, firstPart );
+		Com_Memcpy( com_log.batch + batchBytes + firstPart, ring, length - firstPart );
+		batchBytes += length;
+
+		// the producers only write into zeroed memory
+		const int firstZero = min( size, LOG_RING_SIZE - index );
+		Com_Memset( ring + index, 0, firstZero );
+		Com_Memset( ring, 0, size - firstZero );
+		Sys_AtomicStore( &com_log.tail, Com_LogAdvance( tail, size ) );
+	}
+
+	Com_LogWriteBatch( batchBytes );
+}
+
+
+static void Com_LogFlush()
+{
+	if ( com_log.dirty ) {
+		fflush( com_log.file );
+		com_log.dirty = qfalse;
+	}
+	com_log.lastFlushTime = Sys_Milliseconds();
+}
+
+
+static void Com_LogThread( void* )
+{
+	Prof_SetThreadName( "log writer" );
+
+	for (;;) {
+		Sys_AtomicStore( &com_log.writerSleeping, 1 );
+		const int interval = Sys_AtomicLoad( &com_log.flushInterval );
+		if ( !Sys_AtomicLoad( &com_log.quit ) ) {
+			if ( interval > 0 ) {
+				const int wait = interval - ( Sys_Milliseconds() - com_log.lastFlushTime );
+				if ( wait > 0 ) {
+					Sys_WaitSemaphoreTimeout( com_log.semaphore, wait );
+				}
+			} else {
+				const int tail = Sys_AtomicLoad( &com_log.tail );
+				if ( Sys_AtomicLoad( &com_log.ring[( tail & ( LOG_RING_SIZE - 1 ) ) / 4] ) == 0 ) {
+					Sys_WaitSemaphore( com_log.semaphore );
+				}
+			}
+		}
+		Sys_AtomicStore( &com_log.writerSleeping, 0 );
+
+		Sys_LockMutex( com_log.mutex );
+		Com_LogDrain();
+		if ( Sys_Milliseconds() - com_log.lastFlushTime >= Sys_AtomicLoad( &com_log.flushInterval ) ) {
+			Com_LogFlush();
+		}
+		Sys_UnlockMutex( com_log.mutex );
+
+		if ( Sys_AtomicLoad( &com_log.quit ) )
+			break;
+	}
+
+	Prof_ReleaseThread();
+}
+
+
+static void Com_StartLogWriter()
+{
+	com_log.file = FS_GetWriteFile( logfile );
+	com_log.semaphore = Sys_CreateSemaphore();
+	com_log.mutex = Sys_CreateMutex();
+	com_log.lastFlushTime = Sys_Milliseconds();
+	if ( com_log.semaphore && com_log.mutex ) {
+		com_log.thread = Sys_CreateThread( Com_LogThread, NULL );
+	}
+
+	if ( !com_log.thread ) {
+		if ( com_log.semaphore )
+			Sys_DestroySemaphore( com_log.semaphore );
+		if ( com_log.mutex )
+			Sys_DestroyMutex( com_log.mutex );
+		com_log.semaphore = NULL;
+		com_log.mutex = NULL;
+		Com_Printf( "^3WARNING: couldn't create the log writer thread, qconsole.log is written synchronously\n" );
+	}
+}
+
+
+static void Com_StopLogWriter()
+{
+	if ( !com_log.thread )
+		return;
+
+	Sys_AtomicStore( &com_log.quit, 1 );
+	Sys_PostSemaphore( com_log.semaphore );
+	Sys_JoinThread( com_log.thread );
+	Com_LogDrain();
+	Com_LogFlush();
+	Sys_DestroySemaphore( com_log.semaphore );
+	Sys_DestroyMutex( com_log.mutex );
+	com_log.thread = NULL;
+	com_log.semaphore = NULL;
+	com_log.mutex = NULL;
+	com_log.quit = 0;
+}
+
+
+void Com_FlushLog()
+{
+	if ( !logfile ) {
+		return;
+	}
+
+	if ( !com_log.thread ) {
+		FS_Flush( logfile );
+		return;
+	}
+
+	Sys_LockMutex( com_log.mutex );
+	Com_LogDrain();
+	Com_LogFlush();
+	Sys_UnlockMutex( com_log.mutex );
+}
+
+
+// the writer thread might be writing at the same time,
+// so lines can be duplicated but the last ones before the crash make it
+
+void Com_FlushLogForCrash()
+{
+	if ( !logfile ) {
+		return;
+	}
+
+	if ( com_log.thread ) {
+		Com_LogDrain();
+		com_log.dirty = qtrue;
+		Com_LogFlush();
+	} else {
+		FS_Flush( logfile );
+	}
+}
+
+
 ///////////////////////////////////////////////////////////////
 
 // client and server can both use these, and will do the appropriate things
@@ -192,8 +465,9 @@ void QDECL Com_Printf( PRINTF_FORMAT_STRING const char *fmt, ... )
 		logfile = FS_FOpenFileWrite( "qconsole.log" );
 		if (logfile)
 		{
+			Com_StartLogWriter();
 			Com_Printf( "logfile opened on %s\n", asctime( newtime ) );
-			if ( com_logfile->integer > 1 )
+			if ( com_logfile->integer > 1 && !com_log.thread )
 			{
 				// force it to not buffer so we get valid
 				// data even if we are crashing
@@ -210,7 +484,21 @@ void QDECL Com_Printf( PRINTF_FORMAT_STRING const char *fmt, ... )
 	}
 
 	if ( logfile && FS_Initialized() ) {
-		FS_Write( msg, strlen(msg), logfile );
+		if ( com_log.thread ) {
+			// logfile 2 flushes after every batch
+			int flushInterval = com_log.flushInterval;
+			if ( com_logfile->integer > 1 )
+				flushInterval = 0;
+			else if ( com_logFlushInterval )
+				flushInterval = com_logFlushInterval->integer;
+			if ( flushInterval != com_log.flushInterval ) {
+				Sys_AtomicStore( &com_log.flushInterval, flushInterval );
+				Com_LogWakeWriter(); // it might be waiting with the old interval
+			}
+			Com_LogAppend( msg, strlen(msg) );
+		} else {
+			FS_Write( msg, strlen(msg), logfile );
+		}
 	}
 }
 
@@ -273,6 +561,7 @@ void QDECL Com_ErrorExt( int code, int module, qbool realError, PRINTF_FORMAT_ST
 	lastErrorTime = currentTime;
 
 	if ( com_errorEntered ) {
+		Com_FlushLogForCrash();
 		Sys_Error( "recursive error after: %s", com_errorMessage );
 	}
 	com_errorEntered = qtrue;
@@ -311,6 +600,7 @@ void QDECL Com_ErrorExt( int code, int module, qbool realError, PRINTF_FORMAT_ST
 			Com_Printf( "********************\nERROR: %s\n********************\n", com_errorMessage );
 		else
 			Com_Printf( "ERROR: %s\n", com_errorMessage );
+		Com_FlushLog();
 		SV_Shutdown( va("Server crashed: %s",  com_errorMessage) );
 #ifndef DEDICATED
 		const qbool demo = CL_DemoPlaying();
@@ -690,7 +980,12 @@ int Com_RealTime( qtime_t* qtime )
 There is never any space between memblocks, and there will never be two
 contiguous free memblocks.
 
-The rover can be left pointing at a non-empty block
+Free blocks are also linked into one of ZONE_BINS lists by size:
+16 byte steps below 1 KB, then 8 lists per power of 2.
+An allocation takes the first block big enough from its own list
+and otherwise the head of the next non-empty list, so the cost
+doesn't grow with the number of blocks in the zone.
+The links are stored in the free block itself, right after the header.
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
@@ -700,6 +995,14 @@ all big things are allocated on the hunk.
 #define	ZONEID	0x1d4a11
 #define MINFRAGMENT	64
 
+#define ZONE_SMALL_BIN_SHIFT	4
+#define ZONE_SMALL_BIN_LIMIT	1024
+#define ZONE_SMALL_BINS			( ZONE_SMALL_BIN_LIMIT >> ZONE_SMALL_BIN_SHIFT )
+#define ZONE_SUB_BIN_BITS		3
+#define ZONE_SUB_BINS			( 1 << ZONE_SUB_BIN_BITS )
+#define ZONE_BINS				256
+#define ZONE_MAX_BIN_SCAN		32	// blocks checked in the request's own list
+
 typedef struct zonedebug_s {
 	char *label;
 	char *file;
@@ -717,13 +1020,74 @@ typedef struct memblock_s {
 #endif
 } memblock_t;
 
+typedef struct {
+	memblock_t	*nextFree, *prevFree;
+} memfree_t;
+
+#define Z_FreeLinks(block)	((memfree_t*)((block) + 1))
+#define MIN_BLOCK_SIZE		((int)(sizeof(memblock_t) + sizeof(memfree_t)))
+
 typedef struct {
 	int		size;			// total bytes malloced, including header
 	int		used;			// total bytes used
 	memblock_t	blocklist;	// start / end cap for linked list
-	memblock_t	*rover;
+	memblock_t	*freeLists[ZONE_BINS];
+	unsigned int	freeBins[ZONE_BINS / 32];	// bit set when the list isn't empty
 } memzone_t;
 
+typedef struct {
+	int		usedBytes;
+	int		usedBlocks;
+	int		freeBytes;
+	int		freeBlocks;
+	int		largestFree;
+} zonestats_t;
+
+// running totals per zone tag and per hunk consumer, cheap enough to always keep
+// the counts are since the last /memreset, the live values are always exact
+typedef struct {
+	int64_t	allocs;
+	int64_t	allocBytes;
+	int64_t	frees;
+	int		liveBytes;
+	int		liveBlocks;
+	int		peakBytes;
+	int		peakBlocks;
+} memusage_t;
+
+static memusage_t zoneTagUsage[TAG_STATIC + 1];
+static int64_t memUsageResetTime = 0; // Sys_Microseconds at the last reset
+
+
+static void Com_CountAlloc( memusage_t* usage, int size )
+{
+	usage->allocs++;
+	usage->allocBytes += size;
+	usage->liveBytes += size;
+	usage->liveBlocks++;
+	usage->peakBytes = max( usage->peakBytes, usage->liveBytes );
+	usage->peakBlocks = max( usage->peakBlocks, usage->liveBlocks );
+}
+
+
+static void Com_CountFree( memusage_t* usage, int size )
+{
+	usage->frees++;
+	usage->liveBytes -= size;
+	usage->liveBlocks--;
+}
+
+
+static void Com_ResetUsage( memusage_t* usage )
+{
+	usage->allocs = 0;
+	usage->allocBytes = 0;
+	usage->frees = 0;
+	usage->peakBytes = usage->liveBytes;
+	usage->peakBlocks = usage->liveBlocks;
+}
+
+
 // main zone for all "dynamic" memory allocation
 static memzone_t* mainzone = NULL;
 // we also have a small zone for small allocations that would only
@@ -731,6 +1095,102 @@ static memzone_t* mainzone = NULL;
 static memzone_t* smallzone = NULL;
 
 
+static int Z_BinIndex( int size )
+{
+	if ( size < ZONE_SMALL_BIN_LIMIT ) {
+		return size >> ZONE_SMALL_BIN_SHIFT;
+	}
+
+	int log2 = 10;
+	while ( ( size >> ( log2 + 1 ) ) != 0 ) {
+		log2++;
+	}
+	const int sub = ( size >> ( log2 - ZONE_SUB_BIN_BITS ) ) & ( ZONE_SUB_BINS - 1 );
+
+	return ZONE_SMALL_BINS + ( log2 - 10 ) * ZONE_SUB_BINS + sub;
+}
+
+
+static void Z_LinkFreeBlock( memzone_t* zone, memblock_t* block )
+{
+	const int bin = Z_BinIndex( block->size );
+	memfree_t* const links = Z_FreeLinks( block );
+	links->prevFree = NULL;
+	links->nextFree = zone->freeLists[bin];
+	if ( links->nextFree ) {
+		Z_FreeLinks( links->nextFree )->prevFree = block;
+	}
+	zone->freeLists[bin] = block;
+	zone->freeBins[bin >> 5] |= 1u << ( bin & 31 );
+}
+
+
+static void Z_UnlinkFreeBlock( memzone_t* zone, memblock_t* block )
+{
+	const int bin = Z_BinIndex( block->size );
+	const memfree_t* const links = Z_FreeLinks( block );
+	if ( links->prevFree ) {
+		Z_FreeLinks( links->prevFree )->nextFree = links->nextFree;
+	} else {
+		zone->freeLists[bin] = links->nextFree;
+		if ( !links->nextFree ) {
+			zone->freeBins[bin >> 5] &= ~( 1u << ( bin & 31 ) );
+		}
+	}
+	if ( links->nextFree ) {
+		Z_FreeLinks( links->nextFree )->prevFree = links->prevFree;
+	}
+}
+
+
+// returns the first non-empty list after bin or -1
+static int Z_NextFreeBin( const memzone_t* zone, int bin )
+{
+	for ( int i = bin + 1; i < ZONE_BINS; ) {
+		const unsigned int bits = zone->freeBins[i >> 5] >> ( i & 31 );
+		if ( bits == 0 ) {
+			i = ( i | 31 ) + 1;
+			continue;
+		}
+		if ( bits & 1 ) {
+			return i;
+		}
+		i++;
+	}
+
+	return -1;
+}
+
+
+static memblock_t* Z_FindFreeBlock( const memzone_t* zone, int size )
+{
+	const int bin = Z_BinIndex( size );
+
+	int scanned = 0;
+	for ( memblock_t* block = zone->freeLists[bin]; block && scanned < ZONE_MAX_BIN_SCAN; block = Z_FreeLinks( block )->nextFree, ++scanned ) {
+		if ( block->size >= size ) {
+			return block;
+		}
+	}
+
+	// every block in the later lists is big enough
+	const int nextBin = Z_NextFreeBin( zone, bin );
+	if ( nextBin >= 0 ) {
+		return zone->freeLists[nextBin];
+	}
+
+	// the blocks we didn't check in the request's own list
+	int skipped = 0;
+	for ( memblock_t* block = zone->freeLists[bin]; block; block = Z_FreeLinks( block )->nextFree ) {
+		if ( skipped++ >= ZONE_MAX_BIN_SCAN && block->size >= size ) {
+			return block;
+		}
+	}
+
+	return NULL;
+}
+
+
 static void Z_ClearZone( memzone_t* zone, int size )
 {
 	memblock_t* block;
@@ -742,14 +1202,46 @@ static void Z_ClearZone( memzone_t* zone, int size )
 	zone->blocklist.tag = 1;	// in use block
 	zone->blocklist.id = 0;
 	zone->blocklist.size = 0;
-	zone->rover = block;
 	zone->size = size;
 	zone->used = 0;
+	Com_Memset( zone->freeLists, 0, sizeof(zone->freeLists) );
+	Com_Memset( zone->freeBins, 0, sizeof(zone->freeBins) );
 
 	block->prev = block->next = &zone->blocklist;
 	block->tag = 0;			// free block
 	block->id = ZONEID;
 	block->size = size - sizeof(memzone_t);
+	Z_LinkFreeBlock( zone, block );
+}
+
+
+static void Z_GetZoneStats( const memzone_t* zone, zonestats_t* stats )
+{
+	Com_Memset( stats, 0, sizeof(*stats) );
+
+	for (const memblock_t* block = zone->blocklist.next; block != &zone->blocklist; block = block->next) {
+		if ( block->tag ) {
+			stats->usedBytes += block->size;
+			stats->usedBlocks++;
+		} else {
+			stats->freeBytes += block->size;
+			stats->freeBlocks++;
+			stats->largestFree = max( stats->largestFree, block->size );
+		}
+	}
+}
+
+
+// the fragmentation is the share of the free memory that isn't in the largest free block
+
+static void Z_PrintFragmentation( const memzone_t* zone, const char* name )
+{
+	zonestats_t stats;
+	Z_GetZoneStats( zone, &stats );
+
+	const int fragmentation = stats.freeBytes > 0 ? (int)( ( 100.0 * ( stats.freeBytes - stats.largestFree ) ) / stats.freeBytes ) : 0;
+	Com_Printf( "%8i bytes free in %i %s zone blocks, largest %i, %i%% fragmentation\n",
+		stats.freeBytes, stats.freeBlocks, name, stats.largestFree, fragmentation );
 }
 
 
@@ -790,6 +1282,7 @@ void Z_Free( void* ptr )
 
 	memzone_t* zone = (block->tag == TAG_SMALL) ? smallzone : mainzone;
 	zone->used -= block->size;
+	Com_CountFree( &zoneTagUsage[block->tag], block->size );
 	// set the block to something that should cause problems
 	// if it is referenced...
 	Com_Memset( ptr, 0xaa, block->size - sizeof( *block ) );
@@ -799,27 +1292,23 @@ void Z_Free( void* ptr )
 	memblock_t* other = block->prev;
 	if (!other->tag) {
 		// merge with previous free block
+		Z_UnlinkFreeBlock( zone, other );
 		other->size += block->size;
 		other->next = block->next;
 		other->next->prev = other;
-		if (block == zone->rover) {
-			zone->rover = other;
-		}
 		block = other;
 	}
 
-	zone->rover = block;
-
 	other = block->next;
 	if ( !other->tag ) {
 		// merge the next free block onto the end
+		Z_UnlinkFreeBlock( zone, other );
 		block->size += other->size;
 		block->next = other->next;
 		block->next->prev = block;
-		if (other == zone->rover) {
-			zone->rover = block;
-		}
 	}
+
+	Z_LinkFreeBlock( zone, block );
 }
 
 
@@ -835,6 +1324,7 @@ static void Z_LogZoneHeap( const memzone_t* zone, const char* name )
 
 	if (!logfile || !FS_Initialized())
 		return;
+	Com_FlushLog(); // keep the order of the lines written by the thread
 	size = allocSize = numBlocks = 0;
 	Com_sprintf(buf, sizeof(buf), "\r\n================\r\n%s log\r\n================\r\n", name);
 	FS_Write(buf, strlen(buf), logfile);
@@ -890,11 +1380,11 @@ void *Z_TagMallocDebug( int size, int tag, char *label, char *file, int line ) {
 void *Z_TagMalloc( int size, int tag ) {
 #endif
 	int		extra, allocSize;
-	memblock_t	*start, *rover, *base;
+	memblock_t	*base;
 	memzone_t *zone;
 
-	if (!tag) {
-		Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use a 0 tag" );
+	if (tag <= 0 || tag > TAG_STATIC) {
+		Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use tag %d", tag );
 	}
 
 	if ( tag == TAG_SMALL ) {
@@ -905,37 +1395,25 @@ void *Z_TagMalloc( int size, int tag ) {
 	}
 
 	allocSize = size;
-	//
-	// scan through the block list looking for the first free block
-	// of sufficient size
-	//
 	size += sizeof(memblock_t);	// account for size of block header
 	size += 4;					// space for memory trash tester
 	size = PAD(size, sizeof(intptr_t));		// align to 32/64 bit boundary
+	size = max(size, MIN_BLOCK_SIZE);		// room for the free list links once freed
 
-	base = rover = zone->rover;
-	start = base->prev;
-
-	do {
-		if (rover == start) {
+	base = Z_FindFreeBlock( zone, size );
+	if (!base) {
 #ifdef ZONE_DEBUG
-			Z_LogHeap();
+		Z_LogHeap();
 #endif
-			// scaned all the way around the list
-			Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
-								size, zone == smallzone ? "small" : "main");
-			return NULL;
-		}
-		if (rover->tag) {
-			base = rover = rover->next;
-		} else {
-			rover = rover->next;
-		}
-	} while (base->tag || base->size < size);
+		Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
+							size, zone == smallzone ? "small" : "main");
+		return NULL;
+	}
 
 	//
 	// found a block big enough
 	//
+	Z_UnlinkFreeBlock( zone, base );
 	extra = base->size - size;
 	if (extra > MINFRAGMENT) {
 		// there will be a free fragment after the allocated block
@@ -948,12 +1426,13 @@ void *Z_TagMalloc( int size, int tag ) {
 		p->next->prev = p;
 		base->next = p;
 		base->size = size;
+		Z_LinkFreeBlock( zone, p );
 	}
 
 	base->tag = tag;			// no longer a free block
 
-	zone->rover = base->next;	// next allocation will start looking here
-	zone->used += base->size;	//
+	zone->used += base->size;
+	Com_CountAlloc( &zoneTagUsage[tag], base->size );
 
 	base->id = ZONEID;
 
@@ -971,12 +1450,16 @@ void *Z_TagMalloc( int size, int tag ) {
 }
 
 
-static void Z_CheckHeap()
+static void Z_CheckZone( const memzone_t* zone )
 {
 	const memblock_t* block;
+	int freeBlocks = 0;
 
-	for (block = mainzone->blocklist.next ; ; block = block->next) {
-		if (block->next == &mainzone->blocklist) {
+	for (block = zone->blocklist.next ; ; block = block->next) {
+		if ( !block->tag ) {
+			freeBlocks++;
+		}
+		if (block->next == &zone->blocklist) {
 			break;			// all blocks have been hit
 		}
 		if ( (byte *)block + block->size != (byte *)block->next)
@@ -988,6 +1471,34 @@ static void Z_CheckHeap()
 			Com_Error( ERR_FATAL, "Z_CheckHeap: two consecutive free blocks\n" );
 		}
 	}
+
+	for (int i = 0; i < ZONE_BINS; ++i) {
+		const qbool binSet = ( zone->freeBins[i >> 5] >> ( i & 31 ) ) & 1;
+		if ( binSet != ( zone->freeLists[i] != NULL ) ) {
+			Com_Error( ERR_FATAL, "Z_CheckHeap: free list mask out of date\n" );
+		}
+		for (block = zone->freeLists[i]; block; block = Z_FreeLinks( block )->nextFree) {
+			if ( block->tag || Z_BinIndex( block->size ) != i ) {
+				Com_Error( ERR_FATAL, "Z_CheckHeap: bad block in a free list\n" );
+			}
+			const memblock_t* const next = Z_FreeLinks( block )->nextFree;
+			if ( next && Z_FreeLinks( next )->prevFree != block ) {
+				Com_Error( ERR_FATAL, "Z_CheckHeap: free list doesn't have proper back link\n" );
+			}
+			freeBlocks--;
+		}
+	}
+
+	if ( freeBlocks != 0 ) {
+		Com_Error( ERR_FATAL, "Z_CheckHeap: free blocks missing from the free lists\n" );
+	}
+}
+
+
+static void Z_CheckHeap()
+{
+	Z_CheckZone( mainzone );
+	Z_CheckZone( smallzone );
 }
 
 
@@ -1120,9 +1631,32 @@ static	hunkUsed_t	*hunk_permanent = &hunk_low, *hunk_temp = &hunk_high;
 
 static	byte	*s_hunkData = NULL;
 static	int		s_hunkTotal = 0;
+static	hugePages_t	s_hunkPages = HUGEPAGES_NONE;
+
+static const char* hugePageNames[HUGEPAGES_COUNT] = {
+	"regular pages",
+	"transparent huge pages",
+	"reserved huge pages"
+};
 
 static	int		s_zoneTotal = 0;
 
+static	memusage_t	hunkUsage[HC_COUNT];
+static	int			hunkMarkLiveBytes[HC_COUNT];	// hunkUsage[].liveBytes at Hunk_SetMark
+static	int			hunkMarkLiveBlocks[HC_COUNT];
+static	memusage_t	hunkTempUsage;
+static	hunkConsumer_t	hunkConsumer = HC_OTHER;
+
+static const char* hunkConsumerNames[HC_COUNT] = {
+	"other",
+	"collision",
+	"botlib",
+	"renderer",
+	"vm",
+	"snapshots",
+	"sound"
+};
+
 #ifdef HUNK_DEBUG
 
 typedef struct hunkblock_s {
@@ -1189,7 +1723,7 @@ static void Com_Meminfo_f( void )
 		}
 	}
 
-	Com_Printf( "%8i bytes total hunk\n", s_hunkTotal );
+	Com_Printf( "%8i bytes total hunk in %s\n", s_hunkTotal, hugePageNames[s_hunkPages] );
 	Com_Printf( "%8i bytes total zone\n", s_zoneTotal );
 	Com_Printf( "\n" );
 	Com_Printf( "%8i low mark\n", hunk_low.mark );
@@ -1223,6 +1757,244 @@ static void Com_Meminfo_f( void )
 	Com_Printf( "   %8i bytes in dynamic renderer\n", rendererBytes );
 	Com_Printf( "   %8i bytes in dynamic other\n", zoneBytes - ( botlibBytes + rendererBytes ) );
 	Com_Printf( "   %8i bytes in small Zone memory\n", smallZoneBytes );
+	Com_Printf( "\n" );
+	Z_PrintFragmentation( mainzone, "main" );
+	Z_PrintFragmentation( smallzone, "small" );
+}
+
+
+static void Com_WriteUsageJSON( const char* name, const memusage_t* usage, double seconds )
+{
+	JSONW_BeginObject();
+	JSONW_StringValue( "name", name );
+	JSONW_IntegerValue( "live_bytes", usage->liveBytes );
+	JSONW_IntegerValue( "live_blocks", usage->liveBlocks );
+	JSONW_IntegerValue( "peak_bytes", usage->peakBytes );
+	JSONW_IntegerValue( "peak_blocks", usage->peakBlocks );
+	JSONW_Integer64Value( "allocs", usage->allocs );
+	JSONW_Integer64Value( "alloc_bytes", usage->allocBytes );
+	JSONW_Integer64Value( "frees", usage->frees );
+	JSONW_StringValue( "allocs_per_sec", "%.1f", seconds > 0.0 ? (double)usage->allocs / seconds : 0.0 );
+	JSONW_StringValue( "alloc_bytes_per_sec", "%.1f", seconds > 0.0 ? (double)usage->allocBytes / seconds : 0.0 );
+	JSONW_EndObject();
+}
+
+
+static void Com_WriteZoneJSON( const memzone_t* zone, const char* name )
+{
+	zonestats_t stats;
+	Z_GetZoneStats( zone, &stats );
+
+	JSONW_BeginNamedObject( name );
+	JSONW_IntegerValue( "size", zone->size );
+	JSONW_IntegerValue( "used", zone->used );
+	JSONW_IntegerValue( "used_blocks", stats.usedBlocks );
+	JSONW_IntegerValue( "free_bytes", stats.freeBytes );
+	JSONW_IntegerValue( "free_blocks", stats.freeBlocks );
+	JSONW_IntegerValue( "largest_free", stats.largestFree );
+	JSONW_EndObject();
+}
+
+
+static void Com_WriteMemoryJSON( FILE* file )
+{
+	static const char* tagNames[TAG_STATIC + 1] = {
+		"free",
+		"general",
+		"botlib",
+		"renderer",
+		"small",
+		"static"
+	};
+
+	const double seconds = (double)( Sys_Microseconds() - memUsageResetTime ) / 1000000.0;
+
+	JSONW_BeginFile( file );
+	JSONW_StringValue( "seconds_since_reset", "%.3f", seconds );
+
+	JSONW_BeginNamedObject( "zone" );
+	Com_WriteZoneJSON( mainzone, "main" );
+	Com_WriteZoneJSON( smallzone, "small" );
+	JSONW_BeginNamedArray( "tags" );
+	for ( int i = TAG_GENERAL; i <= TAG_STATIC; ++i ) {
+		Com_WriteUsageJSON( tagNames[i], &zoneTagUsage[i], seconds );
+	}
+	JSONW_EndArray();
+	JSONW_EndObject();
+
+	JSONW_BeginNamedObject( "hunk" );
+	JSONW_IntegerValue( "size", s_hunkTotal );
+	JSONW_StringValue( "pages", "%s", hugePageNames[s_hunkPages] );
+	JSONW_IntegerValue( "low_permanent", hunk_low.permanent );
+	JSONW_IntegerValue( "low_temp_highwater", hunk_low.tempHighwater );
+	JSONW_IntegerValue( "high_permanent", hunk_high.permanent );
+	JSONW_IntegerValue( "high_temp_highwater", hunk_high.tempHighwater );
+	JSONW_IntegerValue( "remaining", Hunk_MemoryRemaining() );
+	JSONW_BeginNamedArray( "consumers" );
+	for ( int i = 0; i < HC_COUNT; ++i ) {
+		Com_WriteUsageJSON( hunkConsumerNames[i], &hunkUsage[i], seconds );
+	}
+	Com_WriteUsageJSON( "temp", &hunkTempUsage, seconds );
+	JSONW_EndArray();
+	JSONW_EndObject();
+
+	JSONW_EndFile();
+}
+
+
+// with no file name, the JSON goes to the console so that it also works through rcon
+
+static void Com_MemJSON_f()
+{
+	FILE* const file = tmpfile();
+	if ( file == NULL ) {
+		Com_Printf( "memjson: couldn't create a temporary file\n" );
+		return;
+	}
+
+	Com_WriteMemoryJSON( file );
+
+	const long size = ftell( file );
+	char* const buffer = (char*)Z_Malloc( size + 1 );
+	rewind( file );
+	const qbool success = size > 0 && fread( buffer, size, 1, file ) == 1;
+	fclose( file );
+	buffer[success ? size : 0] = '\0';
+
+	if ( !success ) {
+		Com_Printf( "memjson: couldn't read back the temporary file\n" );
+	} else if ( Cmd_Argc() > 1 ) {
+		const char* const fileName = Cmd_Argv( 1 );
+		FS_WriteFile( fileName, buffer, (int)size );
+		Com_Printf( "Wrote %s\n", fileName );
+	} else {
+		// the console has a print size limit
+		for ( const char* s = buffer; *s != '\0'; ) {
+			char line[MAXPRINTMSG / 2];
+			int n = 0;
+			while ( s[n] != '\0' && s[n] != '\n' && n < (int)sizeof(line) - 2 ) {
+				n++;
+			}
+			if ( s[n] == '\n' ) {
+				n++;
+			}
+			Com_Memcpy( line, s, n );
+			line[n] = '\0';
+			Com_Printf( "%s", line );
+			s += n;
+		}
+		Com_Printf( "\n" );
+	}
+
+	Z_Free( buffer );
+}
+
+
+static void Com_MemReset_f()
+{
+	for ( int i = 0; i <= TAG_STATIC; ++i ) {
+		Com_ResetUsage( &zoneTagUsage[i] );
+	}
+	for ( int i = 0; i < HC_COUNT; ++i ) {
+		Com_ResetUsage( &hunkUsage[i] );
+	}
+	Com_ResetUsage( &hunkTempUsage );
+	memUsageResetTime = Sys_Microseconds();
+}
+
+
+/*
+zonetest runs a long session's worth of zone traffic in a few seconds:
+mostly short strings, some structures and a few big buffers with random lifetimes,
+a quarter of them living until the end, on the main zone and the small zone.
+Every block is filled and checked before it's freed.
+*/
+static void Z_Test_f()
+{
+	enum { MaxLive = 8192 };
+	typedef struct {
+		byte*	data;
+		int		size;
+	} zoneTestBlock_t;
+
+	const int ops = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 1000000;
+	const int mainBudget = Z_AvailableMemory() / 2;
+	const int smallBudget = Z_AvailableZoneMemory( smallzone ) / 2;
+
+	zoneTestBlock_t* const blocks = (zoneTestBlock_t*)calloc( MaxLive, sizeof(zoneTestBlock_t) );
+	if ( !blocks ) {
+		Com_Printf( "zonetest: out of memory\n" );
+		return;
+	}
+
+	unsigned int seed = 0x5eed;
+	int mainBytes = 0, smallBytes = 0;
+	int allocs = 0, skipped = 0, errors = 0;
+	const int64_t start = Sys_Microseconds();
+
+	for ( int op = 0; op < ops; ++op ) {
+		seed = seed * 1664525 + 1013904223;
+		zoneTestBlock_t* const block = &blocks[( seed >> 8 ) % MaxLive];
+
+		if ( block->data ) {
+			// the first quarter of the slots is only freed at the end
+			if ( block - blocks < MaxLive / 4 )
+				continue;
+
+			if ( block->data[0] != (byte)block->size || block->data[block->size - 1] != (byte)( block - blocks ) )
+				errors++;
+			Z_Free( block->data );
+			if ( block->size < 64 )
+				smallBytes -= block->size;
+			else
+				mainBytes -= block->size;
+			block->data = NULL;
+			continue;
+		}
+
+		seed = seed * 1664525 + 1013904223;
+		const int kind = ( seed >> 8 ) % 100;
+		const int range = kind < 60 ? 60 : ( kind < 95 ? 1024 : ( kind < 99 ? 16384 : 262144 ) );
+		seed = seed * 1664525 + 1013904223;
+		const int size = 4 + ( seed >> 8 ) % range;
+
+		if ( size < 64 ) {
+			if ( smallBytes + size > smallBudget ) {
+				skipped++;
+				continue;
+			}
+			block->data = (byte*)S_Malloc( size );
+			smallBytes += size;
+		} else {
+			if ( mainBytes + size > mainBudget ) {
+				skipped++;
+				continue;
+			}
+			block->data = (byte*)Z_Malloc( size );
+			mainBytes += size;
+		}
+		block->size = size;
+		block->data[0] = (byte)size;
+		block->data[size - 1] = (byte)( block - blocks );
+		allocs++;
+	}
+
+	const int64_t elapsed = Sys_Microseconds() - start;
+
+	Com_Printf( "zonetest: %d operations, %d allocations (%d skipped) in %d ms, %.1f ns per operation\n",
+		ops, allocs, skipped, (int)( elapsed / 1000 ), ops > 0 ? ( 1000.0 * (double)elapsed ) / (double)ops : 0.0 );
+	Z_PrintFragmentation( mainzone, "main" );
+	Z_PrintFragmentation( smallzone, "small" );
+
+	for ( int i = 0; i < MaxLive; ++i ) {
+		if ( blocks[i].data )
+			Z_Free( blocks[i].data );
+	}
+	free( blocks );
+
+	Z_CheckHeap();
+	if ( errors )
+		Com_Printf( "^1zonetest: %d blocks were overwritten\n", errors );
 }
 
 
@@ -1244,7 +2016,7 @@ void Com_TouchMemory()
 	}
 
 	i = ( s_hunkTotal - hunk_high.permanent ) >> 2;
-	j = hunk_high.permanent >> 2;
+	j = s_hunkTotal >> 2;
 	for (  ; i < j ; i+=64 ) {			// only need to touch each page
 		sum += ((int *)s_hunkData)[i];
 	}
@@ -1294,6 +2066,7 @@ static void Com_InitZoneMemory()
 		Com_Error( ERR_FATAL, "Zone data failed to allocate %i megs", s_zoneTotal / (1024*1024) );
 
 	Z_ClearZone( mainzone, s_zoneTotal );
+	memUsageResetTime = Sys_Microseconds();
 }
 
 
@@ -1307,6 +2080,7 @@ static void Hunk_Log( void )
 
 	if (!logfile || !FS_Initialized())
 		return;
+	Com_FlushLog(); // keep the order of the lines written by the thread
 
 	Com_sprintf(buf, sizeof(buf), "\r\n================\r\nHunk log\r\n================\r\n");
 	FS_Write(buf, strlen(buf), logfile);
@@ -1332,6 +2106,7 @@ void Hunk_SmallLog( void )
 
 	if (!logfile || !FS_Initialized())
 		return;
+	Com_FlushLog(); // keep the order of the lines written by the thread
 	for (block = hunkblocks ; block; block = block->next) {
 		block->printed = qfalse;
 	}
@@ -1375,6 +2150,9 @@ void Hunk_SmallLog( void )
 static const cmdTableItem_t hunk_cmds[] =
 {
 	{ "meminfo", Com_Meminfo_f, NULL, "prints memory allocation info" },
+	{ "zonetest", Z_Test_f, NULL, "benchmarks the zone allocator" },
+	{ "memjson", Com_MemJSON_f, NULL, "prints or writes memory usage stats as JSON" },
+	{ "memreset", Com_MemReset_f, NULL, "resets the memory usage counters and peaks" },
 #ifdef ZONE_DEBUG
 	{ "zonelog", Z_LogHeap },
 #endif
@@ -1418,18 +2196,34 @@ static void Com_InitHunkMemory()
 	} else {
 		s_hunkTotal = cv->integer * 1024 * 1024;
 	}
+
+	// the collision map, AAS, renderer BSP data and VM data segments all live on the hunk,
+	// huge pages can save TLB misses on their random accesses
+	// opt-in only until the gain has been measured on real maps
+	const cvar_t* hp = Cvar_Get( "com_hugePages", "0", CVAR_LATCH | CVAR_ARCHIVE );
+	Cvar_SetRange( "com_hugePages", CVART_INTEGER, "0", "2" );
+	Cvar_SetHelp( "com_hugePages", "page size of the hunk's memory\n"
+				 S_COLOR_VAL "    0 " S_COLOR_HELP "= Regular pages\n"
+				 S_COLOR_VAL "    1 " S_COLOR_HELP "= Transparent huge pages (Linux only)\n"
+				 S_COLOR_VAL "    2 " S_COLOR_HELP "= Reserved huge pages, falls back to 1\n"
+				 "Linux: 2 needs vm.nr_hugepages to cover " S_COLOR_CVAR "com_hunkMegs" S_COLOR_HELP ".\n"
+				 "Windows: 2 needs the 'Lock pages in memory' privilege." );
+
+	// the memory is page-aligned and prefaulted so that the first map load doesn't take the page faults
+	const hugePages_t requested = (hugePages_t)hp->integer;
+	s_hunkData = (byte*)Sys_AllocHunk( s_hunkTotal, requested, &s_hunkPages );
+	if ( !s_hunkData ) {
+		Com_Error( ERR_FATAL, "Hunk data failed to allocate %i megs", s_hunkTotal / (1024*1024) );
+	}
 #if defined( _MSC_VER ) && defined( _DEBUG ) && defined( idx64 )
-	// try to allocate at the highest possible address range to help detect errors during development
-	s_hunkData = (byte*)VirtualAlloc( NULL, ( s_hunkTotal + 4095 ) & ( ~4095 ), MEM_COMMIT | MEM_TOP_DOWN, PAGE_READWRITE );
 	Cvar_Get( "sys_hunkBaseAddress", va( "%p", s_hunkData ), CVAR_ROM );
-#else
-	s_hunkData = (byte*)calloc( s_hunkTotal + 63, 1 );
 #endif
-	if ( !s_hunkData ) {
-		Com_Error( ERR_FATAL, "Hunk data failed to allocate %i megs", s_hunkTotal / (1024*1024) );
+	if ( s_hunkPages < requested ) {
+		Com_Printf( "^3WARNING: com_hugePages %d: %s unavailable, the hunk uses %s\n",
+					(int)requested, hugePageNames[requested], hugePageNames[s_hunkPages] );
+	} else {
+		Com_DPrintf( "Hunk: %i megs in %s\n", s_hunkTotal / (1024*1024), hugePageNames[s_hunkPages] );
 	}
-	// cacheline align
-	s_hunkData = (byte *) ( ( (intptr_t)s_hunkData + 63 ) & ( ~63 ) );
 	Hunk_Clear();
 
 	Cmd_RegisterArray( hunk_cmds, MODULE_COMMON );
@@ -1451,6 +2245,11 @@ void Hunk_SetMark()
 {
 	hunk_low.mark = hunk_low.permanent;
 	hunk_high.mark = hunk_high.permanent;
+
+	for ( int i = 0; i < HC_COUNT; ++i ) {
+		hunkMarkLiveBytes[i] = hunkUsage[i].liveBytes;
+		hunkMarkLiveBlocks[i] = hunkUsage[i].liveBlocks;
+	}
 }
 
 
@@ -1460,6 +2259,54 @@ void Hunk_ClearToMark()
 {
 	hunk_low.permanent = hunk_low.temp = hunk_low.mark;
 	hunk_high.permanent = hunk_high.temp = hunk_high.mark;
+
+	for ( int i = 0; i < HC_COUNT; ++i ) {
+		hunkUsage[i].frees += hunkUsage[i].liveBlocks - hunkMarkLiveBlocks[i];
+		hunkUsage[i].liveBytes = hunkMarkLiveBytes[i];
+		hunkUsage[i].liveBlocks = hunkMarkLiveBlocks[i];
+	}
+	hunkTempUsage.frees += hunkTempUsage.liveBlocks;
+	hunkTempUsage.liveBytes = 0;
+	hunkTempUsage.liveBlocks = 0;
+}
+
+
+void Hunk_GetLocalMark( hunkMark_t* mark )
+{
+	mark->low = hunk_low.permanent;
+	mark->high = hunk_high.permanent;
+
+	for ( int i = 0; i < HC_COUNT; ++i ) {
+		mark->liveBytes[i] = hunkUsage[i].liveBytes;
+		mark->liveBlocks[i] = hunkUsage[i].liveBlocks;
+	}
+}
+
+
+// temp memory on top of the permanent allocations keeps them alive
+
+static qbool Hunk_CanClearToLocalMark( const hunkUsed_t* side, int mark )
+{
+	return side->permanent >= mark && side->temp == side->permanent;
+}
+
+
+void Hunk_ClearToLocalMark( const hunkMark_t* mark )
+{
+	if ( !Hunk_CanClearToLocalMark( &hunk_low, mark->low ) ||
+		 !Hunk_CanClearToLocalMark( &hunk_high, mark->high ) ) {
+		Com_DPrintf( "Hunk_ClearToLocalMark: temp memory in use, nothing released\n" );
+		return;
+	}
+
+	hunk_low.permanent = hunk_low.temp = mark->low;
+	hunk_high.permanent = hunk_high.temp = mark->high;
+
+	for ( int i = 0; i < HC_COUNT; ++i ) {
+		hunkUsage[i].frees += hunkUsage[i].liveBlocks - mark->liveBlocks[i];
+		hunkUsage[i].liveBytes = mark->liveBytes[i];
+		hunkUsage[i].liveBlocks = mark->liveBlocks[i];
+	}
 }
 
 
@@ -1505,6 +2352,18 @@ void Hunk_Clear()
 	hunk_permanent = &hunk_low;
 	hunk_temp = &hunk_high;
 
+	for ( int i = 0; i < HC_COUNT; ++i ) {
+		hunkUsage[i].frees += hunkUsage[i].liveBlocks;
+		hunkUsage[i].liveBytes = 0;
+		hunkUsage[i].liveBlocks = 0;
+		hunkMarkLiveBytes[i] = 0;
+		hunkMarkLiveBlocks[i] = 0;
+	}
+	hunkTempUsage.frees += hunkTempUsage.liveBlocks;
+	hunkTempUsage.liveBytes = 0;
+	hunkTempUsage.liveBlocks = 0;
+	hunkConsumer = HC_OTHER;
+
 	VM_Clear();
 
 #ifdef HUNK_DEBUG
@@ -1513,6 +2372,15 @@ void Hunk_Clear()
 }
 
 
+hunkConsumer_t Hunk_SetConsumer( hunkConsumer_t consumer )
+{
+	const hunkConsumer_t previous = hunkConsumer;
+	hunkConsumer = consumer;
+
+	return previous;
+}
+
+
 static void Hunk_SwapBanks()
 {
 	// can't swap banks if there is any temp already allocated
@@ -1579,6 +2447,7 @@ void *Hunk_Alloc( int size, ha_pref preference )
 	}
 
 	hunk_permanent->temp = hunk_permanent->permanent;
+	Com_CountAlloc( &hunkUsage[hunkConsumer], size );
 
 	Com_Memset( buf, 0, size );
 
@@ -1633,6 +2502,7 @@ void* Hunk_AllocateTempMemory( int size )
 	if ( hunk_temp->temp > hunk_temp->tempHighwater ) {
 		hunk_temp->tempHighwater = hunk_temp->temp;
 	}
+	Com_CountAlloc( &hunkTempUsage, size );
 
 	hunkHeader_t* hdr = (hunkHeader_t*)buf;
 	buf = (void*)(hdr+1);
@@ -1661,6 +2531,7 @@ void Hunk_FreeTempMemory( void* buf )
 	}
 
 	hdr->magic = HUNK_MAGIC_FREED;
+	Com_CountFree( &hunkTempUsage, hdr->size );
 
 	// this only works if the files are freed in stack order,
 	// otherwise the memory will stay around until Hunk_ClearTempMemory
@@ -1689,6 +2560,9 @@ void Hunk_ClearTempMemory()
 {
 	if ( s_hunkData ) {
 		hunk_temp->temp = hunk_temp->permanent;
+		hunkTempUsage.frees += hunkTempUsage.liveBlocks;
+		hunkTempUsage.liveBytes = 0;
+		hunkTempUsage.liveBlocks = 0;
 	}
 }
 
@@ -1832,6 +2706,7 @@ static void Com_RunAndTimeServerPacket( const netadr_t& from, msg_t* msg )
 
 int Com_EventLoop()
 {
+	Prof_Scope profScope( "Com_EventLoop" );
 	sysEvent_t	ev;
 	netadr_t	evFrom;
 	byte		bufData[MAX_MSGLEN];
@@ -2180,7 +3055,8 @@ static const cmdTableItem_t com_cmds[] =
 	{ "rand", Com_Rand_f },
 #endif
 	{ "quit", Com_Quit_f, NULL, "closes the application" },
-	{ "writeconfig", Com_WriteConfig_f, Com_CompleteWriteConfig_f, help_writeconfig }
+	{ "writeconfig", Com_WriteConfig_f, Com_CompleteWriteConfig_f, help_writeconfig },
+	{ "profdump", Prof_Dump_f, NULL, help_profdump }
 };
 
 
@@ -2193,12 +3069,16 @@ static const cvarTableItem_t com_cvars[] =
 	{ &com_maxfps, "com_maxfps", "125", CVAR_ARCHIVE, CVART_INTEGER, "60", "250", help_com_maxfps },
 #endif
 	{ &com_developer, "developer", "0", CVAR_TEMP, CVART_BOOL, NULL, NULL, "enables detailed logging" },
+	// before logfile, whose range warning can open the log
+	{ &com_logFlushInterval, "com_logFlushInterval", "1000", CVAR_ARCHIVE, CVART_INTEGER, "0", "60000", "max. time before qconsole.log lines reach the disk [ms]" },
 	{ &com_logfile, "logfile", "0", CVAR_TEMP, CVART_INTEGER, "0", "2", help_com_logfile },
 	{ &com_timescale, "timescale", "1", CVAR_CHEAT | CVAR_SYSTEMINFO, CVART_FLOAT, "0", "100", "game time to real time ratio" },
 	{ &com_fixedtime, "fixedtime", "0", CVAR_CHEAT, CVART_INTEGER, "0", "64", "fixed number of ms per simulation tick, " S_COLOR_VAL "0" S_COLOR_HELP "=off" },
 	{ &com_showtrace, "com_showtrace", "0", CVAR_CHEAT, CVART_BOOL, NULL, NULL, "prints trace optimization info" },
 	{ &com_viewlog, "viewlog", "0", CVAR_CHEAT, CVART_INTEGER, "0", "2", help_com_viewlog },
 	{ &com_speeds, "com_speeds", "0", 0, CVART_BOOL, NULL, NULL, "prints timing info" },
+	{ &com_profile, "com_profile", "0", 0, CVART_BOOL, NULL, NULL, "records a timeline of the engine's work for " S_COLOR_CMD "profdump" },
+	{ &com_profileHitch, "com_profileHitch", "0", 0, CVART_INTEGER, "0", "10000", help_com_profileHitch },
 	{ &com_timedemo, "timedemo", "0", CVAR_CHEAT, CVART_BOOL, NULL, NULL, "benchmarking mode for demo playback" },
 	{ &cl_paused, "cl_paused", "0", CVAR_ROM, CVART_BOOL },
 	{ &sv_paused, "sv_paused", "0", CVAR_ROM, CVART_BOOL },
@@ -2295,6 +3175,8 @@ void Com_Init( char *commandLine )
 
 	Cmd_RegisterArray( com_cmds, MODULE_COMMON );
 
+	Prof_Init();
+
 	const char* s = Q3_VERSION " " PLATFORM_STRING " " __DATE__;
 	com_version = Cvar_Get( "version", s, CVAR_ROM | CVAR_SERVERINFO );
 
@@ -2311,6 +3193,7 @@ void Com_Init( char *commandLine )
 	Sys_Init();
 	Netchan_Init( Com_Milliseconds() & 0xffff );	// pick a port value that should be nice and random
 	VM_Init();
+	CM_Init();
 	SV_Init();
 
 	com_dedicated->modified = qfalse;
@@ -2505,6 +3388,7 @@ static void Com_FrameSleep( qbool demoPlayback )
 void Com_Frame( qbool demoPlayback )
 {
 	if ( setjmp(abortframe) ) {
+		Hunk_SetConsumer( HC_OTHER ); // longjmp skipped the Hunk_ConsumerScope destructors
 		return;			// an ERR_DROP was thrown
 	}
 
@@ -2533,6 +3417,8 @@ void Com_Frame( qbool demoPlayback )
 
 	Com_FrameSleep( demoPlayback );
 
+	const int64_t frameStart = Sys_Microseconds();
+
 	static int lastTime = 0;
 	lastTime = com_frameTime;
 	com_frameTime = Com_EventLoop();
@@ -2625,15 +3511,11 @@ void Com_Frame( qbool demoPlayback )
 	// trace optimization tracking
 	//
 	if ( com_showtrace->integer ) {
-		extern int c_traces, c_brush_traces, c_patch_traces, c_pointcontents;
-		Com_Printf( "%4i traces  (%ib %ip) %4i points\n",
-				c_traces, c_brush_traces, c_patch_traces, c_pointcontents );
-		c_traces = 0;
-		c_brush_traces = 0;
-		c_patch_traces = 0;
-		c_pointcontents = 0;
+		CM_PrintTraceStats();
 	}
 
+	Prof_EndFrame( frameStart );
+
 	com_frameNumber++;
 
 	// this is here because the platform layer can do more initialization
@@ -2646,6 +3528,7 @@ void Com_Frame( qbool demoPlayback )
 
 void Com_Shutdown()
 {
+	Com_StopLogWriter();
 	if (logfile) {
 		FS_FCloseFile( logfile );
 		logfile = 0;
@@ -35,7 +35,20 @@ help_pattern_matching \
 "console logging to qconsole.log\n" \
 S_COLOR_VAL "    0 " S_COLOR_HELP "= Disabled\n" \
 S_COLOR_VAL "    1 " S_COLOR_HELP "= Enabled\n" \
-S_COLOR_VAL "    2 " S_COLOR_HELP "= Enabled and flushes the file after every write"
+S_COLOR_VAL "    2 " S_COLOR_HELP "= Enabled and flushes the file after every write\n" \
+"The file is written by a separate thread, see " S_COLOR_CVAR "com_logFlushInterval" S_COLOR_HELP "."
+
+#define help_com_profileHitch \
+"frame time threshold for automatic profdump calls\n" \
+S_COLOR_VAL "0 " S_COLOR_HELP "disables it, a positive value is a duration in ms.\n" \
+"When a frame takes that long, the last 2 seconds are written to a trace file.\n" \
+"There are at least 10 seconds between 2 automatic dumps."
+
+#define help_profdump \
+"writes the recorded timeline to a Chrome trace file\n" \
+"Usage: " S_COLOR_CMD "profdump " S_COLOR_VAL "[seconds]" S_COLOR_HELP "\n" \
+"The last 10 seconds are written by default, see " S_COLOR_CVAR "com_profile" S_COLOR_HELP ".\n" \
+"The files in the profiles folder open in chrome://tracing and ui.perfetto.dev."
 
 #define help_com_viewlog \
 "early console window visibility\n" \
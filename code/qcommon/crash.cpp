@@ -53,6 +53,8 @@ static const char* GetVMName(vmIndex_t vmIndex)
 		case VM_CGAME: return "cgame";
 		case VM_GAME: return "game";
 		case VM_UI: return "ui";
+		case VM_TEST_INTERPRETED:
+		case VM_TEST_COMPILED: return "vmtest";
 		default: return "unknown";
 	}
 }
@@ -36,6 +36,7 @@ void JSONW_BeginArray();
 void JSONW_BeginNamedArray(const char* name);
 void JSONW_EndArray();
 void JSONW_IntegerValue(const char* name, int number);
+void JSONW_Integer64Value(const char* name, int64_t number);
 void JSONW_HexValue(const char* name, uint64_t number);
 void JSONW_BooleanValue(const char* name, qbool value);
 void JSONW_StringValue(const char* name, PRINTF_FORMAT_STRING const char* format, ...);
@@ -173,10 +173,15 @@ or configs will never get loaded from disk!
 #define MAX_ZPATH			256
 #define	MAX_SEARCH_PATHS	4096
 #define MAX_FILEHASH_SIZE	1024
+#define	MAX_FOUND_FILES		0x1000
 
 typedef struct fileInPack_s {
 	char					*name;		// name of the file
 	unsigned long			pos;		// file info position in zip
+	unsigned long			localPos;	// local header position in zip
+	unsigned long			compressedSize;
+	unsigned long			size;		// uncompressed
+	int						method;		// 0 when stored
 	struct fileInPack_s*	next;		// next file in the hash
 } fileInPack_t;
 
@@ -189,9 +194,12 @@ typedef struct {
 	int				pure_checksum;				// checksum for pure
 	int				numfiles;					// number of files in pk3
 	int				referenced;					// referenced file flags
+	qbool			pure;						// on the pure server's list or not connected to one
 	int				hashSize;					// hash table size (power of 2)
 	fileInPack_t*	*hashTable;					// hash table
 	fileInPack_t*	buildBuffer;				// buffer with the filenames etc.
+	byte*			mapping;					// the whole pk3 when FS_ReadFile can use it
+	size_t			mappingSize;
 } pack_t;
 
 typedef struct {
@@ -207,6 +215,9 @@ typedef struct searchpath_s {
 
 static char fs_gamedir[MAX_OSPATH]; // this will be a single file name with no separators
 static cvar_t* fs_debug;
+static cvar_t* fs_index;
+static cvar_t* fs_pakcache;
+static cvar_t* fs_asyncthreads;
 static cvar_t* fs_homepath;
 static cvar_t* fs_basepath;
 #if defined( QC )
@@ -299,19 +310,532 @@ int FS_LoadStack()
 
 static qbool FS_PakIsPure( const pack_t* pack )
 {
-	if (!fs_numServerPaks)
-		return qtrue;
+	return pack->pure;
+}
+
+
+// call when the pure server pak list or the search path changed
+static void FS_UpdatePurePaks()
+{
+	for ( searchpath_t* search = fs_searchpaths; search; search = search->next ) {
+		pack_t* const pack = search->pack;
+		if ( !pack ) {
+			continue;
+		}
+
+		pack->pure = !fs_numServerPaks;
+		for ( int i = 0; i < fs_numServerPaks; ++i ) {
+			// FIXME: also use hashed file names
+			// NOTE TTimo: a pk3 with same checksum but different name would be validated too
+			//   I don't see this as allowing for any exploit, it would only happen if the client does manips of it's file names 'not a bug'
+			if ( pack->checksum == fs_serverPaks[i] ) {
+				pack->pure = qtrue;		// on the approved list
+				break;
+			}
+		}
+	}
+}
+
+
+/*
+=============================================================================
+
+FILE INDEX
+
+Maps every file of every search path element to where it is, in search order,
+so that lookups don't probe every pak's hash table and fopen in every directory.
+
+It is rebuilt on the first lookup after the search path changed
+or when a scanned directory was modified, which is checked once per second.
+Files we create in fs_homepath are inserted directly instead.
+Files found in directories are still opened to confirm they exist.
+Directories that couldn't be listed completely (too many entries, too deep, paths too long)
+are skipped: lookups of the files in them walk the search path like without the index.
+
+=============================================================================
+*/
+
+#define FS_INDEX_BLOCK_SIZE		(64 * 1024)
+#define FS_INDEX_MAX_DEPTH		32
+#define FS_INDEX_CHECK_MS		1000
+
+typedef struct fsIndexBlock_s {
+	struct fsIndexBlock_s*	next;
+	size_t					used;
+	char					data[FS_INDEX_BLOCK_SIZE];
+} fsIndexBlock_t;
+
+typedef struct fsIndexEntry_s {
+	const char*				name;
+	const searchpath_t*		search;
+	const fileInPack_t*		pakFile;	// NULL when in a directory
+	struct fsIndexEntry_s*	next;		// next in the hash bucket, in search order
+	unsigned				hash;
+	int						searchIndex;	// position of search in the search path
+} fsIndexEntry_t;
+
+typedef struct fsIndexFile_s {
+	struct fsIndexFile_s*	next;
+	const char*				name;
+} fsIndexFile_t;
+
+typedef struct fsIndexDir_s {
+	struct fsIndexDir_s*	next;
+	const char*				path;
+	int64_t					modTime;
+} fsIndexDir_t;
+
+// a directory whose files or sub-directories aren't all indexed
+typedef struct fsIndexSkip_s {
+	struct fsIndexSkip_s*	next;
+	const char*				qpath;		// "" for the game directory itself
+	qbool					subTree;	// qfalse when only the directory's own files are missing
+} fsIndexSkip_t;
+
+typedef struct {
+	qbool				valid;
+	fsIndexEntry_t*		entries;
+	int					numEntries;
+	fsIndexEntry_t**	buckets;
+	int					numBuckets;		// power of 2
+	fsIndexBlock_t*		blocks;			// names and paths from the directory scans
+	fsIndexDir_t*		dirs;			// all scanned directories
+	int					numDirs;
+	fsIndexSkip_t*		skipped;
+	int					numSkipped;
+	int					lastCheckTime;
+} fsIndex_t;
+
+static fsIndex_t fs_fileIndex;
+
+
+static void* FS_IndexAlloc( int size )
+{
+	size = ( size + 7 ) & ~7;
+	if ( !fs_fileIndex.blocks || fs_fileIndex.blocks->used + size > FS_INDEX_BLOCK_SIZE ) {
+		fsIndexBlock_t* const block = Z_New<fsIndexBlock_t>();
+		block->next = fs_fileIndex.blocks;
+		fs_fileIndex.blocks = block;
+	}
+
+	void* const data = fs_fileIndex.blocks->data + fs_fileIndex.blocks->used;
+	fs_fileIndex.blocks->used += size;
+
+	return data;
+}
+
+
+static const char* FS_IndexCopyString( const char* s )
+{
+	const int length = strlen( s ) + 1;
+	char* const copy = (char*)FS_IndexAlloc( length );
+	Com_Memcpy( copy, s, length );
+
+	return copy;
+}
+
+
+// case and separator insensitive, like FS_FilenameCompare
+static int FS_IndexFoldChar( int c )
+{
+	if ( c >= 'A' && c <= 'Z' ) {
+		return c + 'a' - 'A';
+	}
+	if ( c == '\\' || c == ':' ) {
+		return '/';
+	}
+
+	return c;
+}
+
+
+static unsigned FS_IndexHash( const char* name )
+{
+	unsigned hash = 2166136261u;
+	for ( ; *name; ++name ) {
+		hash = ( hash ^ (unsigned)FS_IndexFoldChar( *name ) ) * 16777619u;
+	}
+
+	return hash;
+}
+
+
+static void FS_FreeIndex()
+{
+	fsIndexBlock_t* next;
+	for ( fsIndexBlock_t* block = fs_fileIndex.blocks; block; block = next ) {
+		next = block->next;
+		Z_Free( block );
+	}
+
+	if ( fs_fileIndex.entries ) {
+		Z_Free( fs_fileIndex.entries );
+	}
+	if ( fs_fileIndex.buckets ) {
+		Z_Free( fs_fileIndex.buckets );
+	}
+
+	Com_Memset( &fs_fileIndex, 0, sizeof( fs_fileIndex ) );
+}
+
+
+// qtrue when the directory listing might be missing entries
+static qbool FS_IndexListTruncated( int count )
+{
+	return count >= MAX_FOUND_FILES - 1;
+}
+
+
+static void FS_IndexSkipDirectory( const char* qpath, qbool subTree )
+{
+	fsIndexSkip_t* const skip = (fsIndexSkip_t*)FS_IndexAlloc( sizeof( fsIndexSkip_t ) );
+	skip->qpath = FS_IndexCopyString( qpath );
+	skip->subTree = subTree;
+	skip->next = fs_fileIndex.skipped;
+	fs_fileIndex.skipped = skip;
+	fs_fileIndex.numSkipped++;
+}
+
+
+static qbool FS_IndexIsSkipped( const char* qpath )
+{
+	for ( const fsIndexSkip_t* skip = fs_fileIndex.skipped; skip; skip = skip->next ) {
+		const char* dir = skip->qpath;
+		const char* s = qpath;
+		while ( *dir && FS_IndexFoldChar( *dir ) == FS_IndexFoldChar( *s ) ) {
+			++dir;
+			++s;
+		}
+		if ( *dir ) {
+			continue;
+		}
+		if ( skip->qpath[0] ) {
+			if ( FS_IndexFoldChar( *s ) != '/' ) {
+				continue;
+			}
+			++s;
+		}
+		if ( skip->subTree ) {
+			return qtrue;
+		}
+		// only the files directly in the directory
+		while ( *s && FS_IndexFoldChar( *s ) != '/' ) {
+			++s;
+		}
+		if ( !*s ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+static void FS_IndexDirectory( char* osPath, char* qpath, int depth, fsIndexFile_t** files, int* numFiles )
+{
+	// the time stamp is taken first so that changes made during the scan are caught later
+	fsIndexDir_t* const dir = (fsIndexDir_t*)FS_IndexAlloc( sizeof( fsIndexDir_t ) );
+	dir->path = FS_IndexCopyString( osPath );
+	dir->modTime = Sys_GetModificationTime( osPath );
+	dir->next = fs_fileIndex.dirs;
+	fs_fileIndex.dirs = dir;
+	fs_fileIndex.numDirs++;
+
+	const int osPathLength = strlen( osPath );
+	const int qpathLength = strlen( qpath );
+	int i, count;
+
+	char** const names = Sys_ListFiles( osPath, "", NULL, &count, qfalse );
+	qbool skipFiles = FS_IndexListTruncated( count );
+	for ( i = 0; i < count; ++i ) {
+		if ( qpathLength + strlen( names[i] ) + 2 > MAX_OSPATH ) {
+			skipFiles = qtrue;
+			continue;
+		}
+		fsIndexFile_t* const file = (fsIndexFile_t*)FS_IndexAlloc( sizeof( fsIndexFile_t ) );
+		file->name = FS_IndexCopyString( qpathLength ? va( "%s/%s", qpath, names[i] ) : names[i] );
+		file->next = *files;
+		*files = file;
+		(*numFiles)++;
+	}
+	Sys_FreeFileList( names );
+
+	// the sub-directories that are missing from a truncated list can't be known
+	char** const subDirs = Sys_ListFiles( osPath, "/", NULL, &count, qfalse );
+	if ( FS_IndexListTruncated( count ) ) {
+		FS_IndexSkipDirectory( qpath, qtrue );
+	} else if ( skipFiles ) {
+		FS_IndexSkipDirectory( qpath, qfalse );
+	}
+	for ( i = 0; i < count; ++i ) {
+		if ( !strcmp( subDirs[i], "." ) || !strcmp( subDirs[i], ".." ) ) {
+			continue;
+		}
+		const int nameLength = strlen( subDirs[i] );
+		if ( qpathLength + nameLength + 2 > MAX_OSPATH ) {
+			continue; // nothing can look files up in there
+		}
+		Com_sprintf( qpath + qpathLength, MAX_OSPATH - qpathLength, qpathLength ? "/%s" : "%s", subDirs[i] );
+		if ( depth >= FS_INDEX_MAX_DEPTH || osPathLength + nameLength + 2 > MAX_OSPATH ) {
+			FS_IndexSkipDirectory( qpath, qtrue );
+		} else {
+			Com_sprintf( osPath + osPathLength, MAX_OSPATH - osPathLength, "%c%s", PATH_SEP, subDirs[i] );
+			FS_IndexDirectory( osPath, qpath, depth + 1, files, numFiles );
+		}
+		osPath[osPathLength] = '\0';
+		qpath[qpathLength] = '\0';
+	}
+	Sys_FreeFileList( subDirs );
+}
+
+
+static void FS_IndexAdd( const searchpath_t* search, int searchIndex, const char* name, const fileInPack_t* pakFile )
+{
+	fsIndexEntry_t* const entry = &fs_fileIndex.entries[fs_fileIndex.numEntries++];
+	entry->name = name;
+	entry->search = search;
+	entry->pakFile = pakFile;
+	entry->hash = FS_IndexHash( name );
+	entry->searchIndex = searchIndex;
+
+	fsIndexEntry_t** const bucket = &fs_fileIndex.buckets[entry->hash & ( fs_fileIndex.numBuckets - 1 )];
+	entry->next = *bucket;
+	*bucket = entry;
+}
+
+
+static void FS_BuildIndex()
+{
+	const int startTime = Sys_Milliseconds();
+
+	FS_FreeIndex();
+
+	int numSearchPaths = 0;
+	const searchpath_t* search;
+	for ( search = fs_searchpaths; search; search = search->next ) {
+		numSearchPaths++;
+	}
+
+	// scan the directory trees first to know how many entries we need
+	const searchpath_t** const searchPaths = Z_New<const searchpath_t*>( numSearchPaths );
+	fsIndexFile_t** const dirFiles = Z_New<fsIndexFile_t*>( numSearchPaths );
+	int numEntries = 0;
+	int i = 0;
+	for ( search = fs_searchpaths; search; search = search->next, ++i ) {
+		searchPaths[i] = search;
+		if ( search->pack ) {
+			numEntries += search->pack->numfiles;
+		} else if ( search->dir ) {
+			char osPath[MAX_OSPATH];
+			char qpath[MAX_OSPATH];
+			Q_strncpyz( osPath, FS_BuildOSPath( search->dir->path, search->dir->gamedir, "" ), sizeof( osPath ) );
+			osPath[strlen( osPath ) - 1] = '\0'; // strip the trailing slash
+			qpath[0] = '\0';
+			FS_IndexDirectory( osPath, qpath, 0, &dirFiles[i], &numEntries );
+		}
+	}
+
+	fs_fileIndex.entries = Z_New<fsIndexEntry_t>( max( numEntries, 1 ) );
+	fs_fileIndex.numBuckets = 256;
+	while ( fs_fileIndex.numBuckets < numEntries ) {
+		fs_fileIndex.numBuckets <<= 1;
+	}
+	fs_fileIndex.buckets = Z_New<fsIndexEntry_t*>( fs_fileIndex.numBuckets );
+
+	// entries are prepended to their buckets, so the lowest priority goes first
+	for ( i = numSearchPaths - 1; i >= 0; --i ) {
+		search = searchPaths[i];
+		if ( search->pack ) {
+			// like the pak's own hash table, the last duplicate in the zip wins
+			for ( int j = 0; j < search->pack->numfiles; ++j ) {
+				const fileInPack_t* const pakFile = &search->pack->buildBuffer[j];
+				FS_IndexAdd( search, i, pakFile->name, pakFile );
+			}
+		} else {
+			for ( const fsIndexFile_t* file = dirFiles[i]; file; file = file->next ) {
+				FS_IndexAdd( search, i, file->name, NULL );
+			}
+		}
+	}
+
+	Z_Free( dirFiles );
+	Z_Free( searchPaths );
+
+	fs_fileIndex.valid = qtrue;
+	fs_fileIndex.lastCheckTime = Sys_Milliseconds();
+
+	Com_DPrintf( "File index: %d files, %d directories scanned in %d ms, %d directories skipped\n",
+				 fs_fileIndex.numEntries, fs_fileIndex.numDirs, fs_fileIndex.lastCheckTime - startTime,
+				 fs_fileIndex.numSkipped );
+}
+
+
+static void FS_InvalidateIndex()
+{
+	fs_fileIndex.valid = qfalse;
+}
+
+
+static qbool FS_IndexDirectoriesChanged()
+{
+	for ( const fsIndexDir_t* dir = fs_fileIndex.dirs; dir; dir = dir->next ) {
+		if ( Sys_GetModificationTime( dir->path ) != dir->modTime ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+// qpaths the directory scans could never produce, like "a//b" or "./a", must be probed
+static qbool FS_IsIndexablePath( const char* qpath )
+{
+	qbool newElement = qtrue;
+	for ( const char* s = qpath; *s; ++s ) {
+		const qbool separator = *s == '/' || *s == '\\' || *s == ':';
+		if ( separator && newElement ) {
+			return qfalse;
+		}
+		if ( *s == '.' && newElement && ( s[1] == '\0' || s[1] == '/' || s[1] == '\\' ) ) {
+			return qfalse;
+		}
+		newElement = separator;
+	}
+
+	return !newElement;
+}
+
+
+// builds or refreshes the index as needed
+// returns qfalse when the search path has to be walked instead
+static qbool FS_IndexReady( const char* qpath )
+{
+	if ( !fs_index->integer || !FS_IsIndexablePath( qpath ) ) {
+		return qfalse;
+	}
+
+	if ( fs_fileIndex.valid ) {
+		const int now = Sys_Milliseconds();
+		if ( now - fs_fileIndex.lastCheckTime >= FS_INDEX_CHECK_MS ) {
+			fs_fileIndex.lastCheckTime = now;
+			if ( FS_IndexDirectoriesChanged() ) {
+				FS_InvalidateIndex();
+			}
+		}
+	}
+
+	if ( !fs_fileIndex.valid ) {
+		FS_BuildIndex();
+	}
+
+	return !FS_IndexIsSkipped( qpath );
+}
+
+
+// returns the next entry for the file after the previous one, or the first when previous is NULL
+static const fsIndexEntry_t* FS_IndexFind( const char* qpath, unsigned hash, const fsIndexEntry_t* previous )
+{
+	const fsIndexEntry_t* entry = previous ? previous->next : fs_fileIndex.buckets[hash & ( fs_fileIndex.numBuckets - 1 )];
+	for ( ; entry; entry = entry->next ) {
+		if ( entry->hash == hash && !FS_FilenameCompare( entry->name, qpath ) ) {
+			return entry;
+		}
+	}
+
+	return NULL;
+}
+
+
+static const searchpath_t* FS_IndexHomeSearchPath( const char* gamedir, int* searchIndex )
+{
+	int i = 0;
+	for ( const searchpath_t* search = fs_searchpaths; search; search = search->next, ++i ) {
+		const directory_t* const dir = search->dir;
+		if ( dir && !Q_stricmp( dir->path, fs_homepath->string ) && !Q_stricmp( dir->gamedir, gamedir ) ) {
+			*searchIndex = i;
+			return search;
+		}
+	}
+
+	return NULL;
+}
+
+
+static fsIndexDir_t* FS_IndexFindDirectory( const char* osPath )
+{
+	for ( fsIndexDir_t* dir = fs_fileIndex.dirs; dir; dir = dir->next ) {
+		if ( !strcmp( dir->path, osPath ) ) {
+			return dir;
+		}
+	}
+
+	return NULL;
+}
+
+
+// call after creating a file in a game directory of fs_homepath
+static void FS_IndexFileCreated( const char* gamedir, const char* qpath )
+{
+	// lookups that can't use the index probe the directories anyway
+	if ( !fs_fileIndex.valid || !FS_IsIndexablePath( qpath ) || FS_IndexIsSkipped( qpath ) ) {
+		return;
+	}
+
+	int searchIndex;
+	const searchpath_t* const search = FS_IndexHomeSearchPath( gamedir, &searchIndex );
+	if ( !search ) {
+		return;
+	}
+
+	// the new file changed the directory's time stamp, which would force a rebuild
+	// a directory that was just created for it wasn't scanned at all
+	char osPath[MAX_OSPATH];
+	Q_strncpyz( osPath, FS_BuildOSPath( fs_homepath->string, gamedir, qpath ), sizeof( osPath ) );
+	*strrchr( osPath, PATH_SEP ) = '\0';
+	fsIndexDir_t* const dir = FS_IndexFindDirectory( osPath );
+	if ( !dir ) {
+		FS_InvalidateIndex();
+		return;
+	}
+	dir->modTime = Sys_GetModificationTime( osPath );
 
-	for ( int i = 0; i < fs_numServerPaks; ++i ) {
-		// FIXME: also use hashed file names
-		// NOTE TTimo: a pk3 with same checksum but different name would be validated too
-		//   I don't see this as allowing for any exploit, it would only happen if the client does manips of it's file names 'not a bug'
-		if ( pack->checksum == fs_serverPaks[i] ) {
-			return qtrue;		// on the approved list
+	const unsigned hash = FS_IndexHash( qpath );
+	for ( const fsIndexEntry_t* entry = FS_IndexFind( qpath, hash, NULL ); entry; entry = FS_IndexFind( qpath, hash, entry ) ) {
+		if ( entry->search == search ) {
+			return; // already indexed
 		}
 	}
 
-	return qfalse;	// not on the pure server pak list
+	fsIndexEntry_t* const entry = (fsIndexEntry_t*)FS_IndexAlloc( sizeof( fsIndexEntry_t ) );
+	entry->name = FS_IndexCopyString( qpath );
+	entry->search = search;
+	entry->pakFile = NULL;
+	entry->hash = hash;
+	entry->searchIndex = searchIndex;
+	fs_fileIndex.numEntries++;
+
+	// keep the bucket in search order
+	fsIndexEntry_t** link = &fs_fileIndex.buckets[hash & ( fs_fileIndex.numBuckets - 1 )];
+	while ( *link && (*link)->searchIndex < searchIndex ) {
+		link = &(*link)->next;
+	}
+	entry->next = *link;
+	*link = entry;
+}
+
+
+// the paths of the FS_SV_ functions start with the game directory
+static void FS_IndexSVFileCreated( const char* path )
+{
+	const char* const separator = strpbrk( path, "/\\" );
+	if ( !separator || separator - path >= MAX_QPATH ) {
+		return; // not in a game directory
+	}
+
+	char gamedir[MAX_QPATH];
+	Q_strncpyz( gamedir, path, separator - path + 1 );
+	FS_IndexFileCreated( gamedir, separator + 1 );
 }
 
 
@@ -351,6 +875,12 @@ void FS_ForceFlush( fileHandle_t f )
 }
 
 
+FILE* FS_GetWriteFile( fileHandle_t f )
+{
+	return FS_FileForHandle(f);
+}
+
+
 /*
 ================
 FS_filelength
@@ -550,6 +1080,8 @@ fileHandle_t FS_SV_FOpenFileWrite( const char *filename ) {
 	fsh[f].handleSync = qfalse;
 	if (!fsh[f].handleFiles.file.o) {
 		f = 0;
+	} else {
+		FS_IndexSVFileCreated( filename );
 	}
 	return f;
 }
@@ -660,6 +1192,8 @@ void FS_SV_Rename( const char *from, const char *to ) {
 		//FS_Remove( from_ospath );
 		Com_Error( ERR_FATAL, "FS_SV_Rename: %s --> %s failed\n", from_ospath, to_ospath );
 	}
+
+	FS_IndexSVFileCreated( to );
 }
 
 
@@ -685,7 +1219,9 @@ void FS_Rename( const char *from, const char *to ) {
 		Com_Printf( "FS_Rename: %s --> %s\n", from_ospath, to_ospath );
 	}
 
-	rename( from_ospath, to_ospath );
+	if ( !rename( from_ospath, to_ospath ) ) {
+		FS_IndexFileCreated( fs_gamedir, to );
+	}
 }
 
 /*
@@ -756,6 +1292,8 @@ fileHandle_t FS_FOpenFileWrite( const char *filename ) {
 	fsh[f].handleSync = qfalse;
 	if (!fsh[f].handleFiles.file.o) {
 		f = 0;
+	} else {
+		FS_IndexFileCreated( fs_gamedir, filename );
 	}
 	return f;
 }
@@ -795,6 +1333,8 @@ fileHandle_t FS_FOpenFileAppend( const char *filename ) {
 	fsh[f].handleSync = qfalse;
 	if (!fsh[f].handleFiles.file.o) {
 		f = 0;
+	} else {
+		FS_IndexFileCreated( fs_gamedir, filename );
 	}
 	return f;
 }
@@ -840,7 +1380,7 @@ qbool FS_FilenameCompare( const char *s1, const char *s2 ) {
 
 static qbool FS_IsPureClientReadException( const char* filename )
 {
-	static const char* extensions[] =  { ".cfg", ".ttf", ".dat", ".jpg", ".jpeg", ".tga", ".png", ".shader" };
+	static const char* extensions[] =  { ".cfg", ".ttf", ".dat", ".jpg", ".jpeg", ".tga", ".png", ".shader", ".cmt" };
 	const int shortestExtLength = 3;
 
 	const int nameLength = strlen(filename);
@@ -871,221 +1411,292 @@ separate file or a ZIP file.
 */
 extern qbool		com_fullyInitialized;
 
-int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE, int *pakChecksum ) {
-	searchpath_t	*search;
-	char			*netpath;
-	pack_t			*pak;
-	fileInPack_t	*pakFile;
-	directory_t		*dir;
-	long			hash;
-	unz_s			*zfi;
-	FILE			*temp;
-	int				l;
-	char			demoExt[16];
-
-	hash = 0;
-	if ( pakChecksum ) {
-		*pakChecksum = 0;
+// the zip file is only opened when we first need to stream from it
+static unzFile FS_PakHandle( pack_t* pak )
+{
+	if ( !pak->handle ) {
+		pak->handle = unzOpen( pak->pakFilename );
+		if ( !pak->handle ) {
+			Com_Error( ERR_FATAL, "Couldn't open %s", pak->pakFilename );
+		}
 	}
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
-	}
+	return pak->handle;
+}
 
-	if ( file == NULL ) {
-		// just wants to see if file is there
-		for ( search = fs_searchpaths ; search ; search = search->next ) {
-			//
-			if ( search->pack ) {
-				hash = Q_FileHash( filename, search->pack->hashSize );
-			}
-			// is the element a pak file?
-			if ( search->pack && search->pack->hashTable[hash] ) {
-				// look through all the pak file elements
-				pak = search->pack;
-				pakFile = pak->hashTable[hash];
-				do {
-					// case and separator insensitive comparisons
-					if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-						// found it!
-						if ( pakChecksum ) {
-							*pakChecksum = pak->checksum;
-						}
-						return qtrue;
-					}
-					pakFile = pakFile->next;
-				} while(pakFile != NULL);
-			} else if ( search->dir ) {
-				dir = search->dir;
-				netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
-				temp = fopen (netpath, "rb");
-				if ( !temp ) {
-					continue;
-				}
-				fclose(temp);
-				return qtrue;
-			}
+
+// marks the pak as referenced and opens the file in it, see FS_FOpenFileReadInternal
+static int FS_OpenPakFile( pack_t* pak, const fileInPack_t* pakFile, const char* filename, fileHandle_t* file, int* pakChecksum,
+						   const pack_t** mappedPak, const fileInPack_t** mappedFile )
+{
+	// mark the pak as having been referenced and mark specifics on cgame and ui
+	// shaders, txt, arena files  by themselves do not count as a reference as 
+	// these are loaded from all pk3s 
+	// from every pk3 file.. 
+	const int l = strlen( filename );
+	if ( !(pak->referenced & FS_GENERAL_REF)) {
+		if ( Q_stricmp(filename + l - 7, ".shader") != 0 &&
+			Q_stricmp(filename + l - 4, ".txt") != 0 &&
+			Q_stricmp(filename + l - 4, ".cfg") != 0 &&
+			Q_stricmp(filename + l - 7, ".config") != 0 &&
+			strstr(filename, "levelshots") == NULL &&
+			Q_stricmp(filename + l - 4, ".bot") != 0 &&
+			Q_stricmp(filename + l - 6, ".arena") != 0 &&
+			Q_stricmp(filename + l - 5, ".menu") != 0) {
+			pak->referenced |= FS_GENERAL_REF;
 		}
-		return qfalse;
 	}
 
-	if ( !filename ) {
-		Com_Error( ERR_FATAL, "FS_FOpenFileRead: NULL 'filename' parameter passed\n" );
+	if (!(pak->referenced & FS_QAGAME_REF) && !Q_stricmp(filename, "vm/qagame.qvm")) {
+		pak->referenced |= FS_QAGAME_REF;
 	}
-
-	Com_sprintf (demoExt, sizeof(demoExt), ".dm_%d",PROTOCOL_VERSION );
-	// qpaths are not supposed to have a leading slash
-	if ( filename[0] == '/' || filename[0] == '\\' ) {
-		filename++;
+	if (!(pak->referenced & FS_CGAME_REF) && !Q_stricmp(filename, "vm/cgame.qvm")) {
+		pak->referenced |= FS_CGAME_REF;
+	}
+	if (!(pak->referenced & FS_UI_REF) && !Q_stricmp(filename, "vm/ui.qvm")) {
+		pak->referenced |= FS_UI_REF;
 	}
 
-	// make absolutely sure that it can't back up the path.
-	// The searchpaths do guarantee that something will always
-	// be prepended, so we don't need to worry about "c:" or "//limbo" 
-	if ( strstr( filename, ".." ) || strstr( filename, "::" ) ) {
-		*file = 0;
-		return -1;
+	if ( pakChecksum ) {
+		*pakChecksum = pak->checksum;
 	}
 
-	// make sure the q3key file is only readable by the quake3.exe at initialization
-	// any other time the key should only be accessed in memory using the provided functions
-	if( com_fullyInitialized && strstr( filename, "q3key" ) ) {
+	if ( mappedFile && pak->mapping ) {
+		*mappedPak = pak;
+		*mappedFile = pakFile;
 		*file = 0;
-		return -1;
+		if ( fs_debug->integer ) {
+			Com_Printf( "FS_FOpenFileRead: %s (found in mapped '%s')\n",
+				filename, pak->pakFilename );
+		}
+		return (int)pakFile->size;
 	}
 
-	//
-	// search through the path, one element at a time
-	//
+	if ( fsh[*file].handleFiles.unique ) {
+		// open a new file on the pakfile
+		fsh[*file].handleFiles.file.z = unzReOpen (pak->pakFilename, FS_PakHandle(pak));
+		if (fsh[*file].handleFiles.file.z == NULL) {
+			Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->pakFilename);
+		}
+	} else {
+		fsh[*file].handleFiles.file.z = FS_PakHandle(pak);
+	}
+	Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
+	fsh[*file].zipFile = qtrue;
+	unz_s* const zfi = (unz_s *)fsh[*file].handleFiles.file.z;
+	// in case the file was new
+	FILE* const temp = zfi->file;
+	// set the file position in the zip file (also sets the current file info)
+	unzSetCurrentFileInfoPosition(pak->handle, pakFile->pos);
+	// copy the file info into the unzip structure
+	Com_Memcpy( zfi, pak->handle, sizeof(unz_s) );
+	// we copy this back into the structure
+	zfi->file = temp;
+	// open the file in the zip
+	unzOpenCurrentFile( fsh[*file].handleFiles.file.z );
+	fsh[*file].zipFilePos = pakFile->pos;
 
-	*file = FS_HandleForFile();
-	fsh[*file].handleFiles.unique = uniqueFILE;
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_FOpenFileRead: %s (found in '%s')\n", 
+			filename, pak->pakFilename );
+	}
+	return zfi->cur_file_info.uncompressed_size;
+}
 
-	for ( search = fs_searchpaths ; search ; search = search->next ) {
-		//
-		if ( search->pack ) {
-			hash = Q_FileHash( filename, search->pack->hashSize );
+
+// opens the file in the directory tree if it's allowed to come from there
+// returns the file size or -1
+static int FS_OpenDirectoryFile( const directory_t* dir, const char* filename, fileHandle_t* file )
+{
+	// For mods, we ignore baseq3/q3config.cfg and baseq3/autoexec.cfg
+	// to avoid config pollution.
+	// Mod authors should package a proper default.cfg (pretty much binds only)
+	// in their .pk3 so that it overrides baseq3/default.cfg (it's in pak0.pk3).
+	if (	Q_stricmp( dir->gamedir, fs_gamedir ) &&
+			(	!Q_stricmp( filename, "q3config.cfg" ) ||
+				!Q_stricmp( filename, "autoexec.cfg" ) ) ) {
+		return -1;
+	}
+
+	// if we are running restricted, the only files we
+	// will allow to come from the directory are .cfg files
+
+  // FIXME TTimo I'm not sure about the fs_numServerPaks test
+  // if you are using FS_ReadFile to find out if a file exists,
+  //   this test can make the search fail although the file is in the directory
+  // I had the problem on https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=8
+  // turned out I used FS_FileExists instead
+	if ( fs_numServerPaks && !FS_IsPureClientReadException( filename ) ) {
+		return -1;
+	}
+
+	const char* const netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
+	fsh[*file].handleFiles.file.o = fopen (netpath, "rb");
+	if ( !fsh[*file].handleFiles.file.o ) {
+		return -1;
+	}
+
+	Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
+	fsh[*file].zipFile = qfalse;
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_FOpenFileRead: %s (found in '%s/%s')\n", filename,
+			dir->path, dir->gamedir );
+	}
+
+	return FS_filelength (*file);
+}
+
+
+static qbool FS_DirectoryHasFile( const directory_t* dir, const char* filename )
+{
+	FILE* const temp = fopen( FS_BuildOSPath( dir->path, dir->gamedir, filename ), "rb" );
+	if ( !temp ) {
+		return qfalse;
+	}
+
+	fclose( temp );
+
+	return qtrue;
+}
+
+
+// returns the pak file entry or NULL
+static const fileInPack_t* FS_FindInPak( const pack_t* pak, const char* filename )
+{
+	const long hash = Q_FileHash( filename, pak->hashSize );
+	for ( const fileInPack_t* pakFile = pak->hashTable[hash]; pakFile; pakFile = pakFile->next ) {
+		// case and separator insensitive comparisons
+		if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
+			return pakFile;
 		}
-		// is the element a pak file?
-		if ( search->pack && search->pack->hashTable[hash] ) {
-			// disregard if it doesn't match one of the allowed pure pak files
-			if ( !FS_PakIsPure(search->pack) ) {
-				continue;
-			}
+	}
 
-			// look through all the pak file elements
-			pak = search->pack;
-			pakFile = pak->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					// found it!
+	return NULL;
+}
 
-					// mark the pak as having been referenced and mark specifics on cgame and ui
-					// shaders, txt, arena files  by themselves do not count as a reference as 
-					// these are loaded from all pk3s 
-					// from every pk3 file.. 
-					l = strlen( filename );
-					if ( !(pak->referenced & FS_GENERAL_REF)) {
-						if ( Q_stricmp(filename + l - 7, ".shader") != 0 &&
-							Q_stricmp(filename + l - 4, ".txt") != 0 &&
-							Q_stricmp(filename + l - 4, ".cfg") != 0 &&
-							Q_stricmp(filename + l - 7, ".config") != 0 &&
-							strstr(filename, "levelshots") == NULL &&
-							Q_stricmp(filename + l - 4, ".bot") != 0 &&
-							Q_stricmp(filename + l - 6, ".arena") != 0 &&
-							Q_stricmp(filename + l - 5, ".menu") != 0) {
-							pak->referenced |= FS_GENERAL_REF;
-						}
-					}
 
-					if (!(pak->referenced & FS_QAGAME_REF) && !Q_stricmp(filename, "vm/qagame.qvm")) {
-						pak->referenced |= FS_QAGAME_REF;
-					}
-					if (!(pak->referenced & FS_CGAME_REF) && !Q_stricmp(filename, "vm/cgame.qvm")) {
-						pak->referenced |= FS_CGAME_REF;
-					}
-					if (!(pak->referenced & FS_UI_REF) && !Q_stricmp(filename, "vm/ui.qvm")) {
-						pak->referenced |= FS_UI_REF;
-					}
+// when mappedFile isn't NULL and the file is in a mapped pak, no handle is opened:
+// *file is 0, *mappedPak and *mappedFile are set and the uncompressed size is returned
+static int FS_FOpenFileReadInternal( const char *filename, fileHandle_t *file, qbool uniqueFILE, int *pakChecksum,
+									 const pack_t** mappedPak, const fileInPack_t** mappedFile ) {
+	searchpath_t	*search;
 
-					if ( uniqueFILE ) {
-						// open a new file on the pakfile
-						fsh[*file].handleFiles.file.z = unzReOpen (pak->pakFilename, pak->handle);
-						if (fsh[*file].handleFiles.file.z == NULL) {
-							Com_Error (ERR_FATAL, "Couldn't reopen %s", pak->pakFilename);
-						}
-					} else {
-						fsh[*file].handleFiles.file.z = pak->handle;
-					}
-					Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
-					fsh[*file].zipFile = qtrue;
-					zfi = (unz_s *)fsh[*file].handleFiles.file.z;
-					// in case the file was new
-					temp = zfi->file;
-					// set the file position in the zip file (also sets the current file info)
-					unzSetCurrentFileInfoPosition(pak->handle, pakFile->pos);
-					// copy the file info into the unzip structure
-					Com_Memcpy( zfi, pak->handle, sizeof(unz_s) );
-					// we copy this back into the structure
-					zfi->file = temp;
-					// open the file in the zip
-					unzOpenCurrentFile( fsh[*file].handleFiles.file.z );
-					fsh[*file].zipFilePos = pakFile->pos;
+	if ( pakChecksum ) {
+		*pakChecksum = 0;
+	}
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+	}
 
+	if ( file == NULL ) {
+		// just wants to see if file is there
+		if ( FS_IndexReady( filename ) ) {
+			const unsigned hash = FS_IndexHash( filename );
+			for ( const fsIndexEntry_t* entry = FS_IndexFind( filename, hash, NULL ); entry; entry = FS_IndexFind( filename, hash, entry ) ) {
+				if ( entry->pakFile ) {
 					if ( pakChecksum ) {
-						*pakChecksum = pak->checksum;
+						*pakChecksum = entry->search->pack->checksum;
 					}
+					return qtrue;
+				}
+				if ( FS_DirectoryHasFile( entry->search->dir, filename ) ) {
+					return qtrue;
+				}
+			}
+			return qfalse;
+		}
 
-					if ( fs_debug->integer ) {
-						Com_Printf( "FS_FOpenFileRead: %s (found in '%s')\n", 
-							filename, pak->pakFilename );
+		for ( search = fs_searchpaths ; search ; search = search->next ) {
+			// is the element a pak file?
+			if ( search->pack ) {
+				if ( FS_FindInPak( search->pack, filename ) ) {
+					// found it!
+					if ( pakChecksum ) {
+						*pakChecksum = search->pack->checksum;
 					}
-					return zfi->cur_file_info.uncompressed_size;
+					return qtrue;
+				}
+			} else if ( search->dir ) {
+				if ( FS_DirectoryHasFile( search->dir, filename ) ) {
+					return qtrue;
 				}
-				pakFile = pakFile->next;
-			} while(pakFile != NULL);
-		} else if ( search->dir ) {
-			// check a file in the directory tree
-
-			// For mods, we ignore baseq3/q3config.cfg and baseq3/autoexec.cfg
-			// to avoid config pollution.
-			// Mod authors should package a proper default.cfg (pretty much binds only)
-			// in their .pk3 so that it overrides baseq3/default.cfg (it's in pak0.pk3).
-			if (	Q_stricmp( search->dir->gamedir, fs_gamedir ) &&
-					(	!Q_stricmp( filename, "q3config.cfg" ) ||
-						!Q_stricmp( filename, "autoexec.cfg" ) ) ) {
-				continue;
 			}
+		}
+		return qfalse;
+	}
 
-			// if we are running restricted, the only files we
-			// will allow to come from the directory are .cfg files
+	if ( !filename ) {
+		Com_Error( ERR_FATAL, "FS_FOpenFileRead: NULL 'filename' parameter passed\n" );
+	}
 
-      // FIXME TTimo I'm not sure about the fs_numServerPaks test
-      // if you are using FS_ReadFile to find out if a file exists,
-      //   this test can make the search fail although the file is in the directory
-      // I had the problem on https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=8
-      // turned out I used FS_FileExists instead
-			if ( fs_numServerPaks && !FS_IsPureClientReadException( filename ) ) {
-				continue;
-			}
+	// qpaths are not supposed to have a leading slash
+	if ( filename[0] == '/' || filename[0] == '\\' ) {
+		filename++;
+	}
 
-			dir = search->dir;
-			
-			netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
-			fsh[*file].handleFiles.file.o = fopen (netpath, "rb");
-			if ( !fsh[*file].handleFiles.file.o ) {
-				continue;
+	// make absolutely sure that it can't back up the path.
+	// The searchpaths do guarantee that something will always
+	// be prepended, so we don't need to worry about "c:" or "//limbo" 
+	if ( strstr( filename, ".." ) || strstr( filename, "::" ) ) {
+		*file = 0;
+		return -1;
+	}
+
+	// make sure the q3key file is only readable by the quake3.exe at initialization
+	// any other time the key should only be accessed in memory using the provided functions
+	if( com_fullyInitialized && strstr( filename, "q3key" ) ) {
+		*file = 0;
+		return -1;
+	}
+
+	//
+	// search through the path, one element at a time
+	//
+
+	*file = FS_HandleForFile();
+	fsh[*file].handleFiles.unique = uniqueFILE;
+
+	if ( FS_IndexReady( filename ) ) {
+		// only the search path elements that have the file, in search order
+		const unsigned hash = FS_IndexHash( filename );
+		for ( const fsIndexEntry_t* entry = FS_IndexFind( filename, hash, NULL ); entry; entry = FS_IndexFind( filename, hash, entry ) ) {
+			if ( entry->pakFile ) {
+				// disregard if it doesn't match one of the allowed pure pak files
+				if ( !FS_PakIsPure( entry->search->pack ) ) {
+					continue;
+				}
+				return FS_OpenPakFile( entry->search->pack, entry->pakFile, filename, file, pakChecksum, mappedPak, mappedFile );
 			}
 
-			Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
-			fsh[*file].zipFile = qfalse;
-			if ( fs_debug->integer ) {
-				Com_Printf( "FS_FOpenFileRead: %s (found in '%s/%s')\n", filename,
-					dir->path, dir->gamedir );
+			// the file might have been deleted since the directory was scanned
+			const int length = FS_OpenDirectoryFile( entry->search->dir, filename, file );
+			if ( length >= 0 ) {
+				return length;
 			}
+		}
+	} else {
+		for ( search = fs_searchpaths ; search ; search = search->next ) {
+			// is the element a pak file?
+			if ( search->pack ) {
+				const fileInPack_t* const pakFile = FS_FindInPak( search->pack, filename );
+				if ( !pakFile ) {
+					continue;
+				}
+
+				// disregard if it doesn't match one of the allowed pure pak files
+				if ( !FS_PakIsPure(search->pack) ) {
+					continue;
+				}
 
-			return FS_filelength (*file);
+				return FS_OpenPakFile( search->pack, pakFile, filename, file, pakChecksum, mappedPak, mappedFile );
+			} else if ( search->dir ) {
+				// check a file in the directory tree
+				const int length = FS_OpenDirectoryFile( search->dir, filename, file );
+				if ( length >= 0 ) {
+					return length;
+				}
+			}
 		}
 	}
 
@@ -1100,6 +1711,11 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE
 }
 
 
+int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qbool uniqueFILE, int *pakChecksum ) {
+	return FS_FOpenFileReadInternal( filename, file, uniqueFILE, pakChecksum, NULL, NULL );
+}
+
+
 /*
 =================
 FS_Read
@@ -1338,39 +1954,37 @@ qbool FS_FileIsInPAK( const char* filename, int* pureChecksum, int* checksum )
 		return qfalse;
 	}
 
-	// search through the path, one element at a time
-
-	for ( const searchpath_t* search = fs_searchpaths; search; search = search->next ) {
-		if ( !search->pack )
-			continue;
-
-		long hash = Q_FileHash( filename, search->pack->hashSize );
-		// is the element a pak file?
-		if ( search->pack->hashTable[hash] ) {
+	const pack_t* pak = NULL;
+	if ( FS_IndexReady( filename ) ) {
+		const unsigned hash = FS_IndexHash( filename );
+		for ( const fsIndexEntry_t* entry = FS_IndexFind( filename, hash, NULL ); entry; entry = FS_IndexFind( filename, hash, entry ) ) {
 			// disregard if it doesn't match one of the allowed pure pak files
-			if ( !FS_PakIsPure(search->pack) ) {
-				continue;
+			if ( entry->pakFile && FS_PakIsPure( entry->search->pack ) ) {
+				pak = entry->search->pack;
+				break;
+			}
+		}
+	} else {
+		// search through the path, one element at a time
+		for ( const searchpath_t* search = fs_searchpaths; search; search = search->next ) {
+			if ( search->pack && FS_PakIsPure( search->pack ) && FS_FindInPak( search->pack, filename ) ) {
+				pak = search->pack;
+				break;
 			}
-
-			// look through all the pak file elements
-			const fileInPack_t* pakFile = search->pack->hashTable[hash];
-			do {
-				// case and separator insensitive comparisons
-				if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-					if (pureChecksum) {
-						*pureChecksum = search->pack->pure_checksum;
-					}
-					if (checksum) {
-						*checksum = search->pack->checksum;
-					}
-					return qtrue;
-				}
-				pakFile = pakFile->next;
-			} while (pakFile);
 		}
 	}
 
-	return qfalse;
+	if ( !pak ) {
+		return qfalse;
+	}
+
+	if (pureChecksum) {
+		*pureChecksum = pak->pure_checksum;
+	}
+	if (checksum) {
+		*checksum = pak->checksum;
+	}
+	return qtrue;
 }
 
 
@@ -1382,6 +1996,140 @@ Filename are relative to the quake search path
 a null buffer will just return the file length without loading
 ============
 */
+// the loaders of these only read the data and don't need it to be copied
+static qbool FS_IsZeroCopyFile( const char* qpath )
+{
+	static const char* const extensions[] = { ".bsp", ".jpg", ".jpeg", ".tga", ".png", ".md3" };
+
+	const char* const ext = strrchr( qpath, '.' );
+	if ( !ext ) {
+		return qfalse;
+	}
+
+	for ( int i = 0; i < ARRAY_LEN( extensions ); ++i ) {
+		if ( !Q_stricmp( ext, extensions[i] ) ) {
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+// the files returned in place, so that FS_FreeFile knows there's nothing to free
+static struct {
+	const void**	buffers;
+	int				count;
+	int				maxCount;
+} fs_mappedFiles;
+
+
+static void FS_AddMappedFile( const void* data )
+{
+	if ( fs_mappedFiles.count == fs_mappedFiles.maxCount ) {
+		const int maxCount = max( 64, fs_mappedFiles.maxCount * 2 );
+		const void** const buffers = (const void**)realloc( fs_mappedFiles.buffers, maxCount * sizeof( void* ) );
+		if ( !buffers ) {
+			Com_Error( ERR_DROP, "FS_AddMappedFile: out of memory" );
+		}
+		fs_mappedFiles.buffers = buffers;
+		fs_mappedFiles.maxCount = maxCount;
+	}
+
+	fs_mappedFiles.buffers[fs_mappedFiles.count++] = data;
+}
+
+
+// the most recent files are usually the first ones to be freed
+static qbool FS_RemoveMappedFile( const void* data )
+{
+	for ( int i = fs_mappedFiles.count - 1; i >= 0; --i ) {
+		if ( fs_mappedFiles.buffers[i] == data ) {
+			fs_mappedFiles.buffers[i] = fs_mappedFiles.buffers[--fs_mappedFiles.count];
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+// the start of the file's data in the mapping or NULL when the local header is bad
+static byte* FS_MappedFileData( const pack_t* pak, const fileInPack_t* pakFile )
+{
+	unsigned long dataPos;
+	if ( unzLocateFileData( pak->mapping, pak->mappingSize, pakFile->localPos, pakFile->compressedSize, &dataPos ) != UNZ_OK ) {
+		return NULL;
+	}
+
+	return pak->mapping + dataPos;
+}
+
+
+// stored files can be used in place when they're aligned and safe to share
+// there's always at least the central directory after the data,
+// so the trailing 0 overwrites a byte of our private copy of the page
+static qbool FS_CanShareMappedFile( const pack_t* pak, const fileInPack_t* pakFile, const byte* data, const char* qpath )
+{
+	return
+		pakFile->method == 0 &&
+		pakFile->compressedSize == pakFile->size &&
+		( (intptr_t)data & 3 ) == 0 &&
+		(size_t)( data - pak->mapping ) + pakFile->size < pak->mappingSize &&
+		FS_IsZeroCopyFile( qpath );
+}
+
+
+/*
+=================
+FS_ReadMappedFile
+
+Stored files that are aligned and safe to share are returned in place.
+Everything else is copied or inflated straight from the mapping.
+Returns NULL when unzip should read the file instead.
+=================
+*/
+static byte* FS_ReadMappedFile( const pack_t* pak, const fileInPack_t* pakFile, const char* qpath )
+{
+	byte* const data = FS_MappedFileData( pak, pakFile );
+	if ( !data ) {
+		return NULL;
+	}
+
+	const int len = (int)pakFile->size;
+
+	if ( pakFile->method == 0 ) {
+		if ( pakFile->compressedSize != pakFile->size ) {
+			return NULL;
+		}
+
+		if ( FS_CanShareMappedFile( pak, pakFile, data, qpath ) ) {
+			data[len] = 0;
+			FS_AddMappedFile( data );
+			return data;
+		}
+
+		byte* const buf = (byte*)Hunk_AllocateTempMemory( len + 1 );
+		Com_Memcpy( buf, data, len );
+		buf[len] = 0;
+		return buf;
+	}
+
+	if ( pakFile->method != 8 ) {	// Z_DEFLATED
+		return NULL;
+	}
+
+	byte* const buf = (byte*)Hunk_AllocateTempMemory( len + 1 );
+	if ( len > 0 && unzInflateData( data, pakFile->compressedSize, buf, len ) != UNZ_OK ) {
+		Hunk_FreeTempMemory( buf );
+		return NULL;
+	}
+	buf[len] = 0;
+
+	return buf;
+}
+
+
 int FS_ReadFilePak( const char *qpath, void **buffer, int *pakChecksum ) {
 	fileHandle_t	h;
 	byte*			buf;
@@ -1396,240 +2144,1469 @@ int FS_ReadFilePak( const char *qpath, void **buffer, int *pakChecksum ) {
 		Com_Error( ERR_FATAL, "FS_ReadFile with empty name\n" );
 	}
 
-	buf = NULL;	// quiet compiler warning
-	if ( pakChecksum ) {
-		*pakChecksum = 0;
+	buf = NULL;	// quiet compiler warning
+	if ( pakChecksum ) {
+		*pakChecksum = 0;
+	}
+
+	// if this is a .cfg file and we are playing back a journal, read
+	// it from the journal file
+	if ( strstr( qpath, ".cfg" ) ) {
+		isConfig = qtrue;
+		if ( com_journal && com_journal->integer == 2 ) {
+			int		r;
+
+			Com_DPrintf( "Loading %s from journal file.\n", qpath );
+			r = FS_Read( &len, sizeof( len ), com_journalDataFile );
+			if ( r != sizeof( len ) ) {
+				if (buffer != NULL) *buffer = NULL;
+				return -1;
+			}
+			// if the file didn't exist when the journal was created
+			if (!len) {
+				if (buffer == NULL) {
+					return 1;			// hack for old journal files
+				}
+				*buffer = NULL;
+				return -1;
+			}
+			if (buffer == NULL) {
+				return len;
+			}
+
+			buf = (byte*)Hunk_AllocateTempMemory(len+1);
+			*buffer = buf;
+
+			r = FS_Read( buf, len, com_journalDataFile );
+			if ( r != len ) {
+				Com_Error( ERR_FATAL, "Read from journalDataFile failed" );
+			}
+
+			fs_loadCount++;
+			fs_loadStack++;
+
+			// guarantee that it will have a trailing 0 for string operations
+			buf[len] = 0;
+
+			return len;
+		}
+	} else {
+		isConfig = qfalse;
+	}
+
+	// look for it in the filesystem or pack files
+	const pack_t* mappedPak = NULL;
+	const fileInPack_t* mappedFile = NULL;
+	len = FS_FOpenFileReadInternal( qpath, &h, qfalse, pakChecksum, &mappedPak, buffer ? &mappedFile : NULL );
+	if ( mappedFile ) {
+		buf = FS_ReadMappedFile( mappedPak, mappedFile, qpath );
+		if ( !buf ) {
+			// let unzip deal with whatever is wrong with it
+			len = FS_FOpenFileRead( qpath, &h, qfalse, pakChecksum );
+		}
+	}
+	if ( h == 0 && !buf ) {
+		if ( buffer ) {
+			*buffer = NULL;
+		}
+		// if we are journalling and it is a config file, write a zero to the journal file
+		if ( isConfig && com_journal && com_journal->integer == 1 ) {
+			Com_DPrintf( "Writing zero for %s to journal file.\n", qpath );
+			len = 0;
+			FS_Write( &len, sizeof( len ), com_journalDataFile );
+			FS_Flush( com_journalDataFile );
+		}
+		return -1;
+	}
+	
+	if ( !buffer ) {
+		if ( isConfig && com_journal && com_journal->integer == 1 ) {
+			Com_DPrintf( "Writing len for %s to journal file.\n", qpath );
+			FS_Write( &len, sizeof( len ), com_journalDataFile );
+			FS_Flush( com_journalDataFile );
+		}
+		FS_FCloseFile( h);
+		return len;
+	}
+
+	fs_loadCount++;
+	fs_loadStack++;
+
+	if ( !buf ) {
+		buf = (byte*)Hunk_AllocateTempMemory(len+1);
+
+		FS_Read (buf, len, h);
+
+		// guarantee that it will have a trailing 0 for string operations
+		buf[len] = 0;
+		FS_FCloseFile( h );
+	}
+	*buffer = buf;
+
+	// if we are journalling and it is a config file, write it to the journal file
+	if ( isConfig && com_journal && com_journal->integer == 1 ) {
+		Com_DPrintf( "Writing %s to journal file.\n", qpath );
+		FS_Write( &len, sizeof( len ), com_journalDataFile );
+		FS_Write( buf, len, com_journalDataFile );
+		FS_Flush( com_journalDataFile );
+	}
+	return len;
+}
+
+int FS_ReadFile( const char *qpath, void **buffer ) {
+	return FS_ReadFilePak( qpath, buffer, NULL );
+}
+
+/*
+=================================================================================
+
+ASYNCHRONOUS READS
+
+Requests are resolved on the main thread the same way FS_ReadFilePak does it.
+The worker threads then copy or inflate the data out of the pak mapping
+or read the loose file. Their buffers are malloc'd because the workers
+can't use the hunk or the zone.
+
+=================================================================================
+*/
+
+#define MAX_ASYNC_THREADS		8
+#define MAX_ASYNC_PENDING_BYTES	( 32 << 20 )	// for the buffers of requests that aren't finished
+#define ASYNC_BUFFER_MAGIC		0x46534142		// "BASF", never a hunk block size or ZONEID
+
+typedef enum {
+	FSAR_FREE,
+	FSAR_WAITING,	// for the pending buffers to shrink
+	FSAR_QUEUED,
+	FSAR_READING,
+	FSAR_DONE
+} fsAsyncState_t;
+
+typedef enum {
+	FSAO_NONE,		// done when requested
+	FSAO_COPY,		// stored file in a mapped pak
+	FSAO_INFLATE,	// deflated file in a mapped pak
+	FSAO_FREAD		// loose file
+} fsAsyncOp_t;
+
+typedef struct {
+	int				request;	// the handle, 0 when free
+	fsAsyncState_t	state;
+	fsAsyncOp_t		op;
+	qbool			failed;
+	const byte*		source;		// FSAO_COPY and FSAO_INFLATE
+	int				sourceSize;
+	FILE*			file;		// FSAO_FREAD, closed by whoever reads it
+	byte*			buffer;		// allocated when the request starts
+	void*			result;		// when not delivering the buffer
+	qbool			counted;	// result already added to fs_loadStack
+	int				size;
+	int				next;		// in the queued or waiting list
+	char			qpath[MAX_QPATH];
+} fsAsyncRead_t;
+
+typedef struct {
+	int		first;
+	int		last;
+} fsAsyncList_t;
+
+typedef struct {
+	int		unused[3];
+	int		magic;		// right in front of the data, see FS_IsAsyncBuffer
+} fsAsyncBufferHeader_t;
+
+static struct {
+	fsAsyncRead_t*	reads;
+	int				maxReads;
+	fsAsyncList_t	queued;		// for the worker threads
+	fsAsyncList_t	waiting;	// not started yet
+	int				lastRequest;
+	int				pendingBytes;
+	void*			mutex;
+	void*			jobSemaphore;	// posted for every queued request
+	void*			doneSemaphore;	// posted by the workers for every finished request
+	void*			threads[MAX_ASYNC_THREADS];
+	int				numThreads;
+	qbool			initialized;
+	qbool			quit;
+} fs_async;
+
+
+static void FS_AsyncListAppend( fsAsyncList_t* list, int index )
+{
+	fs_async.reads[index].next = -1;
+	if ( list->last >= 0 ) {
+		fs_async.reads[list->last].next = index;
+	} else {
+		list->first = index;
+	}
+	list->last = index;
+}
+
+
+static void FS_AsyncListRemove( fsAsyncList_t* list, int index )
+{
+	int prev = -1;
+	for ( int i = list->first; i >= 0; prev = i, i = fs_async.reads[i].next ) {
+		if ( i != index )
+			continue;
+
+		if ( prev >= 0 ) {
+			fs_async.reads[prev].next = fs_async.reads[i].next;
+		} else {
+			list->first = fs_async.reads[i].next;
+		}
+		if ( list->last == index ) {
+			list->last = prev;
+		}
+		return;
+	}
+}
+
+
+static void FS_AsyncLock()
+{
+	if ( fs_async.mutex ) {
+		Sys_LockMutex( fs_async.mutex );
+	}
+}
+
+
+static void FS_AsyncUnlock()
+{
+	if ( fs_async.mutex ) {
+		Sys_UnlockMutex( fs_async.mutex );
+	}
+}
+
+
+static byte* FS_AllocAsyncBuffer( int size )
+{
+	fsAsyncBufferHeader_t* const header = (fsAsyncBufferHeader_t*)malloc( sizeof( fsAsyncBufferHeader_t ) + size + 1 );
+	if ( !header ) {
+		Com_Error( ERR_DROP, "FS_AllocAsyncBuffer: failed on %d", size );
+	}
+
+	header->magic = ASYNC_BUFFER_MAGIC;
+	byte* const buffer = (byte*)( header + 1 );
+	buffer[size] = 0;
+
+	return buffer;
+}
+
+
+static qbool FS_IsAsyncBuffer( const void* buffer )
+{
+	return ( (const fsAsyncBufferHeader_t*)buffer - 1 )->magic == ASYNC_BUFFER_MAGIC;
+}
+
+
+static void FS_FreeAsyncBuffer( void* buffer )
+{
+	fsAsyncBufferHeader_t* const header = (fsAsyncBufferHeader_t*)buffer - 1;
+	header->magic = 0;
+	free( header );
+}
+
+
+// runs on any thread, read is a copy when it's a worker
+static qbool FS_ExecuteAsyncRead( const fsAsyncRead_t* read )
+{
+	Prof_Scope profScope( "FS_ExecuteAsyncRead" );
+
+	switch ( read->op ) {
+		case FSAO_COPY:
+			memcpy( read->buffer, read->source, read->size );
+			return qtrue;
+
+		case FSAO_INFLATE:
+			return read->size == 0 || unzInflateData( read->source, read->sourceSize, read->buffer, read->size ) == UNZ_OK;
+
+		case FSAO_FREAD: {
+			const qbool success = read->size == 0 || fread( read->buffer, read->size, 1, read->file ) == 1;
+			fclose( read->file );
+			return success;
+		}
+
+		default:
+			return qtrue;
+	}
+}
+
+
+static void FS_AsyncThread( void* )
+{
+	Prof_SetThreadName( "file reads" );
+
+	for ( ;; ) {
+		Sys_WaitSemaphore( fs_async.jobSemaphore );
+
+		Sys_LockMutex( fs_async.mutex );
+		if ( fs_async.quit ) {
+			Sys_UnlockMutex( fs_async.mutex );
+			Prof_ReleaseThread();
+			return;
+		}
+
+		// the main thread might have taken it already
+		const int index = fs_async.queued.first;
+		if ( index < 0 ) {
+			Sys_UnlockMutex( fs_async.mutex );
+			continue;
+		}
+
+		FS_AsyncListRemove( &fs_async.queued, index );
+		fs_async.reads[index].state = FSAR_READING;
+		// the array can be reallocated while we're not holding the lock
+		const fsAsyncRead_t read = fs_async.reads[index];
+		Sys_UnlockMutex( fs_async.mutex );
+
+		const qbool success = FS_ExecuteAsyncRead( &read );
+
+		Sys_LockMutex( fs_async.mutex );
+		fs_async.reads[index].failed = !success;
+		fs_async.reads[index].state = FSAR_DONE;
+		Sys_UnlockMutex( fs_async.mutex );
+
+		Sys_PostSemaphore( fs_async.doneSemaphore );
+	}
+}
+
+
+static void FS_InitAsyncReads()
+{
+	fs_async.initialized = qtrue;
+	fs_async.queued.first = fs_async.queued.last = -1;
+	fs_async.waiting.first = fs_async.waiting.last = -1;
+
+	const int numThreads = min( fs_asyncthreads->integer, MAX_ASYNC_THREADS );
+	if ( numThreads <= 0 )
+		return;
+
+	fs_async.mutex = Sys_CreateMutex();
+	fs_async.jobSemaphore = Sys_CreateSemaphore();
+	fs_async.doneSemaphore = Sys_CreateSemaphore();
+	if ( fs_async.mutex && fs_async.jobSemaphore && fs_async.doneSemaphore ) {
+		for ( int i = 0; i < numThreads; ++i ) {
+			fs_async.threads[fs_async.numThreads] = Sys_CreateThread( &FS_AsyncThread, NULL );
+			if ( fs_async.threads[fs_async.numThreads] ) {
+				fs_async.numThreads++;
+			}
+		}
+	}
+
+	// without workers, the reads happen in FS_FinishReadFile
+	if ( fs_async.numThreads == 0 ) {
+		Com_Printf( "^3WARNING: couldn't create the file reading threads\n" );
+		if ( fs_async.mutex ) {
+			Sys_DestroyMutex( fs_async.mutex );
+			fs_async.mutex = NULL;
+		}
+		if ( fs_async.jobSemaphore ) {
+			Sys_DestroySemaphore( fs_async.jobSemaphore );
+			fs_async.jobSemaphore = NULL;
+		}
+		if ( fs_async.doneSemaphore ) {
+			Sys_DestroySemaphore( fs_async.doneSemaphore );
+			fs_async.doneSemaphore = NULL;
+		}
+	}
+}
+
+
+static void FS_ReleaseAsyncRead( int index )
+{
+	fsAsyncRead_t* const read = &fs_async.reads[index];
+	if ( read->buffer ) {
+		FS_FreeAsyncBuffer( read->buffer );
+		fs_async.pendingBytes -= read->size;
+	}
+	if ( read->file && read->state != FSAR_DONE ) {
+		fclose( read->file );
+	}
+	if ( read->result && read->counted ) {
+		FS_FreeFile( read->result );
+	} else if ( read->result ) {
+		FS_RemoveMappedFile( read->result );
+	}
+
+	Com_Memset( read, 0, sizeof( *read ) );
+}
+
+
+// takes it off the lists so that nobody starts it and waits for the worker if one already did
+static void FS_CancelAsyncRead( int index )
+{
+	fsAsyncRead_t* const read = &fs_async.reads[index];
+
+	FS_AsyncLock();
+	if ( read->state == FSAR_WAITING ) {
+		FS_AsyncListRemove( &fs_async.waiting, index );
+	} else if ( read->state == FSAR_QUEUED ) {
+		FS_AsyncListRemove( &fs_async.queued, index );
+	}
+	while ( read->state == FSAR_READING ) {
+		FS_AsyncUnlock();
+		Sys_WaitSemaphore( fs_async.doneSemaphore );
+		FS_AsyncLock();
+	}
+	FS_AsyncUnlock();
+
+	FS_ReleaseAsyncRead( index );
+}
+
+
+// waits for the workers to be done with everything and stops them
+static void FS_ShutdownAsyncReads()
+{
+	if ( !fs_async.initialized )
+		return;
+
+	for ( int i = 0; i < fs_async.maxReads; ++i ) {
+		if ( fs_async.reads[i].request != 0 ) {
+			FS_CancelAsyncRead( i );
+		}
+	}
+
+	if ( fs_async.numThreads > 0 ) {
+		Sys_LockMutex( fs_async.mutex );
+		fs_async.quit = qtrue;
+		Sys_UnlockMutex( fs_async.mutex );
+
+		int i;
+		for ( i = 0; i < fs_async.numThreads; ++i ) {
+			Sys_PostSemaphore( fs_async.jobSemaphore );
+		}
+		for ( i = 0; i < fs_async.numThreads; ++i ) {
+			Sys_JoinThread( fs_async.threads[i] );
+		}
+
+		Sys_DestroyMutex( fs_async.mutex );
+		Sys_DestroySemaphore( fs_async.jobSemaphore );
+		Sys_DestroySemaphore( fs_async.doneSemaphore );
+	}
+
+	free( fs_async.reads );
+	Com_Memset( &fs_async, 0, sizeof( fs_async ) );
+}
+
+
+static int FS_AllocAsyncRead()
+{
+	if ( !fs_async.initialized ) {
+		FS_InitAsyncReads();
+	}
+
+	int index;
+	for ( index = 0; index < fs_async.maxReads; ++index ) {
+		if ( fs_async.reads[index].request == 0 )
+			break;
+	}
+
+	if ( index == fs_async.maxReads ) {
+		const int maxReads = max( 64, fs_async.maxReads * 2 );
+		FS_AsyncLock();
+		fsAsyncRead_t* const reads = (fsAsyncRead_t*)realloc( fs_async.reads, maxReads * sizeof( fsAsyncRead_t ) );
+		if ( reads ) {
+			Com_Memset( reads + fs_async.maxReads, 0, ( maxReads - fs_async.maxReads ) * sizeof( fsAsyncRead_t ) );
+			fs_async.reads = reads;
+			fs_async.maxReads = maxReads;
+		}
+		FS_AsyncUnlock();
+		if ( !reads ) {
+			Com_Error( ERR_DROP, "FS_AllocAsyncRead: out of memory" );
+		}
+	}
+
+	if ( ++fs_async.lastRequest <= 0 ) {
+		fs_async.lastRequest = 1;
+	}
+
+	fsAsyncRead_t* const read = &fs_async.reads[index];
+	Com_Memset( read, 0, sizeof( *read ) );
+	read->request = fs_async.lastRequest;
+	read->next = -1;
+
+	return index;
+}
+
+
+static int FS_FindAsyncRead( int request )
+{
+	if ( request <= 0 )
+		return -1;
+
+	for ( int i = 0; i < fs_async.maxReads; ++i ) {
+		if ( fs_async.reads[i].request == request )
+			return i;
+	}
+
+	return -1;
+}
+
+
+static void FS_StartAsyncRead( int index )
+{
+	fsAsyncRead_t* const read = &fs_async.reads[index];
+	read->buffer = FS_AllocAsyncBuffer( read->size );
+	fs_async.pendingBytes += read->size;
+
+	FS_AsyncLock();
+	read->state = FSAR_QUEUED;
+	if ( fs_async.numThreads > 0 ) {
+		FS_AsyncListAppend( &fs_async.queued, index );
+	}
+	FS_AsyncUnlock();
+
+	if ( fs_async.numThreads > 0 ) {
+		Sys_PostSemaphore( fs_async.jobSemaphore );
+	}
+}
+
+
+// reads it on the calling thread unless a worker already took it
+static void FS_RunAsyncRead( int index )
+{
+	fsAsyncRead_t* const read = &fs_async.reads[index];
+
+	qbool execute = qfalse;
+	FS_AsyncLock();
+	if ( read->state == FSAR_QUEUED ) {
+		FS_AsyncListRemove( &fs_async.queued, index );
+		read->state = FSAR_READING;
+		execute = qtrue;
+	}
+	FS_AsyncUnlock();
+
+	if ( execute ) {
+		read->failed = !FS_ExecuteAsyncRead( read );
+		FS_AsyncLock();
+		read->state = FSAR_DONE;
+		FS_AsyncUnlock();
+	}
+}
+
+
+// starts the waiting requests in order for as long as the pending buffers allow
+static void FS_StartWaitingAsyncReads()
+{
+	while ( fs_async.waiting.first >= 0 ) {
+		const int index = fs_async.waiting.first;
+		if ( fs_async.pendingBytes > 0 &&
+			 fs_async.pendingBytes + fs_async.reads[index].size > MAX_ASYNC_PENDING_BYTES )
+			break;
+
+		FS_AsyncListRemove( &fs_async.waiting, index );
+		FS_StartAsyncRead( index );
+	}
+}
+
+
+int FS_ReadFileAsync( const char *qpath, int *pakChecksum ) {
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+	}
+
+	if ( !qpath || !qpath[0] ) {
+		Com_Error( ERR_FATAL, "FS_ReadFileAsync with empty name\n" );
+	}
+
+	const int index = FS_AllocAsyncRead();
+	fsAsyncRead_t* const read = &fs_async.reads[index];
+	Q_strncpyz( read->qpath, qpath, sizeof( read->qpath ) );
+
+	// the journal has to see the config files in order
+	if ( strstr( qpath, ".cfg" ) && com_journal && com_journal->integer ) {
+		const int len = FS_ReadFilePak( qpath, &read->result, pakChecksum );
+		if ( !read->result ) {
+			Com_Memset( read, 0, sizeof( *read ) );
+			return 0;
+		}
+		read->counted = qtrue;
+		read->size = len;
+		read->state = FSAR_DONE;
+		return read->request;
+	}
+
+	fileHandle_t h;
+	const pack_t* mappedPak = NULL;
+	const fileInPack_t* mappedFile = NULL;
+	int len = FS_FOpenFileReadInternal( qpath, &h, qfalse, pakChecksum, &mappedPak, &mappedFile );
+	if ( mappedFile ) {
+		byte* const data = FS_MappedFileData( mappedPak, mappedFile );
+		if ( data && FS_CanShareMappedFile( mappedPak, mappedFile, data, qpath ) ) {
+			data[len] = 0;
+			FS_AddMappedFile( data );
+			read->result = data;
+			read->state = FSAR_DONE;
+		} else if ( data && mappedFile->method == 0 && mappedFile->compressedSize == mappedFile->size ) {
+			read->op = FSAO_COPY;
+		} else if ( data && mappedFile->method == 8 ) {	// Z_DEFLATED
+			read->op = FSAO_INFLATE;
+		} else {
+			// let unzip deal with whatever is wrong with it
+			len = FS_FOpenFileRead( qpath, &h, qfalse, pakChecksum );
+		}
+		read->source = data;
+		read->sourceSize = (int)mappedFile->compressedSize;
+	}
+
+	if ( read->state == FSAR_FREE && read->op == FSAO_NONE ) {
+		if ( h == 0 ) {
+			Com_Memset( read, 0, sizeof( *read ) );
+			return 0;
+		}
+
+		if ( fsh[h].zipFile ) {
+			// unzip uses the zone
+			read->buffer = FS_AllocAsyncBuffer( len );
+			fs_async.pendingBytes += len;
+			FS_Read( read->buffer, len, h );
+			FS_FCloseFile( h );
+			read->state = FSAR_DONE;
+		} else {
+			// the request owns the FILE from now on
+			read->op = FSAO_FREAD;
+			read->file = fsh[h].handleFiles.file.o;
+			Com_Memset( &fsh[h], 0, sizeof( fsh[h] ) );
+		}
+	}
+
+	read->size = len;
+	if ( read->state == FSAR_FREE ) {
+		read->state = FSAR_WAITING;
+		FS_AsyncListAppend( &fs_async.waiting, index );
+		FS_StartWaitingAsyncReads();
+	}
+
+	return read->request;
+}
+
+
+qbool FS_IsFileReadDone( int request ) {
+	const int index = FS_FindAsyncRead( request );
+	if ( index < 0 ) {
+		return qtrue;
+	}
+
+	// nobody else is going to read it
+	// a waiting read isn't started early since polling doesn't mean it's needed now
+	if ( fs_async.numThreads == 0 ) {
+		FS_RunAsyncRead( index );
+	}
+
+	FS_AsyncLock();
+	const qbool done = fs_async.reads[index].state == FSAR_DONE;
+	FS_AsyncUnlock();
+
+	return done;
+}
+
+
+int FS_FinishReadFile( int request, void **buffer ) {
+	if ( buffer ) {
+		*buffer = NULL;
+	}
+
+	const int index = FS_FindAsyncRead( request );
+	if ( index < 0 ) {
+		return -1;
+	}
+
+	fsAsyncRead_t* const read = &fs_async.reads[index];
+
+	// do it ourselves rather than wait for it to start
+	if ( read->state == FSAR_WAITING ) {
+		FS_AsyncListRemove( &fs_async.waiting, index );
+		FS_StartAsyncRead( index );
+	}
+	FS_RunAsyncRead( index );
+
+	FS_AsyncLock();
+	while ( read->state != FSAR_DONE ) {
+		FS_AsyncUnlock();
+		Sys_WaitSemaphore( fs_async.doneSemaphore );
+		FS_AsyncLock();
+	}
+	FS_AsyncUnlock();
+
+	int len = read->size;
+	if ( read->failed ) {
+		// the synchronous path knows how to deal with it
+		char qpath[MAX_QPATH];
+		Q_strncpyz( qpath, read->qpath, sizeof( qpath ) );
+		FS_ReleaseAsyncRead( index );
+		FS_StartWaitingAsyncReads();
+		return buffer ? FS_ReadFilePak( qpath, buffer, NULL ) : len;
+	}
+
+	if ( buffer ) {
+		if ( read->buffer ) {
+			*buffer = read->buffer;
+			fs_async.pendingBytes -= read->size;
+			read->buffer = NULL;
+		} else {
+			*buffer = read->result;
+		}
+		if ( !read->counted ) {
+			fs_loadCount++;
+			fs_loadStack++;
+		}
+		read->result = NULL;
+	}
+
+	FS_ReleaseAsyncRead( index );
+	FS_StartWaitingAsyncReads();
+
+	return len;
+}
+
+
+void FS_CancelReadFile( int request ) {
+	const int index = FS_FindAsyncRead( request );
+	if ( index < 0 ) {
+		return;
+	}
+
+	FS_CancelAsyncRead( index );
+	FS_StartWaitingAsyncReads();
+}
+
+
+/*
+=============
+FS_FreeFile
+=============
+*/
+void FS_FreeFile( void *buffer ) {
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+	}
+	if ( !buffer ) {
+		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
+	}
+	fs_loadStack--;
+
+	if ( FS_RemoveMappedFile( buffer ) ) {
+		// nothing to free
+	} else if ( FS_IsAsyncBuffer( buffer ) ) {
+		FS_FreeAsyncBuffer( buffer );
+	} else {
+		Hunk_FreeTempMemory( buffer );
+	}
+
+	// if all of our temp files are free, clear all of our space
+	if ( fs_loadStack == 0 ) {
+		Hunk_ClearTempMemory();
+	}
+}
+
+/*
+============
+FS_WriteFile
+
+Filename are reletive to the quake search path
+============
+*/
+void FS_WriteFile( const char *qpath, const void *buffer, int size ) {
+	fileHandle_t f;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+	}
+
+	if ( !qpath || !buffer ) {
+		Com_Error( ERR_FATAL, "FS_WriteFile: NULL parameter" );
+	}
+
+	f = FS_FOpenFileWrite( qpath );
+	if ( !f ) {
+		Com_Printf( "Failed to open %s\n", qpath );
+		return;
+	}
+
+	FS_Write( buffer, size, f );
+
+	FS_FCloseFile( f );
+}
+
+
+
+/*
+==========================================================================
+
+ZIP FILE LOADING
+
+==========================================================================
+*/
+
+static const char* FS_GetFileName( const char* filePath )
+{
+	for ( int i = strlen(filePath) - 1; i >= 0; i-- ) {
+		if ( filePath[i] == '/' || filePath[i] == '\\' ) {
+			return filePath + i + 1;
+		}
+	}
+
+	return filePath;
+}
+
+/*
+=================================================================================
+
+PAK CACHE
+
+The central directories of the pk3 files are stored in a cache file
+keyed by path, size and modification time so that startup only has to
+read that one file. The pk3 files missing from it are scanned by a few
+threads at once, which is why the scanning code can't use the zone or print.
+
+=================================================================================
+*/
+
+#define PAK_CACHE_FILE		"pk3cache.dat"
+#define PAK_CACHE_MAGIC		0x31434B50	// "PKC1"
+#define PAK_CACHE_VERSION	2
+#define PAK_SCAN_THREADS	4
+
+// everything FS_LoadPak needs to know about a pk3 file in a single block of memory,
+// which is also the record format of the cache file
+typedef struct {
+	int			recordSize;		// everything included, multiple of 8
+	int			numFiles;
+	int			numCrcs;		// the CRCs of the non-empty files go into the checksums
+	int			numLongNames;	// entries skipped because their name is too long
+	int			badEntry;		// the first entry that couldn't be read, -1 when none
+	int			pathSize;		// terminator included
+	int			namesSize;
+	int			checksum;		// the pure checksum depends on fs_checksumFeed
+	int64_t		fileSize;
+	int64_t		modTime;
+	// pakRecordFile_t	files[numFiles];
+	// int				crcs[numCrcs];			little endian
+	// int				longNames[numLongNames];
+	// char				path[pathSize];
+	// char				names[namesSize];
+} pakRecord_t;
+
+typedef struct {
+	int64_t			pos;
+	int64_t			localPos;
+	unsigned int	compressedSize;
+	unsigned int	size;
+	int				method;
+	int				name;		// offset into the names
+} pakRecordFile_t;
+
+typedef struct {
+	int		magic;
+	int		version;
+	int		recordHeaderSize;
+	int		numRecords;
+} pakCacheHeader_t;
+
+typedef struct {
+	pakRecord_t*	record;
+	qbool			allocated;	// not part of the cache file's data
+	qbool			used;		// by the current search paths
+} pakCacheEntry_t;
+
+static struct {
+	byte*				data;		// the cache file's contents
+	pakCacheEntry_t*	entries;
+	int					numEntries;
+	int					maxEntries;
+	int					nextEntry;	// paks are loaded in the same order every time
+	qbool				modified;
+} fs_pakRecords;
+
+typedef struct {
+	char			path[MAX_OSPATH];
+	int64_t			fileSize;
+	int64_t			modTime;
+	int				pakIndex;
+	pakRecord_t*	record;		// NULL when the file isn't a valid zip file
+} pakScanJob_t;
+
+typedef struct {
+	pakScanJob_t*	jobs;
+	int				numJobs;
+	int				firstJob;
+	int				jobStride;
+} pakScanThread_t;
+
+
+static const pakRecordFile_t* FS_PakRecordFiles( const pakRecord_t* record )
+{
+	return (const pakRecordFile_t*)( record + 1 );
+}
+
+
+static const int* FS_PakRecordCrcs( const pakRecord_t* record )
+{
+	return (const int*)( FS_PakRecordFiles( record ) + record->numFiles );
+}
+
+
+static const int* FS_PakRecordLongNames( const pakRecord_t* record )
+{
+	return FS_PakRecordCrcs( record ) + record->numCrcs;
+}
+
+
+static const char* FS_PakRecordPath( const pakRecord_t* record )
+{
+	return (const char*)( FS_PakRecordLongNames( record ) + record->numLongNames );
+}
+
+
+static const char* FS_PakRecordNames( const pakRecord_t* record )
+{
+	return FS_PakRecordPath( record ) + record->pathSize;
+}
+
+
+static int64_t FS_PakRecordMinSize( const pakRecord_t* record )
+{
+	return (int64_t)sizeof( pakRecord_t ) +
+		(int64_t)record->numFiles * sizeof( pakRecordFile_t ) +
+		(int64_t)record->numCrcs * sizeof( int ) +
+		(int64_t)record->numLongNames * sizeof( int ) +
+		(int64_t)record->pathSize +
+		(int64_t)record->namesSize;
+}
+
+
+static unsigned int FS_ZipShort( const byte* data )
+{
+	return (unsigned int)data[0] | ( (unsigned int)data[1] << 8 );
+}
+
+
+static unsigned int FS_ZipLong( const byte* data )
+{
+	return (unsigned int)data[0] | ( (unsigned int)data[1] << 8 ) |
+		( (unsigned int)data[2] << 16 ) | ( (unsigned int)data[3] << 24 );
+}
+
+
+// builds the record from the central directory (starting at the first entry)
+// the entries accepted are the ones unzGetCurrentFileInfo accepts
+
+static pakRecord_t* FS_ParseCentralDir( const char* path, int64_t fileSize, int64_t modTime,
+										const byte* dir, int64_t dirSize, unsigned int dirOffset, int numEntries )
+{
+	pakRecordFile_t* const files = (pakRecordFile_t*)malloc( numEntries * sizeof( pakRecordFile_t ) );
+	int* const crcs = (int*)malloc( numEntries * sizeof( int ) );
+	int* const longNames = (int*)malloc( numEntries * sizeof( int ) );
+	char* const names = (char*)malloc( dirSize + numEntries );
+	if ( !files || !crcs || !longNames || !names ) {
+		free( files );
+		free( crcs );
+		free( longNames );
+		free( names );
+		return NULL;
+	}
+
+	int numFiles = 0;
+	int numCrcs = 0;
+	int numLongNames = 0;
+	int namesSize = 0;
+	int badEntry = -1;
+	// unzip's positions are relative to the central directory offset and the local positions aren't
+	const int64_t byteBefore = fileSize - dirSize - dirOffset;
+	int64_t pos = dirOffset;
+	for ( int i = 0; i < numEntries; ++i ) {
+		const int64_t offset = pos - dirOffset;
+		const byte* const entry = dir + offset;
+		if ( offset + 46 > dirSize || FS_ZipLong( entry ) != 0x02014b50 ) {
+			badEntry = i;
+			break;
+		}
+
+		const unsigned int nameLength = FS_ZipShort( entry + 28 );
+		const unsigned int copyLength = min( nameLength, (unsigned int)MAX_ZPATH );
+		if ( offset + 46 + copyLength > dirSize ) {
+			badEntry = i;
+			break;
+		}
+
+		char name[MAX_ZPATH];
+		name[MAX_ZPATH - 1] = '\0';
+		memcpy( name, entry + 46, copyLength );
+		if ( nameLength < MAX_ZPATH ) {
+			name[nameLength] = '\0';
+		}
+		const int64_t entryPos = pos;
+		pos += 46 + nameLength + FS_ZipShort( entry + 30 ) + FS_ZipShort( entry + 32 );
+
+		if ( name[MAX_ZPATH - 1] != '\0' ) {
+			longNames[numLongNames++] = i;
+			continue;
+		}
+
+		// unzip wouldn't be able to open the file from an out of range local header
+		const int64_t localPos = (int64_t)FS_ZipLong( entry + 42 ) + byteBefore;
+		if ( localPos < 0 || localPos + 30 > fileSize ) {
+			badEntry = i;
+			break;
+		}
+
+		pakRecordFile_t* const file = &files[numFiles++];
+		file->pos = entryPos;
+		file->localPos = localPos;
+		file->compressedSize = FS_ZipLong( entry + 20 );
+		file->size = FS_ZipLong( entry + 24 );
+		file->method = (int)FS_ZipShort( entry + 10 );
+		file->name = namesSize;
+		if ( file->size > 0 ) {
+			crcs[numCrcs++] = LittleLong( (int)FS_ZipLong( entry + 16 ) );
+		}
+
+		Q_strlwr( name );
+		const int length = strlen( name ) + 1;
+		memcpy( names + namesSize, name, length );
+		namesSize += length;
+	}
+
+	pakRecord_t header;
+	header.numFiles = numFiles;
+	header.numCrcs = numCrcs;
+	header.numLongNames = numLongNames;
+	header.badEntry = badEntry;
+	header.pathSize = strlen( path ) + 1;
+	header.namesSize = namesSize;
+	header.checksum = LittleLong( Com_BlockChecksum( crcs, 4 * numCrcs ) );
+	header.fileSize = fileSize;
+	header.modTime = modTime;
+	header.recordSize = ( (int)FS_PakRecordMinSize( &header ) + 7 ) & ~7;
+
+	pakRecord_t* const record = (pakRecord_t*)malloc( header.recordSize );
+	if ( record ) {
+		memset( record, 0, header.recordSize );
+		*record = header;
+		memcpy( (void*)FS_PakRecordFiles( record ), files, numFiles * sizeof( pakRecordFile_t ) );
+		memcpy( (void*)FS_PakRecordCrcs( record ), crcs, numCrcs * sizeof( int ) );
+		memcpy( (void*)FS_PakRecordLongNames( record ), longNames, numLongNames * sizeof( int ) );
+		memcpy( (void*)FS_PakRecordPath( record ), path, header.pathSize );
+		memcpy( (void*)FS_PakRecordNames( record ), names, namesSize );
+	}
+
+	free( files );
+	free( crcs );
+	free( longNames );
+	free( names );
+
+	return record;
+}
+
+
+static qbool FS_SeekPak( FILE* file, int64_t offset )
+{
+#if defined( _MSC_VER )
+	return _fseeki64( file, offset, SEEK_SET ) == 0;
+#else
+	return fseeko( file, (off_t)offset, SEEK_SET ) == 0;
+#endif
+}
+
+
+// reads the central directory with the same rules as unzOpen
+
+static pakRecord_t* FS_ScanPak( const char* path, int64_t fileSize, int64_t modTime )
+{
+	FILE* const file = fopen( path, "rb" );
+	if ( !file )
+		return NULL;
+
+	// the end of central directory record is followed by a comment of up to 64 KB
+	const int tailSize = (int)min( fileSize, (int64_t)0xFFFF );
+	const int64_t tailStart = fileSize - tailSize;
+	byte* const tail = (byte*)malloc( tailSize );
+	if ( !tail || !FS_SeekPak( file, tailStart ) || fread( tail, tailSize, 1, file ) != 1 ) {
+		free( tail );
+		fclose( file );
+		return NULL;
+	}
+
+	int end = tailSize - 4;
+	while ( end >= 0 && FS_ZipLong( tail + end ) != 0x06054b50 ) {
+		end--;
+	}
+
+	const int64_t centralPos = tailStart + end;
+	if ( end < 0 || centralPos == 0 || end + 22 > tailSize ||
+		 FS_ZipShort( tail + end + 4 ) != 0 ||
+		 FS_ZipShort( tail + end + 6 ) != 0 ||
+		 FS_ZipShort( tail + end + 8 ) != FS_ZipShort( tail + end + 10 ) ) {
+		free( tail );
+		fclose( file );
+		return NULL;
+	}
+
+	const int numEntries = (int)FS_ZipShort( tail + end + 8 );
+	const unsigned int dirSize = FS_ZipLong( tail + end + 12 );
+	const unsigned int dirOffset = FS_ZipLong( tail + end + 16 );
+	if ( (int64_t)dirOffset + dirSize > centralPos ) {
+		free( tail );
+		fclose( file );
+		return NULL;
+	}
+
+	// the entries are read from the start of the central directory up to the end of the file
+	// small central directories are already in the tail
+	const int64_t dirStart = centralPos - dirSize;
+	byte* dir = NULL;
+	if ( dirStart < tailStart ) {
+		const size_t readSize = (size_t)( fileSize - dirStart );
+		dir = (byte*)malloc( readSize );
+		if ( !dir || !FS_SeekPak( file, dirStart ) || fread( dir, readSize, 1, file ) != 1 ) {
+			free( dir );
+			free( tail );
+			fclose( file );
+			return NULL;
+		}
+	}
+	fclose( file );
+
+	const byte* const dirData = dir ? dir : tail + ( dirStart - tailStart );
+	pakRecord_t* const record = FS_ParseCentralDir( path, fileSize, modTime, dirData, fileSize - dirStart, dirOffset, numEntries );
+
+	free( dir );
+	free( tail );
+
+	return record;
+}
+
+
+static void FS_ScanPaksThread( void* userData )
+{
+	const pakScanThread_t* const thread = (const pakScanThread_t*)userData;
+	for ( int i = thread->firstJob; i < thread->numJobs; i += thread->jobStride ) {
+		pakScanJob_t* const job = &thread->jobs[i];
+		Prof_Scope profScope( "FS_ScanPak" );
+		job->record = FS_ScanPak( job->path, job->fileSize, job->modTime );
+	}
+}
+
+
+static void FS_ScanPaksWorker( void* userData )
+{
+	Prof_SetThreadName( "pak scan" );
+	FS_ScanPaksThread( userData );
+	Prof_ReleaseThread();
+}
+
+
+static void FS_ScanPaks( pakScanJob_t* jobs, int numJobs )
+{
+	pakScanThread_t threads[PAK_SCAN_THREADS];
+	void* handles[PAK_SCAN_THREADS];
+	const int numThreads = min( numJobs, PAK_SCAN_THREADS );
+	int i;
+
+	for ( i = 0; i < numThreads; ++i ) {
+		threads[i].jobs = jobs;
+		threads[i].numJobs = numJobs;
+		threads[i].firstJob = i;
+		threads[i].jobStride = numThreads;
+	}
+
+	// the calling thread does its share too
+	for ( i = 1; i < numThreads; ++i ) {
+		handles[i] = Sys_CreateThread( &FS_ScanPaksWorker, &threads[i] );
 	}
 
-	// if this is a .cfg file and we are playing back a journal, read
-	// it from the journal file
-	if ( strstr( qpath, ".cfg" ) ) {
-		isConfig = qtrue;
-		if ( com_journal && com_journal->integer == 2 ) {
-			int		r;
+	FS_ScanPaksThread( &threads[0] );
 
-			Com_DPrintf( "Loading %s from journal file.\n", qpath );
-			r = FS_Read( &len, sizeof( len ), com_journalDataFile );
-			if ( r != sizeof( len ) ) {
-				if (buffer != NULL) *buffer = NULL;
-				return -1;
-			}
-			// if the file didn't exist when the journal was created
-			if (!len) {
-				if (buffer == NULL) {
-					return 1;			// hack for old journal files
-				}
-				*buffer = NULL;
-				return -1;
-			}
-			if (buffer == NULL) {
-				return len;
-			}
+	for ( i = 1; i < numThreads; ++i ) {
+		if ( handles[i] ) {
+			Sys_JoinThread( handles[i] );
+		} else {
+			FS_ScanPaksThread( &threads[i] );
+		}
+	}
+}
 
-			buf = (byte*)Hunk_AllocateTempMemory(len+1);
-			*buffer = buf;
 
-			r = FS_Read( buf, len, com_journalDataFile );
-			if ( r != len ) {
-				Com_Error( ERR_FATAL, "Read from journalDataFile failed" );
-			}
+static qbool FS_IsValidPakRecord( const pakRecord_t* record, int64_t maxSize )
+{
+	if ( maxSize < (int64_t)sizeof( pakRecord_t ) ||
+		 record->recordSize < (int)sizeof( pakRecord_t ) ||
+		 record->recordSize > maxSize ||
+		 ( record->recordSize & 7 ) != 0 ||
+		 record->numFiles < 0 || record->numFiles > 0xFFFF ||
+		 record->numCrcs < 0 || record->numCrcs > record->numFiles ||
+		 record->numLongNames < 0 || record->numLongNames > 0xFFFF ||
+		 record->pathSize <= 1 || record->pathSize > MAX_OSPATH ||
+		 record->namesSize < record->numFiles ||
+		 FS_PakRecordMinSize( record ) > record->recordSize )
+		return qfalse;
 
-			fs_loadCount++;
-			fs_loadStack++;
+	if ( FS_PakRecordPath( record )[record->pathSize - 1] != '\0' )
+		return qfalse;
 
-			// guarantee that it will have a trailing 0 for string operations
-			buf[len] = 0;
+	if ( record->numFiles > 0 && FS_PakRecordNames( record )[record->namesSize - 1] != '\0' )
+		return qfalse;
 
-			return len;
-		}
-	} else {
-		isConfig = qfalse;
+	// the file info and local headers must be inside the pak
+	const pakRecordFile_t* const files = FS_PakRecordFiles( record );
+	for ( int i = 0; i < record->numFiles; ++i ) {
+		if ( files[i].name < 0 || files[i].name >= record->namesSize ||
+			 files[i].pos < 0 || files[i].pos + 46 > record->fileSize ||
+			 files[i].localPos < 0 || files[i].localPos + 30 > record->fileSize )
+			return qfalse;
 	}
 
-	// look for it in the filesystem or pack files
-	len = FS_FOpenFileRead( qpath, &h, qfalse, pakChecksum );
-	if ( h == 0 ) {
-		if ( buffer ) {
-			*buffer = NULL;
-		}
-		// if we are journalling and it is a config file, write a zero to the journal file
-		if ( isConfig && com_journal && com_journal->integer == 1 ) {
-			Com_DPrintf( "Writing zero for %s to journal file.\n", qpath );
-			len = 0;
-			FS_Write( &len, sizeof( len ), com_journalDataFile );
-			FS_Flush( com_journalDataFile );
+	return qtrue;
+}
+
+
+static void FS_AddPakCacheEntry( pakRecord_t* record, qbool allocated, qbool used )
+{
+	if ( fs_pakRecords.numEntries == fs_pakRecords.maxEntries ) {
+		const int maxEntries = max( 64, fs_pakRecords.maxEntries * 2 );
+		pakCacheEntry_t* const entries = (pakCacheEntry_t*)realloc( fs_pakRecords.entries, maxEntries * sizeof( pakCacheEntry_t ) );
+		if ( !entries ) {
+			Com_Error( ERR_FATAL, "FS_AddPakCacheEntry: out of memory" );
 		}
-		return -1;
+		fs_pakRecords.entries = entries;
+		fs_pakRecords.maxEntries = maxEntries;
 	}
-	
-	if ( !buffer ) {
-		if ( isConfig && com_journal && com_journal->integer == 1 ) {
-			Com_DPrintf( "Writing len for %s to journal file.\n", qpath );
-			FS_Write( &len, sizeof( len ), com_journalDataFile );
-			FS_Flush( com_journalDataFile );
+
+	pakCacheEntry_t* const entry = &fs_pakRecords.entries[fs_pakRecords.numEntries++];
+	entry->record = record;
+	entry->allocated = allocated;
+	entry->used = used;
+}
+
+
+static void FS_FreePakCache()
+{
+	for ( int i = 0; i < fs_pakRecords.numEntries; ++i ) {
+		if ( fs_pakRecords.entries[i].allocated ) {
+			free( fs_pakRecords.entries[i].record );
 		}
-		FS_FCloseFile( h);
-		return len;
 	}
 
-	fs_loadCount++;
-	fs_loadStack++;
+	free( fs_pakRecords.entries );
+	free( fs_pakRecords.data );
+	Com_Memset( &fs_pakRecords, 0, sizeof( fs_pakRecords ) );
+}
 
-	buf = (byte*)Hunk_AllocateTempMemory(len+1);
-	*buffer = buf;
 
-	FS_Read (buf, len, h);
+static void FS_LoadPakCache()
+{
+	FS_FreePakCache();
 
-	// guarantee that it will have a trailing 0 for string operations
-	buf[len] = 0;
-	FS_FCloseFile( h );
+	if ( !fs_pakcache->integer )
+		return;
 
-	// if we are journalling and it is a config file, write it to the journal file
-	if ( isConfig && com_journal && com_journal->integer == 1 ) {
-		Com_DPrintf( "Writing %s to journal file.\n", qpath );
-		FS_Write( &len, sizeof( len ), com_journalDataFile );
-		FS_Write( buf, len, com_journalDataFile );
-		FS_Flush( com_journalDataFile );
+	FILE* const file = fopen( FS_BuildOSPath( fs_homepath->string, BASEGAME, PAK_CACHE_FILE ), "rb" );
+	if ( !file )
+		return;
+
+	int64_t size = 0;
+	if ( fseek( file, 0, SEEK_END ) == 0 ) {
+		size = ftell( file );
 	}
-	return len;
-}
 
-int FS_ReadFile( const char *qpath, void **buffer ) {
-	return FS_ReadFilePak( qpath, buffer, NULL );
-}
+	if ( size < (int64_t)sizeof( pakCacheHeader_t ) || fseek( file, 0, SEEK_SET ) != 0 ) {
+		fclose( file );
+		return;
+	}
 
-/*
-=============
-FS_FreeFile
-=============
-*/
-void FS_FreeFile( void *buffer ) {
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+	fs_pakRecords.data = (byte*)malloc( size );
+	if ( !fs_pakRecords.data || fread( fs_pakRecords.data, size, 1, file ) != 1 ) {
+		fclose( file );
+		FS_FreePakCache();
+		return;
 	}
-	if ( !buffer ) {
-		Com_Error( ERR_FATAL, "FS_FreeFile( NULL )" );
+	fclose( file );
+
+	const pakCacheHeader_t* const header = (const pakCacheHeader_t*)fs_pakRecords.data;
+	if ( header->magic != PAK_CACHE_MAGIC ||
+		 header->version != PAK_CACHE_VERSION ||
+		 header->recordHeaderSize != (int)sizeof( pakRecord_t ) ||
+		 header->numRecords < 0 ) {
+		FS_FreePakCache();
+		fs_pakRecords.modified = qtrue;
+		return;
 	}
-	fs_loadStack--;
 
-	Hunk_FreeTempMemory( buffer );
+	int64_t offset = sizeof( pakCacheHeader_t );
+	for ( int i = 0; i < header->numRecords; ++i ) {
+		pakRecord_t* const record = (pakRecord_t*)( fs_pakRecords.data + offset );
+		if ( !FS_IsValidPakRecord( record, size - offset ) ) {
+			fs_pakRecords.modified = qtrue;
+			break;
+		}
+		FS_AddPakCacheEntry( record, qfalse, qfalse );
+		offset += record->recordSize;
+	}
+}
 
-	// if all of our temp files are free, clear all of our space
-	if ( fs_loadStack == 0 ) {
-		Hunk_ClearTempMemory();
+
+static const pakRecord_t* FS_FindPakRecord( const char* path, int64_t fileSize, int64_t modTime )
+{
+	const int numEntries = fs_pakRecords.numEntries;
+	for ( int i = 0; i < numEntries; ++i ) {
+		const int index = ( fs_pakRecords.nextEntry + i ) % numEntries;
+		pakCacheEntry_t* const entry = &fs_pakRecords.entries[index];
+		const pakRecord_t* const record = entry->record;
+		if ( !entry->used && strcmp( FS_PakRecordPath( record ), path ) == 0 ) {
+			if ( record->fileSize != fileSize || record->modTime != modTime )
+				continue;
+			entry->used = qtrue;
+			fs_pakRecords.nextEntry = index + 1;
+			return record;
+		}
 	}
+
+	return NULL;
 }
 
-/*
-============
-FS_WriteFile
 
-Filename are reletive to the quake search path
-============
-*/
-void FS_WriteFile( const char *qpath, const void *buffer, int size ) {
-	fileHandle_t f;
+// keeps the records of pk3 files that weren't loaded this time as long as they're up to date
 
-	if ( !fs_searchpaths ) {
-		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+static void FS_SavePakCache()
+{
+	int i, numEntries = 0;
+	for ( i = 0; i < fs_pakRecords.numEntries; ++i ) {
+		const pakCacheEntry_t* const entry = &fs_pakRecords.entries[i];
+		int64_t fileSize, modTime;
+		if ( !entry->used &&
+			 ( !Sys_GetFileStats( FS_PakRecordPath( entry->record ), &fileSize, &modTime ) ||
+			   fileSize != entry->record->fileSize ||
+			   modTime != entry->record->modTime ) ) {
+			if ( entry->allocated ) {
+				free( entry->record );
+			}
+			fs_pakRecords.modified = qtrue;
+			continue;
+		}
+		fs_pakRecords.entries[numEntries++] = *entry;
 	}
+	fs_pakRecords.numEntries = numEntries;
 
-	if ( !qpath || !buffer ) {
-		Com_Error( ERR_FATAL, "FS_WriteFile: NULL parameter" );
-	}
+	if ( !fs_pakcache->integer || !fs_pakRecords.modified )
+		return;
 
-	f = FS_FOpenFileWrite( qpath );
-	if ( !f ) {
-		Com_Printf( "Failed to open %s\n", qpath );
+	char* const ospath = FS_BuildOSPath( fs_homepath->string, BASEGAME, PAK_CACHE_FILE );
+	if ( !FS_CreatePath( ospath ) )
+		return;
+
+	FILE* const file = fopen( ospath, "wb" );
+	if ( !file ) {
+		Com_Printf( "^3WARNING: couldn't write %s\n", ospath );
 		return;
 	}
 
-	FS_Write( buffer, size, f );
+	pakCacheHeader_t header;
+	header.magic = PAK_CACHE_MAGIC;
+	header.version = PAK_CACHE_VERSION;
+	header.recordHeaderSize = sizeof( pakRecord_t );
+	header.numRecords = numEntries;
+	qbool success = fwrite( &header, sizeof( header ), 1, file ) == 1;
+	for ( i = 0; i < numEntries && success; ++i ) {
+		const pakRecord_t* const record = fs_pakRecords.entries[i].record;
+		success = fwrite( record, record->recordSize, 1, file ) == 1;
+	}
+	fclose( file );
 
-	FS_FCloseFile( f );
+	if ( !success ) {
+		Com_Printf( "^3WARNING: couldn't write %s\n", ospath );
+		remove( ospath );
+	}
 }
 
 
+// finds the records of the pk3 files in the cache and scans the others
 
-/*
-==========================================================================
+static void FS_FindPakRecords( const char* path, const char* dir, char** pakNames, int numPaks, const pakRecord_t** records )
+{
+	if ( numPaks <= 0 )
+		return;
 
-ZIP FILE LOADING
+	pakScanJob_t* const jobs = Z_New<pakScanJob_t>( numPaks );
+	int numJobs = 0;
+	int i;
 
-==========================================================================
-*/
+	for ( i = 0; i < numPaks; ++i ) {
+		const char* const ospath = FS_BuildOSPath( path, dir, pakNames[i] );
+		int64_t fileSize, modTime;
+		records[i] = NULL;
+		if ( !Sys_GetFileStats( ospath, &fileSize, &modTime ) )
+			continue;
 
-static const char* FS_GetFileName( const char* filePath )
-{
-	for ( int i = strlen(filePath) - 1; i >= 0; i-- ) {
-		if ( filePath[i] == '/' || filePath[i] == '\\' ) {
-			return filePath + i + 1;
+		if ( fileSize >= 0x7FFFFFFF ) {
+			Com_Printf( "^3WARNING: %s is too large\n", ospath );
+			continue;
+		}
+
+		records[i] = FS_FindPakRecord( ospath, fileSize, modTime );
+		if ( records[i] )
+			continue;
+
+		pakScanJob_t* const job = &jobs[numJobs++];
+		Q_strncpyz( job->path, ospath, sizeof( job->path ) );
+		job->fileSize = fileSize;
+		job->modTime = modTime;
+		job->pakIndex = i;
+	}
+
+	if ( numJobs > 0 ) {
+		const int startTime = Sys_Milliseconds();
+		FS_ScanPaks( jobs, numJobs );
+		Com_DPrintf( "Scanned %d of %d pk3 files in %d ms\n", numJobs, numPaks, Sys_Milliseconds() - startTime );
+
+		for ( i = 0; i < numJobs; ++i ) {
+			if ( jobs[i].record ) {
+				records[jobs[i].pakIndex] = jobs[i].record;
+				FS_AddPakCacheEntry( jobs[i].record, qtrue, qtrue );
+				fs_pakRecords.modified = qtrue;
+			}
 		}
 	}
 
-	return filePath;
+	Z_Free( jobs );
 }
 
+
 /*
 =================
-FS_LoadZipFile
+FS_LoadPak
 
 Creates a new pak_t in the search chain for the contents
 of a zip file.
 =================
 */
-static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
+static pack_t* FS_LoadPak( const pakRecord_t* record, const char* basename )
 {
-	unzFile			uf;
-	int				err;
-	unz_global_info gi;
-	char			filename_inzip[MAX_ZPATH];
-	unz_file_info	file_info;
-	int				i, len;
-	long			hash;
-	int				fs_numHeaderLongs;
-	int				fileCount;
-	char*			filename_lastchar = &filename_inzip[sizeof(filename_inzip) - 1];
-
-	fs_numHeaderLongs = 0;
-
-	uf = unzOpen(zipfile);
-	err = unzGetGlobalInfo (uf,&gi);
-
-	if (err != UNZ_OK)
-		return NULL;
-
-	len = 0;
-	unzGoToFirstFile(uf);
-	fileCount = 0;
+	const char* const zipfile = FS_PakRecordPath( record );
+	const int* const longNames = FS_PakRecordLongNames( record );
+	int i;
 
-	for (i = 0; i < gi.number_entry; i++)
-	{
-		*filename_lastchar = '\0';
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			Com_Printf("^3FS_LoadZipFile: ^7Can't read past entry %d in '%s'\n", i, FS_GetFileName(zipfile));
-			break;
-		}
-		if (*filename_lastchar != '\0') {
-			Com_Printf("^3FS_LoadZipFile: ^7Entry %d's name is too long in '%s'\n", i, FS_GetFileName(zipfile));
-			unzGoToNextFile(uf);
-			continue;
-		}
-		len += strlen(filename_inzip) + 1;
-		unzGoToNextFile(uf);
-		fileCount++;
+	for ( i = 0; i < record->numLongNames; ++i ) {
+		Com_Printf("^3FS_LoadPak: ^7Entry %d's name is too long in '%s'\n", longNames[i], FS_GetFileName(zipfile));
+	}
+	if ( record->badEntry >= 0 ) {
+		Com_Printf("^3FS_LoadPak: ^7Can't read past entry %d in '%s'\n", record->badEntry, FS_GetFileName(zipfile));
 	}
 
+	const int fileCount = record->numFiles;
 	if ( !fileCount ) {
-		unzClose(uf);
 		return NULL;
 	}
 
-	fileInPack_t* buildBuffer = (fileInPack_t*)Z_Malloc( (fileCount * sizeof( fileInPack_t )) + len );
+	fileInPack_t* buildBuffer = (fileInPack_t*)Z_Malloc( (fileCount * sizeof( fileInPack_t )) + record->namesSize );
 	char* namePtr = ((char*)buildBuffer) + fileCount * sizeof( fileInPack_t );
-	int* fs_headerLongs = (int*)Z_Malloc( ( fileCount + 1 ) * sizeof(int) );
-	fs_headerLongs[ fs_numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
+	Com_Memcpy( namePtr, FS_PakRecordNames( record ), record->namesSize );
+
+	// the pure checksum is recomputed because fs_checksumFeed changes with every server
+	int* fs_headerLongs = (int*)Z_Malloc( ( record->numCrcs + 1 ) * sizeof(int) );
+	fs_headerLongs[0] = LittleLong( fs_checksumFeed );
+	Com_Memcpy( fs_headerLongs + 1, FS_PakRecordCrcs( record ), record->numCrcs * sizeof(int) );
 
 	// get the hash table size from the number of files in the zip
 	// because lots of custom pk3 files have less than 32 or 64 files
@@ -1654,47 +3631,36 @@ static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
 		pack->pakBasename[strlen( pack->pakBasename ) - 4] = 0;
 	}
 
-	pack->handle = uf;
+	pack->handle = NULL; // see FS_PakHandle
 	pack->numfiles = fileCount;
-	unzGoToFirstFile(uf);
-	fileCount = 0;
 
-	for (i = 0; i < gi.number_entry; i++)
+	const pakRecordFile_t* const files = FS_PakRecordFiles( record );
+	for (i = 0; i < fileCount; i++)
 	{
-		*filename_lastchar = '\0';
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			break;
-		}
-		if (*filename_lastchar != '\0') {
-			unzGoToNextFile(uf);
-			continue;
-		}
-		if (file_info.uncompressed_size > 0) {
-			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(file_info.crc);
-		}
-		Q_strlwr( filename_inzip );
-		hash = Q_FileHash( filename_inzip, pack->hashSize );
-		buildBuffer[fileCount].name = namePtr;
-		strcpy( buildBuffer[fileCount].name, filename_inzip );
-		namePtr += strlen(filename_inzip) + 1;
-		// store the file position in the zip
-		unzGetCurrentFileInfoPosition(uf, &buildBuffer[fileCount].pos);
+		const long hash = Q_FileHash( namePtr + files[i].name, pack->hashSize );
+		buildBuffer[i].name = namePtr + files[i].name;
+		buildBuffer[i].pos = files[i].pos;
+		buildBuffer[i].localPos = files[i].localPos;
+		buildBuffer[i].compressedSize = files[i].compressedSize;
+		buildBuffer[i].size = files[i].size;
+		buildBuffer[i].method = files[i].method;
 
-		buildBuffer[fileCount].next = pack->hashTable[hash];
-		pack->hashTable[hash] = &buildBuffer[fileCount];
-		unzGoToNextFile(uf);
-		fileCount++;
+		buildBuffer[i].next = pack->hashTable[hash];
+		pack->hashTable[hash] = &buildBuffer[i];
 	}
 
-	pack->checksum = Com_BlockChecksum( &fs_headerLongs[ 1 ], 4 * ( fs_numHeaderLongs - 1 ) );
-	pack->pure_checksum = Com_BlockChecksum( fs_headerLongs, 4 * fs_numHeaderLongs );
-	pack->checksum = LittleLong( pack->checksum );
+	pack->checksum = record->checksum;
+	pack->pure_checksum = Com_BlockChecksum( fs_headerLongs, 4 * ( record->numCrcs + 1 ) );
 	pack->pure_checksum = LittleLong( pack->pure_checksum );
 	pack->buildBuffer = buildBuffer;
 
 	Z_Free(fs_headerLongs);
 
+	// 32-bit builds need their address space for the hunk and zone
+	if ( sizeof( void* ) == 8 ) {
+		pack->mapping = (byte*)Sys_MapFile( zipfile, &pack->mappingSize );
+	}
+
 	fs_packFiles += fileCount;
 
 	return pack;
@@ -1708,8 +3674,6 @@ DIRECTORY SCANNING FUNCTIONS
 =================================================================================
 */
 
-#define	MAX_FOUND_FILES	0x1000
-
 static int FS_ReturnPath( const char *zname, char *zpath, int *depth ) {
 	int len, at, newdep;
 
@@ -2268,6 +4232,11 @@ static void FS_Path_f()
 		}
 	}
 
+	if ( fs_fileIndex.valid ) {
+		Com_Printf( "\nFile index: %d files, %d directories, %d directories skipped\n",
+					fs_fileIndex.numEntries, fs_fileIndex.numDirs, fs_fileIndex.numSkipped );
+	}
+
 	Com_Printf( "\n" );
 	for ( i = 1 ; i < MAX_FILE_HANDLES ; i++ ) {
 		if ( fsh[i].handleFiles.file.o ) {
@@ -2277,6 +4246,164 @@ static void FS_Path_f()
 }
 
 
+// decompresses every deflated file of the loaded pk3s with both decoders and compares the output
+static void FS_InflateTest_f()
+{
+	int numFiles = 0;
+	int numFailed = 0;
+	int numMismatches = 0;
+	int64_t numBytes = 0;
+	int64_t referenceUS = 0;
+	int64_t fastUS = 0;
+
+	for ( const searchpath_t* s = fs_searchpaths; s; s = s->next ) {
+		if ( !s->pack ) {
+			continue;
+		}
+
+		size_t zipSize;
+		const byte* const zipData = (const byte*)Sys_MapFile( s->pack->pakFilename, &zipSize );
+		if ( !zipData ) {
+			Com_Printf( "^3WARNING: couldn't map %s\n", s->pack->pakFilename );
+			continue;
+		}
+
+		for ( int i = 0; i < s->pack->numfiles; ++i ) {
+			const fileInPack_t* const file = &s->pack->buildBuffer[i];
+			unsigned long dataPos;
+			if ( file->method == 0 ||
+				 unzLocateFileData( zipData, zipSize, file->localPos, file->compressedSize, &dataPos ) != UNZ_OK ) {
+				continue;
+			}
+
+			byte* const reference = (byte*)malloc( file->size + 1 );
+			byte* const fast = (byte*)malloc( file->size + 1 );
+			if ( reference && fast ) {
+				const int64_t startUS = Sys_Microseconds();
+				const int referenceResult = unzInflateDataReference( zipData + dataPos, file->compressedSize, reference, file->size );
+				const int64_t midUS = Sys_Microseconds();
+				const int fastResult = unzInflateData( zipData + dataPos, file->compressedSize, fast, file->size );
+				const int64_t endUS = Sys_Microseconds();
+				numFiles++;
+				if ( referenceResult != fastResult ) {
+					numFailed++;
+					Com_Printf( "^1%s/%s: decoders disagree on validity\n", s->pack->pakBasename, file->name );
+				} else if ( fastResult == UNZ_OK && memcmp( reference, fast, file->size ) != 0 ) {
+					numMismatches++;
+					Com_Printf( "^1%s/%s: output mismatch\n", s->pack->pakBasename, file->name );
+				} else if ( fastResult == UNZ_OK ) {
+					numBytes += file->size;
+					referenceUS += midUS - startUS;
+					fastUS += endUS - midUS;
+				}
+			}
+			free( reference );
+			free( fast );
+		}
+
+		Sys_UnmapFile( (void*)zipData, zipSize );
+	}
+
+	const double MB = (double)numBytes / ( 1024.0 * 1024.0 );
+	Com_Printf( "%d deflated files, %d validity mismatches, %d output mismatches\n", numFiles, numFailed, numMismatches );
+	Com_Printf( "%.2f MB decoded: reference %.1f MB/s, fast %.1f MB/s\n", MB,
+				referenceUS > 0 ? MB * 1000000.0 / (double)referenceUS : 0.0,
+				fastUS > 0 ? MB * 1000000.0 / (double)fastUS : 0.0 );
+}
+
+
+// starts async reads of the loaded pk3s' files, finishes them in a random order,
+// cancels every 4th one and compares the data against synchronous reads
+static void FS_AsyncTest_f()
+{
+	int maxFiles = Cmd_Argc() >= 2 ? atoi( Cmd_Argv( 1 ) ) : 4096;
+	maxFiles = max( maxFiles, 1 );
+	int seed = Cmd_Argc() >= 3 ? atoi( Cmd_Argv( 2 ) ) : 1;
+
+	typedef struct {
+		char	name[MAX_QPATH];
+		int		request;
+	} asyncTestFile_t;
+
+	asyncTestFile_t* const files = (asyncTestFile_t*)malloc( ( maxFiles + 1 ) * sizeof( asyncTestFile_t ) );
+	if ( !files ) {
+		Com_Printf( "^1fs_asynctest: out of memory\n" );
+		return;
+	}
+
+	int numFiles = 0;
+	for ( const searchpath_t* s = fs_searchpaths; s && numFiles < maxFiles; s = s->next ) {
+		if ( !s->pack ) {
+			continue;
+		}
+		for ( int i = 0; i < s->pack->numfiles && numFiles < maxFiles; ++i ) {
+			Q_strncpyz( files[numFiles++].name, s->pack->buildBuffer[i].name, MAX_QPATH );
+		}
+	}
+	// a missing file must give a null request
+	Q_strncpyz( files[numFiles++].name, "fs_asynctest/missing.file", MAX_QPATH );
+
+	const int startLoadStack = fs_loadStack;
+	const int startMS = Sys_Milliseconds();
+	int numMissing = 0;
+	for ( int i = 0; i < numFiles; ++i ) {
+		files[i].request = FS_ReadFileAsync( files[i].name, NULL );
+		if ( !files[i].request ) {
+			numMissing++;
+		}
+	}
+
+	// shuffled so that requests get finished while they're waiting, queued and being read
+	for ( int i = numFiles - 1; i > 0; --i ) {
+		const int j = ( Q_rand( &seed ) & 0x7FFFFFFF ) % ( i + 1 );
+		const asyncTestFile_t temp = files[i];
+		files[i] = files[j];
+		files[j] = temp;
+	}
+
+	int numRead = 0;
+	int numCancelled = 0;
+	int numMismatches = 0;
+	for ( int i = 0; i < numFiles; ++i ) {
+		const asyncTestFile_t* const file = &files[i];
+		if ( !file->request ) {
+			continue;
+		}
+
+		if ( ( i % 4 ) == 0 ) {
+			FS_CancelReadFile( file->request );
+			numCancelled++;
+			continue;
+		}
+
+		void* async;
+		const int asyncLength = FS_FinishReadFile( file->request, &async );
+		void* sync;
+		const int syncLength = FS_ReadFilePak( file->name, &sync, NULL );
+		numRead++;
+		if ( !async || !sync || asyncLength != syncLength ||
+			 memcmp( async, sync, syncLength ) != 0 || ( (const char*)async )[asyncLength] != '\0' ) {
+			numMismatches++;
+			Com_Printf( "^1%s: async read mismatch (%d bytes, %d expected)\n", file->name, asyncLength, syncLength );
+		}
+		if ( sync ) {
+			FS_FreeFile( sync );
+		}
+		if ( async ) {
+			FS_FreeFile( async );
+		}
+	}
+
+	Com_Printf( "%d files: %d read, %d cancelled, %d missing, %d mismatches in %d ms\n",
+				numFiles, numRead, numCancelled, numMissing, numMismatches, Sys_Milliseconds() - startMS );
+	if ( fs_loadStack != startLoadStack || fs_async.pendingBytes != 0 ) {
+		Com_Printf( "^1%d files and %d pending bytes were leaked\n", fs_loadStack - startLoadStack, fs_async.pendingBytes );
+	}
+
+	free( files );
+}
+
+
 //===========================================================================
 
 
@@ -2344,9 +4471,11 @@ static void FS_AddGameDirectory( const char *path, const char *dir )
 
 	qsort( sorted, numfiles, sizeof(char*), paksort );
 
+	const pakRecord_t* records[MAX_PAKFILES];
+	FS_FindPakRecords( path, dir, sorted, numfiles, records );
+
 	for ( i = 0 ; i < numfiles ; i++ ) {
-		pakfile = FS_BuildOSPath( path, dir, sorted[i] );
-		if ( ( pak = FS_LoadZipFile( pakfile, sorted[i] ) ) == 0 )
+		if ( !records[i] || ( pak = FS_LoadPak( records[i], sorted[i] ) ) == 0 )
 			continue;
 		// store the game name for downloading
 		strcpy(pak->pakGamename, dir);
@@ -2557,7 +4686,9 @@ static const cmdTableItem_t fs_cmds[] =
 	{ "path", FS_Path_f, NULL, "prints info about the current search path" },
 	{ "dir", FS_Dir_f, NULL, "prints an extension-filtered file list" },
 	{ "fdir", FS_NewDir_f, NULL, "prints a pattern-filtered file list" },
-	{ "fs_restart", FS_Restart_f, NULL, "restarts the file system" }
+	{ "fs_restart", FS_Restart_f, NULL, "restarts the file system" },
+	{ "fs_inflatetest", FS_InflateTest_f, NULL, "compares the pk3 decompressors on all loaded files" },
+	{ "fs_asynctest", FS_AsyncTest_f, NULL, "compares async file reads against synchronous ones" }
 };
 
 
@@ -2572,6 +4703,8 @@ void FS_Shutdown( qbool closemfp ) {
 	searchpath_t	*p, *next;
 	int	i;
 
+	FS_ShutdownAsyncReads();
+
 	for(i = 0; i < MAX_FILE_HANDLES; i++) {
 		if (fsh[i].fileSize) {
 			FS_FCloseFile(i);
@@ -2583,7 +4716,12 @@ void FS_Shutdown( qbool closemfp ) {
 		next = p->next;
 
 		if ( p->pack ) {
-			unzClose(p->pack->handle);
+			if ( p->pack->handle ) {
+				unzClose(p->pack->handle);
+			}
+			if ( p->pack->mapping ) {
+				Sys_UnmapFile( p->pack->mapping, p->pack->mappingSize );
+			}
 			Z_Free( p->pack->buildBuffer );
 			Z_Free( p->pack );
 		}
@@ -2595,6 +4733,7 @@ void FS_Shutdown( qbool closemfp ) {
 
 	// any FS_ calls will now be an error until reinitialized
 	fs_searchpaths = NULL;
+	FS_FreeIndex();
 
 	Cmd_UnregisterArray( fs_cmds );
 
@@ -2638,6 +4777,7 @@ static void FS_ReorderPurePaks()
 				*p_insert_index = s;
 				// increment insert list
 				p_insert_index = &s->next;
+				FS_InvalidateIndex();
 				break; // iterate to next server pack
 			}
 			p_previous = &s->next; 
@@ -2660,6 +4800,19 @@ static void FS_Startup( const char *gameName )
 	fs_debug = Cvar_Get( "fs_debug", "0", 0 );
 	Cvar_SetRange( "fs_debug", CVART_BOOL, NULL, NULL );
 	Cvar_SetHelp( "fs_debug", "prints file open/write accesses" );
+	fs_index = Cvar_Get( "fs_index", "1", 0 );
+	Cvar_SetRange( "fs_index", CVART_BOOL, NULL, NULL );
+	Cvar_SetHelp( "fs_index", "finds files with an index of all search paths\n"
+		"Directories are scanned once and rescanned when modified." );
+	fs_pakcache = Cvar_Get( "fs_pakcache", "1", 0 );
+	Cvar_SetRange( "fs_pakcache", CVART_BOOL, NULL, NULL );
+	Cvar_SetHelp( "fs_pakcache", "caches the pk3 file lists in " PAK_CACHE_FILE "\n"
+		"Pk3 files are only scanned when new or modified." );
+	fs_asyncthreads = Cvar_Get( "fs_asyncthreads", "2", 0 );
+	Cvar_SetRange( "fs_asyncthreads", CVART_INTEGER, "0", XSTRING(MAX_ASYNC_THREADS) );
+	Cvar_SetHelp( "fs_asyncthreads", "number of threads reading files ahead of time\n"
+		"With 0, the files are read when the data is needed.\n"
+		"Changes apply on the next file system restart." );
 	fs_basepath = Cvar_Get ("fs_basepath", Sys_Cwd(), CVAR_INIT );
 	fs_basegame = Cvar_Get ("fs_basegame", "", CVAR_INIT );
 #if defined( QC )
@@ -2672,6 +4825,8 @@ static void FS_Startup( const char *gameName )
 		homePath = fs_basepath->string;
 	fs_homepath = Cvar_Get ("fs_homepath", homePath, CVAR_INIT );
 
+	FS_LoadPakCache();
+
 	// add search path elements in reverse priority order
 	if (fs_basepath->string[0]) {
 		FS_AddGameDirectory( fs_basepath->string, gameName );
@@ -2707,6 +4862,9 @@ static void FS_Startup( const char *gameName )
 		}
 	}
 
+	FS_SavePakCache();
+	FS_FreePakCache();
+
 	Com_ReadCDKey(BASEGAME);
 	if (fs_gamedirvar && fs_gamedirvar->string[0] != 0) {
 		Com_AppendCDKey( fs_gamedirvar->string );
@@ -2718,6 +4876,7 @@ static void FS_Startup( const char *gameName )
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=506
 	// reorder the pure pk3 files according to server order
 	FS_ReorderPurePaks();
+	FS_UpdatePurePaks();
 
 	fs_gamedirvar->modified = qfalse; // We just loaded, it's not modified
 
@@ -3008,6 +5167,7 @@ void FS_PureServerSetLoadedPaks( const char *pakSums ) {
 	for ( int i = 0 ; i < c ; i++ ) {
 		fs_serverPaks[i] = atoi( Cmd_Argv( i ) );
 	}
+	FS_UpdatePurePaks();
 
 	if (fs_numServerPaks) {
 		Com_DPrintf( "Connected to a pure server.\n" );
@@ -0,0 +1,575 @@
+/*
+===========================================================================
+Copyright (C) 2024 Gian 'myT' Schellenbaum
+
+This file is part of Challenge Quake 3 (CNQ3).
+
+Challenge Quake 3 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Challenge Quake 3 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Challenge Quake 3. If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+// one-shot decoder for raw deflate streams (RFC 1951) of known uncompressed size
+
+#include "q_shared.h"
+#include "qcommon.h"
+#include "unzip.h"
+
+
+/*
+The whole input and output are in memory, so matches are copied straight from
+the output buffer and there is no window to maintain.
+
+- the bit buffer is 64 bits wide and refilled 8 bytes at a time,
+  which is enough for a full length/distance pair between refills
+- the literal/length table resolves codes of up to 11 bits in one lookup
+  and holds 2 literals in one entry when both codes fit in those 11 bits
+- longer codes go through a second-level table
+- matches are copied 8 bytes at a time when they don't overlap within a word
+
+Table entry layout:
+bits  0- 3: bits to consume
+bits  4- 7: extra bits to read (length/distance) or second-level table bits
+bits  8-10: entry type
+bit     11: the entry holds a second literal
+bits 16-31: literal(s), length/distance base or second-level table offset
+*/
+
+
+#define LITLEN_TABLE_BITS	11
+#define DIST_TABLE_BITS		8
+#define MAX_CODE_BITS		15
+#define NUM_LITLEN_SYMBOLS	288
+#define NUM_DIST_SYMBOLS	32
+#define NUM_CODELEN_SYMBOLS	19
+
+// the first level plus one second-level table of the largest size per long code
+#define LITLEN_TABLE_SIZE	( ( 1 << LITLEN_TABLE_BITS ) + NUM_LITLEN_SYMBOLS * ( 1 << ( MAX_CODE_BITS - LITLEN_TABLE_BITS ) ) )
+#define DIST_TABLE_SIZE		( ( 1 << DIST_TABLE_BITS ) + NUM_DIST_SYMBOLS * ( 1 << ( MAX_CODE_BITS - DIST_TABLE_BITS ) ) )
+#define CODELEN_TABLE_SIZE	( 1 << 7 )
+
+enum {
+	ENTRY_INVALID,
+	ENTRY_LITERAL,
+	ENTRY_BASE,			// length or distance
+	ENTRY_END,			// end of block
+	ENTRY_SUBTABLE
+};
+
+#define ENTRY( bits, extra, type, value )	( (uint32_t)(bits) | ( (uint32_t)(extra) << 4 ) | ( (uint32_t)(type) << 8 ) | ( (uint32_t)(value) << 16 ) )
+#define ENTRY_BITS( e )						( (e) & 15 )
+#define ENTRY_EXTRA( e )					( ( (e) >> 4 ) & 15 )
+#define ENTRY_TYPE( e )						( ( (e) >> 8 ) & 7 )
+#define ENTRY_VALUE( e )					( (e) >> 16 )
+#define ENTRY_TWO_LITERALS					( 1 << 11 )
+
+
+static const uint16_t lengthBases[29] = {
+	3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+};
+
+static const byte lengthExtras[29] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+};
+
+static const uint16_t distBases[30] = {
+	1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+};
+
+static const byte distExtras[30] = {
+	0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+};
+
+static const byte codeLengthOrder[NUM_CODELEN_SYMBOLS] = {
+	16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15
+};
+
+
+typedef struct {
+	const byte*	in;
+	const byte*	inEnd;
+	uint64_t	bitBuf;
+	unsigned	bitCount;
+	unsigned	overrun;	// zero bytes fed past the end of the input
+} bitReader_t;
+
+typedef struct {
+	bitReader_t	bits;
+	byte*		outStart;
+	byte*		out;
+	byte*		outEnd;
+	uint32_t	litLenTable[LITLEN_TABLE_SIZE];
+	uint32_t	distTable[DIST_TABLE_SIZE];
+} inflater_t;
+
+
+// only the low bitCount bits are valid, but the bits above are the next input bits,
+// so OR'ing the same bytes in again at the same positions is harmless
+static void Inflate_Refill( bitReader_t* b )
+{
+#if defined( Q3_LITTLE_ENDIAN )
+	if ( b->inEnd - b->in >= 8 ) {
+		uint64_t word;
+		memcpy( &word, b->in, 8 );
+		b->bitBuf |= word << b->bitCount;
+		b->in += ( 63 - b->bitCount ) >> 3;
+		b->bitCount |= 56;
+		return;
+	}
+#endif
+
+	while ( b->bitCount < 56 ) {
+		if ( b->in < b->inEnd ) {
+			b->bitBuf |= (uint64_t)*b->in++ << b->bitCount;
+		} else {
+			b->overrun++;
+		}
+		b->bitCount += 8;
+	}
+}
+
+
+static unsigned Inflate_Bits( bitReader_t* b, unsigned count )
+{
+	const unsigned bits = (unsigned)( b->bitBuf & ( ( (uint64_t)1 << count ) - 1 ) );
+	b->bitBuf >>= count;
+	b->bitCount -= count;
+
+	return bits;
+}
+
+
+static unsigned Inflate_ReverseBits( unsigned code, int length )
+{
+	unsigned reversed = 0;
+	for ( int i = 0; i < length; ++i ) {
+		reversed = ( reversed << 1 ) | ( code & 1 );
+		code >>= 1;
+	}
+
+	return reversed;
+}
+
+
+/*
+=================
+Inflate_BuildTable
+
+Builds a canonical Huffman decoding table where symbolEntries holds the
+entry of every symbol without its bit count.
+Over-subscribed codes are rejected, missing codes are invalid entries.
+=================
+*/
+static qbool Inflate_BuildTable( uint32_t* table, int tableSize, int tableBits,
+								 const byte* lengths, int numSymbols, const uint32_t* symbolEntries )
+{
+	int count[MAX_CODE_BITS + 1];
+	int offsets[MAX_CODE_BITS + 2];
+	uint16_t sorted[NUM_LITLEN_SYMBOLS];
+	int i;
+
+	Com_Memset( count, 0, sizeof( count ) );
+	for ( i = 0; i < numSymbols; ++i ) {
+		count[lengths[i]]++;
+	}
+	count[0] = 0;
+
+	int maxLength = 0;
+	int left = 1;
+	for ( i = 1; i <= MAX_CODE_BITS; ++i ) {
+		left = ( left << 1 ) - count[i];
+		if ( left < 0 ) {
+			return qfalse;
+		}
+		if ( count[i] ) {
+			maxLength = i;
+		}
+	}
+
+	offsets[1] = 0;
+	for ( i = 1; i <= MAX_CODE_BITS; ++i ) {
+		offsets[i + 1] = offsets[i] + count[i];
+	}
+	for ( i = 0; i < numSymbols; ++i ) {
+		if ( lengths[i] ) {
+			sorted[offsets[lengths[i]]++] = (uint16_t)i;
+		}
+	}
+
+	for ( i = 0; i < ( 1 << tableBits ); ++i ) {
+		table[i] = ENTRY_INVALID;
+	}
+
+	const int subBits = max( maxLength - tableBits, 0 );
+	int nextSubtable = 1 << tableBits;
+	unsigned code = 0;
+	int symbolIndex = 0;
+	for ( int length = 1; length <= maxLength; ++length, code <<= 1 ) {
+		for ( int n = 0; n < count[length]; ++n, ++code ) {
+			const uint32_t entry = symbolEntries[sorted[symbolIndex++]];
+			const unsigned reversed = Inflate_ReverseBits( code, length );
+			if ( length <= tableBits ) {
+				for ( int j = reversed; j < ( 1 << tableBits ); j += 1 << length ) {
+					table[j] = entry | length;
+				}
+				continue;
+			}
+
+			// all long codes sharing the first tableBits bits go into the same second-level table
+			const int prefix = reversed & ( ( 1 << tableBits ) - 1 );
+			if ( ENTRY_TYPE( table[prefix] ) != ENTRY_SUBTABLE ) {
+				if ( nextSubtable + ( 1 << subBits ) > tableSize ) {
+					return qfalse;
+				}
+				table[prefix] = ENTRY( tableBits, subBits, ENTRY_SUBTABLE, nextSubtable );
+				for ( int j = 0; j < ( 1 << subBits ); ++j ) {
+					table[nextSubtable + j] = ENTRY_INVALID;
+				}
+				nextSubtable += 1 << subBits;
+			}
+			uint32_t* const subtable = table + ENTRY_VALUE( table[prefix] );
+			const int subLength = length - tableBits;
+			for ( int j = reversed >> tableBits; j < ( 1 << subBits ); j += 1 << subLength ) {
+				subtable[j] = entry | subLength;
+			}
+		}
+	}
+
+	return qtrue;
+}
+
+
+// merges pairs of short literal codes into single entries
+// the second literal is looked up at index i >> firstBits <= i,
+// so walking backwards only ever reads entries that weren't merged yet
+static void Inflate_PairLiterals( uint32_t* table, int tableBits )
+{
+	for ( int i = ( 1 << tableBits ) - 1; i >= 0; --i ) {
+		const uint32_t first = table[i];
+		if ( ENTRY_TYPE( first ) != ENTRY_LITERAL ) {
+			continue;
+		}
+		const int firstBits = ENTRY_BITS( first );
+		const uint32_t second = table[i >> firstBits];
+		if ( ENTRY_TYPE( second ) != ENTRY_LITERAL ||
+			 firstBits + ENTRY_BITS( second ) > tableBits ) {
+			continue;
+		}
+		table[i] = ENTRY( firstBits + ENTRY_BITS( second ), 0, ENTRY_LITERAL,
+						  ENTRY_VALUE( first ) | ( ENTRY_VALUE( second ) << 8 ) ) | ENTRY_TWO_LITERALS;
+	}
+}
+
+
+static qbool Inflate_BuildTables( inflater_t* s, const byte* litLenLengths, int numLitLen, const byte* distLengths, int numDist )
+{
+	uint32_t entries[NUM_LITLEN_SYMBOLS];
+	int i;
+
+	for ( i = 0; i < 256; ++i ) {
+		entries[i] = ENTRY( 0, 0, ENTRY_LITERAL, i );
+	}
+	entries[256] = ENTRY( 0, 0, ENTRY_END, 0 );
+	for ( i = 257; i < 286; ++i ) {
+		entries[i] = ENTRY( 0, lengthExtras[i - 257], ENTRY_BASE, lengthBases[i - 257] );
+	}
+	entries[286] = entries[287] = ENTRY_INVALID;
+	if ( !Inflate_BuildTable( s->litLenTable, LITLEN_TABLE_SIZE, LITLEN_TABLE_BITS, litLenLengths, numLitLen, entries ) ) {
+		return qfalse;
+	}
+
+	Inflate_PairLiterals( s->litLenTable, LITLEN_TABLE_BITS );
+
+	for ( i = 0; i < 30; ++i ) {
+		entries[i] = ENTRY( 0, distExtras[i], ENTRY_BASE, distBases[i] );
+	}
+	entries[30] = entries[31] = ENTRY_INVALID;
+
+	return Inflate_BuildTable( s->distTable, DIST_TABLE_SIZE, DIST_TABLE_BITS, distLengths, numDist, entries );
+}
+
+
+static uint32_t Inflate_Decode( bitReader_t* b, const uint32_t* table, int tableBits )
+{
+	uint32_t entry = table[b->bitBuf & ( ( 1 << tableBits ) - 1 )];
+	if ( ENTRY_TYPE( entry ) == ENTRY_SUBTABLE ) {
+		b->bitBuf >>= tableBits;
+		b->bitCount -= tableBits;
+		entry = table[ENTRY_VALUE( entry ) + ( b->bitBuf & ( ( 1 << ENTRY_EXTRA( entry ) ) - 1 ) )];
+	}
+	b->bitBuf >>= ENTRY_BITS( entry );
+	b->bitCount -= ENTRY_BITS( entry );
+
+	return entry;
+}
+
+
+static qbool Inflate_FixedTables( inflater_t* s )
+{
+	byte lengths[NUM_LITLEN_SYMBOLS + NUM_DIST_SYMBOLS];
+	int i;
+
+	for ( i = 0; i < 144; ++i )
+		lengths[i] = 8;
+	for ( ; i < 256; ++i )
+		lengths[i] = 9;
+	for ( ; i < 280; ++i )
+		lengths[i] = 7;
+	for ( ; i < NUM_LITLEN_SYMBOLS; ++i )
+		lengths[i] = 8;
+	for ( i = 0; i < NUM_DIST_SYMBOLS; ++i )
+		lengths[NUM_LITLEN_SYMBOLS + i] = 5;
+
+	return Inflate_BuildTables( s, lengths, NUM_LITLEN_SYMBOLS, lengths + NUM_LITLEN_SYMBOLS, NUM_DIST_SYMBOLS );
+}
+
+
+static qbool Inflate_DynamicTables( inflater_t* s )
+{
+	byte lengths[NUM_LITLEN_SYMBOLS + NUM_DIST_SYMBOLS];
+	byte codeLengths[NUM_CODELEN_SYMBOLS];
+	uint32_t codeLengthEntries[NUM_CODELEN_SYMBOLS];
+	uint32_t codeLengthTable[CODELEN_TABLE_SIZE];
+	int i;
+
+	Inflate_Refill( &s->bits );
+	const int numLitLen = Inflate_Bits( &s->bits, 5 ) + 257;
+	const int numDist = Inflate_Bits( &s->bits, 5 ) + 1;
+	const int numCodeLen = Inflate_Bits( &s->bits, 4 ) + 4;
+	if ( numLitLen > 286 || numDist > 30 ) {
+		return qfalse;
+	}
+
+	Com_Memset( codeLengths, 0, sizeof( codeLengths ) );
+	for ( i = 0; i < numCodeLen; ++i ) {
+		if ( s->bits.bitCount < 3 ) {
+			Inflate_Refill( &s->bits );
+		}
+		codeLengths[codeLengthOrder[i]] = (byte)Inflate_Bits( &s->bits, 3 );
+	}
+	for ( i = 0; i < NUM_CODELEN_SYMBOLS; ++i ) {
+		codeLengthEntries[i] = ENTRY( 0, 0, ENTRY_LITERAL, i );
+	}
+	if ( !Inflate_BuildTable( codeLengthTable, CODELEN_TABLE_SIZE, 7, codeLengths, NUM_CODELEN_SYMBOLS, codeLengthEntries ) ) {
+		return qfalse;
+	}
+
+	const int numLengths = numLitLen + numDist;
+	i = 0;
+	while ( i < numLengths ) {
+		Inflate_Refill( &s->bits );
+		const uint32_t entry = Inflate_Decode( &s->bits, codeLengthTable, 7 );
+		if ( ENTRY_TYPE( entry ) != ENTRY_LITERAL ) {
+			return qfalse;
+		}
+		const int symbol = ENTRY_VALUE( entry );
+		if ( symbol < 16 ) {
+			lengths[i++] = (byte)symbol;
+			continue;
+		}
+
+		int repeat;
+		byte value = 0;
+		if ( symbol == 16 ) {
+			if ( i == 0 ) {
+				return qfalse;
+			}
+			value = lengths[i - 1];
+			repeat = 3 + Inflate_Bits( &s->bits, 2 );
+		} else if ( symbol == 17 ) {
+			repeat = 3 + Inflate_Bits( &s->bits, 3 );
+		} else {
+			repeat = 11 + Inflate_Bits( &s->bits, 7 );
+		}
+		if ( i + repeat > numLengths ) {
+			return qfalse;
+		}
+		while ( repeat-- ) {
+			lengths[i++] = value;
+		}
+	}
+
+	if ( lengths[256] == 0 ) {
+		return qfalse; // no end of block code
+	}
+
+	return Inflate_BuildTables( s, lengths, numLitLen, lengths + numLitLen, numDist );
+}
+
+
+static qbool Inflate_StoredBlock( inflater_t* s )
+{
+	bitReader_t* const b = &s->bits;
+
+	// drop the bits up to the byte boundary and give back the whole bytes
+	Inflate_Bits( b, b->bitCount & 7 );
+	if ( b->overrun * 8 > b->bitCount ) {
+		return qfalse;
+	}
+	b->in -= ( b->bitCount >> 3 ) - b->overrun;
+	b->overrun = 0;
+	b->bitBuf = 0;
+	b->bitCount = 0;
+
+	if ( b->inEnd - b->in < 4 ) {
+		return qfalse;
+	}
+	const unsigned length = b->in[0] | ( b->in[1] << 8 );
+	const unsigned invLength = b->in[2] | ( b->in[3] << 8 );
+	b->in += 4;
+	if ( length != ( ~invLength & 0xFFFF ) ||
+		 (unsigned)( b->inEnd - b->in ) < length ||
+		 (unsigned)( s->outEnd - s->out ) < length ) {
+		return qfalse;
+	}
+
+	Com_Memcpy( s->out, b->in, length );
+	b->in += length;
+	s->out += length;
+
+	return qtrue;
+}
+
+
+static qbool Inflate_HuffmanBlock( inflater_t* s )
+{
+	const uint32_t* const litLenTable = s->litLenTable;
+	const uint32_t* const distTable = s->distTable;
+	byte* out = s->out;
+	byte* const outStart = s->outStart;
+	byte* const outEnd = s->outEnd;
+
+	// a local copy that the output stores can't alias, so it stays in registers
+	bitReader_t bits = s->bits;
+	bitReader_t* const b = &bits;
+
+	for ( ;; ) {
+		// enough for a literal/length code, a distance code and all their extra bits
+		Inflate_Refill( b );
+		if ( b->overrun > 8 ) {
+			return qfalse;
+		}
+
+		uint32_t entry = Inflate_Decode( b, litLenTable, LITLEN_TABLE_BITS );
+		const int type = ENTRY_TYPE( entry );
+		if ( type == ENTRY_LITERAL ) {
+			if ( entry & ENTRY_TWO_LITERALS ) {
+				if ( outEnd - out < 2 ) {
+					return qfalse;
+				}
+				out[0] = (byte)ENTRY_VALUE( entry );
+				out[1] = (byte)( ENTRY_VALUE( entry ) >> 8 );
+				out += 2;
+			} else {
+				if ( out >= outEnd ) {
+					return qfalse;
+				}
+				*out++ = (byte)ENTRY_VALUE( entry );
+			}
+			continue;
+		}
+
+		if ( type == ENTRY_END ) {
+			s->bits = bits;
+			s->out = out;
+			return qtrue;
+		}
+
+		if ( type != ENTRY_BASE ) {
+			return qfalse;
+		}
+
+		const unsigned length = ENTRY_VALUE( entry ) + Inflate_Bits( b, ENTRY_EXTRA( entry ) );
+		entry = Inflate_Decode( b, distTable, DIST_TABLE_BITS );
+		if ( ENTRY_TYPE( entry ) != ENTRY_BASE ) {
+			return qfalse;
+		}
+		const unsigned dist = ENTRY_VALUE( entry ) + Inflate_Bits( b, ENTRY_EXTRA( entry ) );
+		if ( dist > (unsigned)( out - outStart ) || length > (unsigned)( outEnd - out ) ) {
+			return qfalse;
+		}
+
+		const byte* src = out - dist;
+		byte* const matchEnd = out + length;
+		if ( dist >= 8 && outEnd - matchEnd >= 8 ) {
+			// may write up to 7 bytes past the match, they get overwritten later
+			do {
+				uint64_t word;
+				memcpy( &word, src, 8 );
+				memcpy( out, &word, 8 );
+				src += 8;
+				out += 8;
+			} while ( out < matchEnd );
+			out = matchEnd;
+		} else if ( dist == 1 ) {
+			memset( out, *src, length );
+			out = matchEnd;
+		} else {
+			while ( out < matchEnd ) {
+				*out++ = *src++;
+			}
+		}
+	}
+}
+
+
+qbool Inflate_Raw( const void* src, int srcSize, void* dest, int destSize )
+{
+	if ( srcSize < 0 || destSize < 0 ) {
+		return qfalse;
+	}
+
+	inflater_t state;
+	inflater_t* const s = &state;
+	s->bits.in = (const byte*)src;
+	s->bits.inEnd = s->bits.in + srcSize;
+	s->bits.bitBuf = 0;
+	s->bits.bitCount = 0;
+	s->bits.overrun = 0;
+	s->outStart = (byte*)dest;
+	s->out = s->outStart;
+	s->outEnd = s->outStart + destSize;
+
+	qbool success = qfalse;
+	for ( ;; ) {
+		Inflate_Refill( &s->bits );
+		const unsigned final = Inflate_Bits( &s->bits, 1 );
+		const unsigned type = Inflate_Bits( &s->bits, 2 );
+
+		qbool valid;
+		if ( type == 0 ) {
+			valid = Inflate_StoredBlock( s );
+		} else if ( type == 1 ) {
+			valid = Inflate_FixedTables( s ) && Inflate_HuffmanBlock( s );
+		} else if ( type == 2 ) {
+			valid = Inflate_DynamicTables( s ) && Inflate_HuffmanBlock( s );
+		} else {
+			valid = qfalse;
+		}
+
+		if ( !valid ) {
+			break;
+		}
+
+		if ( final ) {
+			// the padding bytes must not have been consumed
+			success = s->out == s->outEnd && s->bits.overrun * 8 <= s->bits.bitCount;
+			break;
+		}
+	}
+
+	return success;
+}
@@ -322,6 +322,14 @@ void JSONW_IntegerValue(const char* name, int number)
 	JSONW_StringValue(name, "%d", number);
 }
 
+void JSONW_Integer64Value(const char* name, int64_t number)
+{
+	if (!name)
+		return;
+
+	JSONW_StringValue(name, "%lld", (long long)number);
+}
+
 void JSONW_HexValue(const char* name, uint64_t number)
 {
 	if (!name)
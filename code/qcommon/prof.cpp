@@ -0,0 +1,234 @@
+/*
+===========================================================================
+Copyright (C) 2024 Gian 'myT' Schellenbaum
+
+This file is part of Challenge Quake 3 (CNQ3).
+
+Challenge Quake 3 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Challenge Quake 3 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Challenge Quake 3. If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+// timeline profiler writing Chrome trace event files
+
+#include "q_shared.h"
+#include "qcommon.h"
+
+
+/*
+Prof_Scope objects mark the engine's hot paths. While com_profile or com_profileHitch
+is enabled, every scope writes a complete event (name, start, duration) into the ring
+buffer of its thread when it ends, so recording doesn't need any locking and a scope
+skipped by Com_Error's longjmp is simply lost.
+The main thread owns the first and largest ring. The other threads claim one on their
+first event and give it back when they exit.
+
+/profdump writes the last seconds of all rings in the Chrome trace event format,
+which chrome://tracing and ui.perfetto.dev can open.
+com_profileHitch writes one automatically when a frame takes longer than the threshold.
+
+The threads can overwrite the oldest events of their ring while it's being written out,
+so the oldest PROF_READ_MARGIN events of the worker rings are always left out.
+*/
+
+
+#define PROF_MAX_THREADS		16
+#define PROF_MAIN_RING_SIZE		(1 << 17)	// events, power of 2
+#define PROF_WORKER_RING_SIZE	(1 << 13)	// events, power of 2
+#define PROF_READ_MARGIN		1024
+#define PROF_DUMP_SECONDS		10
+#define PROF_HITCH_SECONDS		2
+#define PROF_HITCH_COOLDOWN		10000		// min. ms between 2 automatic dumps
+
+
+typedef struct {
+	const char*	name;		// string literal
+	int64_t		start;		// us
+	int			duration;	// us
+} profEvent_t;
+
+typedef struct {
+	profEvent_t*	events;
+	int				size;		// power of 2
+	int				count;		// events written, only moved by the owner
+	int				used;		// owned by a running thread
+	const char*		name;		// of the last owner
+} profThread_t;
+
+static profEvent_t prof_mainEvents[PROF_MAIN_RING_SIZE];
+static profEvent_t prof_workerEvents[PROF_MAX_THREADS - 1][PROF_WORKER_RING_SIZE];
+
+static struct {
+	profThread_t	threads[PROF_MAX_THREADS];
+	int64_t			startTime;
+	int				lastHitchDumpTime;
+} prof;
+
+int prof_enabled;
+
+static THREAD_LOCAL int prof_threadSlot;	// index + 1, 0 when not claimed yet, -1 when none was left
+static THREAD_LOCAL const char* prof_threadName;
+
+
+static profThread_t* Prof_GetThread()
+{
+	if ( prof_threadSlot == 0 ) {
+		prof_threadSlot = -1;
+		for ( int i = 1; i < PROF_MAX_THREADS; ++i ) {
+			profThread_t* const thread = &prof.threads[i];
+			if ( Sys_AtomicCompareExchange( &thread->used, 0, 1 ) ) {
+				thread->name = prof_threadName ? prof_threadName : "worker";
+				prof_threadSlot = i + 1;
+				break;
+			}
+		}
+	}
+
+	return prof_threadSlot > 0 ? &prof.threads[prof_threadSlot - 1] : NULL;
+}
+
+
+void Prof_RecordScope( const char* name, int64_t start )
+{
+	const int64_t end = Sys_Microseconds();
+	profThread_t* const thread = Prof_GetThread();
+	if ( thread == NULL )
+		return;
+
+	const int count = thread->count;
+	profEvent_t* const event = &thread->events[count & ( thread->size - 1 )];
+	event->name = name;
+	event->start = start;
+	event->duration = (int)( end - start );
+
+	// once wrapped around, the count stays >= size so that readers know the ring is full
+	Sys_AtomicStore( &thread->count, count == INT_MAX ? thread->size : count + 1 );
+}
+
+
+void Prof_SetThreadName( const char* name )
+{
+	prof_threadName = name;
+}
+
+
+void Prof_ReleaseThread()
+{
+	if ( prof_threadSlot > 1 )
+		Sys_AtomicStore( &prof.threads[prof_threadSlot - 1].used, 0 );
+	prof_threadSlot = 0;
+}
+
+
+static void Prof_WriteTraceFile( const char* filename, int seconds )
+{
+	const fileHandle_t f = FS_FOpenFileWrite( filename );
+	if ( !f ) {
+		Com_Printf( "Couldn't write %s.\n", filename );
+		return;
+	}
+
+	const int64_t firstTime = Sys_Microseconds() - (int64_t)seconds * 1000000;
+	int numEvents = 0;
+
+	FS_Printf( f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+	FS_Printf( f, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"%s\"}}\n", Q3_VERSION );
+	for ( int t = 0; t < PROF_MAX_THREADS; ++t ) {
+		profThread_t* const thread = &prof.threads[t];
+		const int count = Sys_AtomicLoad( &thread->count );
+		if ( count == 0 )
+			continue;
+
+		FS_Printf( f, ",{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}\n", t, thread->name );
+
+		// nobody else writes to the main thread's ring
+		const int margin = t == 0 ? 0 : PROF_READ_MARGIN;
+		const int available = min( count, thread->size - margin );
+		for ( int i = count - available; i < count; ++i ) {
+			const profEvent_t* const event = &thread->events[i & ( thread->size - 1 )];
+			if ( event->start + event->duration < firstTime )
+				continue;
+
+			FS_Printf( f, ",{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%d}\n",
+					   event->name, t, (long long)( event->start - prof.startTime ), event->duration );
+			numEvents++;
+		}
+	}
+	FS_Printf( f, "]}\n" );
+	FS_FCloseFile( f );
+
+	Com_Printf( "Wrote %d events to %s\n", numEvents, filename );
+}
+
+
+static void Prof_WriteTrace( int seconds )
+{
+	qtime_t t;
+	Com_RealTime( &t );
+	const char* const filename = va( "profiles/%d_%02d_%02d-%02d_%02d_%02d-%03d.json",
+		1900 + t.tm_year, 1 + t.tm_mon, t.tm_mday, t.tm_hour, t.tm_min, t.tm_sec, Sys_Milliseconds() % 1000 );
+	Prof_WriteTraceFile( filename, seconds );
+}
+
+
+void Prof_Init()
+{
+	for ( int i = 0; i < PROF_MAX_THREADS; ++i ) {
+		profThread_t* const thread = &prof.threads[i];
+		thread->events = i == 0 ? prof_mainEvents : prof_workerEvents[i - 1];
+		thread->size = i == 0 ? PROF_MAIN_RING_SIZE : PROF_WORKER_RING_SIZE;
+	}
+
+	prof.threads[0].used = 1;
+	prof.threads[0].name = "main";
+	prof_threadSlot = 1;
+	prof.startTime = Sys_Microseconds();
+	prof.lastHitchDumpTime = Sys_Milliseconds() - PROF_HITCH_COOLDOWN;
+	prof_enabled = com_profile->integer || com_profileHitch->integer;
+}
+
+
+void Prof_EndFrame( int64_t frameStart )
+{
+	if ( prof_enabled ) {
+		Prof_RecordScope( "Com_Frame", frameStart );
+
+		const int frameMsec = (int)( ( Sys_Microseconds() - frameStart ) / 1000 );
+		const int now = Sys_Milliseconds();
+		if ( com_profileHitch->integer > 0 &&
+			 frameMsec >= com_profileHitch->integer &&
+			 now - prof.lastHitchDumpTime >= PROF_HITCH_COOLDOWN ) {
+			Com_Printf( "A frame took %d ms\n", frameMsec );
+			Prof_WriteTrace( PROF_HITCH_SECONDS );
+			prof.lastHitchDumpTime = Sys_Milliseconds();
+		}
+	}
+
+	prof_enabled = com_profile->integer || com_profileHitch->integer;
+}
+
+
+void Prof_Dump_f()
+{
+	if ( Cmd_Argc() > 2 ) {
+		Com_Printf( "Usage: %s [seconds]\n", Cmd_Argv(0) );
+		return;
+	}
+
+	if ( prof.threads[0].count == 0 ) {
+		Com_Printf( "Nothing was recorded, set com_profile to 1 first\n" );
+		return;
+	}
+
+	const int seconds = Cmd_Argc() == 2 ? Com_ClampInt( 1, 3600, atoi( Cmd_Argv(1) ) ) : PROF_DUMP_SECONDS;
+	Prof_WriteTrace( seconds );
+}
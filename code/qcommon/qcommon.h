@@ -26,6 +26,14 @@ Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
 #include "../qcommon/cm_public.h"
 
 
+#if defined(_MSC_VER)
+#include <intrin.h> // for the Sys_Atomic functions
+#define THREAD_LOCAL __declspec( thread )
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+
 //
 // msg.c
 //
@@ -277,16 +285,42 @@ typedef enum {
 	// note that ceil/floor etc have different numbers across VMs
 } sharedTraps_t;
 
+// traps that only read their arguments and write into VM memory
+// the JIT calls their native implementation directly instead of going through the syscall handler
+typedef enum {
+	VMPT_MEMSET,
+	VMPT_MEMCPY,
+	VMPT_STRNCPY,
+	VMPT_SIN,
+	VMPT_COS,
+	VMPT_ATAN2,
+	VMPT_SQRT,
+	VMPT_FLOOR,
+	VMPT_CEIL,
+	VMPT_ACOS,
+	VMPT_MATRIXMULTIPLY,
+	VMPT_ANGLEVECTORS,
+	VMPT_PERPENDICULARVECTOR,
+	VMPT_COUNT
+} vmPureTrapId_t;
+
+typedef struct {
+	int				trap;	// the VM-specific trap number
+	vmPureTrapId_t	id;
+} vmPureTrap_t;
+
 typedef enum {
 	VM_BAD = -1,
 	VM_GAME = 0,
 	VM_CGAME,
 	VM_UI,
+	VM_TEST_INTERPRETED,	// differential testing only
+	VM_TEST_COMPILED,		// differential testing only
 	VM_COUNT
 } vmIndex_t;
 
 void	VM_Init();
-vm_t	*VM_Create( vmIndex_t index, syscall_t systemCalls, vmInterpret_t interpret );
+vm_t	*VM_Create( vmIndex_t index, syscall_t systemCalls, const vmPureTrap_t *pureTraps, int numPureTraps, vmInterpret_t interpret );
 
 void	VM_Free( vm_t *vm );
 void	VM_Clear(void);
@@ -294,7 +328,11 @@ void	VM_Forced_Unload_Start(void);
 void	VM_Forced_Unload_Done(void);
 vm_t	*VM_Restart( vm_t *vm );
 
-intptr_t	QDECL VM_Call( vm_t *vm, int callNum, ... );
+intptr_t	VM_Call0( vm_t *vm, int callNum );
+intptr_t	VM_Call1( vm_t *vm, int callNum, int arg0 );
+intptr_t	VM_Call2( vm_t *vm, int callNum, int arg0, int arg1 );
+intptr_t	VM_Call3( vm_t *vm, int callNum, int arg0, int arg1, int arg2 );
+intptr_t	VM_Call4( vm_t *vm, int callNum, int arg0, int arg1, int arg2, int arg3 );
 
 void	VM_Debug( int level );
 
@@ -687,9 +725,27 @@ int		FS_ReadFilePak( const char *qpath, void **buffer, int *pakChecksum );
 // the buffer should be considered read-only, because it may be cached
 // for other uses.
 
+int		FS_ReadFileAsync( const char *qpath, int *pakChecksum );
+// finds the file right away and has a worker thread read it
+// returns a request handle or 0 when the file isn't present
+
+qbool	FS_IsFileReadDone( int request );
+// qtrue when FS_FinishReadFile won't have to wait for the worker threads
+
+int		FS_FinishReadFile( int request, void **buffer );
+// waits for the request and returns what FS_ReadFilePak would have
+// every request must be finished or cancelled once, a null buffer discards the data
+
+void	FS_CancelReadFile( int request );
+// drops the request without reading it if it wasn't started yet
+
 void	FS_ForceFlush( fileHandle_t f );
 // forces flush on files we're writing to.
 
+FILE*	FS_GetWriteFile( fileHandle_t f );
+// the stdio file of a file opened for writing, for threads that can't use the file system
+// the handle must stay open for as long as the FILE is used
+
 void	FS_FreeFile( void *buffer );
 // frees the memory returned by FS_ReadFile
 
@@ -868,6 +924,8 @@ void		Com_StartupVariable( const char *match );
 extern	cvar_t	*com_developer;
 extern	cvar_t	*com_dedicated;
 extern	cvar_t	*com_speeds;
+extern	cvar_t	*com_profile;
+extern	cvar_t	*com_profileHitch;		// ms, 0 = off
 extern	cvar_t	*com_timescale;
 extern	cvar_t	*com_sv_running;
 extern	cvar_t	*com_cl_running;
@@ -955,6 +1013,40 @@ int Hunk_MemoryRemaining();
 template <class T> T* H_New( ha_pref heap ) { return (T*)Hunk_Alloc(sizeof(T), heap); }
 template <class T> T* H_New( int c, ha_pref heap ) { return static_cast<T*>(Hunk_Alloc(sizeof(T) * c, heap)); }
 
+// who the permanent hunk allocations are charged to in /memjson
+typedef enum {
+	HC_OTHER,
+	HC_COLLISION,
+	HC_BOTLIB,
+	HC_RENDERER,
+	HC_VM,
+	HC_SNAPSHOTS,
+	HC_SOUND,
+	HC_COUNT
+} hunkConsumer_t;
+
+hunkConsumer_t Hunk_SetConsumer( hunkConsumer_t consumer ); // returns the previous one
+
+// for releasing permanent allocations before the next map load without touching the global mark
+typedef struct {
+	int		low;
+	int		high;
+	int		liveBytes[HC_COUNT];	// hunk usage to restore
+	int		liveBlocks[HC_COUNT];
+} hunkMark_t;
+
+void Hunk_GetLocalMark( hunkMark_t* mark );
+void Hunk_ClearToLocalMark( const hunkMark_t* mark );
+
+struct Hunk_ConsumerScope {
+	Hunk_ConsumerScope( hunkConsumer_t consumer ) { previous = Hunk_SetConsumer(consumer); }
+	~Hunk_ConsumerScope() { Hunk_SetConsumer(previous); }
+private:
+	Hunk_ConsumerScope( const Hunk_ConsumerScope& rhs );
+	Hunk_ConsumerScope& operator=( const Hunk_ConsumerScope& rhs );
+	hunkConsumer_t previous;
+};
+
 void Com_TouchMemory();
 
 // commandLine should not include the executable name (argv[0])
@@ -962,6 +1054,10 @@ void Com_Init( char *commandLine );
 void Com_Frame( qbool demoPlayback );
 void Com_Shutdown();
 
+// writes out qconsole.log's pending lines and flushes it
+void Com_FlushLog();
+void Com_FlushLogForCrash(); // doesn't wait for the writer thread
+
 
 /*
 ==============================================================
@@ -1145,6 +1241,50 @@ const char* Sys_DefaultHomePath();
 char**	Sys_ListFiles( const char *directory, const char *extension, const char *filter, int *numfiles, qbool wantsubs );
 void	Sys_FreeFileList( char **list );
 
+// maps the whole file, writes go to private copies of the pages
+// returns NULL on failure
+void*	Sys_MapFile( const char* path, size_t* size );
+void	Sys_UnmapFile( void* data, size_t size );
+int64_t	Sys_GetModificationTime( const char* path ); // 0 when the file or directory doesn't exist
+
+typedef enum {
+	HUGEPAGES_NONE,
+	HUGEPAGES_TRANSPARENT,	// the kernel builds huge pages when it can
+	HUGEPAGES_EXPLICIT,		// reserved huge pages (Linux hugetlbfs, Windows large pages)
+	HUGEPAGES_COUNT
+} hugePages_t;
+
+// zeroed and prefaulted memory for the hunk, never freed
+// falls back to smaller pages when the requested ones aren't available
+// returns NULL on failure
+void*	Sys_AllocHunk( size_t size, hugePages_t requested, hugePages_t* result );
+qbool	Sys_GetFileStats( const char* path, int64_t* size, int64_t* modTime );
+
+// the function can't use the zone, the hunk, cvars, commands or print
+typedef void ( *threadFunc_t )( void* userData );
+void*	Sys_CreateThread( threadFunc_t function, void* userData ); // NULL on failure
+void	Sys_JoinThread( void* thread ); // waits for the thread to finish and frees it
+void*	Sys_CreateMutex(); // NULL on failure
+void	Sys_DestroyMutex( void* mutex );
+void	Sys_LockMutex( void* mutex );
+void	Sys_UnlockMutex( void* mutex );
+void*	Sys_CreateSemaphore(); // starts at 0, NULL on failure
+void	Sys_DestroySemaphore( void* semaphore );
+void	Sys_PostSemaphore( void* semaphore );
+void	Sys_WaitSemaphore( void* semaphore );
+qbool	Sys_WaitSemaphoreTimeout( void* semaphore, int ms ); // qfalse when it timed out
+
+// sequentially consistent, for lock-free data shared between threads
+#if defined(_MSC_VER)
+inline int		Sys_AtomicLoad( volatile int* value ) { return (int)_InterlockedOr( (volatile long*)value, 0 ); }
+inline void		Sys_AtomicStore( volatile int* value, int newValue ) { _InterlockedExchange( (volatile long*)value, (long)newValue ); }
+inline qbool	Sys_AtomicCompareExchange( volatile int* value, int expected, int newValue ) { return _InterlockedCompareExchange( (volatile long*)value, (long)newValue, (long)expected ) == (long)expected; }
+#else
+inline int		Sys_AtomicLoad( volatile int* value ) { return __atomic_load_n( value, __ATOMIC_SEQ_CST ); }
+inline void		Sys_AtomicStore( volatile int* value, int newValue ) { __atomic_store_n( value, newValue, __ATOMIC_SEQ_CST ); }
+inline qbool	Sys_AtomicCompareExchange( volatile int* value, int expected, int newValue ) { return __atomic_compare_exchange_n( value, &expected, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST ) ? qtrue : qfalse; }
+#endif
+
 qbool	Sys_LowPhysicalMemory( void );
 
 qbool	Sys_HardReboot(); // qtrue when the server can restart itself
@@ -1172,6 +1312,25 @@ void Sys_FindQ3APath( void );
 qboolean Sys_LocateQ3APath( void );
 #endif
 
+// prof.cpp - timeline profiler
+extern	int		prof_enabled;
+void	Prof_Init();
+void	Prof_EndFrame( int64_t frameStart );
+void	Prof_RecordScope( const char* name, int64_t start ); // name must be a string literal
+void	Prof_SetThreadName( const char* name ); // name must be a string literal
+void	Prof_ReleaseThread(); // call before a thread that recorded events exits
+void	Prof_Dump_f();
+
+struct Prof_Scope {
+	Prof_Scope( const char* name_ ) : name(name_), start(prof_enabled ? Sys_Microseconds() : 0) {}
+	~Prof_Scope() { if (start != 0) Prof_RecordScope(name, start); }
+private:
+	Prof_Scope( const Prof_Scope& rhs );
+	Prof_Scope& operator=( const Prof_Scope& rhs );
+	const char* name;
+	int64_t start;
+};
+
 // huffman.cpp - id's original code
 // used for out-of-band (OOB) datagrams with dynamically created trees
 void	DynHuff_Compress( msg_t* buf, int offset );
@@ -1695,6 +1695,25 @@ extern int unzGetCurrentFileInfoPosition (unzFile file, unsigned long *pos )
 	return UNZ_OK;
 }
 
+/*
+  Get the position of the local header of the current file in the zip file,
+  including the bytes before the zipfile.
+  return UNZ_OK if there is no problem
+*/
+extern int unzGetCurrentFileLocalHeaderPosition (unzFile file, unsigned long *pos )
+{
+	unz_s* s;	
+
+	if (file==NULL)
+		return UNZ_PARAMERROR;
+	s=(unz_s*)file;
+	if (!s->current_file_ok)
+		return UNZ_PARAMERROR;
+
+	*pos = s->cur_file_info_internal.offset_curfile + s->byte_before_the_zipfile;
+	return UNZ_OK;
+}
+
 /*
   Set the position of the info of the current file in the zip.
   return UNZ_OK if there is no problem
@@ -1950,6 +1969,45 @@ extern int unzOpenCurrentFile (unzFile file)
 }
 
 
+/*
+  Decompress the whole current file with Inflate_Raw when buf can hold it.
+  The compressed data is read with a single fread instead of UNZ_BUFSIZE chunks.
+  return the number of bytes read, or 0 to fall back to the streaming inflate
+*/
+static uInt unzReadCurrentFileAtOnce (file_in_zip_read_info_s* pfile_in_zip_read_info, void *buf)
+{
+	uLong compressedSize = pfile_in_zip_read_info->rest_read_compressed;
+	uLong uncompressedSize = pfile_in_zip_read_info->rest_read_uncompressed;
+	void *src;
+	int ok;
+
+	if (compressedSize == 0 || uncompressedSize == 0)
+		return 0;
+
+	/* not ALLOC: this can be larger than the zone and failing here is fine */
+	src = malloc(compressedSize);
+	if (src == NULL)
+		return 0;
+
+	ok = fseek(pfile_in_zip_read_info->file,
+			   pfile_in_zip_read_info->pos_in_zipfile +
+				 pfile_in_zip_read_info->byte_before_the_zipfile, SEEK_SET) == 0 &&
+		 fread(src, compressedSize, 1, pfile_in_zip_read_info->file) == 1 &&
+		 Inflate_Raw(src, (int)compressedSize, buf, (int)uncompressedSize);
+	free(src);
+
+	/* on failure, rest_read_compressed is untouched and the streaming path seeks back */
+	if (!ok)
+		return 0;
+
+	pfile_in_zip_read_info->pos_in_zipfile += compressedSize;
+	pfile_in_zip_read_info->rest_read_compressed = 0;
+	pfile_in_zip_read_info->rest_read_uncompressed = 0;
+	pfile_in_zip_read_info->stream.total_out += uncompressedSize;
+
+	return (uInt)uncompressedSize;
+}
+
 /*
   Read bytes from the current file.
   buf contain buffer where data must be copied
@@ -1980,6 +2038,16 @@ extern int unzReadCurrentFile  (unzFile file, void *buf, unsigned len)
 	if (len==0)
 		return 0;
 
+	if ((pfile_in_zip_read_info->compression_method!=0) &&
+		(pfile_in_zip_read_info->stream.total_out==0) &&
+		(s->cur_file_info.compressed_size==pfile_in_zip_read_info->rest_read_compressed) &&
+		(len>=pfile_in_zip_read_info->rest_read_uncompressed))
+	{
+		iRead = unzReadCurrentFileAtOnce(pfile_in_zip_read_info, buf);
+		if (iRead > 0)
+			return iRead;
+	}
+
 	pfile_in_zip_read_info->stream.next_out = (Byte*)buf;
 
 	pfile_in_zip_read_info->stream.avail_out = (uInt)len;
@@ -2176,6 +2244,84 @@ extern int unzGetLocalExtrafield (unzFile file,void *buf,unsigned len)
 	return (int)read_now;
 }
 
+/*
+  Locate the data of a file in a memory view of the whole zip file.
+  The first byte of the local header's signature isn't checked because
+  the view's owner may have overwritten it (e.g. to null-terminate the
+  data of the file before it).
+  return UNZ_OK and the data's position in the view if both the local
+  header and the data are inside the view
+*/
+extern int unzLocateFileData (const void *zipData, unsigned long zipSize,
+							  unsigned long localHeaderPos, unsigned long compressedSize,
+							  unsigned long *dataPos)
+{
+	const unsigned char* header;
+	uLong size_filename, size_extra_field, pos;
+
+	if (zipData==NULL || localHeaderPos > zipSize ||
+		zipSize - localHeaderPos < SIZEZIPLOCALHEADER)
+		return UNZ_PARAMERROR;
+
+	header = (const unsigned char*)zipData + localHeaderPos;
+	if (header[1]!=0x4b || header[2]!=0x03 || header[3]!=0x04)
+		return UNZ_BADZIPFILE;
+
+	size_filename = (uLong)header[26] | ((uLong)header[27] << 8);
+	size_extra_field = (uLong)header[28] | ((uLong)header[29] << 8);
+	pos = localHeaderPos + SIZEZIPLOCALHEADER + size_filename + size_extra_field;
+	if (pos > zipSize || zipSize - pos < compressedSize)
+		return UNZ_BADZIPFILE;
+
+	*dataPos = pos;
+	return UNZ_OK;
+}
+
+/*
+  Decompress deflated data that is entirely in memory in a single call.
+  dest must hold exactly destSize bytes, the uncompressed size.
+  return UNZ_OK if destSize bytes were written
+*/
+extern int unzInflateData (const void *src, unsigned long srcSize, void *dest, unsigned long destSize)
+{
+	if (!Inflate_Raw(src, (int)srcSize, dest, (int)destSize))
+		return UNZ_BADZIPFILE;
+
+	return UNZ_OK;
+}
+
+/*
+  Same as unzInflateData but with the streaming inflate used by unzReadCurrentFile.
+  This is the reference decoder for fs_inflatetest.
+*/
+extern int unzInflateDataReference (const void *src, unsigned long srcSize, void *dest, unsigned long destSize)
+{
+	z_stream stream;
+	int err;
+
+	Com_Memset(&stream, 0, sizeof(stream));
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return UNZ_INTERNALERROR;
+
+	stream.next_in = (Byte*)src;
+	stream.avail_in = (uInt)srcSize;
+	stream.next_out = (Byte*)dest;
+	stream.avail_out = (uInt)destSize;
+
+	/* see unzOpenCurrentFile: without a zlib header, the stream may
+	   not report its end, so the uncompressed size is what matters */
+	do {
+		err = inflate(&stream, Z_SYNC_FLUSH);
+	} while (err == Z_OK && stream.avail_out > 0 && stream.avail_in > 0);
+
+	inflateEnd(&stream);
+
+	if ((err != Z_OK && err != Z_STREAM_END) || stream.total_out != destSize)
+		return UNZ_BADZIPFILE;
+
+	return UNZ_OK;
+}
+
 /*
   Close the file in zip opened with unzipOpenCurrentFile
   Return UNZ_CRCERROR if all the file was read but the CRC is not good
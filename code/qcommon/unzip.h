@@ -241,6 +241,13 @@ extern int unzGetCurrentFileInfoPosition (unzFile file, unsigned long *pos );
   return UNZ_OK if there is no problem
 */
 
+extern int unzGetCurrentFileLocalHeaderPosition (unzFile file, unsigned long *pos );
+
+/*
+  Get the position of the local header of the current file in the zip file.
+  return UNZ_OK if there is no problem
+*/
+
 extern int unzSetCurrentFileInfoPosition (unzFile file, unsigned long pos );
 
 /*
@@ -334,3 +341,33 @@ extern int unzGetLocalExtrafield (unzFile file, void* buf, unsigned len);
   the return value is the number of unsigned chars copied in buf, or (if <0) 
 	the error code
 */
+
+extern int unzLocateFileData (const void *zipData, unsigned long zipSize, unsigned long localHeaderPos, unsigned long compressedSize, unsigned long *dataPos);
+
+/*
+  Locate a file's data in a memory view of the whole zip file (e.g. a file mapping)
+  using the local header position and compressed size from the central directory.
+  return UNZ_OK if the local header and the data are inside the view
+*/
+
+extern int unzInflateData (const void *src, unsigned long srcSize, void *dest, unsigned long destSize);
+
+/*
+  Decompress deflated data that is entirely in memory into dest,
+  which is exactly the uncompressed size.
+  return UNZ_OK if all of dest was written
+*/
+
+extern int unzInflateDataReference (const void *src, unsigned long srcSize, void *dest, unsigned long destSize);
+
+/*
+  Same as unzInflateData but with the original streaming inflate.
+*/
+
+qbool Inflate_Raw (const void *src, int srcSize, void *dest, int destSize);
+
+/*
+  inflate.cpp: decompress a raw deflate stream that is entirely in memory
+  into dest, which must be exactly the uncompressed size.
+  return qtrue if the stream was valid and filled all of dest
+*/
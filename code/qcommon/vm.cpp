@@ -119,13 +119,22 @@ opcode_info_t ops[ OP_MAX ] =
 vm_t	*currentVM = NULL;
 vm_t	*lastVM    = NULL;
 
-#define	MAX_VM		3
-vm_t	vmTable[MAX_VM];
+vm_t	vmTable[VM_COUNT];
+
+static char vmTestName[ MAX_QPATH ];
 
 static const char *vmName[ VM_COUNT ] = {
 	"qagame",
 	"cgame",
-	"ui"
+	"ui",
+	vmTestName,
+	vmTestName
+};
+
+
+static const cmdTableItem_t vm_cmds[] =
+{
+	{ "vmtest", VM_Test_f, NULL, "compares and benchmarks the QVM interpreter and compiler" }
 };
 
 
@@ -150,6 +159,8 @@ void VM_Init( void ) {
 #endif
 
 	Com_Memset( vmTable, 0, sizeof( vmTable ) );
+
+	Cmd_RegisterArray( vm_cmds, MODULE_COMMON );
 }
 
 
@@ -866,13 +877,19 @@ vm_t *VM_Restart( vm_t *vm ) {
 	if ( vm->dllHandle ) {
 		char		name[MAX_QPATH];
 		syscall_t	systemCall;
+		const vmPureTrap_t	*pureTraps;
+		int			numPureTraps;
+		vmIndex_t	index;
 
 		systemCall = vm->systemCall;
+		pureTraps = vm->pureTraps;
+		numPureTraps = vm->numPureTraps;
+		index = vm->index;
 		Q_strncpyz( name, vm->name, sizeof( name ) );
 
 		VM_Free( vm );
 
-		vm = VM_Create( vm->index, systemCall, VMI_NATIVE );
+		vm = VM_Create( index, systemCall, pureTraps, numPureTraps, VMI_NATIVE );
 		return vm;
 	}
 
@@ -899,7 +916,7 @@ If image ends in .qvm it will be interpreted, otherwise
 it will attempt to load as a system dll
 ================
 */
-vm_t *VM_Create( vmIndex_t index, syscall_t systemCalls, vmInterpret_t interpret ) {
+vm_t *VM_Create( vmIndex_t index, syscall_t systemCalls, const vmPureTrap_t *pureTraps, int numPureTraps, vmInterpret_t interpret ) {
 	int			remaining;
 	const char	*name;
 	vmHeader_t	*header;
@@ -913,6 +930,7 @@ vm_t *VM_Create( vmIndex_t index, syscall_t systemCalls, vmInterpret_t interpret
 		Com_Error( ERR_FATAL, "VM_Create: bad vm index %i", index );
 	}
 
+	Hunk_ConsumerScope scope( HC_VM );
 	remaining = Hunk_MemoryRemaining();
 
 	vm = &vmTable[ index ];
@@ -931,6 +949,8 @@ vm_t *VM_Create( vmIndex_t index, syscall_t systemCalls, vmInterpret_t interpret
 	vm->name = name;
 	vm->index = index;
 	vm->systemCall = systemCalls;
+	vm->pureTraps = pureTraps;
+	vm->numPureTraps = numPureTraps;
 
 #if !defined( QC ) || 1
 	// never allow dll loading with a demo
@@ -987,6 +1007,7 @@ vm_t *VM_Create( vmIndex_t index, syscall_t systemCalls, vmInterpret_t interpret
 #else
 	if ( interpret >= VMI_COMPILED ) {
 		vm->compiled = qtrue;
+		Prof_Scope profScope( "VM_Compile" );
 		if ( !VM_Compile( vm, header ) ) {
 			FS_FreeFile( header );	// free the original file
 			VM_Free( vm );
@@ -1044,6 +1065,13 @@ void VM_Free( vm_t *vm ) {
 }
 
 
+void VM_PrepareTest( const char *name ) {
+	VM_Free( &vmTable[ VM_TEST_INTERPRETED ] );
+	VM_Free( &vmTable[ VM_TEST_COMPILED ] );
+	Q_strncpyz( vmTestName, name, sizeof( vmTestName ) );
+}
+
+
 void VM_Clear( void ) {
 	int i;
 	for ( i = 0; i < VM_COUNT; i++ ) {
@@ -1086,8 +1114,149 @@ intptr_t VM_ExplicitArgPtr( const vm_t* vm, intptr_t intValue )
 
 /*
 ==============
-VM_Call
+Pure trap implementations
+
+Called directly by the generated code with args pointing to the first argument.
+They must behave exactly like the matching cases of the syscall handlers.
+==============
+*/
+
+static void *VM_NativeArgPtr( const vm_t *vm, int vmPtr )
+{
+	if ( !vmPtr )
+		return NULL;
+
+	return vm->dataBase + ( vmPtr & vm->dataMask );
+}
+
+#define NVMA(x) ((float*)VM_NativeArgPtr(vm, args[x]))
+#define NVMF(x) _vmf(args[x])
+
+
+static int QDECL VM_Native_Memset( const vm_t *vm, const int *args )
+{
+	Com_Memset( VM_NativeArgPtr( vm, args[0] ), args[1], args[2] );
+	return 0;
+}
+
+
+static int QDECL VM_Native_Memcpy( const vm_t *vm, const int *args )
+{
+	Com_Memcpy( VM_NativeArgPtr( vm, args[0] ), VM_NativeArgPtr( vm, args[1] ), args[2] );
+	return 0;
+}
+
+
+static int QDECL VM_Native_Strncpy( const vm_t *vm, const int *args )
+{
+	strncpy( (char*)VM_NativeArgPtr( vm, args[0] ), (const char*)VM_NativeArgPtr( vm, args[1] ), args[2] );
+	return args[0];
+}
+
+
+static int QDECL VM_Native_Sin( const vm_t *vm, const int *args )
+{
+	return PASSFLOAT( sin( NVMF(0) ) );
+}
+
+
+static int QDECL VM_Native_Cos( const vm_t *vm, const int *args )
+{
+	return PASSFLOAT( cos( NVMF(0) ) );
+}
+
+
+static int QDECL VM_Native_Atan2( const vm_t *vm, const int *args )
+{
+	return PASSFLOAT( atan2( NVMF(0), NVMF(1) ) );
+}
+
+
+static int QDECL VM_Native_Sqrt( const vm_t *vm, const int *args )
+{
+	return PASSFLOAT( sqrt( NVMF(0) ) );
+}
+
+
+static int QDECL VM_Native_Floor( const vm_t *vm, const int *args )
+{
+	return PASSFLOAT( floor( NVMF(0) ) );
+}
+
+
+static int QDECL VM_Native_Ceil( const vm_t *vm, const int *args )
+{
+	return PASSFLOAT( ceil( NVMF(0) ) );
+}
+
+
+static int QDECL VM_Native_Acos( const vm_t *vm, const int *args )
+{
+	return PASSFLOAT( Q_acos( NVMF(0) ) );
+}
+
+
+static int QDECL VM_Native_MatrixMultiply( const vm_t *vm, const int *args )
+{
+	MatrixMultiply( (float(*)[3])NVMA(0), (float(*)[3])NVMA(1), (float(*)[3])NVMA(2) );
+	return 0;
+}
+
+
+static int QDECL VM_Native_AngleVectors( const vm_t *vm, const int *args )
+{
+	AngleVectors( NVMA(0), NVMA(1), NVMA(2), NVMA(3) );
+	return 0;
+}
+
+
+static int QDECL VM_Native_PerpendicularVector( const vm_t *vm, const int *args )
+{
+	PerpendicularVector( NVMA(0), NVMA(1) );
+	return 0;
+}
+
+#undef NVMA
+#undef NVMF
+
+
+static const vmNativeTrap_t vmNativeTraps[VMPT_COUNT] = {
+	VM_Native_Memset,
+	VM_Native_Memcpy,
+	VM_Native_Strncpy,
+	VM_Native_Sin,
+	VM_Native_Cos,
+	VM_Native_Atan2,
+	VM_Native_Sqrt,
+	VM_Native_Floor,
+	VM_Native_Ceil,
+	VM_Native_Acos,
+	VM_Native_MatrixMultiply,
+	VM_Native_AngleVectors,
+	VM_Native_PerpendicularVector
+};
+
+
+vmNativeTrap_t VM_FindPureTrap( const vm_t *vm, int trap, vmPureTrapId_t *id )
+{
+	for ( int i = 0; i < vm->numPureTraps; ++i ) {
+		if ( vm->pureTraps[i].trap == trap ) {
+			if ( id )
+				*id = vm->pureTraps[i].id;
+			return vmNativeTraps[vm->pureTraps[i].id];
+		}
+	}
+
+	return NULL;
+}
+
+
+/*
+==============
+VM_Call0 .. VM_Call4
 
+Fixed-arity entry points: the arguments are written straight
+into vmMain's stack frame without any va_list walking.
 
 Upon a system call, the stack will look like:
 
@@ -1108,7 +1277,7 @@ locals from sp
 ==============
 */
 
-intptr_t QDECL VM_Call( vm_t *vm, int callnum, ... )
+static intptr_t VM_CallArgs( vm_t *vm, int numArgs, int *args )
 {
 	if ( !vm ) {
 		Com_Error( ERR_FATAL, "VM_Call with NULL vm" );
@@ -1125,45 +1294,20 @@ intptr_t QDECL VM_Call( vm_t *vm, int callnum, ... )
 	if ( vm->entryPoint )
 	{
 		//rcg010207 -  see dissertation at top of VM_DllSyscall() in this file.
-		int args[VMMAIN_CALL_ARGS-1];
-		va_list ap;
-		va_start( ap, callnum );
-		for ( int i = 0; i < ARRAY_LEN( args ); i++ ) {
-			args[i] = va_arg(ap, int);
-		}
-		va_end(ap);
+		int a[VMMAIN_CALL_ARGS];
+		Com_Memset( a, 0, sizeof( a ) );
+		Com_Memcpy( a, args, ( numArgs + 1 ) * sizeof( int ) );
 
-		r = vm->entryPoint( callnum, args[0], args[1], args[2], args[3],
-			args[4], args[5], args[6], args[7],
-			args[8], args[9], args[10], args[11] );
+		r = vm->entryPoint( a[0], a[1], a[2], a[3], a[4],
+			a[5], a[6], a[7], a[8],
+			a[9], a[10], a[11], a[12] );
 	} else {
-#if id386 && !defined __clang__ // calling convention doesn't need conversion in some cases
-#ifndef NO_VM_COMPILED
-		if ( vm->compiled )
-			r = VM_CallCompiled( vm, (int*)&callnum );
-		else
-#endif
-			r = VM_CallInterpreted2( vm, (int*)&callnum );
-#else
-		struct {
-			int callnum;
-			int args[VMMAIN_CALL_ARGS-1];
-		} a;
-		va_list ap;
-
-		a.callnum = callnum;
-		va_start(ap, callnum);
-		for (int i = 0; i < ARRAY_LEN( a.args ); i++ ) {
-			a.args[i] = va_arg( ap, int );
-		}
-		va_end(ap);
 #ifndef NO_VM_COMPILED
 		if ( vm->compiled )
-			r = VM_CallCompiled( vm, &a.callnum );
+			r = VM_CallCompiled( vm, numArgs, args );
 		else
 #endif
-			r = VM_CallInterpreted2( vm, &a.callnum );
-#endif
+			r = VM_CallInterpreted2( vm, numArgs, args );
 	}
 	--vm->callLevel;
 
@@ -1172,3 +1316,38 @@ intptr_t QDECL VM_Call( vm_t *vm, int callnum, ... )
 	return r;
 }
 
+
+intptr_t VM_Call0( vm_t *vm, int callNum )
+{
+	int args[1] = { callNum };
+	return VM_CallArgs( vm, 0, args );
+}
+
+
+intptr_t VM_Call1( vm_t *vm, int callNum, int arg0 )
+{
+	int args[2] = { callNum, arg0 };
+	return VM_CallArgs( vm, 1, args );
+}
+
+
+intptr_t VM_Call2( vm_t *vm, int callNum, int arg0, int arg1 )
+{
+	int args[3] = { callNum, arg0, arg1 };
+	return VM_CallArgs( vm, 2, args );
+}
+
+
+intptr_t VM_Call3( vm_t *vm, int callNum, int arg0, int arg1, int arg2 )
+{
+	int args[4] = { callNum, arg0, arg1, arg2 };
+	return VM_CallArgs( vm, 3, args );
+}
+
+
+intptr_t VM_Call4( vm_t *vm, int callNum, int arg0, int arg1, int arg2, int arg3 )
+{
+	int args[5] = { callNum, arg0, arg1, arg2, arg3 };
+	return VM_CallArgs( vm, 4, args );
+}
+
@@ -177,7 +177,7 @@ an OP_ENTER instruction, which will subtract space for
 locals from sp
 ==============
 */
-int	VM_CallInterpreted2( vm_t *vm, int *args ) {
+int	VM_CallInterpreted2( vm_t *vm, int numArgs, int *args ) {
 	typedef union floatint_u {
 		int i;
 		unsigned int u;
@@ -218,9 +218,12 @@ int	VM_CallInterpreted2( vm_t *vm, int *args ) {
 
 	programStack -= 8 + (VMMAIN_CALL_ARGS*4);
 	img = (int*)&image[ programStack ];
-	for ( i = 0; i < VMMAIN_CALL_ARGS; i++ ) {
+	for ( i = 0; i <= numArgs; i++ ) {
 		img[ i + 2 ] = args[ i ];
 	}
+	for ( ; i < VMMAIN_CALL_ARGS; i++ ) {
+		img[ i + 2 ] = 0;
+	}
 	img[ 1 ] = 0; 	// return stack
 	img[ 0 ] = -1;	// will terminate the loop on return
 
@@ -204,6 +204,9 @@ struct vm_s {
 
 	vmIndex_t	index;
 
+	const vmPureTrap_t	*pureTraps;
+	int			numPureTraps;
+
 	int			callStackDepth;
 	int			lastCallStackDepth;
 	int			callStackDepthTemp; // only for vm_x86.cpp
@@ -227,11 +230,12 @@ typedef struct {
 	int		bssLength;			// zero filled memory appended to datalength
 } vmHeader_t;
 
+// args[0] is the vmMain command, followed by numArgs arguments
 qboolean VM_Compile( vm_t *vm, vmHeader_t *header );
-int	VM_CallCompiled( vm_t *vm, int *args );
+int	VM_CallCompiled( vm_t *vm, int numArgs, int *args );
 
 qboolean VM_PrepareInterpreter2( vm_t *vm, vmHeader_t *header );
-int	VM_CallInterpreted2( vm_t *vm, int *args );
+int	VM_CallInterpreted2( vm_t *vm, int numArgs, int *args );
 
 const char *VM_LoadInstructions( const vmHeader_t *header, instruction_t *buf );
 const char *VM_CheckInstructions( instruction_t *buf, int instructionCount, 
@@ -239,6 +243,18 @@ const char *VM_CheckInstructions( instruction_t *buf, int instructionCount,
 								 int numJumpTableTargets, 
 								 int dataLength );
 
+// args[0] is the trap's first argument
+typedef int (QDECL *vmNativeTrap_t)( const vm_t *vm, const int *args );
+
+vmNativeTrap_t VM_FindPureTrap( const vm_t *vm, int trap, vmPureTrapId_t *id );
+
+// frees the test VMs and sets the name of the QVM they load
+void VM_PrepareTest( const char *name );
+
+// vm_test.cpp
+int VM_Test_Run( const char* name, int iterations ); // returns the failure count or -1
+void VM_Test_f();
+
 intptr_t VM_ArgPtr( intptr_t intValue );
 intptr_t VM_ExplicitArgPtr( const vm_t* vm, intptr_t intValue );
 
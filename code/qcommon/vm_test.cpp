@@ -0,0 +1,409 @@
+/*
+===========================================================================
+Copyright (C) 2024 Gian 'myT' Schellenbaum
+
+This file is part of Challenge Quake 3 (CNQ3).
+
+Challenge Quake 3 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Challenge Quake 3 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Challenge Quake 3. If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+// differential testing and benchmarking of the QVM interpreter and compiler
+
+#include "vm_local.h"
+#include <setjmp.h>
+
+
+/*
+The test QVMs are built from code/tools/vmtest, which also builds this harness as a standalone program.
+vm/<name>.qvm is loaded twice, once per backend, and vm/<name>.calls lists the vmMain calls to make:
+
+// comment
+<label> <command> [arg0] [arg1] ...
+
+Every call is first made once on both VMs to compare the return values and the data segments.
+Every call is then timed separately on each VM.
+The results and data hashes are listed with the timings, so builds of the same QVM can be compared.
+An error raised by a test VM ends the test and is reported as a failure.
+*/
+
+
+// must match code/tools/vmtest/vmtest_syscalls.asm
+typedef enum {
+	VMT_PRINT,
+	VMT_ERROR,
+	VMT_MILLISECONDS,
+
+	VMT_MEMSET = 100,
+	VMT_MEMCPY,
+	VMT_STRNCPY,
+	VMT_SIN,
+	VMT_COS,
+	VMT_ATAN2,
+	VMT_SQRT,
+	VMT_FLOOR,
+	VMT_CEIL,
+	VMT_ACOS
+} vmTestImport_t;
+
+
+#define MAX_TEST_CALLS	64
+
+
+typedef struct {
+	char	label[32];
+	int		numArgs;
+	int		args[VMMAIN_CALL_ARGS];	// args[0] is the vmMain command
+	int		result;					// of the interpreter's first call
+	unsigned int	dataHash;		// of the interpreter's data segment after the first call
+} vmTestCall_t;
+
+
+static const vmPureTrap_t vmTestPureTraps[] = {
+	{ VMT_MEMSET, VMPT_MEMSET },
+	{ VMT_MEMCPY, VMPT_MEMCPY },
+	{ VMT_STRNCPY, VMPT_STRNCPY },
+	{ VMT_SIN, VMPT_SIN },
+	{ VMT_COS, VMPT_COS },
+	{ VMT_ATAN2, VMPT_ATAN2 },
+	{ VMT_SQRT, VMPT_SQRT },
+	{ VMT_FLOOR, VMPT_FLOOR },
+	{ VMT_CEIL, VMPT_CEIL },
+	{ VMT_ACOS, VMPT_ACOS }
+};
+
+
+// the test VMs only deal with strings and raw memory
+#define VMTA(x) ((char*)VM_ArgPtr(args[x]))
+
+
+static qbool vmt_quiet;	// drops the prints of the test VMs while benchmarking
+static vm_t* vmt_interpreted;
+static vm_t* vmt_compiled;
+static vm_t* vmt_callerVM;	// currentVM when /vmtest was called
+static hunkMark_t vmt_hunkMark;
+static jmp_buf vmt_abortFrame;	// set around every call into the test VMs
+static char vmt_error[MAXPRINTMSG];
+static byte* vmt_initialData;	// data segment as loaded, shared by both test VMs
+
+
+// the data segments and symbols of both test VMs live on the hunk
+static void VM_Test_Release()
+{
+	VM_Free( vmt_interpreted );
+	VM_Free( vmt_compiled );
+	vmt_interpreted = NULL;
+	vmt_compiled = NULL;
+	Hunk_ClearToLocalMark( &vmt_hunkMark );
+
+	// VM_Free cleared it
+	currentVM = vmt_callerVM;
+}
+
+
+// Com_Error would drop the game that is running, so only the current test call is abandoned
+static void VM_Test_Error( const char* message )
+{
+	Q_strncpyz( vmt_error, message, sizeof( vmt_error ) );
+	longjmp( vmt_abortFrame, 1 );
+}
+
+
+static intptr_t VM_Test_SystemCalls( intptr_t *args )
+{
+	switch( args[0] ) {
+	case VMT_PRINT:
+		if ( !vmt_quiet )
+			Com_Printf( "%s", VMTA(1) );
+		return 0;
+	case VMT_ERROR:
+		VM_Test_Error( VMTA(1) );
+		return 0;
+	case VMT_MILLISECONDS:
+		// must be deterministic for both VMs to agree
+		return 0;
+
+	case VMT_MEMSET:
+		Com_Memset( VMTA(1), args[2], args[3] );
+		return 0;
+	case VMT_MEMCPY:
+		Com_Memcpy( VMTA(1), VMTA(2), args[3] );
+		return 0;
+	case VMT_STRNCPY:
+		strncpy( VMTA(1), VMTA(2), args[3] );
+		return args[1];
+	case VMT_SIN:
+		return PASSFLOAT( sin( VMF(1) ) );
+	case VMT_COS:
+		return PASSFLOAT( cos( VMF(1) ) );
+	case VMT_ATAN2:
+		return PASSFLOAT( atan2( VMF(1), VMF(2) ) );
+	case VMT_SQRT:
+		return PASSFLOAT( sqrt( VMF(1) ) );
+	case VMT_FLOOR:
+		return PASSFLOAT( floor( VMF(1) ) );
+	case VMT_CEIL:
+		return PASSFLOAT( ceil( VMF(1) ) );
+	case VMT_ACOS:
+		return PASSFLOAT( Q_acos( VMF(1) ) );
+
+	default:
+		VM_Test_Error( va( "Bad test VM system trap: %ld", (long int)args[0] ) );
+	}
+
+	return -1;
+}
+
+
+static int VM_Test_ParseCalls( const char* fileName, vmTestCall_t* calls )
+{
+	char* text;
+	if ( FS_ReadFile( fileName, (void**)&text ) <= 0 ) {
+		Com_Printf( "ERROR: couldn't load %s\n", fileName );
+		return 0;
+	}
+
+	int numCalls = 0;
+	const char* p = text;
+	for ( ;; ) {
+		const char* token = COM_ParseExt( &p, qtrue );
+		if ( !token[0] )
+			break;
+
+		if ( numCalls >= MAX_TEST_CALLS ) {
+			Com_Printf( "WARNING: %s has more than %d calls\n", fileName, MAX_TEST_CALLS );
+			break;
+		}
+
+		vmTestCall_t* const call = &calls[numCalls];
+		Com_Memset( call, 0, sizeof( *call ) );
+		Q_strncpyz( call->label, token, sizeof( call->label ) );
+		call->numArgs = -1;
+		for ( ;; ) {
+			token = COM_ParseExt( &p, qfalse );
+			if ( !token[0] )
+				break;
+			if ( call->numArgs + 1 >= VMMAIN_CALL_ARGS ) {
+				Com_Printf( "WARNING: too many arguments for call '%s'\n", call->label );
+				continue;
+			}
+			call->args[++call->numArgs] = atoi( token );
+		}
+
+		if ( call->numArgs < 0 ) {
+			Com_Printf( "WARNING: call '%s' has no vmMain command\n", call->label );
+			continue;
+		}
+
+		numCalls++;
+	}
+
+	FS_FreeFile( text );
+
+	return numCalls;
+}
+
+
+// only hashes what changed since the QVM was loaded, so that builds of the same code
+// can be compared even though their jump tables have different instruction numbers
+// the stack is excluded because the backends don't leave the same garbage in it
+static unsigned int VM_Test_DataHash( const vm_t* vm )
+{
+	byte block[1024];
+	unsigned int crc32;
+	CRC32_Begin( &crc32 );
+	for ( int offset = 0; offset < vm->stackBottom; offset += sizeof( block ) ) {
+		const int size = min( (int)sizeof( block ), vm->stackBottom - offset );
+		for ( int i = 0; i < size; ++i ) {
+			block[i] = vm->dataBase[offset + i] ^ vmt_initialData[offset + i];
+		}
+		CRC32_ProcessBlock( &crc32, block, size );
+	}
+	CRC32_End( &crc32 );
+
+	return crc32;
+}
+
+
+static int VM_Test_FirstDataDifference( const vm_t* vm1, const vm_t* vm2 )
+{
+	for ( int i = 0; i < vm1->stackBottom; ++i ) {
+		if ( vm1->dataBase[i] != vm2->dataBase[i] )
+			return i;
+	}
+
+	return -1;
+}
+
+
+static int VM_Test_Call( vm_t* vm, const vmTestCall_t* call )
+{
+	int args[VMMAIN_CALL_ARGS];
+	Com_Memcpy( args, call->args, sizeof( args ) );
+
+	currentVM = vm;
+	++vm->callLevel;
+	const int result = vm->compiled ? VM_CallCompiled( vm, call->numArgs, args ) : VM_CallInterpreted2( vm, call->numArgs, args );
+	--vm->callLevel;
+	currentVM = vmt_callerVM;
+
+	return result;
+}
+
+
+// the longjmp skipped the end of VM_Test_Call
+static void VM_Test_ReportError( vm_t* vm, const vmTestCall_t* call )
+{
+	--vm->callLevel;
+	currentVM = vmt_callerVM;
+	Com_Printf( S_COLOR_RED "%s: %s VM error: %s\n", call->label, vm->compiled ? "compiled" : "interpreted", vmt_error );
+}
+
+
+static qbool VM_Test_SafeCall( vm_t* vm, const vmTestCall_t* call, int* result )
+{
+	if ( setjmp( vmt_abortFrame ) ) {
+		VM_Test_ReportError( vm, call );
+		return qfalse;
+	}
+
+	*result = VM_Test_Call( vm, call );
+
+	return qtrue;
+}
+
+
+static qbool VM_Test_Benchmark( vm_t* vm, const vmTestCall_t* call, int iterations, double* nsPerCall )
+{
+	if ( setjmp( vmt_abortFrame ) ) {
+		VM_Test_ReportError( vm, call );
+		return qfalse;
+	}
+
+	const int64_t start = Sys_Microseconds();
+	for ( int i = 0; i < iterations; ++i ) {
+		VM_Test_Call( vm, call );
+	}
+	const int64_t end = Sys_Microseconds();
+	*nsPerCall = (double)( end - start ) * 1000.0 / (double)iterations;
+
+	return qtrue;
+}
+
+
+// returns qfalse when a test VM raised an error
+static qbool VM_Test_CompareCalls( vm_t* vmi, vm_t* vmc, vmTestCall_t* calls, int numCalls, int* failures )
+{
+	for ( int i = 0; i < numCalls; ++i ) {
+		vmTestCall_t* const call = &calls[i];
+		int ri, rc;
+		if ( !VM_Test_SafeCall( vmi, call, &ri ) || !VM_Test_SafeCall( vmc, call, &rc ) ) {
+			(*failures)++;
+			return qfalse;
+		}
+		const unsigned int hi = VM_Test_DataHash( vmi );
+		const unsigned int hc = VM_Test_DataHash( vmc );
+		call->result = ri;
+		call->dataHash = hi;
+		if ( ri != rc ) {
+			Com_Printf( S_COLOR_RED "%s: result mismatch: %d (interpreted) != %d (compiled)\n", call->label, ri, rc );
+			(*failures)++;
+		}
+		if ( hi != hc ) {
+			Com_Printf( S_COLOR_RED "%s: data mismatch: %08X != %08X, first difference at offset %d\n",
+				call->label, hi, hc, VM_Test_FirstDataDifference( vmi, vmc ) );
+			(*failures)++;
+		}
+	}
+
+	return qtrue;
+}
+
+
+static void VM_Test_BenchmarkCalls( vm_t* vmi, vm_t* vmc, const vmTestCall_t* calls, int numCalls, int iterations, int* failures )
+{
+	Com_Printf( "%-24s %11s %8s %14s %14s %8s\n", "call", "result", "data", "interp ns/call", "jit ns/call", "speed-up" );
+	vmt_quiet = qtrue;
+	for ( int i = 0; i < numCalls; ++i ) {
+		const vmTestCall_t* const call = &calls[i];
+		double ti, tc;
+		if ( !VM_Test_Benchmark( vmi, call, iterations, &ti ) || !VM_Test_Benchmark( vmc, call, iterations, &tc ) ) {
+			vmt_quiet = qfalse;
+			(*failures)++;
+			return;
+		}
+		Com_Printf( "%-24s %11d %08X %14.1f %14.1f %7.2fx\n", call->label, call->result, call->dataHash, ti, tc, tc > 0.0 ? ti / tc : 0.0 );
+	}
+	vmt_quiet = qfalse;
+
+	if ( VM_Test_DataHash( vmi ) != VM_Test_DataHash( vmc ) ) {
+		Com_Printf( S_COLOR_RED "data mismatch after the benchmarks\n" );
+		(*failures)++;
+	}
+}
+
+
+int VM_Test_Run( const char* name, int iterations )
+{
+#ifdef NO_VM_COMPILED
+	Com_Printf( "ERROR: this architecture doesn't have a bytecode compiler\n" );
+	return -1;
+#else
+	static vmTestCall_t calls[MAX_TEST_CALLS];
+	const int numCalls = VM_Test_ParseCalls( va( "vm/%s.calls", name ), calls );
+	if ( numCalls <= 0 )
+		return -1;
+
+	VM_PrepareTest( name );
+	vmt_callerVM = currentVM;
+	Hunk_GetLocalMark( &vmt_hunkMark );
+	vmt_interpreted = VM_Create( VM_TEST_INTERPRETED, VM_Test_SystemCalls, vmTestPureTraps, ARRAY_LEN( vmTestPureTraps ), VMI_BYTECODE );
+	vmt_compiled = VM_Create( VM_TEST_COMPILED, VM_Test_SystemCalls, vmTestPureTraps, ARRAY_LEN( vmTestPureTraps ), VMI_COMPILED );
+	vm_t* const vmi = vmt_interpreted;
+	vm_t* const vmc = vmt_compiled;
+	if ( !vmi || !vmc || !vmc->compiled ) {
+		Com_Printf( "ERROR: failed to create both test VMs\n" );
+		VM_Test_Release();
+		return -1;
+	}
+
+	// released with the test VMs
+	vmt_initialData = (byte*)Hunk_Alloc( vmi->stackBottom, h_high );
+	Com_Memcpy( vmt_initialData, vmi->dataBase, vmi->stackBottom );
+
+	int failures = 0;
+	if ( VM_Test_CompareCalls( vmi, vmc, calls, numCalls, &failures ) )
+		VM_Test_BenchmarkCalls( vmi, vmc, calls, numCalls, iterations, &failures );
+
+	if ( failures )
+		Com_Printf( S_COLOR_RED "%s: %d failure(s)\n", name, failures );
+	else
+		Com_Printf( S_COLOR_GREEN "%s: all %d calls match\n", name, numCalls );
+
+	VM_Test_Release();
+
+	return failures;
+#endif
+}
+
+
+void VM_Test_f()
+{
+	if ( Cmd_Argc() < 2 ) {
+		Com_Printf( "usage: %s <qvmname> [iterations]\n", Cmd_Argv(0) );
+		return;
+	}
+
+	const int iterations = Cmd_Argc() >= 3 ? max( atoi( Cmd_Argv(2) ), 1 ) : 1000;
+	VM_Test_Run( Cmd_Argv(1), iterations );
+}
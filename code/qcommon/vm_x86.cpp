@@ -150,6 +150,7 @@ typedef enum
 	FUNC_ENTR = 0,
 	FUNC_CALL,
 	FUNC_SYSC,
+	FUNC_NATC,
 	FUNC_BCPY,
 	FUNC_PSOF,
 	FUNC_OSOF,
@@ -792,6 +793,92 @@ funcOffset[FUNC_SYSC] = compiledOfs;
 }
 
 
+/*
+=================
+EmitNativeCallFunc
+
+Calls the pure trap implementation whose address is in eax
+with the VM and a pointer to the trap's arguments
+and pushes the return value on the opStack.
+No need to update vm->programStack since pure traps never re-enter the VM.
+=================
+*/
+static void EmitNativeCallFunc(vm_t *vm)
+{
+#if idx64
+	// allocate stack for shadow(win32)+saved registers
+	EmitString( "48 81 EC" );				// sub rsp, SHADOW_BASE+PUSH_STACK
+	Emit4( SHADOW_BASE + PUSH_STACK );
+
+	// save scratch registers
+	EmitString( "48 8D 54 24" );			// lea rdx, [rsp+SHADOW_BASE]
+	Emit1( SHADOW_BASE );
+	EmitString( "48 89 32" );				// mov [rdx+00], rsi
+	EmitString( "48 89 7A 08" );			// mov [rdx+08], rdi
+	EmitString( "4C 89 42 10" );			// mov [rdx+16], r8
+	EmitString( "4C 89 4A 18" );			// mov [rdx+24], r9
+
+#ifdef _WIN32
+	EmitString( "48 B9" );					// mov rcx, vm
+	EmitPtr( vm );
+	EmitString( "48 8D 55 08" );			// lea rdx, [rbp+8]
+#else // linux/*BSD ABI
+	EmitString( "48 BF" );					// mov rdi, vm
+	EmitPtr( vm );
+	EmitString( "48 8D 75 08" );			// lea rsi, [rbp+8]
+#endif
+
+	EmitString( "FF D0" );					// call rax
+
+	// restore registers
+	EmitString( "48 8D 54 24" );			// lea rdx, [rsp+SHADOW_BASE]
+	Emit1( SHADOW_BASE );
+	EmitString( "48 8B 32" );				// mov rsi, [rdx+00]
+	EmitString( "48 8B 7A 08" );			// mov rdi, [rdx+08]
+	EmitString( "4C 8B 42 10" );			// mov r8,  [rdx+16]
+	EmitString( "4C 8B 4A 18" );			// mov r9,  [rdx+24]
+
+	// we added the return value: *(opstack+1) = eax
+	EmitAddEDI4( vm );						// add edi, 4
+	EmitCommand( LAST_COMMAND_MOV_EDI_EAX );// mov [edi], eax
+
+	// return stack
+	EmitString( "48 81 C4" );				// add rsp, SHADOW_BASE+PUSH_STACK
+	Emit4( SHADOW_BASE + PUSH_STACK );
+
+	EmitString( "C3" );						// ret
+
+#else // i386
+
+	// args = (int *)((byte *)currentVM->dataBase + programStack + 8);
+	EmitString( "8D 4D 08" );				// lea ecx, [ebp+8]
+
+	// function prologue
+	EmitString( "55" );						// push ebp
+	EmitRexString( "89 E5" );				// mov ebp, esp
+	EmitRexString( "83 EC 08" );			// sub esp, 8
+	// align stack before call
+	EmitRexString( "83 E4 F0" );			// and esp, -16
+
+	// cdecl - set params
+	EmitString( "C7 04 24" );				// mov dword ptr [esp], vm
+	EmitPtr( vm );
+	EmitString( "89 4C 24 04" );			// mov [esp+4], ecx
+
+	EmitString( "FF D0" );					// call eax
+
+	// we added the return value: *(opstack+1) = eax
+	EmitString( "89 47 04" );				// mov [edi+4], eax
+	EmitAddEDI4( vm );						// add edi, 4
+
+	// function epilogue
+	EmitRexString( "89 EC" );				// mov esp, ebp
+	EmitString( "5D" );						// pop ebp
+	EmitString( "C3" );						// ret
+#endif
+}
+
+
 static void EmitBCPYFunc(vm_t *vm)
 {
 	// FIXME: range check
@@ -863,24 +950,6 @@ static void EmitDATAFunc(vm_t *vm)
 }
 
 
-static qbool IsFloorTrap(vm_t *vm, int trap)
-{
-	if ( vm->index == VM_CGAME || vm->index == VM_UI )
-		return trap == ~107;
-
-	return trap == ~110; // VM_GAME
-}
-
-
-static qbool IsCeilTrap(vm_t *vm, int trap)
-{
-	if ( vm->index == VM_CGAME || vm->index == VM_UI )
-		return trap == ~108;
-
-	return trap == ~111; // VM_GAME
-}
-
-
 /*
 =================
 ConstOptimize
@@ -1125,6 +1194,29 @@ static qboolean ConstOptimize(vm_t *vm)
 #endif
 		v = ci->value;
 		// try to inline some syscalls
+		if ( v < 0 ) {
+			vmPureTrapId_t pureTrap = VMPT_COUNT;
+			const vmNativeTrap_t nativeTrap = VM_FindPureTrap( vm, ~v, &pureTrap );
+			if ( ( pureTrap == VMPT_FLOOR || pureTrap == VMPT_CEIL ) && ( cpu_features & CPU_SSE41 ) != 0 ) {
+				EmitString( "f3 0f 10 45 08" );		// movss xmm0, dword ptr [ebp + 8]
+				EmitAddEDI4( vm );
+				if ( pureTrap == VMPT_FLOOR )
+					EmitString( "66 0f 3a 0a c0 01" );	// roundss xmm0, xmm0, 1 (exceptions not masked)
+				else
+					EmitString( "66 0f 3a 0a c0 02" );	// roundss xmm0, xmm0, 2 (exceptions not masked)
+				EmitCommand( LAST_COMMAND_STORE_FLOAT_EDI );
+				ip += 1;
+				return qtrue;
+			} else if ( nativeTrap != NULL && pureTrap != VMPT_SQRT ) {
+				EmitRexString( "B8" );		// mov eax, nativeTrap
+				EmitPtr( (const void*)nativeTrap );
+				EmitCallOffset( FUNC_NATC );
+				LastCommand = LAST_COMMAND_MOV_EAX_EDI_CALL;
+				ip += 1; // OP_CALL
+				return qtrue;
+			}
+		}
+
 		if ( v == ~TRAP_SQRT ) {
 			EmitString( "f3 0f 10 45 08" );		// movss xmm0, dword ptr [ebp + 8]
 			EmitAddEDI4( vm );
@@ -1132,20 +1224,6 @@ static qboolean ConstOptimize(vm_t *vm)
 			EmitCommand( LAST_COMMAND_STORE_FLOAT_EDI );
 			ip += 1;
 			return qtrue;
-		} else if ( IsFloorTrap( vm, v ) && ( cpu_features & CPU_SSE41 ) != 0 ) {
-			EmitString( "f3 0f 10 45 08" );		// movss xmm0, dword ptr [ebp + 8]
-			EmitAddEDI4( vm );
-			EmitString( "66 0f 3a 0a c0 01" );	// roundss xmm0, xmm0, 1 (exceptions not masked)
-			EmitCommand( LAST_COMMAND_STORE_FLOAT_EDI );
-			ip += 1;
-			return qtrue;
-		} else if ( IsCeilTrap( vm, v ) && ( cpu_features & CPU_SSE41 ) != 0 ) {
-			EmitString( "f3 0f 10 45 08" );		// movss xmm0, dword ptr [ebp + 8]
-			EmitAddEDI4( vm );
-			EmitString( "66 0f 3a 0a c0 02" );	// roundss xmm0, xmm0, 2 (exceptions not masked)
-			EmitCommand( LAST_COMMAND_STORE_FLOAT_EDI );
-			ip += 1;
-			return qtrue;
 		}
 
 		if ( v < 0 ) // syscall
@@ -2154,6 +2232,10 @@ __compile:
 		funcOffset[FUNC_CALL] = compiledOfs;
 		EmitCallFunc( vm );
 
+		EmitAlign( 4 );
+		funcOffset[FUNC_NATC] = compiledOfs;
+		EmitNativeCallFunc( vm );
+
 		EmitAlign( 4 );
 		funcOffset[FUNC_BCPY] = compiledOfs;
 		EmitBCPYFunc( vm );
@@ -2298,7 +2380,7 @@ VM_CallCompiled
 This function is called directly by the generated code
 ==============
 */
-int	VM_CallCompiled( vm_t *vm, int *args )
+int	VM_CallCompiled( vm_t *vm, int numArgs, int *args )
 {
 	int		opStack[MAX_OPSTACK_SIZE];
 	int		stackOnEntry;
@@ -2317,9 +2399,12 @@ int	VM_CallCompiled( vm_t *vm, int *args )
 
 	// set up the stack frame
 	image = (int*)( vm->dataBase + vm->programStack );
-	for ( i = 0; i < VMMAIN_CALL_ARGS; i++ ) {
+	for ( i = 0; i <= numArgs; i++ ) {
 		image[ i + 2 ] = args[ i ];
 	}
+	for ( ; i < VMMAIN_CALL_ARGS; i++ ) {
+		image[ i + 2 ] = 0;
+	}
 	image[1] =  0;	// return stack
 	image[0] = -1;	// will terminate loop on return
 
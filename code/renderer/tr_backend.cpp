@@ -633,6 +633,7 @@ static const void* RB_SwapBuffers( const void* data )
 
 void RB_ExecuteRenderCommands( const void *data )
 {
+	Prof_Scope profScope( "RB_ExecuteRenderCommands" );
 	startTime = ri.Microseconds();
 
 	while ( 1 ) {
@@ -1609,6 +1609,7 @@ qbool R_GetEntityToken( char* buffer, int size )
 
 void RE_LoadWorldMap( const char* name )
 {
+	Prof_Scope profScope( "RE_LoadWorldMap" );
 	int i;
 
 	if ( tr.worldMapLoaded )
@@ -1632,21 +1633,24 @@ void RE_LoadWorldMap( const char* name )
 	Q_strncpyz( s_worldData.baseName, COM_SkipPath( s_worldData.name ), sizeof( s_worldData.name ) );
 	COM_StripExtension(s_worldData.baseName, s_worldData.baseName, sizeof(s_worldData.baseName));
 
-	dheader_t* header = (dheader_t*)buffer;
-	fileBase = (byte*)header;
+	fileBase = buffer;
 
-	i = LittleLong(header->version);
-	if ( i != BSP_VERSION )
-		ri.Error( ERR_DROP, "RE_LoadWorldMap: %s has wrong version number (%i should be %i)", name, i, BSP_VERSION );
-
-	// swap all the lumps
+	// the file can be mapped in place and shared with the collision code, so we swap a copy
+	dheader_t fileHeader = *(dheader_t*)buffer;
 	for (i=0 ; i<sizeof(dheader_t)/4 ; i++) {
-		((int *)header)[i] = LittleLong ( ((int *)header)[i]);
+		((int *)&fileHeader)[i] = LittleLong ( ((int *)&fileHeader)[i]);
 	}
+	const dheader_t* const header = &fileHeader;
+
+	if ( header->version != BSP_VERSION )
+		ri.Error( ERR_DROP, "RE_LoadWorldMap: %s has wrong version number (%i should be %i)", name, header->version, BSP_VERSION );
 
 	byte* startMarker = (byte*)ri.Hunk_Alloc( 0, h_low );
 
 	R_LoadShaders( &header->lumps[LUMP_SHADERS] );
+	R_ClearPrefetchedImages();
+	for ( i = 0; i < s_worldData.numShaders; ++i )
+		R_PrefetchShaderImages( s_worldData.shaders[i].shader );
 	R_LoadLightmaps( &header->lumps[LUMP_LIGHTMAPS] );
 	R_LoadPlanes (&header->lumps[LUMP_PLANES]);
 	R_LoadFogs( &header->lumps[LUMP_FOGS], &header->lumps[LUMP_BRUSHES], &header->lumps[LUMP_BRUSHSIDES] );
@@ -1665,6 +1669,8 @@ void RE_LoadWorldMap( const char* name )
 
 	ri.FS_FreeFile( buffer );
 
+	R_ClearPrefetchedImages();
+
 	// invertedpenguin: replace the blood pool behind the RA because it severely impedes legibility
 	// (yes, r_mapGreyscale can be an effective work-around)
 	if ( pakChecksum == 1472072794 &&
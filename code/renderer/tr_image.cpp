@@ -786,6 +786,92 @@ static const imageLoader_t imageLoaders[] = {
 };
 
 
+// files requested ahead of time by R_PrefetchImage
+
+#define MAX_PREFETCHED_IMAGES 1024
+
+typedef struct {
+	char	name[MAX_QPATH];		// as passed to R_FindImageFile
+	char	fileName[MAX_QPATH];	// what was found
+	int		request;
+	int		pakChecksum;
+} prefetchedImage_t;
+
+static prefetchedImage_t s_prefetchedImages[MAX_PREFETCHED_IMAGES];
+static int s_numPrefetchedImages;
+
+
+static const prefetchedImage_t* R_FindPrefetchedImage( const char* name )
+{
+	for ( int i = 0; i < s_numPrefetchedImages; ++i ) {
+		if ( s_prefetchedImages[i].request != 0 && !Q_stricmp( s_prefetchedImages[i].name, name ) )
+			return &s_prefetchedImages[i];
+	}
+
+	return NULL;
+}
+
+
+static qbool R_IsImageLoaded( const char* name )
+{
+	const int hash = Q_FileHash( name, IMAGE_HASH_SIZE );
+	for ( const image_t* image = hashTable[hash]; image; image = image->next ) {
+		if ( !strcmp( name, image->name ) )
+			return qtrue;
+	}
+
+	return qfalse;
+}
+
+
+// has the file system start reading the image the same way R_LoadImage would find it
+
+void R_PrefetchImage( const char* name )
+{
+	if ( s_numPrefetchedImages >= MAX_PREFETCHED_IMAGES || strlen( name ) >= MAX_QPATH )
+		return;
+
+	if ( R_IsImageLoaded( name ) || R_FindPrefetchedImage( name ) )
+		return;
+
+	prefetchedImage_t* const prefetch = &s_prefetchedImages[s_numPrefetchedImages];
+	Q_strncpyz( prefetch->fileName, name, sizeof(prefetch->fileName) );
+	prefetch->request = ri.FS_ReadFileAsync( prefetch->fileName, &prefetch->pakChecksum );
+	if ( prefetch->request == 0 ) {
+		const char* lastDot = strrchr( name, '.' );
+		const int nameLength = lastDot != NULL ? (int)(lastDot - name) : (int)strlen( name );
+
+		for ( int i = 0; i < ARRAY_LEN( imageLoaders ); ++i ) {
+			memcpy( prefetch->fileName, name, nameLength );
+			prefetch->fileName[nameLength] = '\0';
+			Q_strcat( prefetch->fileName, sizeof(prefetch->fileName), imageLoaders[i].extension );
+			prefetch->request = ri.FS_ReadFileAsync( prefetch->fileName, &prefetch->pakChecksum );
+			if ( prefetch->request != 0 )
+				break;
+		}
+
+		if ( prefetch->request == 0 )
+			return;
+	}
+
+	Q_strncpyz( prefetch->name, name, sizeof(prefetch->name) );
+	s_numPrefetchedImages++;
+}
+
+
+// discards whatever wasn't used
+
+void R_ClearPrefetchedImages()
+{
+	for ( int i = 0; i < s_numPrefetchedImages; ++i ) {
+		if ( s_prefetchedImages[i].request != 0 )
+			ri.FS_CancelReadFile( s_prefetchedImages[i].request );
+	}
+
+	s_numPrefetchedImages = 0;
+}
+
+
 static void R_LoadImage( int* pakChecksum, const char* name, byte** pic, int* w, int* h, textureFormat_t* format )
 {
 	*pic = NULL;
@@ -795,8 +881,21 @@ static void R_LoadImage( int* pakChecksum, const char* name, byte** pic, int* w,
 	const int loaderCount = ARRAY_LEN( imageLoaders );
 	char altName[MAX_QPATH];
 
-	byte* buffer;
-	int bufferSize = ri.FS_ReadFilePak( name, (void**)&buffer, pakChecksum );
+	byte* buffer = NULL;
+	int bufferSize = 0;
+	prefetchedImage_t* const prefetch = (prefetchedImage_t*)R_FindPrefetchedImage( name );
+	if ( prefetch != NULL ) {
+		bufferSize = ri.FS_FinishReadFile( prefetch->request, (void**)&buffer );
+		prefetch->request = 0;
+		if ( buffer != NULL ) {
+			Q_strncpyz( altName, prefetch->fileName, sizeof(altName) );
+			name = altName;
+			*pakChecksum = prefetch->pakChecksum;
+		}
+	}
+
+	if ( buffer == NULL )
+		bufferSize = ri.FS_ReadFilePak( name, (void**)&buffer, pakChecksum );
 	if ( buffer == NULL ) {
 		const char* lastDot = strrchr( name, '.' );
 		const int nameLength = lastDot != NULL ? (int)(lastDot - name) : (int)strlen( name );
@@ -1032,6 +1131,7 @@ void R_SetColorMappings()
 
 void R_InitImages()
 {
+	R_ClearPrefetchedImages();
 	Com_Memset( hashTable, 0, sizeof(hashTable) );
 	R_SetColorMappings(); // build brightness translation tables
 	R_CreateBuiltinImages(); // create default textures (white, fog, etc)
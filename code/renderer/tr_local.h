@@ -1173,6 +1173,8 @@ void	R_ConfigureVideoMode( int desktopWidth, int desktopHeight );	// writes to g
 #define IMG_NOAF        0x0020  // never enable anisotropic filtering
 
 image_t* R_FindImageFile( const char* name, int flags, textureWrap_t glWrapClampMode );
+void R_PrefetchImage( const char* name );
+void R_ClearPrefetchedImages();
 image_t* R_CreateImage( const char* name, byte* pic, int width, int height, textureFormat_t format, int flags, textureWrap_t wrapClampMode );
 void	R_UploadLightmapTile( image_t* image, byte* pic, int x, int y, int width, int height );
 
@@ -1212,6 +1214,7 @@ qhandle_t RE_RegisterShaderFromImage( const char* name, image_t* image );
 #define FINDSHADER_VERTEXLIGHT_BIT 2
 
 shader_t	*R_FindShader( const char *name, int lightmapIndex, int flags );
+void		R_PrefetchShaderImages( const char* name );
 const shader_t* R_GetShaderByHandle( qhandle_t hShader );
 void		R_InitShaders();
 void		R_ShaderList_f( void );
@@ -237,6 +237,9 @@ typedef struct {
 	// NULL can be passed for buf to just determine existance
 	int		(*FS_ReadFile)( const char *name, void **buf );
 	int		(*FS_ReadFilePak)( const char *name, void **buf, int* pakChecksum );
+	int		(*FS_ReadFileAsync)( const char *name, int* pakChecksum );
+	int		(*FS_FinishReadFile)( int request, void **buf );
+	void	(*FS_CancelReadFile)( int request );
 	void	(*FS_FreeFile)( void *buf );
 	char**	(*FS_ListFiles)( const char *name, const char *extension, int *numfilesfound );
 	void	(*FS_FreeFileList)( char **filelist );
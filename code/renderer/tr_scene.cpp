@@ -199,6 +199,8 @@ void RE_AddLightToScene( const vec3_t org, float radius, float r, float g, float
 
 void RE_RenderScene( const refdef_t* fd, int us )
 {
+	Prof_Scope profScope( "RE_RenderScene" );
+
 	if ( !tr.registered ) {
 		return;
 	}
@@ -2544,6 +2544,81 @@ static const char* FindShaderInShaderText( const char* shadername )
 }
 
 
+static void PrefetchSkyBox( const char* token )
+{
+	static const char* suf[6] = { "rt", "lf", "bk", "ft", "up", "dn" };
+	char pathname[MAX_QPATH];
+
+	if ( token[0] == 0 || !strcmp( token, "-" ) )
+		return;
+
+	for (int i = 0; i < 6; ++i) {
+		Com_sprintf( pathname, sizeof(pathname), "%s_%s.tga", token, suf[i] );
+		R_PrefetchImage( pathname );
+	}
+}
+
+
+// has the file system start reading the images R_FindShader will want for this shader
+// it only looks at the image names, everything else is left to ParseShader
+
+void R_PrefetchShaderImages( const char* name )
+{
+	char strippedName[MAX_QPATH];
+	char fileName[MAX_QPATH];
+
+	if ( name[0] == 0 )
+		return;
+
+	COM_StripExtension( name, strippedName, sizeof(strippedName) );
+	const char* p = FindShaderInShaderText( strippedName );
+	if ( !p ) {
+		Q_strncpyz( fileName, name, sizeof( fileName ) );
+		COM_DefaultExtension( fileName, sizeof( fileName ), ".tga" );
+		R_PrefetchImage( fileName );
+		return;
+	}
+
+	int depth = 0;
+	for (;;) {
+		const char* token = COM_ParseExt( &p, qtrue );
+		if ( !token[0] )
+			break;
+
+		if ( token[0] == '{' && token[1] == 0 ) {
+			depth++;
+			continue;
+		}
+
+		if ( token[0] == '}' && token[1] == 0 ) {
+			if ( --depth <= 0 )
+				break;
+			continue;
+		}
+
+		if ( !Q_stricmp( token, "map" ) || !Q_stricmp( token, "clampmap" ) ) {
+			token = COM_ParseExt( &p, qfalse );
+			if ( token[0] && token[0] != '$' )
+				R_PrefetchImage( token );
+		} else if ( !Q_stricmp( token, "animMap" ) ) {
+			COM_ParseExt( &p, qfalse );
+			for (;;) {
+				token = COM_ParseExt( &p, qfalse );
+				if ( !token[0] )
+					break;
+				R_PrefetchImage( token );
+			}
+		} else if ( !Q_stricmp( token, "skyParms" ) ) {
+			PrefetchSkyBox( COM_ParseExt( &p, qfalse ) );
+			COM_ParseExt( &p, qfalse );
+			PrefetchSkyBox( COM_ParseExt( &p, qfalse ) );
+		}
+
+		SkipRestOfLine( &p );
+	}
+}
+
+
 /*
 ===============
 R_FindShader
@@ -2997,6 +3072,7 @@ static void ScanAndLoadShaderFiles()
 	static const int MAX_SHADER_FILES = 4096;
 	char* buffers[MAX_SHADER_FILES];
 	int len[MAX_SHADER_FILES];
+	int requests[MAX_SHADER_FILES];
 
 	int i;
 	char* p;
@@ -3020,14 +3096,23 @@ static void ScanAndLoadShaderFiles()
 
 	long sum = 0;
 	long sumNames = 0;
-	// load and parse shader files
+	// have all the files read in the background while we compress them one by one
 	for ( i = 0; i < numShaderFiles; i++ )
 	{
 		char filename[MAX_QPATH];
 		Com_sprintf( filename, sizeof( filename ), "scripts/%s", shaderFileNames[i] );
-		ri.FS_ReadFilePak( filename, (void **)&buffers[i], &s_shaderPakChecksums[i] );
-		if ( !buffers[i] )
-			ri.Error( ERR_DROP, "Couldn't load %s", filename );
+		requests[i] = ri.FS_ReadFileAsync( filename, &s_shaderPakChecksums[i] );
+	}
+
+	// load and parse shader files
+	for ( i = 0; i < numShaderFiles; i++ )
+	{
+		ri.FS_FinishReadFile( requests[i], (void **)&buffers[i] );
+		if ( !buffers[i] ) {
+			for ( int j = i + 1; j < numShaderFiles; j++ )
+				ri.FS_CancelReadFile( requests[j] );
+			ri.Error( ERR_DROP, "Couldn't load scripts/%s", shaderFileNames[i] );
+		}
 		len[i] = COM_Compress( buffers[i] );
 		sum += len[i];
 		sumNames += strlen( shaderFileNames[i] ) + 1;
@@ -42,6 +42,9 @@ typedef struct svEntity_s {
 	int			lastCluster;		// if all the clusters don't fit in clusternums
 	int			areanum, areanum2;
 	int			snapshotCounter;	// used to prevent double adding from portal views
+	vec3_t		leafMins;			// the absolute bounds the clusters and areas were found for
+	vec3_t		leafMaxs;
+	float		leafMargin;			// how far the bounds can move before they change, <= 0 to look them up
 } svEntity_t;
 
 typedef enum {
@@ -249,6 +252,7 @@ extern	cvar_t	*sv_floodProtect;
 extern	cvar_t	*sv_lanForceRate;
 extern	cvar_t	*sv_strictAuth;
 extern	cvar_t	*sv_minRestartDelay;
+extern	cvar_t	*sv_traceCache;
 
 //===========================================================
 
@@ -379,6 +383,7 @@ clipHandle_t SV_ClipHandleForEntity( const sharedEntity_t *ent );
 
 
 void SV_SectorList_f( void );
+void SV_TraceCacheStats_f( void );
 
 
 int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount );
@@ -300,6 +300,7 @@ void *BotImport_HunkAlloc( int size ) {
 	if( Hunk_CheckMark() ) {
 		Com_Error( ERR_DROP, "SV_Bot_HunkAlloc: Alloc with marks already set\n" );
 	}
+	Hunk_ConsumerScope scope( HC_BOTLIB );
 	return Hunk_Alloc( size, h_high );
 }
 
@@ -423,7 +424,7 @@ void SV_BotFrame( int time ) {
 	if (!bot_enable) return;
 	//NOTE: maybe the game is already shutdown
 	if (!gvm) return;
-	VM_Call( gvm, BOTAI_START_FRAME, time );
+	VM_Call1( gvm, BOTAI_START_FRAME, time );
 }
 
 /*
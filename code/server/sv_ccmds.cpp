@@ -265,7 +265,7 @@ static void SV_MapRestart_f( )
 	// run a few frames to allow everything to settle
 	for (i = 0; i < 3; i++)
 	{
-		VM_Call( gvm, GAME_RUN_FRAME, svs.time );
+		VM_Call1( gvm, GAME_RUN_FRAME, svs.time );
 		svs.time += 100;
 	}
 
@@ -287,7 +287,7 @@ static void SV_MapRestart_f( )
 		SV_AddServerCommand( client, "map_restart\n" );
 
 		// connect the client again, without the firstTime flag
-		const char* denied = (const char*)VM_ExplicitArgPtr( gvm, VM_Call( gvm, GAME_CLIENT_CONNECT, i, qfalse, isBot ) );
+		const char* denied = (const char*)VM_ExplicitArgPtr( gvm, VM_Call3( gvm, GAME_CLIENT_CONNECT, i, qfalse, isBot ) );
 		if ( denied ) {
 			// this generally shouldn't happen, because the client
 			// was connected before the level change
@@ -301,7 +301,7 @@ static void SV_MapRestart_f( )
 	}
 
 	// run another frame to allow things to look at all the players
-	VM_Call( gvm, GAME_RUN_FRAME, svs.time );
+	VM_Call1( gvm, GAME_RUN_FRAME, svs.time );
 	svs.time += 100;
 }
 
@@ -770,7 +770,8 @@ static const cmdTableItem_t sv_cmds[] =
 	{ "systeminfo", SV_Systeminfo_f, NULL, "prints all system info cvars" },
 	{ "dumpuser", SV_DumpUser_f, NULL, "prints a user's info cvars" },
 	{ "map_restart", SV_MapRestart_f, NULL, "resets the game without reloading the map" },
-	{ "sectorlist", SV_SectorList_f, NULL, "prints entity count for all sectors" },
+	{ "sectorlist", SV_SectorList_f, NULL, "prints entity count for all sectors and the link stats" },
+	{ "tracecachestats", SV_TraceCacheStats_f, NULL, "prints the " S_COLOR_CVAR "sv_traceCache " S_COLOR_HELP "hit rate" },
 	{ "map", SV_Map_f, SV_CompleteMap_f, "loads a map" },
 	{ "devmap", SV_DevMap_f, SV_CompleteMap_f, "loads a map with cheats enabled" },
 	{ "killserver", SV_KillServer_f, NULL, "shuts the server down" },
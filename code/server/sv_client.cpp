@@ -375,7 +375,7 @@ void SV_DirectConnect( netadr_t from )
 
 //			// disconnect the client from the game first so any flags the
 //			// player might have are dropped
-//			VM_Call( gvm, GAME_CLIENT_DISCONNECT, newcl - svs.clients );
+//			VM_Call1( gvm, GAME_CLIENT_DISCONNECT, newcl - svs.clients );
 			//
 			goto gotnewcl;
 		}
@@ -459,7 +459,7 @@ gotnewcl:
 	Q_strncpyz( newcl->userinfo, userinfo, sizeof(newcl->userinfo) );
 
 	// give the game a chance to reject this connection or modify the userinfo
-	intptr_t denied = VM_Call( gvm, GAME_CLIENT_CONNECT, clientNum, qtrue, qfalse ); // firstTime = qtrue
+	intptr_t denied = VM_Call3( gvm, GAME_CLIENT_CONNECT, clientNum, qtrue, qfalse ); // firstTime = qtrue
 	if ( denied ) {
 		// we can't just use VM_ArgPtr, because that is only valid inside a VM_Call
 		const char* s = (const char*)VM_ExplicitArgPtr( gvm, denied );
@@ -535,7 +535,7 @@ void SV_DropClient( client_t* drop, const char* reason )
 
 	// call the prog function for removing a client
 	// this will remove the body, among other things
-	VM_Call( gvm, GAME_CLIENT_DISCONNECT, drop - svs.clients );
+	VM_Call1( gvm, GAME_CLIENT_DISCONNECT, drop - svs.clients );
 
 	// add the disconnect command
 	SV_SendServerCommand( drop, "disconnect \"%s\"", reason );
@@ -654,7 +654,7 @@ void SV_ClientEnterWorld( client_t* cl, const usercmd_t* cmd )
 	cl->lastUsercmd = *cmd;
 
 	// tell the game vm that the client is live
-	VM_Call( gvm, GAME_CLIENT_BEGIN, cl - svs.clients );
+	VM_Call1( gvm, GAME_CLIENT_BEGIN, cl - svs.clients );
 }
 
 
@@ -1112,7 +1112,7 @@ static void SV_UpdateUserinfo_f( client_t* cl )
 
 	SV_UserinfoChanged( cl );
 	// call prog code to allow overrides
-	VM_Call( gvm, GAME_CLIENT_USERINFO_CHANGED, cl - svs.clients );
+	VM_Call1( gvm, GAME_CLIENT_USERINFO_CHANGED, cl - svs.clients );
 }
 
 
@@ -1150,7 +1150,7 @@ void SV_ExecuteClientCommand( client_t* cl, const char* s, qbool clientOK )
 	if (clientOK) {
 		// pass unknown strings to the game
 		if (sv.state == SS_GAME) {
-			VM_Call( gvm, GAME_CLIENT_COMMAND, cl - svs.clients );
+			VM_Call1( gvm, GAME_CLIENT_COMMAND, cl - svs.clients );
 			return;
 		}
 	}
@@ -1217,7 +1217,7 @@ void SV_ClientThink( client_t* cl, const usercmd_t* cmd )
 		return;		// may have been kicked during the last usercmd
 	}
 
-	VM_Call( gvm, GAME_CLIENT_THINK, cl - svs.clients );
+	VM_Call1( gvm, GAME_CLIENT_THINK, cl - svs.clients );
 }
 
 
@@ -198,6 +198,7 @@ static qbool SV_EntityContact( const vec3_t mins, const vec3_t maxs, const share
 	const float* angles = gEnt->r.currentAngles;
 
 	clipHandle_t ch = SV_ClipHandleForEntity( gEnt );
+	CM_CaptureTrace( vec3_origin, vec3_origin, mins, maxs, ch, -1, origin, angles, capsule );
 	CM_TransformedBoxTrace( &trace, vec3_origin, vec3_origin, mins, maxs, ch, -1, origin, angles, capsule );
 
 	return trace.startsolid;
@@ -851,7 +852,7 @@ void SV_ShutdownGameProgs()
 	if ( !gvm )
 		return;
 
-	VM_Call( gvm, GAME_SHUTDOWN, qfalse );
+	VM_Call1( gvm, GAME_SHUTDOWN, qfalse );
 	VM_Free( gvm );
 	gvm = NULL;
 }
@@ -873,7 +874,7 @@ static void SV_InitGameVM( qbool restart )
 
 	// use the current msec count for a random seed
 	// init for this gamestate
-	VM_Call( gvm, GAME_INIT, svs.time, Com_Milliseconds(), restart );
+	VM_Call3( gvm, GAME_INIT, svs.time, Com_Milliseconds(), restart );
 }
 
 
@@ -885,7 +886,7 @@ void SV_RestartGameProgs()
 	if ( !gvm )
 		return;
 
-	VM_Call( gvm, GAME_SHUTDOWN, qtrue );
+	VM_Call1( gvm, GAME_SHUTDOWN, qtrue );
 
 	gvm = VM_Restart( gvm );
 
@@ -893,6 +894,22 @@ void SV_RestartGameProgs()
 }
 
 
+static const vmPureTrap_t sv_gamePureTraps[] = {
+	{ G_MEMSET, VMPT_MEMSET },
+	{ G_MEMCPY, VMPT_MEMCPY },
+	{ G_STRNCPY, VMPT_STRNCPY },
+	{ G_SIN, VMPT_SIN },
+	{ G_COS, VMPT_COS },
+	{ G_ATAN2, VMPT_ATAN2 },
+	{ G_SQRT, VMPT_SQRT },
+	{ G_MATRIXMULTIPLY, VMPT_MATRIXMULTIPLY },
+	{ G_ANGLEVECTORS, VMPT_ANGLEVECTORS },
+	{ G_PERPENDICULARVECTOR, VMPT_PERPENDICULARVECTOR },
+	{ G_FLOOR, VMPT_FLOOR },
+	{ G_CEIL, VMPT_CEIL }
+};
+
+
 // called on a normal map change, not on a map_restart
 
 void SV_InitGameProgs()
@@ -910,7 +927,7 @@ void SV_InitGameProgs()
 #endif
 
 	// load the dll or bytecode
-	gvm = VM_Create( VM_GAME, SV_GameSystemCalls, interpret );
+	gvm = VM_Create( VM_GAME, SV_GameSystemCalls, sv_gamePureTraps, ARRAY_LEN( sv_gamePureTraps ), interpret );
 
 	SV_InitGameVM( qfalse );
 }
@@ -922,12 +939,12 @@ qbool SV_GameCommand()
 {
 	if ( sv.state != SS_GAME )
 		return qfalse;
-	return VM_Call( gvm, GAME_CONSOLE_COMMAND );
+	return VM_Call0( gvm, GAME_CONSOLE_COMMAND );
 }
 
 #if defined( QC )
 qboolean SV_SkipEntityTrace( int clientNum, int entityNum )
 {
-	return VM_Call( gvm, GAME_SKIP_ENTITY_TRACE, clientNum, entityNum );
+	return VM_Call2( gvm, GAME_SKIP_ENTITY_TRACE, clientNum, entityNum );
 }
 #endif // QC
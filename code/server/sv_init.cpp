@@ -324,6 +324,8 @@ static void SV_TouchCGame()
 
 void SV_SpawnServer( const char* mapname )
 {
+	Prof_Scope profScope( "SV_SpawnServer" );
+
 	// shut down the existing game if it is running
 	SV_ShutdownGameProgs();
 
@@ -359,7 +361,10 @@ void SV_SpawnServer( const char* mapname )
 	FS_ClearPakReferences(-1);
 
 	// allocate the snapshot entities on the hunk
-	svs.snapshotEntities = (entityState_t*)Hunk_Alloc( sizeof(entityState_t)*svs.numSnapshotEntities, h_high );
+	{
+		Hunk_ConsumerScope scope( HC_SNAPSHOTS );
+		svs.snapshotEntities = (entityState_t*)Hunk_Alloc( sizeof(entityState_t)*svs.numSnapshotEntities, h_high );
+	}
 	svs.nextSnapshotEntities = 0;
 
 	// toggle the server bit so clients can detect that a
@@ -388,7 +393,10 @@ void SV_SpawnServer( const char* mapname )
 	FS_Restart( sv.checksumFeed );
 
 	unsigned checksum;
-	CM_LoadMap( va("maps/%s.bsp", mapname), qfalse, &checksum );
+	{
+		Hunk_ConsumerScope scope( HC_COLLISION );
+		CM_LoadMap( va("maps/%s.bsp", mapname), qfalse, &checksum );
+	}
 
 	// set serverinfo visible name
 	Cvar_Set( "mapname", mapname );
@@ -422,7 +430,7 @@ void SV_SpawnServer( const char* mapname )
 	// run a few frames to allow everything to settle
 	for (int i = 0;i < 3; i++)
 	{
-		VM_Call (gvm, GAME_RUN_FRAME, svs.time);
+		VM_Call1 (gvm, GAME_RUN_FRAME, svs.time);
 		SV_BotFrame (svs.time);
 		svs.time += 100;
 	}
@@ -435,7 +443,7 @@ void SV_SpawnServer( const char* mapname )
 		if (svs.clients[i].state >= CS_CONNECTED) {
 			qbool isBot = ( svs.clients[i].netchan.remoteAddress.type == NA_BOT );
 			// connect the client again
-			const char* denied = (const char*)VM_ExplicitArgPtr( gvm, VM_Call( gvm, GAME_CLIENT_CONNECT, i, qfalse, isBot ) );	// firstTime = qfalse
+			const char* denied = (const char*)VM_ExplicitArgPtr( gvm, VM_Call3( gvm, GAME_CLIENT_CONNECT, i, qfalse, isBot ) );	// firstTime = qfalse
 			if ( denied ) {
 				// this generally shouldn't happen, because the client
 				// was connected before the level change
@@ -456,14 +464,14 @@ void SV_SpawnServer( const char* mapname )
 					client->deltaMessage = -1;
 					client->nextSnapshotTime = svs.time;	// generate a snapshot immediately
 
-					VM_Call( gvm, GAME_CLIENT_BEGIN, i );
+					VM_Call1( gvm, GAME_CLIENT_BEGIN, i );
 				}
 			}
 		}
 	}
 
 	// run another frame to allow things to look at all the players
-	VM_Call (gvm, GAME_RUN_FRAME, svs.time);
+	VM_Call1 (gvm, GAME_RUN_FRAME, svs.time);
 	SV_BotFrame (svs.time);
 	svs.time += 100;
 
@@ -565,7 +573,8 @@ static const cvarTableItem_t sv_cvars[] =
 	{ NULL, "sv_mapChecksum", "", CVAR_ROM, CVART_INTEGER, NULL, NULL, ".bsp file checksum" },
 	{ &sv_lanForceRate, "sv_lanForceRate", "1", CVAR_ARCHIVE, CVART_BOOL, NULL, NULL, S_COLOR_VAL "1 " S_COLOR_HELP "means uncapped rate on LAN" },
 	{ &sv_strictAuth, "sv_strictAuth", "0", CVAR_ARCHIVE, CVART_BOOL, NULL, NULL, "requires CD key authentication" },
-	{ &sv_minRestartDelay, "sv_minRestartDelay", "2", 0, CVART_INTEGER, "1", "48", "min. hours to wait before restarting the server" }
+	{ &sv_minRestartDelay, "sv_minRestartDelay", "2", 0, CVART_INTEGER, "1", "48", "min. hours to wait before restarting the server" },
+	{ &sv_traceCache, "sv_traceCache", "0", CVAR_ARCHIVE, CVART_BOOL, NULL, NULL, "reuses the results of identical traces within a server frame" }
 };
 
 #undef SV_PURE_DEFAULT
@@ -52,6 +52,7 @@ cvar_t	*sv_floodProtect;
 cvar_t	*sv_lanForceRate;		// dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
 cvar_t	*sv_strictAuth;
 cvar_t	*sv_minRestartDelay;	// min. time before restart in hours
+cvar_t	*sv_traceCache;			// caches identical SV_Trace calls within a frame
 
 
 
@@ -741,6 +742,7 @@ happen before SV_Frame is called
 ==================
 */
 void SV_Frame( int msec ) {
+	Prof_Scope profScope( "SV_Frame" );
 	int		frameMsec;
 
 	// the menu kills the server with this cvar
@@ -830,15 +832,19 @@ void SV_Frame( int msec ) {
 	// update pings based on the OOB packets received while we were sleeping
 	SV_CalcPings();
 
-	if (com_dedicated->integer)
+	if (com_dedicated->integer) {
+		Prof_Scope botScope( "SV_BotFrame" );
 		SV_BotFrame( svs.time );
+	}
 
 	// run the game simulation in chunks
 	while ( sv.timeResidual >= frameMsec ) {
+		Prof_Scope gameScope( "GAME_RUN_FRAME" );
 		sv.timeResidual -= frameMsec;
 		svs.time += frameMsec;
 		// let everything in the world think and move
-		VM_Call( gvm, GAME_RUN_FRAME, svs.time );
+		VM_Call1( gvm, GAME_RUN_FRAME, svs.time );
+		CM_EndCaptureFrame();
 	}
 
 	if ( com_speeds->integer ) {
@@ -308,6 +308,12 @@ static void SV_AddEntToSnapshot( svEntity_t *svEnt, const sharedEntity_t *gEnt,
 }
 
 
+static qbool SV_AreaConnected( const byte* connectedAreas, int area )
+{
+	return area >= 0 && ( connectedAreas[area >> 3] & ( 1 << ( area & 7 ) ) );
+}
+
+
 static void SV_AddEntitiesVisibleFromPoint( const vec3_t origin,
 		clientSnapshot_t *frame, snapshotEntityNumbers_t *eNums )
 {
@@ -327,6 +333,13 @@ static void SV_AddEntitiesVisibleFromPoint( const vec3_t origin,
 
 	// calculate the visible areas
 	frame->areabytes = CM_WriteAreaBits( frame->areabits, clientarea );
+	const byte* const connectedAreas = CM_ConnectedAreas( clientarea );
+
+	// like CM_AreasConnected, cm_noAreas also connects entities outside of any area
+	static const cvar_t* cm_noAreas = NULL;
+	if ( !cm_noAreas )
+		cm_noAreas = Cvar_Get( "cm_noAreas", "0", CVAR_CHEAT );
+	const qbool allAreas = cm_noAreas->integer != 0;
 
 	for (int e = 0; e < sv.num_entities; ++e) {
 		const sharedEntity_t* ent = SV_GentityNum(e);
@@ -385,10 +398,10 @@ static void SV_AddEntitiesVisibleFromPoint( const vec3_t origin,
 
 		// ignore if not touching a PV leaf
 		// check area
-		if ( !CM_AreasConnected( clientarea, svEnt->areanum ) ) {
+		if ( !allAreas && !SV_AreaConnected( connectedAreas, svEnt->areanum ) ) {
 			// doors can legally straddle two areas, so
 			// we may need to check another one
-			if ( !CM_AreasConnected( clientarea, svEnt->areanum2 ) ) {
+			if ( !SV_AreaConnected( connectedAreas, svEnt->areanum2 ) ) {
 				continue;		// blocked by a door
 			}
 		}
@@ -692,6 +705,7 @@ SV_SendClientMessages
 =======================
 */
 void SV_SendClientMessages( void ) {
+	Prof_Scope profScope( "SV_SendClientMessages" );
 	int			i;
 	client_t	*c;
 
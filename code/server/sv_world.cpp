@@ -48,6 +48,165 @@ clipHandle_t SV_ClipHandleForEntity( const sharedEntity_t *ent ) {
 
 
 
+/*
+===============================================================================
+
+TRACE CACHE
+
+The game often issues bit-identical traces within a frame (item touch checks,
+bot visibility checks, pmove retries) so with sv_traceCache, SV_Trace results
+are kept until the server time advances. Linking or unlinking an entity drops
+the entries whose sweep it overlaps, since those are the only traces it could change.
+Game code that changes an entity's contents or owner without relinking it
+isn't noticed, which is why the cache is opt-in.
+
+===============================================================================
+*/
+
+#define TRACE_CACHE_SIZE	256	// must be a power of 2
+#define TRACE_CACHE_PROBES	8	// lookups don't stop at empty slots, so entries can be dropped anywhere
+
+typedef struct {
+	vec3_t	start;
+	vec3_t	end;
+	vec3_t	mins;
+	vec3_t	maxs;
+	int		passEntityNum;
+	int		contentmask;
+	int		capsule;
+} traceCacheKey_t;
+
+typedef struct {
+	traceCacheKey_t	key;
+	unsigned		hash;
+	int				generation;		// valid when equal to traceCache.generation
+	vec3_t			boxmins;		// what the sweep can touch, as in SV_Trace
+	vec3_t			boxmaxs;
+	trace_t			trace;
+} traceCacheEntry_t;
+
+typedef struct {
+	traceCacheEntry_t	entries[TRACE_CACHE_SIZE];
+	int		generation;		// bumped to drop every entry
+	int		time;			// svs.time of the entries
+	vec3_t	boxmins;		// all entries since the last flush
+	vec3_t	boxmaxs;
+	int64_t	hits;			// the stats are cleared with the world
+	int64_t	misses;
+	int64_t	drops;			// entries dropped by SV_LinkEntity/SV_UnlinkEntity
+	int64_t	flushes;
+} traceCache_t;
+
+static traceCache_t traceCache;
+
+
+static qbool SV_BoxesOverlap( const vec3_t mins1, const vec3_t maxs1, const vec3_t mins2, const vec3_t maxs2 )
+{
+	return
+		mins1[0] <= maxs2[0] && mins1[1] <= maxs2[1] && mins1[2] <= maxs2[2] &&
+		maxs1[0] >= mins2[0] && maxs1[1] >= mins2[1] && maxs1[2] >= mins2[2];
+}
+
+
+static void SV_TraceCache_Flush()
+{
+	traceCache.generation++;
+	traceCache.time = svs.time;
+	ClearBounds( traceCache.boxmins, traceCache.boxmaxs );
+	traceCache.flushes++;
+}
+
+
+static void SV_TraceCache_Clear()
+{
+	Com_Memset( &traceCache, 0, sizeof( traceCache ) );
+	SV_TraceCache_Flush();
+}
+
+
+static unsigned SV_TraceCache_Hash( const traceCacheKey_t* key )
+{
+	// FNV-1a
+	const byte* const data = (const byte*)key;
+	unsigned hash = 2166136261u;
+	for ( int i = 0; i < sizeof( *key ); ++i ) {
+		hash = ( hash ^ data[i] ) * 16777619u;
+	}
+
+	return hash;
+}
+
+
+static qbool SV_TraceCache_Find( const traceCacheKey_t* key, unsigned hash, trace_t* results )
+{
+	for ( int i = 0; i < TRACE_CACHE_PROBES; ++i ) {
+		const traceCacheEntry_t* const entry = &traceCache.entries[( hash + i ) & ( TRACE_CACHE_SIZE - 1 )];
+		if ( entry->generation == traceCache.generation &&
+			 entry->hash == hash &&
+			 !memcmp( &entry->key, key, sizeof( *key ) ) ) {
+			*results = entry->trace;
+			return qtrue;
+		}
+	}
+
+	return qfalse;
+}
+
+
+static void SV_TraceCache_Store( const traceCacheKey_t* key, unsigned hash, const vec3_t boxmins, const vec3_t boxmaxs, const trace_t* trace )
+{
+	// take the first free slot or evict the home slot's entry
+	traceCacheEntry_t* entry = &traceCache.entries[hash & ( TRACE_CACHE_SIZE - 1 )];
+	for ( int i = 0; i < TRACE_CACHE_PROBES; ++i ) {
+		traceCacheEntry_t* const slot = &traceCache.entries[( hash + i ) & ( TRACE_CACHE_SIZE - 1 )];
+		if ( slot->generation != traceCache.generation ) {
+			entry = slot;
+			break;
+		}
+	}
+
+	entry->key = *key;
+	entry->hash = hash;
+	entry->generation = traceCache.generation;
+	VectorCopy( boxmins, entry->boxmins );
+	VectorCopy( boxmaxs, entry->boxmaxs );
+	entry->trace = *trace;
+	AddPointToBounds( boxmins, traceCache.boxmins, traceCache.boxmaxs );
+	AddPointToBounds( boxmaxs, traceCache.boxmins, traceCache.boxmaxs );
+}
+
+
+static void SV_TraceCache_DropEntity( const sharedEntity_t* gEnt )
+{
+	if ( !SV_BoxesOverlap( gEnt->r.absmin, gEnt->r.absmax, traceCache.boxmins, traceCache.boxmaxs ) )
+		return;
+
+	for ( int i = 0; i < TRACE_CACHE_SIZE; ++i ) {
+		traceCacheEntry_t* const entry = &traceCache.entries[i];
+		if ( entry->generation == traceCache.generation &&
+			 SV_BoxesOverlap( gEnt->r.absmin, gEnt->r.absmax, entry->boxmins, entry->boxmaxs ) ) {
+			entry->generation = 0;
+			traceCache.drops++;
+		}
+	}
+}
+
+
+void SV_TraceCacheStats_f( void )
+{
+	const int64_t traces = traceCache.hits + traceCache.misses;
+	if ( !traces ) {
+		Com_Printf( "No traces cached%s\n", sv_traceCache->integer ? " yet" : ", " S_COLOR_CVAR "sv_traceCache " S_COLOR_HELP "is off" );
+		return;
+	}
+
+	Com_Printf( "%lld hits, %lld misses (%.1f%% hit rate)\n",
+		(long long)traceCache.hits, (long long)traceCache.misses, 100.0 * (double)traceCache.hits / (double)traces );
+	Com_Printf( "%lld entries dropped by entity links, %lld flushes\n", (long long)traceCache.drops, (long long)traceCache.flushes );
+}
+
+
+
 /*
 ===============================================================================
 
@@ -74,6 +233,13 @@ typedef struct worldSector_s {
 static worldSector_t sv_worldSectors[AREA_NODES];
 static int sv_numworldSectors;
 
+// SV_LinkEntity calls that could skip work, cleared with the world
+static struct {
+	int64_t	leafLookups;
+	int64_t	sameLeafs;		// moved less than the leaf margin
+	int64_t	sameSectors;
+} sv_linkStats;
+
 
 /*
 ===============
@@ -94,6 +260,10 @@ void SV_SectorList_f( void ) {
 		}
 		Com_Printf( "sector %i: %i entities\n", i, c );
 	}
+
+	const int64_t links = sv_linkStats.leafLookups + sv_linkStats.sameLeafs;
+	Com_Printf( "%lld links: %lld leaf lookups, %lld skipped, %lld in the same sector\n",
+		(long long)links, (long long)sv_linkStats.leafLookups, (long long)sv_linkStats.sameLeafs, (long long)sv_linkStats.sameSectors );
 }
 
 /*
@@ -150,6 +320,32 @@ void SV_ClearWorld()
 	clipHandle_t h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
 	SV_CreateworldSector( 0, mins, maxs );
+
+	Com_Memset( &sv_linkStats, 0, sizeof( sv_linkStats ) );
+	SV_TraceCache_Clear();
+}
+
+
+static void SV_RemoveFromWorldSector( svEntity_t *ent ) {
+	svEntity_t		*scan;
+	worldSector_t	*ws;
+
+	ws = ent->worldSector;
+	ent->worldSector = NULL;
+
+	if ( ws->entities == ent ) {
+		ws->entities = ent->nextEntityInWorldSector;
+		return;
+	}
+
+	for ( scan = ws->entities ; scan ; scan = scan->nextEntityInWorldSector ) {
+		if ( scan->nextEntityInWorldSector == ent ) {
+			scan->nextEntityInWorldSector = ent->nextEntityInWorldSector;
+			return;
+		}
+	}
+
+	Com_Printf( "WARNING: SV_UnlinkEntity: not found in worldSector\n" );
 }
 
 
@@ -161,32 +357,104 @@ SV_UnlinkEntity
 */
 void SV_UnlinkEntity( sharedEntity_t *gEnt ) {
 	svEntity_t		*ent;
-	svEntity_t		*scan;
-	worldSector_t	*ws;
 
 	ent = SV_SvEntityForGentity( gEnt );
 
 	gEnt->r.linked = qfalse;
 
-	ws = ent->worldSector;
-	if ( !ws ) {
+	if ( !ent->worldSector ) {
 		return;		// not linked in anywhere
 	}
-	ent->worldSector = NULL;
 
-	if ( ws->entities == ent ) {
-		ws->entities = ent->nextEntityInWorldSector;
+	SV_TraceCache_DropEntity( gEnt );
+	SV_RemoveFromWorldSector( ent );
+}
+
+
+// the leafs found for leafMins/leafMaxs are still the right ones as long as no corner
+// of the box moved further than the nearest plane of the nodes the lookup visited
+static qbool SV_SameLeafs( const svEntity_t *ent, const sharedEntity_t *gEnt ) {
+	if ( ent->leafMargin <= 0.0f ) {
+		return qfalse;
+	}
+
+	float dist2 = 0.0f;
+	for ( int i = 0; i < 3; ++i ) {
+		const float d = max( fabsf( gEnt->r.absmin[i] - ent->leafMins[i] ), fabsf( gEnt->r.absmax[i] - ent->leafMaxs[i] ) );
+		dist2 += d * d;
+	}
+
+	return dist2 < ent->leafMargin * ent->leafMargin;
+}
+
+
+#define MAX_TOTAL_ENT_LEAFS		128
+#define LEAF_MARGIN_EPSILON		0.125f	// for the float error of CM_BoxLeafnumsMargin's plane distances
+
+// finds the clusters and areas of the entity's absolute bounds
+// leafMargin is negative when the entity is outside the world
+static void SV_LinkToLeafs( svEntity_t *ent, const sharedEntity_t *gEnt ) {
+	int			leafs[MAX_TOTAL_ENT_LEAFS];
+	int			cluster;
+	int			num_leafs;
+	int			i;
+	int			area;
+	int			lastLeaf;
+	float		margin;
+
+	ent->numClusters = 0;
+	ent->lastCluster = 0;
+	ent->areanum = -1;
+	ent->areanum2 = -1;
+
+	//get all leafs, including solids
+	num_leafs = CM_BoxLeafnumsMargin( gEnt->r.absmin, gEnt->r.absmax,
+		leafs, MAX_TOTAL_ENT_LEAFS, &lastLeaf, &margin );
+
+	if ( !num_leafs ) {
+		ent->leafMargin = -1.0f;
 		return;
 	}
 
-	for ( scan = ws->entities ; scan ; scan = scan->nextEntityInWorldSector ) {
-		if ( scan->nextEntityInWorldSector == ent ) {
-			scan->nextEntityInWorldSector = ent->nextEntityInWorldSector;
-			return;
+	VectorCopy( gEnt->r.absmin, ent->leafMins );
+	VectorCopy( gEnt->r.absmax, ent->leafMaxs );
+	ent->leafMargin = max( margin - LEAF_MARGIN_EPSILON, 0.0f );
+
+	// set areas, even from clusters that don't fit in the entity array
+	for (i=0 ; i<num_leafs ; i++) {
+		area = CM_LeafArea (leafs[i]);
+		if (area != -1) {
+			// doors may legally straddle two areas,
+			// but nothing should ever need more than that
+			if (ent->areanum != -1 && ent->areanum != area) {
+				if (ent->areanum2 != -1 && ent->areanum2 != area && sv.state == SS_LOADING) {
+					Com_DPrintf ("Object %i touching 3 areas at %f %f %f\n",
+					gEnt->s.number,
+					gEnt->r.absmin[0], gEnt->r.absmin[1], gEnt->r.absmin[2]);
+				}
+				ent->areanum2 = area;
+			} else {
+				ent->areanum = area;
+			}
 		}
 	}
 
-	Com_Printf( "WARNING: SV_UnlinkEntity: not found in worldSector\n" );
+	// store as many explicit clusters as we can
+	ent->numClusters = 0;
+	for (i=0 ; i < num_leafs ; i++) {
+		cluster = CM_LeafCluster( leafs[i] );
+		if ( cluster != -1 ) {
+			ent->clusternums[ent->numClusters++] = cluster;
+			if ( ent->numClusters == MAX_ENT_CLUSTERS ) {
+				break;
+			}
+		}
+	}
+
+	// store off a last cluster if we need to
+	if ( i != num_leafs ) {
+		ent->lastCluster = CM_LeafCluster( lastLeaf );
+	}
 }
 
 
@@ -196,22 +464,18 @@ SV_LinkEntity
 
 ===============
 */
-#define MAX_TOTAL_ENT_LEAFS		128
 void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	worldSector_t	*node;
-	int			leafs[MAX_TOTAL_ENT_LEAFS];
-	int			cluster;
-	int			num_leafs;
 	int			i, j, k;
-	int			area;
-	int			lastLeaf;
 	float		*origin, *angles;
 	svEntity_t	*ent;
 
 	ent = SV_SvEntityForGentity( gEnt );
 
+	// the sector link is only updated once we know where the entity goes,
+	// but the trace cache has to forget what it could touch at its old position
 	if ( ent->worldSector ) {
-		SV_UnlinkEntity( gEnt );	// unlink from old position
+		SV_TraceCache_DropEntity( gEnt );
 	}
 
 	// encode the size into the entityState_t for client prediction
@@ -272,60 +536,27 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	gEnt->r.absmax[1] += 1;
 	gEnt->r.absmax[2] += 1;
 
-	// link to PVS leafs
-	ent->numClusters = 0;
-	ent->lastCluster = 0;
-	ent->areanum = -1;
-	ent->areanum2 = -1;
-
-	//get all leafs, including solids
-	num_leafs = CM_BoxLeafnums( gEnt->r.absmin, gEnt->r.absmax,
-		leafs, MAX_TOTAL_ENT_LEAFS, &lastLeaf );
-
-	// if none of the leafs were inside the map, the
-	// entity is outside the world and can be considered unlinked
-	if ( !num_leafs ) {
-		return;
-	}
-
-	// set areas, even from clusters that don't fit in the entity array
-	for (i=0 ; i<num_leafs ; i++) {
-		area = CM_LeafArea (leafs[i]);
-		if (area != -1) {
-			// doors may legally straddle two areas,
-			// but nothing should ever need more than that
-			if (ent->areanum != -1 && ent->areanum != area) {
-				if (ent->areanum2 != -1 && ent->areanum2 != area && sv.state == SS_LOADING) {
-					Com_DPrintf ("Object %i touching 3 areas at %f %f %f\n",
-					gEnt->s.number,
-					gEnt->r.absmin[0], gEnt->r.absmin[1], gEnt->r.absmin[2]);
-				}
-				ent->areanum2 = area;
-			} else {
-				ent->areanum = area;
-			}
-		}
-	}
-
-	// store as many explicit clusters as we can
-	ent->numClusters = 0;
-	for (i=0 ; i < num_leafs ; i++) {
-		cluster = CM_LeafCluster( leafs[i] );
-		if ( cluster != -1 ) {
-			ent->clusternums[ent->numClusters++] = cluster;
-			if ( ent->numClusters == MAX_ENT_CLUSTERS ) {
-				break;
+	// the clusters and areas of small moves are usually still valid
+	if ( SV_SameLeafs( ent, gEnt ) ) {
+		sv_linkStats.sameLeafs++;
+	} else {
+		sv_linkStats.leafLookups++;
+		SV_LinkToLeafs( ent, gEnt );
+		if ( ent->leafMargin < 0.0f ) {
+			// none of the leafs were inside the map, the
+			// entity is outside the world and can be considered unlinked
+			if ( ent->worldSector ) {
+				SV_RemoveFromWorldSector( ent );
 			}
+			gEnt->r.linked = qfalse;
+			return;
 		}
 	}
 
-	// store off a last cluster if we need to
-	if ( i != num_leafs ) {
-		ent->lastCluster = CM_LeafCluster( lastLeaf );
-	}
-
 	gEnt->r.linkcount++;
 
+	SV_TraceCache_DropEntity( gEnt );
+
 	// find the first world sector node that the ent's box crosses
 	node = sv_worldSectors;
 	while (1)
@@ -340,6 +571,16 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 			break;		// crosses the node
 	}
 
+	if ( ent->worldSector == node ) {
+		sv_linkStats.sameSectors++;
+		gEnt->r.linked = qtrue;
+		return;
+	}
+
+	if ( ent->worldSector ) {
+		SV_RemoveFromWorldSector( ent );
+	}
+
 	// link it in
 	ent->worldSector = node;
 	ent->nextEntityInWorldSector = node->entities;
@@ -470,6 +711,7 @@ void SV_ClipToEntity( trace_t *trace, const vec3_t start, const vec3_t mins, con
 		angles = vec3_origin;	// boxes don't rotate
 	}
 
+	CM_CaptureTrace( start, end, mins, maxs, clipHandle, contentmask, origin, angles, capsule );
 	CM_TransformedBoxTrace( trace, start, end, mins, maxs, clipHandle, contentmask, origin, angles, capsule );
 
 	if ( trace->fraction < 1 ) {
@@ -542,6 +784,8 @@ static void SV_ClipMoveToEntities( moveclip_t *clip )
 			angles = vec3_origin;	// boxes don't rotate
 		}
 
+		CM_CaptureTrace( clip->start, clip->end, clip->mins, clip->maxs, clipHandle, clip->contentmask,
+			origin, angles, clip->capsule );
 		CM_TransformedBoxTrace( &trace, clip->start, clip->end,
 			clip->mins, clip->maxs, clipHandle, clip->contentmask,
 			origin, angles, clip->capsule );
@@ -568,15 +812,7 @@ static void SV_ClipMoveToEntities( moveclip_t *clip )
 }
 
 
-/*
-==================
-SV_Trace
-
-Moves the given mins/maxs volume through the world from start to end.
-passEntityNum and entities owned by passEntityNum are explicitly not checked.
-==================
-*/
-void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule ) {
+static void SV_TraceUncached( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule ) {
 	moveclip_t	clip;
 	int			i;
 #if defined( QC )
@@ -600,6 +836,7 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 	Com_Memset ( &clip, 0, sizeof ( moveclip_t ) );
 
 	// clip to world
+	CM_CaptureTrace( start, end, mins, maxs, 0, contentmask, NULL, NULL, capsule );
 	CM_BoxTrace( &clip.trace, start, end, mins, maxs, 0, contentmask, capsule );
 	clip.trace.entityNum = clip.trace.fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
 	if ( clip.trace.fraction == 0 ) {
@@ -640,6 +877,58 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 }
 
 
+/*
+==================
+SV_Trace
+
+Moves the given mins/maxs volume through the world from start to end.
+passEntityNum and entities owned by passEntityNum are explicitly not checked.
+==================
+*/
+void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule ) {
+	if ( !sv_traceCache->integer ) {
+		SV_TraceUncached( results, start, mins, maxs, end, passEntityNum, contentmask, capsule );
+		return;
+	}
+
+	if ( !mins ) {
+		mins = vec3_origin;
+	}
+	if ( !maxs ) {
+		maxs = vec3_origin;
+	}
+
+	if ( traceCache.time != svs.time ) {
+		SV_TraceCache_Flush();
+	}
+
+	traceCacheKey_t key;
+	VectorCopy( start, key.start );
+	VectorCopy( end, key.end );
+	VectorCopy( mins, key.mins );
+	VectorCopy( maxs, key.maxs );
+	key.passEntityNum = passEntityNum;
+	key.contentmask = contentmask;
+	key.capsule = capsule;
+
+	const unsigned hash = SV_TraceCache_Hash( &key );
+	if ( SV_TraceCache_Find( &key, hash, results ) ) {
+		traceCache.hits++;
+		return;
+	}
+	traceCache.misses++;
+
+	SV_TraceUncached( results, start, mins, maxs, end, passEntityNum, contentmask, capsule );
+
+	vec3_t boxmins, boxmaxs;
+	for ( int i = 0; i < 3; ++i ) {
+		boxmins[i] = min( start[i], end[i] ) + mins[i] - 1;
+		boxmaxs[i] = max( start[i], end[i] ) + maxs[i] + 1;
+	}
+	SV_TraceCache_Store( &key, hash, boxmins, boxmaxs, results );
+}
+
+
 int SV_PointContents( const vec3_t p, int passEntityNum )
 {
 	// get base contents from world
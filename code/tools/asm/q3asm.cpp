@@ -42,6 +42,8 @@ struct VanillaStringCmp
 };
 
 
+#include <vector>
+
 #include "../../qcommon/vm_local.h"
 
 extern "C" {
@@ -92,6 +94,7 @@ static symbol_t* lastSymbol; // symbol most recently defined, used by HackToSegm
 struct options_t {
 	qboolean verbose;
 	qboolean writeMapFile;
+	qboolean optimize;
 };
 
 static options_t options;
@@ -387,6 +390,8 @@ static int ParseValue()
 }
 
 
+static qboolean expressionIsLiteral; // the last parsed expression didn't reference any symbol
+
 static int ParseExpression()
 {
 	// skip any leading minus
@@ -405,8 +410,10 @@ static int ParseExpression()
 	int v;
 	if ( isdigit(s[0]) || (s[0] == '-') ) {
 		v = atoiNoCap( s );
+		expressionIsLiteral = qtrue;
 	} else {
 		v = LookupSymbol( s );
+		expressionIsLiteral = qfalse;
 	}
 
 	// parse add / subtract offsets
@@ -454,14 +461,808 @@ static void HackToSegment( segmentName_t seg )
 }
 
 
+///////////////////////////////////////////////////////////////
+
+/*
+Optional bytecode optimizer (-O)
+
+The code of each procedure is buffered instead of being emitted directly
+and is then rewritten before the labels get their final instruction numbers.
+
+Every decision must be identical on both passes since labels are only defined on pass 0,
+so the optimizer never looks at values that come from symbols (those are 0 on pass 0).
+Only plain numbers, opcodes and label names are used.
+
+Transformations never span a label and keep the linear opStack accounting of
+VM_LoadInstructions valid: the stack depth at every remaining label is unchanged.
+VM_LoadInstructions also finds the end of a procedure by looking for the first
+PUSH + LEAVE pair, so no such pair may ever be created before the final one.
+*/
+
+struct asmOpInfo_t {
+	int size;	// operand bytes
+	int pops;	// opStack slots consumed
+	int pushes;	// opStack slots produced
+};
+
+static asmOpInfo_t asmOps[OP_MAX];
+
+static void InitOpInfo()
+{
+	static const int unary[] = { OP_LOAD1, OP_LOAD2, OP_LOAD4, OP_SEX8, OP_SEX16, OP_NEGI, OP_BCOM, OP_NEGF, OP_CVIF, OP_CVFI };
+	static const int binary[] = {
+		OP_ADD, OP_SUB, OP_DIVI, OP_DIVU, OP_MODI, OP_MODU, OP_MULI, OP_MULU,
+		OP_BAND, OP_BOR, OP_BXOR, OP_LSH, OP_RSHI, OP_RSHU, OP_ADDF, OP_SUBF, OP_DIVF, OP_MULF
+	};
+
+	for (size_t i = 0; i < ARRAY_LEN(unary); ++i) {
+		asmOps[unary[i]].pops = 1;
+		asmOps[unary[i]].pushes = 1;
+	}
+	for (size_t i = 0; i < ARRAY_LEN(binary); ++i) {
+		asmOps[binary[i]].pops = 2;
+		asmOps[binary[i]].pushes = 1;
+	}
+	for (int i = OP_EQ; i <= OP_GEF; ++i) {
+		asmOps[i].size = 4;
+		asmOps[i].pops = 2;
+	}
+
+	asmOps[OP_ENTER].size = 4;
+	asmOps[OP_LEAVE].size = 4;
+	asmOps[OP_LEAVE].pops = 1;
+	asmOps[OP_CALL].pops = 1;
+	asmOps[OP_CALL].pushes = 1;
+	asmOps[OP_PUSH].pushes = 1;
+	asmOps[OP_POP].pops = 1;
+	asmOps[OP_CONST].size = 4;
+	asmOps[OP_CONST].pushes = 1;
+	asmOps[OP_LOCAL].size = 4;
+	asmOps[OP_LOCAL].pushes = 1;
+	asmOps[OP_JUMP].pops = 1;
+	asmOps[OP_STORE1].pops = 2;
+	asmOps[OP_STORE2].pops = 2;
+	asmOps[OP_STORE4].pops = 2;
+	asmOps[OP_ARG].size = 1;
+	asmOps[OP_ARG].pops = 1;
+	asmOps[OP_BLOCK_COPY].size = 4;
+	asmOps[OP_BLOCK_COPY].pops = 2;
+}
+
+
+struct asmInstruction_t {
+	int op;
+	int value;
+	qboolean literal;		// value is a plain number
+	char* target;			// label operand of a jump, owned
+	int firstLabel;			// into procLabels, first label defined right before this instruction or -1
+	qboolean removed;
+};
+
+struct asmLabel_t {
+	char* name;				// owned
+	int index;				// into procCode
+	int next;				// into procLabels, next label of the same instruction or -1
+};
+
+typedef stdext::hash_map< const char*, int, VanillaStringCmp > LabelTable;
+
+static qboolean bufferingProc;
+static std::vector<asmInstruction_t> procCode;
+static std::vector<asmLabel_t> procLabels;
+static LabelTable procLabelTable;	// label name -> index into procLabels
+
+struct optStats_t {
+	int folded;
+	int reduced;
+	int deadStores;
+	int forwarded;
+	int threaded;
+	int inverted;
+	int returns;
+	int removed;
+};
+
+static optStats_t optStats;
+
+
+static void WriteInstruction( int op, int value )
+{
+	EmitByte( &segment[CODESEG], op );
+	if ( asmOps[op].size == 4 ) {
+		EmitInt( &segment[CODESEG], value );
+	} else if ( asmOps[op].size == 1 ) {
+		EmitByte( &segment[CODESEG], value );
+	}
+	instructionCount++;
+}
+
+
+static void EmitInstruction( int op, int value = 0, qboolean literal = qtrue, const char* target = NULL )
+{
+	if ( !bufferingProc ) {
+		WriteInstruction( op, value );
+		return;
+	}
+
+	asmInstruction_t i;
+	i.op = op;
+	i.value = value;
+	i.literal = literal;
+	i.target = target ? copystring( target ) : NULL;
+	i.firstLabel = -1;
+	i.removed = qfalse;
+	procCode.push_back( i );
+}
+
+
+static void SetTarget( asmInstruction_t& ins, const char* target )
+{
+	char* const copy = target ? copystring( target ) : NULL;
+	free( ins.target );
+	ins.target = copy;
+}
+
+
+static int NextLive( int i )
+{
+	const int count = (int)procCode.size();
+	for ( ++i; i < count; ++i ) {
+		if ( !procCode[i].removed )
+			return i;
+	}
+	return -1;
+}
+
+
+static int LiveOp( int i )
+{
+	return i >= 0 ? procCode[i].op : OP_UNDEF;
+}
+
+
+static qboolean HasLabels( int i )
+{
+	return procCode[i].firstLabel >= 0;
+}
+
+
+static qboolean EndsBlock( int op )
+{
+	return op == OP_JUMP || op == OP_LEAVE || ( op >= OP_EQ && op <= OP_GEF );
+}
+
+
+// labels defined on a removed instruction move to the next one
+static void RemoveInstruction( int i )
+{
+	asmInstruction_t& ins = procCode[i];
+	ins.removed = qtrue;
+	optStats.removed++;
+	if ( ins.firstLabel < 0 )
+		return;
+
+	// the final PUSH + LEAVE pair is never removed
+	const int next = NextLive( i );
+	int last = ins.firstLabel;
+	for ( int l = ins.firstLabel; l >= 0; l = procLabels[l].next ) {
+		procLabels[l].index = next;
+		last = l;
+	}
+	procLabels[last].next = procCode[next].firstLabel;
+	procCode[next].firstLabel = ins.firstLabel;
+	ins.firstLabel = -1;
+}
+
+
+static int FindLabel( const char* name )
+{
+	LabelTable::const_iterator it = procLabelTable.find( name );
+	if ( it == procLabelTable.end() )
+		return -1;
+
+	return procLabels[(*it).second].index;
+}
+
+
+/*
+Finds the instruction consuming the value pushed by instruction i
+and which operand it is (1 is the top of the opStack).
+Gives up at the end of the basic block.
+*/
+static int FindConsumer( int i, int* operand )
+{
+	int above = 0;
+	for ( int j = NextLive( i ); j >= 0; j = NextLive( j ) ) {
+		const asmInstruction_t& ins = procCode[j];
+		if ( HasLabels( j ) )
+			return -1;
+		if ( asmOps[ins.op].pops > above ) {
+			*operand = above + 1;
+			return j;
+		}
+		if ( EndsBlock( ins.op ) )
+			return -1;
+		above += asmOps[ins.op].pushes - asmOps[ins.op].pops;
+	}
+	return -1;
+}
+
+
+static qboolean FoldBinary( int op, int a, int b, int* result )
+{
+	switch ( op ) {
+		case OP_ADD: *result = (int)( (unsigned)a + (unsigned)b ); return qtrue;
+		case OP_SUB: *result = (int)( (unsigned)a - (unsigned)b ); return qtrue;
+		case OP_MULI:
+		case OP_MULU: *result = (int)( (unsigned)a * (unsigned)b ); return qtrue;
+		case OP_BAND: *result = a & b; return qtrue;
+		case OP_BOR: *result = a | b; return qtrue;
+		case OP_BXOR: *result = a ^ b; return qtrue;
+		case OP_LSH: if ( b < 0 || b > 31 ) return qfalse; *result = (int)( (unsigned)a << b ); return qtrue;
+		case OP_RSHI: if ( b < 0 || b > 31 ) return qfalse; *result = a >> b; return qtrue;
+		case OP_RSHU: if ( b < 0 || b > 31 ) return qfalse; *result = (int)( (unsigned)a >> b ); return qtrue;
+		case OP_DIVI: if ( b == 0 || ( a == (int)0x80000000 && b == -1 ) ) return qfalse; *result = a / b; return qtrue;
+		case OP_MODI: if ( b == 0 || ( a == (int)0x80000000 && b == -1 ) ) return qfalse; *result = a % b; return qtrue;
+		case OP_DIVU: if ( b == 0 ) return qfalse; *result = (int)( (unsigned)a / (unsigned)b ); return qtrue;
+		case OP_MODU: if ( b == 0 ) return qfalse; *result = (int)( (unsigned)a % (unsigned)b ); return qtrue;
+		default: return qfalse;
+	}
+}
+
+
+static int Log2( int v )
+{
+	if ( v <= 0 || ( v & ( v - 1 ) ) )
+		return -1;
+
+	int n = 0;
+	while ( ( 1 << n ) != v )
+		n++;
+	return n;
+}
+
+
+// CONST a, CONST b, op -> CONST (a op b)
+// CONST a, unary op -> CONST (op a)
+static qboolean FoldConstants( int i )
+{
+	asmInstruction_t& a = procCode[i];
+	if ( a.op != OP_CONST || !a.literal )
+		return qfalse;
+
+	const int j = NextLive( i );
+	if ( j < 0 || HasLabels( j ) )
+		return qfalse;
+
+	asmInstruction_t& b = procCode[j];
+	if ( b.op == OP_NEGI || b.op == OP_BCOM || b.op == OP_SEX8 || b.op == OP_SEX16 ) {
+		switch ( b.op ) {
+			case OP_NEGI: a.value = (int)( 0u - (unsigned)a.value ); break;
+			case OP_BCOM: a.value = ~a.value; break;
+			case OP_SEX8: a.value = (signed char)a.value; break;
+			case OP_SEX16: a.value = (short)a.value; break;
+		}
+		RemoveInstruction( j );
+		optStats.folded++;
+		return qtrue;
+	}
+
+	if ( b.op != OP_CONST || !b.literal )
+		return qfalse;
+
+	const int k = NextLive( j );
+	if ( k < 0 || HasLabels( k ) )
+		return qfalse;
+
+	int result;
+	if ( !FoldBinary( procCode[k].op, a.value, b.value, &result ) )
+		return qfalse;
+
+	a.value = result;
+	RemoveInstruction( j );
+	RemoveInstruction( k );
+	optStats.folded++;
+	return qtrue;
+}
+
+
+// x + 0, x * 1, etc are removed
+// multiplications and unsigned divisions by powers of 2 become shifts and masks
+static qboolean ReduceStrength( int i )
+{
+	asmInstruction_t& c = procCode[i];
+	if ( c.op != OP_CONST || !c.literal || HasLabels( i ) )
+		return qfalse;
+
+	const int j = NextLive( i );
+	if ( j < 0 || HasLabels( j ) )
+		return qfalse;
+
+	asmInstruction_t& o = procCode[j];
+	const int v = c.value;
+
+	qboolean identity = qfalse;
+	switch ( o.op ) {
+		case OP_ADD:
+		case OP_SUB:
+		case OP_BOR:
+		case OP_BXOR:
+		case OP_LSH:
+		case OP_RSHI:
+		case OP_RSHU:
+			identity = ( v == 0 );
+			break;
+		case OP_MULI:
+		case OP_MULU:
+		case OP_DIVI:
+		case OP_DIVU:
+			identity = ( v == 1 );
+			break;
+		case OP_BAND:
+			identity = ( v == -1 );
+			break;
+		default:
+			break;
+	}
+
+	if ( identity ) {
+		RemoveInstruction( i );
+		RemoveInstruction( j );
+		optStats.reduced++;
+		return qtrue;
+	}
+
+	const int n = Log2( v );
+	if ( n <= 0 )
+		return qfalse;
+
+	if ( o.op == OP_MULI || o.op == OP_MULU ) {
+		c.value = n;
+		o.op = OP_LSH;
+	} else if ( o.op == OP_DIVU ) {
+		c.value = n;
+		o.op = OP_RSHU;
+	} else if ( o.op == OP_MODU ) {
+		c.value = v - 1;
+		o.op = OP_BAND;
+	} else {
+		return qfalse;
+	}
+
+	optStats.reduced++;
+	return qtrue;
+}
+
+
+// LOCAL a, LOCAL a, LOAD4, STORE4 does nothing
+static qboolean RemoveSelfAssignment( int i )
+{
+	if ( procCode[i].op != OP_LOCAL )
+		return qfalse;
+
+	const int j = NextLive( i );
+	const int k = NextLive( j );
+	const int l = NextLive( k );
+	if ( l < 0 || HasLabels( j ) || HasLabels( k ) || HasLabels( l ) )
+		return qfalse;
+
+	if ( procCode[j].op != OP_LOCAL || procCode[j].value != procCode[i].value ||
+		procCode[k].op != OP_LOAD4 || procCode[l].op != OP_STORE4 )
+		return qfalse;
+
+	RemoveInstruction( i );
+	RemoveInstruction( j );
+	RemoveInstruction( k );
+	RemoveInstruction( l );
+	optStats.deadStores++;
+	return qtrue;
+}
+
+
+static qboolean IsLoad( int op )
+{
+	return op == OP_LOAD1 || op == OP_LOAD2 || op == OP_LOAD4;
+}
+
+
+static qboolean IsStore( int op )
+{
+	return op == OP_STORE1 || op == OP_STORE2 || op == OP_STORE4;
+}
+
+
+/*
+Returns the lowest local address that is used for anything else than LOCAL+LOAD / LOCAL+...+STORE
+(passed to a function, stored, indexed, etc) or INT_MAX if there is none.
+lcc gives every local its own slot and the memory reachable from such an address
+starts at that address, so the locals below it can only be accessed directly.
+*/
+static int LowestEscapedLocal()
+{
+	int lowest = INT_MAX;
+	for ( int i = NextLive( -1 ); i >= 0; i = NextLive( i ) ) {
+		if ( procCode[i].op != OP_LOCAL )
+			continue;
+		if ( IsLoad( LiveOp( NextLive( i ) ) ) )
+			continue;
+		int operand;
+		const int c = FindConsumer( i, &operand );
+		if ( c < 0 || !IsStore( procCode[c].op ) || operand != 2 )
+			lowest = min( lowest, procCode[i].value );
+	}
+
+	return lowest;
+}
+
+
+static int escapedLocal;	// LowestEscapedLocal of the current procedure
+
+static qboolean IsPrivateLocal( int a )
+{
+	return a + 4 <= escapedLocal;
+}
+
+
+static qboolean Overlaps( int a, int b )
+{
+	return a - b < 4 && b - a < 4;
+}
+
+
+// scans for a read of local a until the matching STORE4 of the address pushed at i
+static qboolean ReadBeforeStore( int i, int a )
+{
+	int operand;
+	const int c = FindConsumer( i, &operand );
+	if ( c < 0 || procCode[c].op != OP_STORE4 )
+		return qtrue;
+
+	for ( int j = NextLive( i ); j != c; j = NextLive( j ) ) {
+		if ( procCode[j].op == OP_LOCAL && Overlaps( procCode[j].value, a ) )
+			return qtrue;
+	}
+
+	return qfalse;
+}
+
+
+// LOCAL a, <CONST or LOCAL b LOAD4>, STORE4 overwritten later in the block without a read in between
+static qboolean RemoveDeadStore( int i )
+{
+	if ( procCode[i].op != OP_LOCAL )
+		return qfalse;
+
+	const int a = procCode[i].value;
+	if ( !IsPrivateLocal( a ) )
+		return qfalse;
+
+	int j = NextLive( i );
+	if ( j < 0 || HasLabels( j ) )
+		return qfalse;
+
+	int e;
+	if ( procCode[j].op == OP_CONST ) {
+		e = NextLive( j );
+	} else if ( procCode[j].op == OP_LOCAL && LiveOp( NextLive( j ) ) == OP_LOAD4 && !HasLabels( NextLive( j ) ) ) {
+		e = NextLive( NextLive( j ) );
+	} else {
+		return qfalse;
+	}
+
+	if ( e < 0 || HasLabels( e ) || procCode[e].op != OP_STORE4 )
+		return qfalse;
+
+	for ( int k = NextLive( e ); k >= 0; k = NextLive( k ) ) {
+		const asmInstruction_t& ins = procCode[k];
+		if ( HasLabels( k ) || EndsBlock( ins.op ) )
+			return qfalse;
+		if ( ins.op != OP_LOCAL || !Overlaps( ins.value, a ) )
+			continue;
+		if ( ins.value != a || IsLoad( LiveOp( NextLive( k ) ) ) || ReadBeforeStore( k, a ) )
+			return qfalse;
+
+		// overwritten before being read
+		for ( int r = i; r != NextLive( e ); r = NextLive( r ) )
+			RemoveInstruction( r );
+		optStats.deadStores++;
+		return qtrue;
+	}
+
+	return qfalse;
+}
+
+
+// the instruction at i is the LOCAL a of a STORE4 immediately followed by LOCAL a, LOAD4
+// returns the STORE4
+static int FindStoreAndReload( int i )
+{
+	int operand;
+	const int s = FindConsumer( i, &operand );
+	if ( s < 0 || procCode[s].op != OP_STORE4 || operand != 2 )
+		return -1;
+
+	const int r = NextLive( s );
+	if ( r < 0 || HasLabels( r ) || procCode[r].op != OP_LOCAL || procCode[r].value != procCode[i].value )
+		return -1;
+
+	const int l = NextLive( r );
+	if ( l < 0 || HasLabels( l ) || procCode[l].op != OP_LOAD4 )
+		return -1;
+
+	return s;
+}
+
+
+// true when every read of local a is the reload right after a store to it
+static qboolean OnlyReloadsRead( int a )
+{
+	int reads = 0;
+	int reloads = 0;
+	for ( int i = NextLive( -1 ); i >= 0; i = NextLive( i ) ) {
+		const asmInstruction_t& ins = procCode[i];
+		if ( ins.op != OP_LOCAL || !Overlaps( ins.value, a ) )
+			continue;
+		if ( ins.value != a )
+			return qfalse;
+
+		const int next = LiveOp( NextLive( i ) );
+		if ( next == OP_LOAD4 ) {
+			reads++;
+		} else if ( IsLoad( next ) ) {
+			return qfalse;
+		} else if ( FindStoreAndReload( i ) >= 0 ) {
+			reloads++;
+		}
+	}
+
+	return reads == reloads;
+}
+
+
+/*
+LOCAL a, <value>, STORE4, LOCAL a, LOAD4 -> <value>
+lcc spills most intermediate results to temporaries (call results, "*p++" operands, etc)
+and immediately loads them back, recomputing the address of the temporary it just wrote to.
+The store can only go away when nothing else ever reads the temporary.
+*/
+static qboolean ForwardStore( int i )
+{
+	if ( procCode[i].op != OP_LOCAL )
+		return qfalse;
+
+	if ( !IsPrivateLocal( procCode[i].value ) )
+		return qfalse;
+
+	const int s = FindStoreAndReload( i );
+	if ( s < 0 || !OnlyReloadsRead( procCode[i].value ) )
+		return qfalse;
+
+	const int r = NextLive( s );
+	const int l = NextLive( r );
+	RemoveInstruction( i );
+	RemoveInstruction( s );
+	RemoveInstruction( r );
+	RemoveInstruction( l );
+	optStats.forwarded++;
+	return qtrue;
+}
+
+
+// jumps to unconditional jumps go straight to the final target
+// and unconditional jumps to the next instruction are removed
+static qboolean ThreadJump( int i )
+{
+	asmInstruction_t& ins = procCode[i];
+	const qboolean conditional = ins.op >= OP_EQ && ins.op <= OP_GEF;
+	int jump = -1;
+	if ( ins.op == OP_CONST ) {
+		jump = NextLive( i );
+		if ( LiveOp( jump ) != OP_JUMP || HasLabels( jump ) )
+			return qfalse;
+	} else if ( !conditional ) {
+		return qfalse;
+	}
+
+	if ( !ins.target )
+		return qfalse;
+
+	qboolean changed = qfalse;
+	for ( int hops = 0; hops < 16; ++hops ) {
+		const int t = FindLabel( ins.target );
+		if ( t < 0 || t == i )
+			break;
+
+		if ( jump >= 0 && t == NextLive( jump ) ) {
+			RemoveInstruction( i );
+			RemoveInstruction( jump );
+			optStats.threaded++;
+			return qtrue;
+		}
+
+		const int tj = NextLive( t );
+		if ( procCode[t].op != OP_CONST || !procCode[t].target || LiveOp( tj ) != OP_JUMP || HasLabels( tj ) )
+			break;
+
+		// a jump to itself would be rejected by the VM and loops that never move on are left alone
+		const int next = FindLabel( procCode[t].target );
+		if ( next == i || next == t )
+			break;
+
+		SetTarget( ins, procCode[t].target );
+		optStats.threaded++;
+		changed = qtrue;
+	}
+
+	return changed;
+}
+
+
+// the opposite integer comparison, floating-point comparisons can't be inverted because of NaNs
+static int InvertedBranch( int op )
+{
+	switch ( op ) {
+		case OP_EQ: return OP_NE;
+		case OP_NE: return OP_EQ;
+		case OP_LTI: return OP_GEI;
+		case OP_LEI: return OP_GTI;
+		case OP_GTI: return OP_LEI;
+		case OP_GEI: return OP_LTI;
+		case OP_LTU: return OP_GEU;
+		case OP_LEU: return OP_GTU;
+		case OP_GTU: return OP_LEU;
+		case OP_GEU: return OP_LTU;
+		default: return OP_UNDEF;
+	}
+}
+
+
+// cond a, CONST b, JUMP, a: -> !cond b, a:
+static qboolean InvertBranch( int i )
+{
+	asmInstruction_t& ins = procCode[i];
+	const int inverted = InvertedBranch( ins.op );
+	if ( inverted == OP_UNDEF || !ins.target )
+		return qfalse;
+
+	const int c = NextLive( i );
+	const int j = NextLive( c );
+	if ( j < 0 || HasLabels( c ) || HasLabels( j ) )
+		return qfalse;
+	if ( procCode[c].op != OP_CONST || !procCode[c].target || procCode[j].op != OP_JUMP )
+		return qfalse;
+	const int t = FindLabel( ins.target );
+	if ( t < 0 || t != NextLive( j ) )
+		return qfalse;
+
+	ins.op = inverted;
+	SetTarget( ins, procCode[c].target );
+	RemoveInstruction( c );
+	RemoveInstruction( j );
+	optStats.inverted++;
+	return qtrue;
+}
+
+
+/*
+CONST end, JUMP -> CONST 0, LEAVE
+when the end label is on the final PUSH + LEAVE pair.
+The returned value is undefined either way.
+*/
+static qboolean JumpToReturn( int i )
+{
+	asmInstruction_t& ins = procCode[i];
+	if ( ins.op != OP_CONST || !ins.target )
+		return qfalse;
+
+	const int j = NextLive( i );
+	if ( LiveOp( j ) != OP_JUMP || HasLabels( j ) )
+		return qfalse;
+
+	const int leave = (int)procCode.size() - 1;
+	if ( FindLabel( ins.target ) != leave - 1 )
+		return qfalse;
+
+	ins.value = 0;
+	ins.literal = qtrue;
+	SetTarget( ins, NULL );
+	procCode[j].op = OP_LEAVE;
+	procCode[j].value = procCode[leave].value;
+	optStats.returns++;
+	return qtrue;
+}
+
+
+// instructions between an unconditional jump or return and the next label are never executed
+static qboolean RemoveUnreachable( int i )
+{
+	const int op = procCode[i].op;
+	if ( op != OP_JUMP && op != OP_LEAVE )
+		return qfalse;
+
+	// the final PUSH + LEAVE pair must remain
+	const int last = (int)procCode.size() - 2;
+	int depth = 0;
+	int end = NextLive( i );
+	while ( end >= 0 && end < last && !HasLabels( end ) ) {
+		depth += asmOps[procCode[end].op].pushes - asmOps[procCode[end].op].pops;
+		end = NextLive( end );
+	}
+
+	if ( depth != 0 || end == NextLive( i ) )
+		return qfalse;
+
+	for ( int r = NextLive( i ); r != end; r = NextLive( r ) )
+		RemoveInstruction( r );
+
+	return qtrue;
+}
+
+
+static void OptimizeProc()
+{
+	for ( int l = 0; l < (int)procLabels.size(); ++l ) {
+		asmInstruction_t& ins = procCode[procLabels[l].index];
+		procLabels[l].next = ins.firstLabel;
+		ins.firstLabel = l;
+		procLabelTable[procLabels[l].name] = l;
+	}
+
+	escapedLocal = LowestEscapedLocal();
+
+	qboolean changed = qtrue;
+	for ( int pass = 0; changed && pass < 8; ++pass ) {
+		changed = qfalse;
+		for ( int i = NextLive( -1 ); i >= 0; i = NextLive( i ) ) {
+			if ( FoldConstants( i ) ||
+				ReduceStrength( i ) ||
+				RemoveSelfAssignment( i ) ||
+				RemoveDeadStore( i ) ||
+				ForwardStore( i ) ||
+				ThreadJump( i ) ||
+				InvertBranch( i ) ||
+				JumpToReturn( i ) ||
+				RemoveUnreachable( i ) ) {
+				changed = qtrue;
+			}
+		}
+	}
+}
+
+
+static void FlushProc()
+{
+	segment_t* const oldSegment = currentSegment;
+	currentSegment = &segment[CODESEG];
+
+	const int count = (int)procCode.size();
+	for ( int i = 0; i < count; ++i ) {
+		asmInstruction_t& ins = procCode[i];
+		if ( !ins.removed ) {
+			for ( int l = ins.firstLabel; l >= 0; l = procLabels[l].next )
+				DefineSymbol( procLabels[l].name, instructionCount );
+			WriteInstruction( ins.op, ins.target ? LookupSymbol( ins.target ) : ins.value );
+		}
+		free( ins.target );
+	}
+
+	for ( size_t l = 0; l < procLabels.size(); ++l )
+		free( procLabels[l].name );
+
+	currentSegment = oldSegment;
+	procCode.clear();
+	procLabels.clear();
+	procLabelTable.clear();
+}
+
+
 #define ASM(O) static qboolean TryAssemble##O()
 
 // call instructions reset currentArgOffset
 ASM(CALL)
 {
 	if ( !strncmp( token, "CALL", 4 ) ) {
-		EmitByte( &segment[CODESEG], OP_CALL );
-		instructionCount++;
+		EmitInstruction( OP_CALL );
 		currentArgOffset = 0;
 		return qtrue;
 	}
@@ -472,13 +1273,11 @@ ASM(CALL)
 ASM(ARG)
 {
 	if ( !strncmp( token, "ARG", 3 ) ) {
-		EmitByte( &segment[CODESEG], OP_ARG );
-		instructionCount++;
 		if ( 8 + currentArgOffset >= 256 ) {
 			CodeError( "currentArgOffset >= 256" );
 			return qtrue;
 		}
-		EmitByte( &segment[CODESEG], 8 + currentArgOffset );
+		EmitInstruction( OP_ARG, 8 + currentArgOffset );
 		currentArgOffset += 4;
 		return qtrue;
 	}
@@ -489,9 +1288,7 @@ ASM(ARG)
 ASM(RET)
 {
 	if ( !strncmp( token, "RET", 3 ) ) {
-		EmitByte( &segment[CODESEG], OP_LEAVE );
-		instructionCount++;
-		EmitInt( &segment[CODESEG], 8 + currentLocals + currentArgs );
+		EmitInstruction( OP_LEAVE, 8 + currentLocals + currentArgs );
 		return qtrue;
 	}
 	return qfalse;
@@ -501,8 +1298,7 @@ ASM(RET)
 ASM(POP)
 {
 	if ( !strncmp( token, "pop", 3 ) ) {
-		EmitByte( &segment[CODESEG], OP_POP );
-		instructionCount++;
+		EmitInstruction( OP_POP );
 		return qtrue;
 	}
 	return qfalse;
@@ -512,11 +1308,9 @@ ASM(POP)
 ASM(ADDRF)
 {
 	if ( !strncmp( token, "ADDRF", 5 ) ) {
-		instructionCount++;
 		GetToken();
 		int v = ParseExpression() + 16 + currentArgs + currentLocals;
-		EmitByte( &segment[CODESEG], OP_LOCAL );
-		EmitInt( &segment[CODESEG], v );
+		EmitInstruction( OP_LOCAL, v );
 		return qtrue;
 	}
 	return qfalse;
@@ -526,11 +1320,9 @@ ASM(ADDRF)
 ASM(ADDRL)
 {
 	if ( !strncmp( token, "ADDRL", 5 ) ) {
-		instructionCount++;
 		GetToken();
 		int v = ParseExpression() + 8 + currentArgs;
-		EmitByte( &segment[CODESEG], OP_LOCAL );
-		EmitInt( &segment[CODESEG], v );
+		EmitInstruction( OP_LOCAL, v );
 		return qtrue;
 	}
 	return qfalse;
@@ -551,9 +1343,8 @@ ASM(PROC)
 			CodeError( "Locals > 32k in %s\n", token );
 		}
 
-		instructionCount++;
-		EmitByte( &segment[CODESEG], OP_ENTER );
-		EmitInt( &segment[CODESEG], 8 + currentLocals + currentArgs );
+		EmitInstruction( OP_ENTER, 8 + currentLocals + currentArgs );
+		bufferingProc = options.optimize;
 		return qtrue;
 	}
 	return qfalse;
@@ -568,12 +1359,14 @@ ASM(ENDPROC)
 		v2 = ParseValue();		// arg marshalling
 
 		// all functions must leave something on the opstack
-		instructionCount++;
-		EmitByte( &segment[CODESEG], OP_PUSH );
+		EmitInstruction( OP_PUSH );
+		EmitInstruction( OP_LEAVE, 8 + currentLocals + currentArgs );
 
-		instructionCount++;
-		EmitByte( &segment[CODESEG], OP_LEAVE );
-		EmitInt( &segment[CODESEG], 8 + currentLocals + currentArgs );
+		if ( bufferingProc ) {
+			bufferingProc = qfalse;
+			OptimizeProc();
+			FlushProc();
+		}
 
 		return qtrue;
 	}
@@ -736,7 +1529,10 @@ ASM(LABEL)
 {
 	if ( !strncmp( token, "LABEL", 5 ) ) {
 		GetToken();
-		if ( currentSegment == &segment[CODESEG] ) {
+		if ( currentSegment == &segment[CODESEG] && bufferingProc ) {
+			asmLabel_t label = { copystring( token ), (int)procCode.size(), -1 };
+			procLabels.push_back( label );
+		} else if ( currentSegment == &segment[CODESEG] ) {
 			DefineSymbol( token, instructionCount );
 		} else {
 			DefineSymbol( token, currentSegment->imageUsed );
@@ -784,9 +1580,16 @@ static void AssembleLine()
 		// check for expression
 		GetToken();
 
-		EmitByte( &segment[CODESEG], opcode );
+		int expression = 0;
+		qboolean literal = qtrue;
+		const char* target = NULL;
 		if ( token[0] && opcode != OP_CVIF && opcode != OP_CVFI ) {
-			int expression = ParseExpression();
+			// plain label operands can be retargeted by the optimizer
+			if ( token[0] == '$' && !strpbrk( token, "+-" ) ) {
+				target = token;
+			}
+			expression = ParseExpression();
+			literal = expressionIsLiteral;
 			// code like this can generate non-dword block copies:
 			// auto char buf[2] = " ";
 			// we are just going to round up.  This might conceivably
@@ -794,10 +1597,9 @@ static void AssembleLine()
 			if ( opcode == OP_BLOCK_COPY ) {
 				expression = ( expression + 3 ) & ~3;
 			}
-			EmitInt( &segment[CODESEG], expression );
 		}
 
-		instructionCount++;
+		EmitInstruction( opcode, expression, literal, target );
 		return;
 	}
 
@@ -856,6 +1658,8 @@ static void InitTables()
 	segment[LITSEG].name = "LS";
 	segment[BSSSEG].name = "BS";
 	segment[JTRGSEG].name = "JT";
+
+	InitOpInfo();
 }
 
 
@@ -899,6 +1703,10 @@ static void WriteVmFile()
 	for (int seg = 0; seg < NUM_SEGMENTS; ++seg)
 		report( "%s: %7i\n", segment[seg].name, segment[seg].imageUsed );
 	report( "instruction count: %i\n", instructionCount );
+	if ( options.optimize ) {
+		report( "optimizer: %i folded, %i reduced, %i dead stores, %i stores forwarded, %i jumps threaded, %i branches inverted, %i jumps to returns, %i instructions removed\n",
+			optStats.folded, optStats.reduced, optStats.deadStores, optStats.forwarded, optStats.threaded, optStats.inverted, optStats.returns, optStats.removed );
+	}
 
 	if ( errorCount != 0 ) {
 		report( "Not writing a file due to errors\n" );
@@ -956,6 +1764,7 @@ static void Assemble()
 		}
 		segment[DATASEG].imageUsed = 4;		// skip the 0 byte, so NULL pointers are fixed up properly
 		instructionCount = 0;
+		memset( &optStats, 0, sizeof( optStats ) );
 
 		for ( i = 0 ; i < numAsmFiles ; i++ ) {
 			currentFileIndex = i;
@@ -1035,6 +1844,7 @@ int main( int argc, char **argv )
 				"-o OUTPUT     Write assembled output to file OUTPUT.qvm\n"
 				"-f LISTFILE   Read options and list of files to assemble from LISTFILE\n"
 				"-m            Write symbols to a .map file\n"
+				"-O            Optimize the generated bytecode\n"
 				"-v            Verbose compilation report\n"
 				, argv[0] );
 	}
@@ -1079,6 +1889,11 @@ int main( int argc, char **argv )
 			continue;
 		}
 
+		if ( !strcmp( argv[ i ], "-O" ) ) {
+			options.optimize = qtrue;
+			continue;
+		}
+
 		Com_Error( ERR_FATAL, "Unknown option: %s", argv[i] );
 	}
 
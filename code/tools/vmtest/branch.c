@@ -0,0 +1,157 @@
+// control flow: switches, loops, comparisons and calls
+
+#include "vmtest.h"
+
+static int DenseSwitch( int n );
+static int SparseSwitch( int n );
+static int NestedLoops( int n );
+static int Comparisons( int n );
+static int Ackermann( int m, int n );
+static int Recursion( int n );
+static int EarlyReturns( int n );
+
+int results[8];
+
+int vmMain( int command, int arg0, int arg1, int arg2 )
+{
+	switch ( command ) {
+		case 0: return results[0] = DenseSwitch( arg0 );
+		case 1: return results[1] = SparseSwitch( arg0 );
+		case 2: return results[2] = NestedLoops( arg0 );
+		case 3: return results[3] = Comparisons( arg0 );
+		case 4: return results[4] = Ackermann( arg0, arg1 );
+		case 5: return results[5] = Recursion( arg0 );
+		case 6: return results[6] = EarlyReturns( arg0 );
+		default: return -1;
+	}
+}
+
+static int DenseSwitch( int n )
+{
+	int i, s = 0;
+	for ( i = 0; i < n; i++ ) {
+		switch ( i % 10 ) {
+			case 0: s += 1; break;
+			case 1: s -= 3; break;
+			case 2: s ^= 5; break;
+			case 3: s += i; break;
+			case 4: s <<= 1; break;
+			case 5: s >>= 1; break;
+			case 6: s |= 16; break;
+			case 7: s &= 0xFFFF;
+			case 8: s += 7; break;
+			default: s--; break;
+		}
+	}
+	return s;
+}
+
+static int SparseSwitch( int n )
+{
+	int i, s = 0;
+	for ( i = 0; i < n; i++ ) {
+		switch ( ( i * 37 ) % 1000 ) {
+			case 3: s += 1; break;
+			case 74: s += 2; break;
+			case 111: s += 3; break;
+			case 500: s += 4; break;
+			case 999: s += 5; break;
+			default: break;
+		}
+	}
+	return s;
+}
+
+static int NestedLoops( int n )
+{
+	int i, j, k, s = 0;
+	for ( i = 0; i < n; i++ ) {
+		for ( j = 0; j < i; j++ ) {
+			if ( j == 3 )
+				continue;
+			if ( j > 40 )
+				break;
+			k = 0;
+			do {
+				s += i ^ j ^ k;
+			} while ( ++k < 3 );
+		}
+		if ( s > 1000000 )
+			s -= 1000000;
+	}
+	return s;
+}
+
+static int Comparisons( int n )
+{
+	int i, s = 0;
+	unsigned int u;
+	float f;
+	for ( i = -n; i < n; i++ ) {
+		u = (unsigned int)i;
+		f = (float)i * 0.5f;
+		s += ( i < 3 ) + ( i <= -2 ) * 2 + ( i > 7 ) * 4 + ( i >= 0 ) * 8 + ( i == 5 ) * 16 + ( i != 9 ) * 32;
+		s += ( u < 3u ) + ( u <= 100u ) * 2 + ( u > 0x80000000u ) * 4 + ( u >= 7u ) * 8;
+		s += ( f < 1.0f ) + ( f <= -1.5f ) * 2 + ( f > 2.0f ) * 4 + ( f >= 0.0f ) * 8 + ( f == 3.5f ) * 16 + ( f != 0.5f ) * 32;
+	}
+	return s;
+}
+
+static int Ackermann( int m, int n )
+{
+	if ( m == 0 )
+		return n + 1;
+	if ( n == 0 )
+		return Ackermann( m - 1, 1 );
+	return Ackermann( m - 1, Ackermann( m, n - 1 ) );
+}
+
+static int Recursion( int n )
+{
+	if ( n < 2 )
+		return n;
+	return Recursion( n - 1 ) + Recursion( n - 2 );
+}
+
+static int state;
+
+static void Step( int i )
+{
+	if ( i % 7 == 0 ) {
+		state += 3;
+		return;
+	}
+	if ( i % 5 == 0 ) {
+		state ^= i;
+		return;
+	}
+	while ( i > 10 ) {
+		if ( i & 1 ) {
+			i = i * 3 + 1;
+		} else {
+			i >>= 1;
+		}
+	}
+	state += i;
+}
+
+static int EarlyReturns( int n )
+{
+	int i;
+	state = 0;
+	for ( i = 0; i < n; i++ ) {
+		if ( i & 1 ) {
+			state += 2;
+			while ( state > 50 && ( state & 3 ) )
+				state--;
+		} else {
+			Step( i );
+		}
+		if ( state > 100000 ) {
+			state -= 100000;
+		} else if ( state < 0 ) {
+			state = -state;
+		}
+	}
+	return state;
+}
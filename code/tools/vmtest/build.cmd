@@ -0,0 +1,18 @@
+@echo off
+rem builds the test QVMs of the vmtest command into %1 (default: vm)
+rem q3lcc.exe and q3asm.exe are the in-tree code\tools\lcc and code\tools\asm builds
+
+setlocal
+if "%LCC%"=="" set LCC=q3lcc
+if "%Q3ASM%"=="" set Q3ASM=q3asm
+set OUTDIR=%~1
+if "%OUTDIR%"=="" set OUTDIR=vm
+set SRCDIR=%~dp0
+
+if not exist "%OUTDIR%" mkdir "%OUTDIR%" || exit /b 1
+for %%N in (int float branch memory) do (
+	%LCC% -DQ3_VM -S -Wf-target=bytecode -Wf-g -o "%OUTDIR%\%%N.asm" "%SRCDIR%%%N.c" || exit /b 1
+	%Q3ASM% -o "%OUTDIR%\%%N" "%OUTDIR%\%%N.asm" "%SRCDIR%vmtest_syscalls.asm" || exit /b 1
+	copy /y "%SRCDIR%%%N.calls" "%OUTDIR%\" > nul || exit /b 1
+	del "%OUTDIR%\%%N.asm"
+)
@@ -0,0 +1,18 @@
+#!/bin/sh
+
+# builds the test QVMs of the vmtest command into $1 (default: ./vm, where the built QVMs are committed)
+# q3lcc and q3asm are the in-tree code/tools/lcc and code/tools/asm builds
+# e.g. Q3ASM="q3asm -O" ./build.sh ~/.q3a/baseq3/vm
+
+LCC="${LCC:-q3lcc}"
+Q3ASM="${Q3ASM:-q3asm}"
+OUTDIR="${1:-vm}"
+SRCDIR="$(cd "$(dirname "$0")" && pwd)"
+
+mkdir -p "$OUTDIR" || exit 1
+for NAME in int float branch memory; do
+	$LCC -DQ3_VM -S -Wf-target=bytecode -Wf-g -o "$OUTDIR/$NAME.asm" "$SRCDIR/$NAME.c" || exit 1
+	$Q3ASM -o "$OUTDIR/$NAME" "$OUTDIR/$NAME.asm" "$SRCDIR/vmtest_syscalls.asm" || exit 1
+	cp "$SRCDIR/$NAME.calls" "$OUTDIR/" || exit 1
+	rm -f "$OUTDIR/$NAME.asm"
+done
@@ -0,0 +1,111 @@
+// floating-point arithmetic and math traps
+
+#include "vmtest.h"
+
+static float Polynomial( int n );
+static float Newton( int n );
+static float Trigonometry( int n );
+static float Normalize( int n );
+static int Conversions( int n );
+static float Rounding( int n );
+
+float results[8];
+
+int vmMain( int command, int arg0, int arg1, int arg2 )
+{
+	float r;
+	switch ( command ) {
+		case 0: r = Polynomial( arg0 ); break;
+		case 1: r = Newton( arg0 ); break;
+		case 2: r = Trigonometry( arg0 ); break;
+		case 3: r = Normalize( arg0 ); break;
+		case 4: return Conversions( arg0 );
+		case 5: r = Rounding( arg0 ); break;
+		default: return -1;
+	}
+	results[command] = r;
+	return FLOAT_RESULT( r );
+}
+
+static float Polynomial( int n )
+{
+	float sum = 0.0f, x;
+	int i;
+	for ( i = 0; i < n; i++ ) {
+		x = (float)i * 0.01f - 2.5f;
+		sum += ( ( ( 3.0f * x - 2.0f ) * x + 0.5f ) * x - 7.25f ) / ( 1.0f + x * x );
+	}
+	return sum;
+}
+
+static float Newton( int n )
+{
+	float sum = 0.0f, x, y;
+	int i, j;
+	for ( i = 1; i <= n; i++ ) {
+		x = (float)i;
+		y = x * 0.5f;
+		for ( j = 0; j < 8; j++ ) {
+			y = 0.5f * ( y + x / y );
+		}
+		sum += y - sqrt( x );
+	}
+	return sum;
+}
+
+static float Trigonometry( int n )
+{
+	float sum = 0.0f, a;
+	int i;
+	for ( i = 0; i < n; i++ ) {
+		a = (float)i * 0.037f;
+		sum += sin( a ) * cos( a ) + atan2( a, 1.0f + a ) - acos( cos( a * 0.5f ) * 0.5f );
+	}
+	return sum;
+}
+
+static float Normalize( int n )
+{
+	float v[3], length, sum = 0.0f;
+	int i;
+	for ( i = 0; i < n; i++ ) {
+		v[0] = (float)( i % 17 ) - 8.0f;
+		v[1] = (float)( i % 5 ) + 0.25f;
+		v[2] = -(float)( i % 3 );
+		length = sqrt( v[0] * v[0] + v[1] * v[1] + v[2] * v[2] );
+		if ( length > 0.0f ) {
+			v[0] /= length;
+			v[1] /= length;
+			v[2] /= length;
+		}
+		sum += v[0] - v[1] * v[2];
+	}
+	return sum;
+}
+
+static int Conversions( int n )
+{
+	int i, s = 0;
+	float f;
+	for ( i = -n; i < n; i++ ) {
+		f = (float)i * 1.75f;
+		s += (int)f;
+		s ^= (int)( -f * 0.3f );
+		if ( f < 0.0f && f != -3.5f )
+			s++;
+		if ( f >= (float)s )
+			s--;
+	}
+	return s;
+}
+
+static float Rounding( int n )
+{
+	float sum = 0.0f, x;
+	int i;
+	for ( i = 0; i < n; i++ ) {
+		x = (float)( i - n / 2 ) * 0.3f;
+		sum += floor( x ) * 2.0f - ceil( x );
+	}
+	return sum;
+}
@@ -0,0 +1,101 @@
+// integer arithmetic
+
+#include "vmtest.h"
+
+static int Fibonacci( int n );
+static int Collatz( int n );
+static int GreatestCommonDivisor( int a, int b );
+static int DivisionMix( int n );
+static int XorShift( int n );
+static int LinearCongruential( int n );
+
+int results[8];
+
+int vmMain( int command, int arg0, int arg1, int arg2 )
+{
+	switch ( command ) {
+		case 0: return results[0] = Fibonacci( arg0 );
+		case 1: return results[1] = Collatz( arg0 );
+		case 2: return results[2] = GreatestCommonDivisor( arg0, arg1 );
+		case 3: return results[3] = DivisionMix( arg0 );
+		case 4: return results[4] = XorShift( arg0 );
+		case 5: return results[5] = LinearCongruential( arg0 );
+		default: return -1;
+	}
+}
+
+static int Fibonacci( int n )
+{
+	int a = 0, b = 1, t;
+	while ( n-- > 0 ) {
+		t = a + b;
+		a = b;
+		b = t;
+	}
+	return a;
+}
+
+static int Collatz( int n )
+{
+	int total = 0, i, x;
+	for ( i = 1; i <= n; i++ ) {
+		x = i;
+		while ( x != 1 ) {
+			x = ( x & 1 ) ? 3 * x + 1 : x / 2;
+			total++;
+		}
+	}
+	return total;
+}
+
+static int GreatestCommonDivisor( int a, int b )
+{
+	int t, sum = 0, i;
+	for ( i = 0; i < 256; i++ ) {
+		int x = a + i, y = b + 3 * i;
+		while ( y != 0 ) {
+			t = x % y;
+			x = y;
+			y = t;
+		}
+		sum += x;
+	}
+	return sum;
+}
+
+static int DivisionMix( int n )
+{
+	int i, s = 0;
+	unsigned int u = 0;
+	for ( i = -n; i < n; i++ ) {
+		s += i / 7 + i % 5 - ( i * 13 ) / -3;
+		s ^= ( i << 3 ) >> 1;
+		u += (unsigned int)i / 9u + (unsigned int)i % 11u;
+		u += ( (unsigned int)i >> 5 ) * 6u;
+	}
+	return s + (int)u;
+}
+
+static int XorShift( int n )
+{
+	unsigned int x = 2463534242u;
+	int i;
+	for ( i = 0; i < n; i++ ) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+	}
+	return (int)x;
+}
+
+static int LinearCongruential( int n )
+{
+	int x = 12345, i, s = 0;
+	for ( i = 0; i < n; i++ ) {
+		x = x * 1103515245 + 12345;
+		s += ( x >> 16 ) & 0x7FFF;
+		s -= ~x & 0xFF;
+		s += -x % 1000;
+	}
+	return s;
+}
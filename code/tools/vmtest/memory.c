@@ -0,0 +1,122 @@
+// loads, stores, block copies and memory traps
+
+#include "vmtest.h"
+
+typedef struct {
+	int		id;
+	short	flags;
+	char	name[10];
+	float	origin[3];
+} item_t;
+
+static int Bytes( int n );
+static int Structs( int n );
+static int Sort( int n );
+static int Strings( int n );
+static int MemoryTraps( int n );
+
+#define MAX_ITEMS	256
+
+item_t items[MAX_ITEMS];
+int numbers[1024];
+unsigned char bytes[1024];
+char text[256];
+int results[8];
+
+int vmMain( int command, int arg0, int arg1, int arg2 )
+{
+	switch ( command ) {
+		case 0: return results[0] = Bytes( arg0 );
+		case 1: return results[1] = Structs( arg0 );
+		case 2: return results[2] = Sort( arg0 );
+		case 3: return results[3] = Strings( arg0 );
+		case 4: return results[4] = MemoryTraps( arg0 );
+		default: return -1;
+	}
+}
+
+static int Bytes( int n )
+{
+	int i, s = 0;
+	signed char c;
+	short h;
+	for ( i = 0; i < n; i++ ) {
+		bytes[i & 1023] = (unsigned char)( i * 7 );
+		c = (signed char)bytes[( i * 3 ) & 1023];
+		h = (short)( c * 300 );
+		s += c + h;
+	}
+	return s;
+}
+
+static int Structs( int n )
+{
+	item_t local;
+	int i, s = 0;
+	// the unused name bytes would otherwise be copied from the stack garbage
+	memset( &local, 0, sizeof( local ) );
+	for ( i = 0; i < n; i++ ) {
+		local.id = i;
+		local.flags = (short)( i * 3 );
+		local.name[0] = (char)( 'a' + i % 26 );
+		local.name[1] = 0;
+		local.origin[0] = (float)i;
+		local.origin[1] = (float)-i;
+		local.origin[2] = 0.5f;
+		items[i % MAX_ITEMS] = local;
+		local = items[( i * 5 ) % MAX_ITEMS];
+		s += local.id + local.flags + local.name[0];
+	}
+	return s;
+}
+
+static int Sort( int n )
+{
+	int i, j, t, x = 7;
+	if ( n > 1024 )
+		n = 1024;
+	for ( i = 0; i < n; i++ ) {
+		x = x * 1103515245 + 12345;
+		numbers[i] = ( x >> 8 ) & 0xFFFF;
+	}
+	for ( i = 1; i < n; i++ ) {
+		t = numbers[i];
+		for ( j = i - 1; j >= 0 && numbers[j] > t; j-- ) {
+			numbers[j + 1] = numbers[j];
+		}
+		numbers[j + 1] = t;
+	}
+	return numbers[0] + numbers[n / 2] * 3 + numbers[n - 1] * 7;
+}
+
+static int Strings( int n )
+{
+	static const char* words[] = { "alpha", "bravo", "charlie", "delta", "echo" };
+	int i, length, s = 0;
+	const char* p;
+	char* d;
+	for ( i = 0; i < n; i++ ) {
+		p = words[i % 5];
+		d = text + ( i % 200 );
+		length = 0;
+		while ( *p ) {
+			*d++ = *p++;
+			length++;
+		}
+		*d = 0;
+		s += length * text[i % 200];
+	}
+	return s;
+}
+
+static int MemoryTraps( int n )
+{
+	int i, s = 0;
+	for ( i = 0; i < n; i++ ) {
+		memset( bytes, i & 0xFF, sizeof( bytes ) );
+		memcpy( numbers, bytes + ( i & 63 ), 256 );
+		strncpy( text, "differential testing", i & 31 );
+		s += numbers[i & 63] + text[0] + bytes[1023];
+	}
+	return s;
+}
@@ -0,0 +1,37 @@
+#!/bin/sh
+
+# checks that the q3asm optimizer (-O) doesn't change what the test QVMs compute
+# every test QVM is built with and without -O and each call must have the same result and data hash
+# q3lcc and q3asm are the in-tree code/tools/lcc and code/tools/asm builds, ./vmtest must be built
+# e.g. Q3ASM=~/cnq3/.build/q3asm ./optcheck.sh
+
+cd "$(dirname "$0")" || exit 1
+
+LCC="${LCC:-q3lcc}"
+Q3ASM="${Q3ASM:-q3asm}"
+DIR="$(mktemp -d)" || exit 1
+trap 'rm -rf "$DIR"' EXIT
+
+LCC="$LCC" Q3ASM="$Q3ASM" ./build.sh "$DIR/plain/vm" || exit 1
+LCC="$LCC" Q3ASM="$Q3ASM -O" ./build.sh "$DIR/opt/vm" || exit 1
+
+# call, result and data hash of each row of the vmtest table
+CALLS='NF == 6 && $6 ~ /x$/ { print $1, $2, $3 }'
+
+FAILED=0
+for NAME in int float branch memory; do
+	./vmtest -b "$DIR/plain" $NAME 1 > "$DIR/plain.txt" || FAILED=1
+	./vmtest -b "$DIR/opt" $NAME 1 > "$DIR/opt.txt" || FAILED=1
+	awk "$CALLS" "$DIR/plain.txt" > "$DIR/plain.calls"
+	awk "$CALLS" "$DIR/opt.txt" > "$DIR/opt.calls"
+	PLAIN_SIZE=$(wc -c < "$DIR/plain/vm/$NAME.qvm")
+	OPT_SIZE=$(wc -c < "$DIR/opt/vm/$NAME.qvm")
+	if [ ! -s "$DIR/plain.calls" ] || ! diff "$DIR/plain.calls" "$DIR/opt.calls"; then
+		echo "$NAME: -O changed the results"
+		FAILED=1
+	else
+		echo "$NAME: $(wc -l < "$DIR/plain.calls") calls match, $PLAIN_SIZE -> $OPT_SIZE bytes"
+	fi
+done
+
+exit $FAILED
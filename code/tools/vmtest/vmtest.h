@@ -0,0 +1,26 @@
+// shared by the test QVMs of the engine's vmtest command
+// vmMain must be the first function of every test QVM
+
+#ifndef NULL
+#define NULL ((void*)0)
+#endif
+
+typedef unsigned int size_t;
+
+void	trap_Print( const char* text );
+void	trap_Error( const char* text );
+int		trap_Milliseconds( void );
+
+void*	memset( void* dest, int c, size_t count );
+void*	memcpy( void* dest, const void* src, size_t count );
+char*	strncpy( char* dest, const char* src, size_t count );
+float	sin( float x );
+float	cos( float x );
+float	atan2( float y, float x );
+float	sqrt( float x );
+float	floor( float x );
+float	ceil( float x );
+float	acos( float x );
+
+// return values are compared bit for bit
+#define FLOAT_RESULT(f)	(*(int*)&(f))
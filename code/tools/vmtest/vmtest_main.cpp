@@ -0,0 +1,331 @@
+/*
+===========================================================================
+Copyright (C) 2024 Gian 'myT' Schellenbaum
+
+This file is part of Challenge Quake 3 (CNQ3).
+
+Challenge Quake 3 is free software; you can redistribute it
+and/or modify it under the terms of the GNU General Public License as
+published by the Free Software Foundation; either version 2 of the License,
+or (at your option) any later version.
+
+Challenge Quake 3 is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with Challenge Quake 3. If not, see <https://www.gnu.org/licenses/>.
+===========================================================================
+*/
+// standalone build of the engine's vmtest command
+// only provides the engine services the VM code needs: no file system, cvars or zone
+
+#include "../../qcommon/vm_local.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <cpuid.h>
+
+
+static const char* host_baseDir = ".";
+
+static cvar_t host_developer;
+cvar_t* com_developer = &host_developer;
+
+int cpu_features = 0;
+int prof_enabled = 0;
+
+
+static void Host_Print( FILE* file, const char* msg )
+{
+	while ( *msg ) {
+		if ( Q_IsColorString( msg ) ) {
+			msg += 2;
+			continue;
+		}
+		fputc( *msg++, file );
+	}
+}
+
+
+void QDECL Com_Printf( const char* fmt, ... )
+{
+	char msg[MAXPRINTMSG];
+	va_list argptr;
+	va_start( argptr, fmt );
+	Q_vsnprintf( msg, sizeof( msg ), fmt, argptr );
+	va_end( argptr );
+
+	Host_Print( stdout, msg );
+}
+
+
+void QDECL Com_DPrintf( const char* fmt, ... )
+{
+}
+
+
+// the engine would drop the game, there is nothing to return to here
+void QDECL Com_Error( int level, const char* fmt, ... )
+{
+	char msg[MAXPRINTMSG];
+	va_list argptr;
+	va_start( argptr, fmt );
+	Q_vsnprintf( msg, sizeof( msg ), fmt, argptr );
+	va_end( argptr );
+
+	fputs( "ERROR: ", stderr );
+	Host_Print( stderr, msg );
+	fputc( '\n', stderr );
+	exit( 2 );
+}
+
+
+// VM_Test_f isn't used
+
+int Cmd_Argc()
+{
+	return 0;
+}
+
+
+const char* Cmd_Argv( int arg )
+{
+	return "";
+}
+
+
+void Cmd_RegisterTable( const cmdTableItem_t* cmds, int count, module_t module )
+{
+}
+
+
+float Cvar_VariableValue( const char* var_name )
+{
+	return 0.0f;
+}
+
+
+int FS_ReadFile( const char* qpath, void** buffer )
+{
+	FILE* const file = fopen( va( "%s/%s", host_baseDir, qpath ), "rb" );
+	if ( !file ) {
+		if ( buffer )
+			*buffer = NULL;
+		return -1;
+	}
+
+	fseek( file, 0, SEEK_END );
+	const int length = (int)ftell( file );
+	fseek( file, 0, SEEK_SET );
+	if ( !buffer ) {
+		fclose( file );
+		return length;
+	}
+
+	byte* const data = (byte*)malloc( length + 1 );
+	if ( !data || fread( data, 1, length, file ) != (size_t)length ) {
+		Com_Error( ERR_FATAL, "couldn't read %s", qpath );
+	}
+	fclose( file );
+	data[length] = '\0';
+	*buffer = data;
+
+	return length;
+}
+
+
+void FS_FreeFile( void* buffer )
+{
+	free( buffer );
+}
+
+
+void* Z_Malloc( int size )
+{
+	void* const buf = calloc( 1, size );
+	if ( !buf )
+		Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes", size );
+
+	return buf;
+}
+
+
+void Z_Free( void* ptr )
+{
+	free( ptr );
+}
+
+
+// a single permanent stack is enough for the 2 test VMs
+
+#define HOST_HUNK_SIZE	(64 << 20)
+
+static byte* host_hunk;
+static int host_hunkUsed;
+
+
+void* Hunk_Alloc( int size, ha_pref preference )
+{
+	size = ( size + 63 ) & ( ~63 );
+	if ( host_hunkUsed + size > HOST_HUNK_SIZE )
+		Com_Error( ERR_DROP, "Hunk_Alloc failed on %i", size );
+
+	byte* const buf = host_hunk + host_hunkUsed;
+	host_hunkUsed += size;
+	Com_Memset( buf, 0, size );
+
+	return buf;
+}
+
+
+int Hunk_MemoryRemaining()
+{
+	return HOST_HUNK_SIZE - host_hunkUsed;
+}
+
+
+hunkConsumer_t Hunk_SetConsumer( hunkConsumer_t consumer )
+{
+	return HC_OTHER;
+}
+
+
+void Hunk_GetLocalMark( hunkMark_t* mark )
+{
+	Com_Memset( mark, 0, sizeof( *mark ) );
+	mark->low = host_hunkUsed;
+}
+
+
+void Hunk_ClearToLocalMark( const hunkMark_t* mark )
+{
+	host_hunkUsed = mark->low;
+}
+
+
+void Crash_SaveQVMPointer( vmIndex_t vmIndex, vm_t* vm )
+{
+}
+
+
+void Crash_SaveQVMChecksum( vmIndex_t vmIndex, unsigned int crc32 )
+{
+}
+
+
+void Prof_RecordScope( const char* name, int64_t start )
+{
+}
+
+
+void* Sys_LoadDll( const char* name, dllSyscall_t* entryPoint, dllSyscall_t systemcalls )
+{
+	return NULL;
+}
+
+
+void Sys_UnloadDll( void* dllHandle )
+{
+}
+
+
+int64_t Sys_Microseconds()
+{
+	timespec ts;
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+
+	return (int64_t)ts.tv_sec * 1000000 + (int64_t)ts.tv_nsec / 1000;
+}
+
+
+float Q_acos( float c )
+{
+	float angle = acos( c );
+
+	if ( angle > M_PI ) {
+		return (float)M_PI;
+	}
+	if ( angle < -M_PI ) {
+		return (float)M_PI;
+	}
+	return angle;
+}
+
+
+static unsigned int CRC32_table[256];
+
+
+void CRC32_Begin( unsigned int* crc )
+{
+	if ( !CRC32_table[1] ) {
+		for ( int i = 0; i < 256; i++ ) {
+			unsigned int c = i;
+			for ( int j = 0; j < 8; j++ )
+				c = c & 1 ? (c >> 1) ^ 0xEDB88320UL : c >> 1;
+			CRC32_table[i] = c;
+		}
+	}
+
+	*crc = 0xFFFFFFFFUL;
+}
+
+
+void CRC32_ProcessBlock( unsigned int* crc, const void* buffer, unsigned int length )
+{
+	unsigned int hash = *crc;
+	const unsigned char* buf = (const unsigned char*)buffer;
+	while ( length-- ) {
+		hash = CRC32_table[(hash ^ *buf++) & 0xFF] ^ (hash >> 8);
+	}
+	*crc = hash;
+}
+
+
+void CRC32_End( unsigned int* crc )
+{
+	*crc ^= 0xFFFFFFFFUL;
+}
+
+
+// the compiler only checks for SSE4.1
+static void Host_GetProcessorInfo()
+{
+	unsigned int eax, ebx, ecx, edx;
+	if ( __get_cpuid( 1, &eax, &ebx, &ecx, &edx ) && ( ecx & ( 1 << 19 ) ) != 0 ) {
+		cpu_features |= CPU_SSE41;
+	}
+}
+
+
+int main( int argc, char** argv )
+{
+	int arg = 1;
+	if ( arg + 1 < argc && !strcmp( argv[arg], "-b" ) ) {
+		host_baseDir = argv[arg + 1];
+		arg += 2;
+	}
+
+	if ( arg >= argc ) {
+		fprintf( stderr, "usage: %s [-b basedir] <qvmname> [iterations]\n", argv[0] );
+		fprintf( stderr, "loads <basedir>/vm/<qvmname>.qvm and <basedir>/vm/<qvmname>.calls, basedir defaults to .\n" );
+		return 2;
+	}
+
+	host_hunk = (byte*)malloc( HOST_HUNK_SIZE );
+	if ( !host_hunk ) {
+		fprintf( stderr, "ERROR: failed to allocate the hunk\n" );
+		return 2;
+	}
+
+	Host_GetProcessorInfo();
+
+	const int iterations = arg + 1 < argc ? max( atoi( argv[arg + 1] ), 1 ) : 1000;
+	const int failures = VM_Test_Run( argv[arg], iterations );
+
+	if ( failures < 0 )
+		return 2;
+
+	return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,18 @@
+code
+
+; must match vmTestImport_t in code/qcommon/vm_test.cpp
+
+equ	trap_Print			-1
+equ	trap_Error			-2
+equ	trap_Milliseconds	-3
+
+equ	memset				-101
+equ	memcpy				-102
+equ	strncpy				-103
+equ	sin					-104
+equ	cos					-105
+equ	atan2				-106
+equ	sqrt				-107
+equ	floor				-108
+equ	ceil				-109
+equ	acos				-110
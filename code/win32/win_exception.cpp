@@ -519,6 +519,10 @@ static LONG WIN_HandleCrash( EXCEPTION_POINTERS* ep )
 	} __except(EXCEPTION_EXECUTE_HANDLER) {}
 #endif
 
+	__try {
+		Com_FlushLogForCrash();
+	} __except(EXCEPTION_EXECUTE_HANDLER) {}
+
 	if (IsDebuggerPresent() && WIN_WouldDebuggingBeOkay())
 		return EXCEPTION_CONTINUE_SEARCH;
 
@@ -167,6 +167,221 @@ void Sys_Mkdir( const char* path )
 }
 
 
+void* Sys_MapFile( const char* path, size_t* size )
+{
+	const HANDLE file = CreateFileA( path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+	if ( file == INVALID_HANDLE_VALUE )
+		return NULL;
+
+	LARGE_INTEGER fileSize;
+	if ( !GetFileSizeEx( file, &fileSize ) || fileSize.QuadPart <= 0 || (ULONGLONG)fileSize.QuadPart > (SIZE_T)-1 ) {
+		CloseHandle( file );
+		return NULL;
+	}
+
+	// the view keeps its own references to the file and the mapping
+	const HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_WRITECOPY, 0, 0, NULL );
+	CloseHandle( file );
+	if ( mapping == NULL )
+		return NULL;
+
+	void* const data = MapViewOfFile( mapping, FILE_MAP_COPY, 0, 0, 0 );
+	CloseHandle( mapping );
+	if ( data == NULL )
+		return NULL;
+
+	*size = (size_t)fileSize.QuadPart;
+
+	return data;
+}
+
+
+void Sys_UnmapFile( void* data, size_t )
+{
+	UnmapViewOfFile( data );
+}
+
+
+// large pages need the "Lock pages in memory" privilege (SeLockMemoryPrivilege)
+// and there is no transparent huge page support, so most users get regular pages
+
+static qbool Sys_EnableLockMemoryPrivilege()
+{
+	HANDLE token;
+	if ( !OpenProcessToken( GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token ) )
+		return qfalse;
+
+	TOKEN_PRIVILEGES privileges;
+	privileges.PrivilegeCount = 1;
+	privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+	qbool success = LookupPrivilegeValueA( NULL, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid ) &&
+		AdjustTokenPrivileges( token, FALSE, &privileges, 0, NULL, NULL ) &&
+		GetLastError() == ERROR_SUCCESS;
+	CloseHandle( token );
+
+	return success;
+}
+
+
+void* Sys_AllocHunk( size_t size, hugePages_t requested, hugePages_t* result )
+{
+	const SIZE_T largePageSize = GetLargePageMinimum();
+	if ( requested == HUGEPAGES_EXPLICIT && largePageSize > 0 && Sys_EnableLockMemoryPrivilege() ) {
+		// large pages are always resident
+		const SIZE_T largeSize = ( size + largePageSize - 1 ) & ~( largePageSize - 1 );
+		void* const data = VirtualAlloc( NULL, largeSize, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE );
+		if ( data != NULL ) {
+			*result = HUGEPAGES_EXPLICIT;
+			return data;
+		}
+	}
+
+	DWORD flags = MEM_RESERVE | MEM_COMMIT;
+#if defined( _DEBUG ) && defined( idx64 )
+	// try to allocate at the highest possible address range to help detect errors during development
+	flags |= MEM_TOP_DOWN;
+#endif
+	byte* const data = (byte*)VirtualAlloc( NULL, size, flags, PAGE_READWRITE );
+	if ( data == NULL )
+		return NULL;
+
+	// committed pages only get faulted in on first access
+	for ( size_t i = 0; i < size; i += 4096 ) {
+		data[i] = 0;
+	}
+
+	*result = HUGEPAGES_NONE;
+
+	return data;
+}
+
+
+int64_t Sys_GetModificationTime( const char* path )
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if ( !GetFileAttributesExA( path, GetFileExInfoStandard, &data ) )
+		return 0;
+
+	return ( (int64_t)data.ftLastWriteTime.dwHighDateTime << 32 ) | (int64_t)data.ftLastWriteTime.dwLowDateTime;
+}
+
+
+qbool Sys_GetFileStats( const char* path, int64_t* size, int64_t* modTime )
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if ( !GetFileAttributesExA( path, GetFileExInfoStandard, &data ) )
+		return qfalse;
+
+	*size = ( (int64_t)data.nFileSizeHigh << 32 ) | (int64_t)data.nFileSizeLow;
+	*modTime = ( (int64_t)data.ftLastWriteTime.dwHighDateTime << 32 ) | (int64_t)data.ftLastWriteTime.dwLowDateTime;
+
+	return qtrue;
+}
+
+
+typedef struct {
+	HANDLE			handle;
+	threadFunc_t	function;
+	void*			userData;
+} sysThread_t;
+
+
+static DWORD WINAPI Sys_ThreadMain( LPVOID data )
+{
+	const sysThread_t* const thread = (const sysThread_t*)data;
+	thread->function( thread->userData );
+
+	return 0;
+}
+
+
+void* Sys_CreateThread( threadFunc_t function, void* userData )
+{
+	sysThread_t* const thread = (sysThread_t*)malloc( sizeof( sysThread_t ) );
+	if ( !thread )
+		return NULL;
+
+	thread->function = function;
+	thread->userData = userData;
+	thread->handle = CreateThread( NULL, 0, &Sys_ThreadMain, thread, 0, NULL );
+	if ( thread->handle == NULL ) {
+		free( thread );
+		return NULL;
+	}
+
+	return thread;
+}
+
+
+void Sys_JoinThread( void* thread )
+{
+	WaitForSingleObject( ((sysThread_t*)thread)->handle, INFINITE );
+	CloseHandle( ((sysThread_t*)thread)->handle );
+	free( thread );
+}
+
+
+void* Sys_CreateMutex()
+{
+	CRITICAL_SECTION* const mutex = (CRITICAL_SECTION*)malloc( sizeof( CRITICAL_SECTION ) );
+	if ( !mutex )
+		return NULL;
+
+	InitializeCriticalSection( mutex );
+
+	return mutex;
+}
+
+
+void Sys_DestroyMutex( void* mutex )
+{
+	DeleteCriticalSection( (CRITICAL_SECTION*)mutex );
+	free( mutex );
+}
+
+
+void Sys_LockMutex( void* mutex )
+{
+	EnterCriticalSection( (CRITICAL_SECTION*)mutex );
+}
+
+
+void Sys_UnlockMutex( void* mutex )
+{
+	LeaveCriticalSection( (CRITICAL_SECTION*)mutex );
+}
+
+
+void* Sys_CreateSemaphore()
+{
+	return CreateSemaphoreA( NULL, 0, LONG_MAX, NULL );
+}
+
+
+void Sys_DestroySemaphore( void* semaphore )
+{
+	CloseHandle( (HANDLE)semaphore );
+}
+
+
+void Sys_PostSemaphore( void* semaphore )
+{
+	ReleaseSemaphore( (HANDLE)semaphore, 1, NULL );
+}
+
+
+void Sys_WaitSemaphore( void* semaphore )
+{
+	WaitForSingleObject( (HANDLE)semaphore, INFINITE );
+}
+
+
+qbool Sys_WaitSemaphoreTimeout( void* semaphore, int ms )
+{
+	return WaitForSingleObject( (HANDLE)semaphore, (DWORD)ms ) == WAIT_OBJECT_0;
+}
+
+
 const char* Sys_Cwd()
 {
 	static char cwd[MAX_OSPATH];
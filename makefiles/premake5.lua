@@ -312,6 +312,8 @@ local function ApplyExeProjectSettings(exeName, server)
 	local server_sources =
 	{
 		"qcommon/cmd.cpp",
+		"qcommon/cm_cache.cpp",
+		"qcommon/cm_debug.cpp",
 		"qcommon/cm_load.cpp",
 		"qcommon/cm_patch.cpp",
 		"qcommon/cm_polylib.cpp",
@@ -329,11 +331,14 @@ local function ApplyExeProjectSettings(exeName, server)
 		"qcommon/msg.cpp",
 		"qcommon/net_chan.cpp",
 		"qcommon/net_ip.cpp",
+		"qcommon/prof.cpp",
 		"qcommon/q_math.c",
 		"qcommon/q_shared.c",
+		"qcommon/inflate.cpp",
 		"qcommon/unzip.cpp",
 		"qcommon/vm.cpp",
 		"qcommon/vm_interpreted.cpp",
+		"qcommon/vm_test.cpp",
 		"qcommon/vm_x86.cpp",
 		"server/sv_bot.cpp",
 		"server/sv_ccmds.cpp",
@@ -386,6 +391,8 @@ local function ApplyExeProjectSettings(exeName, server)
 		"client/snd_mem.cpp",
 		"client/snd_mix.cpp",
 		"qcommon/cmd.cpp",
+		"qcommon/cm_cache.cpp",
+		"qcommon/cm_debug.cpp",
 		"qcommon/cm_load.cpp",
 		"qcommon/cm_patch.cpp",
 		"qcommon/cm_polylib.cpp",
@@ -403,11 +410,14 @@ local function ApplyExeProjectSettings(exeName, server)
 		"qcommon/msg.cpp",
 		"qcommon/net_chan.cpp",
 		"qcommon/net_ip.cpp",
+		"qcommon/prof.cpp",
 		"qcommon/q_math.c",
 		"qcommon/q_shared.c",
+		"qcommon/inflate.cpp",
 		"qcommon/unzip.cpp",
 		"qcommon/vm.cpp",
 		"qcommon/vm_interpreted.cpp",
+		"qcommon/vm_test.cpp",
 		"qcommon/vm_x86.cpp",
 		"server/sv_bot.cpp",
 		"server/sv_ccmds.cpp",
@@ -511,7 +521,7 @@ local function ApplyExeProjectSettings(exeName, server)
 		end
 
 	filter "system:not windows"
-		links { "dl", "m" }
+		links { "dl", "m", "pthread" }
 		if (server == 0) then
 			links { "SDL2", "GL" }
 		end